@@ -0,0 +1,437 @@
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#if !defined(DWT) && (defined(__x86_64__) || defined(__i386__))
+# include <x86intrin.h>
+#endif
+#include "eh_utilities.h" // For ARRAY_SIZE
+#include "eh_data.h"
+#include "eh_codec.h"
+
+using namespace utest::v1;
+
+// These are benchmarks for the eh_codec and eh_data modules; they
+// check little, the functional tests being in unit_tests/codec and
+// unit_tests/data, but measure how long things take.  On target
+// time is counted in CPU cycles with the DWT cycle counter, on a
+// host with the time-stamp counter (or in nanoseconds where there is
+// none); the elapsed time comes from a Timer in both cases.
+//
+// Each result is printed on a line of its own, beginning "BENCH,",
+// as comma separated values in the order of the header line printed
+// first, so that the lines can be picked out of a log and compared
+// between builds:
+//
+// BENCH,benchmark,parameter,operations,cycles_per_operation,elapsed_us,bytes_per_second,extra
+//
+// ...where parameter is the data type or queue depth, as relevant,
+// bytes_per_second is zero where it has no meaning and extra depends
+// on the benchmark (see the PRIVATE FUNCTIONS below).
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "BENCH"
+
+// The number of data items of a type encoded per round.
+#define ENCODE_ITEMS_PER_ROUND 20
+
+// The number of rounds of encoding for each data type.
+#define ENCODE_ROUNDS 20
+
+// The number of random allocate/free operations in a workload.
+#define ALLOC_FREE_OPERATIONS 20000
+
+// The most data items held at once during a random workload.
+#define ALLOC_FREE_MAX_ITEMS 200
+
+// The number of times an ack message is decoded.
+#define DECODE_ROUNDS 10000
+
+// The name used in reports and acks.
+#define DEVICE_NAME "357520071700641"
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// Storage for data contents
+static DataContents gContents;
+
+// A data buffer
+static int gBuffer[DATA_MAX_SIZE_WORDS];
+
+// The data items held during a workload
+static Data *gpData[ALLOC_FREE_MAX_ITEMS];
+
+// The queue depths at which sorting is timed
+static const int gSortDepth[] = {10, 20, 50, 100, 200};
+
+// An encode buffer
+static char gEncodeBuf[CODEC_ENCODE_BUFFER_MIN_SIZE];
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// Start the cycle counter, where there is one to start.
+static void stampInit()
+{
+#ifdef DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+// Read a time-stamp: CPU cycles where available, else nanoseconds.
+static unsigned long long int stamp()
+{
+#if defined(DWT)
+    return DWT->CYCCNT;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long int) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// The cycles between two time-stamps; the DWT counter is 32 bits
+// wide and wraps in a little over a minute at 64 MHz so benchmarks
+// on target should sum short intervals rather than time long ones.
+static unsigned long long int cycles(unsigned long long int start,
+                                     unsigned long long int end)
+{
+#ifdef DWT
+    return (unsigned int) (end - start);
+#else
+    return end - start;
+#endif
+}
+
+// Print the header line.
+static void printHeader()
+{
+    printf("BENCH,benchmark,parameter,operations,cycles_per_operation,elapsed_us,bytes_per_second,extra\n");
+}
+
+// Print a result line.
+static void printResult(const char *pBenchmark, int parameter, unsigned int operations,
+                        unsigned long long int totalCycles, int elapsedUs,
+                        unsigned long long int bytes, int extra)
+{
+    unsigned long long int bytesPerSecond = 0;
+
+    if ((bytes > 0) && (elapsedUs > 0)) {
+        bytesPerSecond = bytes * 1000000 / elapsedUs;
+    }
+    printf("BENCH,%s,%d,%u,%llu,%d,%llu,%d\n", pBenchmark, parameter, operations,
+           (operations > 0) ? totalCycles / operations : 0, elapsedUs,
+           bytesPerSecond, extra);
+}
+
+// Fill in valid contents for a data type, as the codec tests do.
+static void fillContents(DataContents *pContents, DataType type)
+{
+    memset(pContents, 0xFF, sizeof(*pContents));
+    if (type == DATA_TYPE_BLE) {
+        strcpy(pContents->ble.name, "BLE-THING");
+    } else if (type == DATA_TYPE_LOG) {
+        pContents->log.numItems = ARRAY_SIZE(pContents->log.log);
+    } else if (type == DATA_TYPE_I2C_STATISTICS) {
+        pContents->i2cStatistics.numDevices = ARRAY_SIZE(pContents->i2cStatistics.device);
+    } else if (type == DATA_TYPE_LOG_PACKED) {
+        pContents->logPacked.numBytes = sizeof(pContents->logPacked.packed);
+    } else if (type == DATA_TYPE_HEAP_STATISTICS) {
+        pContents->heapStatistics.numFreeBlocks = ARRAY_SIZE(pContents->heapStatistics.freeBlock);
+    } else if (type == DATA_TYPE_WAKE_UP_REASON) {
+        pContents->wakeUpReason.reason = WAKE_UP_MAGNETIC;
+    }
+}
+
+// Return a randomly selected data type
+static DataType randomDataType()
+{
+    return (DataType) ((rand() % (MAX_NUM_DATA_TYPES - 1)) + 1); // -/+1 to avoid the NULL data type
+}
+
+// Run a random workload of ALLOC_FREE_OPERATIONS allocations and
+// frees against the data queue as it was last initialised, holding
+// at most ALLOC_FREE_MAX_ITEMS, and print the results.  For the
+// allocations extra is the number that failed; for the frees it is
+// the percentage of the bytes in use that held queued data at the
+// end, i.e. 100 less the fragmentation.
+static void allocFree(const char *pAllocName, const char *pFreeName)
+{
+    Action action;
+    Timer timer;
+    unsigned long long int start;
+    unsigned long long int allocCycles = 0;
+    unsigned long long int freeCycles = 0;
+    unsigned int numAllocs = 0;
+    unsigned int numFrees = 0;
+    int numFailures = 0;
+    int numItems = 0;
+    int percentQueued = 100;
+    DataType type;
+    int x;
+
+    memset(&action, 0, sizeof(action));
+    memset(gpData, 0, sizeof(gpData));
+    srand(1);
+
+    timer.start();
+    for (int y = 0; y < ALLOC_FREE_OPERATIONS; y++) {
+        // Allocate more often than free while the queue is less
+        // than half full, the other way around after that
+        if ((numItems == 0) ||
+            ((numItems < (int) ARRAY_SIZE(gpData)) &&
+             (rand() % ARRAY_SIZE(gpData) >= (unsigned int) numItems))) {
+            type = randomDataType();
+            fillContents(&gContents, type);
+            start = stamp();
+            gpData[numItems] = pDataAlloc(&action, type, 0, &gContents);
+            allocCycles += cycles(start, stamp());
+            numAllocs++;
+            if (gpData[numItems] != NULL) {
+                numItems++;
+            } else {
+                numFailures++;
+            }
+        } else {
+            x = rand() % numItems;
+            start = stamp();
+            dataFree(&(gpData[x]));
+            freeCycles += cycles(start, stamp());
+            numFrees++;
+            numItems--;
+            gpData[x] = gpData[numItems];
+            gpData[numItems] = NULL;
+        }
+    }
+    timer.stop();
+
+    if (dataGetBytesUsed() > 0) {
+        percentQueued = (int) (((unsigned long long int) dataGetBytesQueued()) * 100 /
+                               dataGetBytesUsed());
+    }
+    printResult(pAllocName, numItems, numAllocs, allocCycles, timer.read_us(), 0, numFailures);
+    printResult(pFreeName, numItems, numFrees, freeCycles, timer.read_us(), 0, percentQueued);
+
+    for (x = 0; x < numItems; x++) {
+        dataFree(&(gpData[x]));
+    }
+    TEST_ASSERT(dataCount() == 0);
+}
+
+// ----------------------------------------------------------------
+// BENCHMARKS
+// ----------------------------------------------------------------
+
+// Encoding, for each data type: extra is the number of reports.
+void test_encode() {
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+    Action action;
+    Timer timer;
+    unsigned long long int start;
+    unsigned long long int totalCycles;
+    unsigned long long int bytes;
+    unsigned int numItems;
+    int numReports;
+    int x;
+
+    tr_debug("Print something out as tr_debug seems to allocate from the heap when first called.\n");
+
+    dataInit(NULL);
+    mbed_stats_heap_get(&statsHeapBefore);
+
+    memset(&action, 0, sizeof(action));
+    printHeader();
+    for (int type = DATA_TYPE_NULL + 1; type < MAX_NUM_DATA_TYPES; type++) {
+        fillContents(&gContents, (DataType) type);
+        totalCycles = 0;
+        bytes = 0;
+        numItems = 0;
+        numReports = 0;
+        timer.reset();
+        for (int round = 0; round < ENCODE_ROUNDS; round++) {
+            for (x = 0; x < ENCODE_ITEMS_PER_ROUND; x++) {
+                TEST_ASSERT(pDataAlloc(&action, (DataType) type, 0, &gContents) != NULL);
+            }
+            // Only the encoding is timed, which includes freeing
+            // the items once encoded
+            timer.start();
+            start = stamp();
+            codecPrepareData();
+            while (CODEC_SIZE(x = codecEncodeData(DEVICE_NAME, gEncodeBuf,
+                                                  sizeof(gEncodeBuf), false)) > 0) {
+                bytes += CODEC_SIZE(x);
+                numReports++;
+            }
+            totalCycles += cycles(start, stamp());
+            timer.stop();
+            numItems += ENCODE_ITEMS_PER_ROUND;
+            TEST_ASSERT(dataCount() == 0);
+        }
+        printResult("encode", type, numItems, totalCycles, timer.read_us(), bytes, numReports);
+    }
+
+    mbed_stats_heap_get(&statsHeapAfter);
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
+// Allocating and freeing over a long random workload, from the heap
+// and from the internal data buffer.
+void test_alloc_free() {
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    dataInit(NULL);
+    mbed_stats_heap_get(&statsHeapBefore);
+    printHeader();
+    allocFree("alloc_heap", "free_heap");
+    mbed_stats_heap_get(&statsHeapAfter);
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+
+    dataInit(gBuffer);
+    allocFree("alloc_buffer", "free_buffer");
+    dataInit(NULL);
+}
+
+// Sorting versus queue depth: extra is the number of items in
+// the queue, which may fall short of the depth if memory ran out.
+void test_sort() {
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+    Action action;
+    Timer timer;
+    unsigned long long int start;
+    unsigned long long int totalCycles;
+    DataType type;
+    Data *pData;
+    int numItems;
+
+    dataInit(NULL);
+    mbed_stats_heap_get(&statsHeapBefore);
+
+    memset(&action, 0, sizeof(action));
+    srand(1);
+    printHeader();
+    for (unsigned int x = 0; x < ARRAY_SIZE(gSortDepth); x++) {
+        // Fill the queue with random types in random order
+        numItems = 0;
+        for (int y = 0; y < gSortDepth[x]; y++) {
+            type = randomDataType();
+            fillContents(&gContents, type);
+            if (pDataAlloc(&action, type, (rand() & 1) ? DATA_FLAG_REQUIRES_ACK : 0,
+                           &gContents) != NULL) {
+                numItems++;
+            }
+        }
+        timer.reset();
+        timer.start();
+        start = stamp();
+        pDataSort();
+        totalCycles = cycles(start, stamp());
+        timer.stop();
+        printResult("sort", gSortDepth[x], 1, totalCycles, timer.read_us(), 0, numItems);
+
+        // Empty the queue
+        while ((pData = pDataFirst()) != NULL) {
+            dataFree(&pData);
+        }
+        TEST_ASSERT(dataCount() == 0);
+    }
+
+    mbed_stats_heap_get(&statsHeapAfter);
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
+// Decoding an ack: extra is the index decoded.
+void test_decode_ack() {
+    char buf[64];
+    Timer timer;
+    unsigned long long int start;
+    unsigned long long int totalCycles = 0;
+    int index = 0;
+    int length;
+
+    length = sprintf(buf, "{\"n\":\"%s\",\"i\":2147483647}", DEVICE_NAME);
+    printHeader();
+    timer.start();
+    for (int x = 0; x < DECODE_ROUNDS; x++) {
+        start = stamp();
+        index = codecDecodeAck(buf, length, DEVICE_NAME);
+        totalCycles += cycles(start, stamp());
+    }
+    timer.stop();
+    TEST_ASSERT(index == 2147483647);
+    printResult("decode_ack", 0, DECODE_ROUNDS, totalCycles, timer.read_us(),
+                ((unsigned long long int) length) * DECODE_ROUNDS, index);
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout: sorting a deep queue takes
+    // a long time on target
+    GREENTEA_SETUP(600, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Encode", test_encode),
+    Case("Alloc and free", test_alloc_free),
+    Case("Sort", test_sort),
+    Case("Decode ack", test_decode_ack)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    stampInit();
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
@@ -233,6 +233,22 @@ void test_add() {
     TEST_ASSERT(gpAction[MAX_NUM_ACTIONS - 1]->state == ACTION_STATE_REQUESTED);
     TEST_ASSERT(gpAction[MAX_NUM_ACTIONS - 1]->type == MAX_NUM_ACTION_TYPES - 1);
     TEST_ASSERT(pActionAdd(ACTION_TYPE_NULL) == NULL);
+
+    // Set some of the actions to DEFERRED and check
+    // that they have not run and are re-used
+    tr_debug("Adding 2 more actions on top of DEFERRED ones.");
+    actionDeferred(gpAction[0]);
+    actionDeferred(gpAction[MAX_NUM_ACTIONS - 1]);
+    TEST_ASSERT(gpAction[0]->state == ACTION_STATE_DEFERRED);
+    TEST_ASSERT(!hasActionRun(gpAction[0]));
+    gpAction[0] = pActionAdd(ACTION_TYPE_NULL);
+    TEST_ASSERT(gpAction[0] != NULL);
+    TEST_ASSERT(gpAction[0]->state == ACTION_STATE_REQUESTED);
+    TEST_ASSERT(gpAction[0]->type == ACTION_TYPE_NULL);
+    gpAction[MAX_NUM_ACTIONS - 1] = pActionAdd(ACTION_TYPE_NULL);
+    TEST_ASSERT(gpAction[MAX_NUM_ACTIONS - 1] != NULL);
+    TEST_ASSERT(gpAction[MAX_NUM_ACTIONS - 1]->state == ACTION_STATE_REQUESTED);
+    TEST_ASSERT(pActionAdd(ACTION_TYPE_NULL) == NULL);
 }
 
 // Test of moving an action in the ranked list
@@ -231,6 +231,62 @@ void test_temperature() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
+// Test combined temperature/humidity/pressure reading
+void test_combined() {
+    int x = 0;
+    signed int cX100 = 0;
+    unsigned char percentage = 0;
+    unsigned int pascalX100 = 0;
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    tr_debug("Print something out with a float (%f) in it as tr_debug and floats allocate from the heap when first called.\n", 1.0);
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Instantiate I2C
+    i2cInit(I2C_DATA, I2C_CLOCK);
+
+    // Try to take a reading before initialisation - should fail
+    TEST_ASSERT(getTemperatureHumidityPressure(&cX100, &percentage, &pascalX100) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+
+    tr_debug("Initialising BME280...");
+    TEST_ASSERT(bme280Init(BME280_ADDRESS) == ACTION_DRIVER_OK);
+
+    // Get a combined reading 10 times
+    for (int y = 0; y < 10; y++) {
+        tr_debug("Reading temperature, humidity and pressure...");
+        x = getTemperatureHumidityPressure(&cX100, &percentage, &pascalX100);
+        tr_debug("Result of reading is %d.", x);
+        TEST_ASSERT(x == ACTION_DRIVER_OK);
+        tr_debug("Temperature is %.2f C, humidity is %d%%, pressure is %.2f Pa.",
+                 ((float) cX100) / 100, percentage, ((float) pascalX100) / 100);
+        // Range check
+        TEST_ASSERT(cX100 > -5000);
+        TEST_ASSERT(cX100 < 8500);
+        TEST_ASSERT(percentage <= 100);
+        TEST_ASSERT(pascalX100 > 50000);
+        TEST_ASSERT(pascalX100 < 150000);
+    }
+
+    // Repeat with null parameters
+    TEST_ASSERT(getTemperatureHumidityPressure(NULL, NULL, NULL) == ACTION_DRIVER_OK);
+
+    bme280Deinit();
+
+    // Shut down I2C
+    i2cDeinit();
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
 // ----------------------------------------------------------------
 // TEST ENVIRONMENT
 // ----------------------------------------------------------------
@@ -247,7 +303,8 @@ Case cases[] = {
     Case("Initialisation", test_init),
     Case("Get humidity", test_humidity),
     Case("Get pressure", test_pressure),
-    Case("Get temperature", test_temperature)
+    Case("Get temperature", test_temperature),
+    Case("Get temperature, humidity and pressure", test_combined)
 };
 
 Specification specification(test_setup, cases);
@@ -0,0 +1,190 @@
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#include "mbed.h"
+#include "eh_config.h"
+#include "eh_clock.h"
+
+using namespace utest::v1;
+
+// These are tests for the eh_clock module.
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "CLOCK"
+
+// A time at which the time is known: midnight UTC on 1st July 2018
+#define MIDNIGHT_UTC 1530403200
+
+// The rate at which the simulated clock loses time
+#define DRIFT_PPM 50
+
+// The number of days over which drift is simulated
+#define DRIFT_NUM_DAYS 10
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// ----------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------
+
+// Test retaining the time across a reset
+void test_retain() {
+    // Nothing retained: the clock starts at zero, not set
+    TEST_ASSERT_FALSE(clockInit());
+    TEST_ASSERT(time(NULL) < 2);
+    TEST_ASSERT(clockLastSetTime() == 0);
+
+    // Set the time, retain it and "reset"
+    clockSet(MIDNIGHT_UTC);
+    TEST_ASSERT(clockLastSetTime() == MIDNIGHT_UTC);
+    wait_ms(1000);
+    clockRetain();
+    set_time(0);
+
+    // The time, and when it was set, are restored
+    TEST_ASSERT(clockInit());
+    tr_debug("Restored time %d, set at %d.", (int) time(NULL), (int) clockLastSetTime());
+    TEST_ASSERT(time(NULL) >= MIDNIGHT_UTC + 1);
+    TEST_ASSERT(time(NULL) <= MIDNIGHT_UTC + 2);
+    TEST_ASSERT(clockLastSetTime() == MIDNIGHT_UTC);
+
+    // ...but only once
+    TEST_ASSERT_FALSE(clockInit());
+    TEST_ASSERT(time(NULL) < 2);
+    TEST_ASSERT(clockLastSetTime() == 0);
+
+    // The time lost over a reset is not learnt as drift
+    clockSet(MIDNIGHT_UTC);
+    set_time(MIDNIGHT_UTC + CLOCK_DRIFT_MIN_SAMPLE_SECONDS);
+    clockRetain();
+    set_time(0);
+    TEST_ASSERT(clockInit());
+    clockSet(MIDNIGHT_UTC + CLOCK_DRIFT_MIN_SAMPLE_SECONDS + 10);
+    TEST_ASSERT(clockDriftPpm(NULL) == 0);
+}
+
+// Test learning and correcting drift
+void test_drift() {
+    double clockSeconds = MIDNIGHT_UTC;
+    time_t realTime;
+    int driftSeconds;
+    int driftPpm;
+    int uncertaintyPpm;
+    int errorSeconds;
+    int numUpdates = 0;
+
+    // The time has never been set so it needs updating
+    clockInit();
+    TEST_ASSERT(clockUpdateNeeded());
+    TEST_ASSERT(clockPredictedErrorSeconds() == -1);
+    TEST_ASSERT(clockDriftSeconds() == 0);
+
+    // Run a clock that loses time, correcting it every hour
+    // and updating it at the end of the day if required
+    clockSet(MIDNIGHT_UTC);
+    for (int day = 1; day <= DRIFT_NUM_DAYS; day++) {
+        for (int hour = 0; hour < 24; hour++) {
+            clockSeconds += 3600.0 - (3600.0 * DRIFT_PPM / 1000000);
+            set_time((time_t) clockSeconds);
+            driftSeconds = clockDriftSeconds();
+            if (driftSeconds != 0) {
+                clockCorrect(time(NULL) + driftSeconds);
+                clockSeconds += driftSeconds;
+            }
+        }
+        realTime = MIDNIGHT_UTC + day * 3600 * 24;
+        errorSeconds = (int) (realTime - time(NULL));
+        tr_debug("Day %d: error %d second(s), predicted %d, drift %d ppm.",
+                 day, errorSeconds, clockPredictedErrorSeconds(), clockDriftPpm(NULL));
+        TEST_ASSERT(errorSeconds <= CLOCK_MAX_ERROR_SECONDS);
+        TEST_ASSERT(errorSeconds >= -CLOCK_MAX_ERROR_SECONDS);
+        if (clockUpdateNeeded()) {
+            // Until the drift is learnt that's every day
+            TEST_ASSERT((day > CLOCK_DRIFT_MIN_NUM_SAMPLES) ||
+                        (clockPredictedErrorSeconds() == -1));
+            clockSet(realTime);
+            clockSeconds = realTime;
+            numUpdates++;
+        }
+    }
+
+    // The drift has been learnt and fewer updates were needed
+    driftPpm = clockDriftPpm(&uncertaintyPpm);
+    tr_debug("%d update(s), drift %d ppm, uncertainty %d ppm.",
+             numUpdates, driftPpm, uncertaintyPpm);
+    TEST_ASSERT(driftPpm > DRIFT_PPM - 12);
+    TEST_ASSERT(driftPpm < DRIFT_PPM + 12);
+    TEST_ASSERT(uncertaintyPpm >= CLOCK_DRIFT_MIN_UNCERTAINTY_PPM);
+    TEST_ASSERT(numUpdates < DRIFT_NUM_DAYS);
+
+    // The drift survives a reset, even one where the
+    // time is not retained
+    TEST_ASSERT_FALSE(clockInit());
+    TEST_ASSERT(clockDriftPpm(NULL) == driftPpm);
+    TEST_ASSERT(clockUpdateNeeded());
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Retain", test_retain),
+    Case("Drift", test_drift)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
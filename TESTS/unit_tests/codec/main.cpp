@@ -76,9 +76,19 @@ static void createDataItem(DataContents *pContents, DataType type, char flags, A
     } else if (type == DATA_TYPE_LOG) {
         // Need a valid number of items
         pContents->log.numItems = ARRAY_SIZE(gContents.log.log);
+    } else if (type == DATA_TYPE_I2C_STATISTICS) {
+        // Need a valid number of devices
+        pContents->i2cStatistics.numDevices = ARRAY_SIZE(gContents.i2cStatistics.device);
+    } else if (type == DATA_TYPE_LOG_PACKED) {
+        // Need a valid number of bytes
+        pContents->logPacked.numBytes = sizeof(gContents.logPacked.packed);
+    } else if (type == DATA_TYPE_HEAP_STATISTICS) {
+        // Need a valid number of free blocks
+        pContents->heapStatistics.numFreeBlocks = ARRAY_SIZE(gContents.heapStatistics.freeBlock);
     } else if (type == DATA_TYPE_WAKE_UP_REASON) {
-        // Wake-up reason needs to be a valid one
-        pContents->wakeUpReason.reason = WAKE_UP_ACCELERATION;
+        // Wake-up reason needs to be a valid one, magnetic
+        // giving the longest encoding
+        pContents->wakeUpReason.reason = WAKE_UP_MAGNETIC;
     }
     TEST_ASSERT(pDataAlloc(pAction, type, flags, pContents) != NULL);
 }
@@ -92,7 +102,7 @@ static void fillBuf(char *pBuf, int len, const char *pString)
         x = len;
     }
 
-    memcpy(pBuf, pString, len);
+    memcpy(pBuf, pString, x);
     for (int y = x; y < len; y++) {
         *(pBuf + y) = rand();
     }
@@ -253,6 +263,10 @@ void test_rand() {
     pBuf = (char *) malloc(CODEC_ENCODE_BUFFER_MIN_SIZE);
     TEST_ASSERT (pBuf != NULL);
 
+    // Start from a clean action rather than whatever happens to be
+    // on the stack, which can make an item too big for the buffer
+    memset(&action, 0, sizeof(action));
+
     // Do random stuff 10 times
     for (z = 0; z < 10; z++) {
         // Fill up the data queue with random types, randomly requiring acks
@@ -376,6 +390,86 @@ void test_decode() {
     TEST_ASSERT(gBufferPost == BUFFER_GUARD);
 }
 
+// Test packing log entries
+void test_log_pack() {
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+    DataContents contents;
+    LogEntry entry;
+    const unsigned char expected[] = {0x03, 0x00, 0x00,             // event 3, +0 us, 0
+                                      0xc8, 0x01, 0xac, 0x02, 0x01, // event 200, +300 us (wrapping), -1
+                                      0x05, 0x20, 0xfe, 0xff, 0xff, 0xff, 0x0f}; // event 5, +32 us, 0x7fffffff
+    char buf[CODEC_ENCODE_BUFFER_MIN_SIZE];
+    int numBytes;
+    int x;
+
+    tr_debug("Print something out as tr_debug seems to allocate from the heap when first called.\n");
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Pack a few entries and check the result byte for byte
+    memset(&contents, 0, sizeof(contents));
+    entry.timestamp = 0xFFFFFED4;
+    entry.event = (LogEvent) 3;
+    entry.parameter = 0;
+    TEST_ASSERT(codecPackLogEntry(&contents.logPacked, &entry) == 3);
+    TEST_ASSERT(contents.logPacked.timestamp == 0xFFFFFED4);
+    entry.timestamp += 300; // Wraps
+    entry.event = (LogEvent) 200;
+    entry.parameter = -1;
+    TEST_ASSERT(codecPackLogEntry(&contents.logPacked, &entry) == 5);
+    entry.timestamp += 32;
+    entry.event = (LogEvent) 5;
+    entry.parameter = 0x7fffffff;
+    TEST_ASSERT(codecPackLogEntry(&contents.logPacked, &entry) == 7);
+    TEST_ASSERT(contents.logPacked.numItems == 3);
+    TEST_ASSERT(contents.logPacked.numBytes == sizeof(expected));
+    TEST_ASSERT(memcmp(contents.logPacked.packed, expected, sizeof(expected)) == 0);
+
+    // Fill it up: there must always be room for an entry while
+    // CODEC_LOG_PACKED_ENTRY_MAX_BYTES are left and, once an entry
+    // doesn't fit, nothing should change
+    entry.event = (LogEvent) 0x7fffffff;
+    entry.parameter = (int) 0x80000000;
+    do {
+        numBytes = contents.logPacked.numBytes;
+        entry.timestamp += 0x80000000;
+        x = codecPackLogEntry(&contents.logPacked, &entry);
+        if (sizeof(contents.logPacked.packed) - numBytes >= CODEC_LOG_PACKED_ENTRY_MAX_BYTES) {
+            TEST_ASSERT(x == CODEC_LOG_PACKED_ENTRY_MAX_BYTES);
+        }
+    } while (x > 0);
+    TEST_ASSERT(contents.logPacked.numBytes == numBytes);
+    TEST_ASSERT(contents.logPacked.numBytes <= sizeof(contents.logPacked.packed));
+
+    // Encode the first three entries and check the base64
+    memset(&contents, 0, sizeof(contents));
+    contents.logPacked.numBytes = sizeof(expected);
+    memcpy(contents.logPacked.packed, expected, sizeof(expected));
+    TEST_ASSERT(pDataAlloc(NULL, DATA_TYPE_LOG_PACKED, 0, &contents) != NULL);
+    codecPrepareData();
+    x = codecEncodeData("357520071700641", buf, sizeof(buf), false);
+    TEST_ASSERT(CODEC_SIZE(x) > 0);
+    TEST_ASSERT(CODEC_SIZE(x) < (int) sizeof(buf));
+    buf[CODEC_SIZE(x)] = 0;
+    tr_debug("Encoded packed log: |%s|\n", buf);
+    TEST_ASSERT(strstr(buf, "\"pk\":\"AwAAyAGsAgEFIP7///8P\"") != NULL);
+    TEST_ASSERT(dataCount() == 0);
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+
+    // Check that the guards are still good
+    TEST_ASSERT(gBufferPre == BUFFER_GUARD);
+    TEST_ASSERT(gBufferPost == BUFFER_GUARD);
+}
+
 // ----------------------------------------------------------------
 // TEST ENVIRONMENT
 // ----------------------------------------------------------------
@@ -392,7 +486,8 @@ Case cases[] = {
     Case("Print all data items", test_print_all_data_items),
     Case("Ack data", test_ack_data),
     Case("Random contents", test_rand),
-    Case("Decode", test_decode)
+    Case("Decode", test_decode),
+    Case("Log packing", test_log_pack)
 };
 
 Specification specification(test_setup, cases);
@@ -137,7 +137,7 @@ void test_alloc_free() {
         TEST_ASSERT((Data *) action.pData == pData);
         gpData[x] = pData;
         y++;
-        if (x % (rand() % 5) == 0) {
+        if (x % ((rand() % 5) + 1) == 0) {
             z = 0;
             if (x != 0) {
                 z = rand() % x;
@@ -184,6 +184,7 @@ void test_sort() {
     DataType dataType = (DataType) (DATA_TYPE_NULL + 1);
     unsigned int x = 0;
     unsigned int y = 0;
+    int sendNowCount = 0;
     Timer timer;
 
     tr_debug("Print something out with a float in it %f as tr_debug and float prints seems to allocate from the heap when first called.\n", 1.0);
@@ -207,12 +208,16 @@ void test_sort() {
     for (x = 0; (x < 500) && ((pThis = pDataAlloc(&action, dataType, flags, &gContents)) != NULL); x++) {
         TEST_ASSERT((Data *) action.pData == pThis);
         pThis->timeUTC = rand() & 0x7FFFFFFF;
+        if (flags & DATA_FLAG_SEND_NOW) {
+            sendNowCount++;
+        }
         action.type = randomActionType();
         dataType = randomDataType();
         flags = randomFlags();
     }
 
     tr_debug("%d data item(s) to sort.", x);
+    TEST_ASSERT(dataCountFlags(DATA_FLAG_SEND_NOW) == sendNowCount);
 
     // Sort the list and check that it is as expected
     tr_debug("Sorting this list, might take a while (if this test fails with TIMEOUT then try increasing the guard timer in GREENTEA_SETUP() below)...");
@@ -0,0 +1,192 @@
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#include "mbed.h"
+#include "eh_config.h"
+#include "eh_processor.h" // For PROCESSOR_POWER_IDLE_NW
+#include "eh_forecast.h"
+
+using namespace utest::v1;
+
+// These are tests for the eh_forecast module.
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "FORECAST"
+
+// A time at which the time is known: midnight UTC on 1st July 2018
+#define MIDNIGHT_UTC 1530403200
+
+// A harvest rate well above the idle power
+#define SUNNY_NW 500000
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// ----------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------
+
+// Test learning and forecasting
+void test_learning() {
+    int harvestNW;
+
+    forecastReset();
+
+    // Nothing learnt: no forecast, no reserve and the usual interval
+    TEST_ASSERT_FALSE(forecastHarvestNW(1, MIDNIGHT_UTC, &harvestNW));
+    TEST_ASSERT(harvestNW == 0);
+    TEST_ASSERT(forecastEnergyBudgetNWH(1, MIDNIGHT_UTC, 1000, PROCESSOR_POWER_IDLE_NW) == 1000);
+    TEST_ASSERT(forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC, 1000, 1000,
+                                              PROCESSOR_POWER_IDLE_NW) == WAKEUP_INTERVAL_SECONDS);
+
+    // Before the time is known only the any-time average is learnt
+    forecastUpdate(1, 1000, SUNNY_NW);
+    TEST_ASSERT(forecastHarvestNW(1, 1000, &harvestNW));
+    TEST_ASSERT(harvestNW == SUNNY_NW);
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC, &harvestNW));
+    TEST_ASSERT(harvestNW == SUNNY_NW);
+    TEST_ASSERT_FALSE(forecastHarvestNW(2, MIDNIGHT_UTC, &harvestNW));
+
+    // Learn a day: dark at night, sunny from 06:00 to 18:00
+    forecastReset();
+    for (int x = 0; x < 24; x++) {
+        forecastUpdate(1, MIDNIGHT_UTC + x * 3600,
+                       ((x >= 6) && (x < 18)) ? SUNNY_NW : 0);
+    }
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 12 * 3600 + 1800, &harvestNW));
+    TEST_ASSERT(harvestNW == SUNNY_NW);
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 3600 * 24 * 7 + 2 * 3600, &harvestNW));
+    TEST_ASSERT(harvestNW == 0);
+
+    // What has been learnt survives a re-initialisation, as it
+    // would a reset
+    TEST_ASSERT(forecastInit());
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 12 * 3600 + 1800, &harvestNW));
+    TEST_ASSERT(harvestNW == SUNNY_NW);
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 2 * 3600, &harvestNW));
+    TEST_ASSERT(harvestNW == 0);
+
+    // A dull day moves the forecast towards it, but not all the way
+    forecastUpdate(1, MIDNIGHT_UTC + 3600 * 24 + 12 * 3600, 0);
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 12 * 3600, &harvestNW));
+    tr_debug("Forecast at noon after a dull day %d nW.", harvestNW);
+    TEST_ASSERT(harvestNW > 0);
+    TEST_ASSERT(harvestNW < SUNNY_NW);
+
+    // Negative estimates are taken as zero
+    forecastUpdate(1, MIDNIGHT_UTC + 3 * 3600, -1000);
+    TEST_ASSERT(forecastHarvestNW(1, MIDNIGHT_UTC + 3 * 3600, &harvestNW));
+    TEST_ASSERT(harvestNW == 0);
+}
+
+// Test the energy budget and the wake-up interval
+void test_budget() {
+    unsigned long long int reserveNWH;
+    unsigned long long int energyNWH = 1000000;
+    int intervalSeconds;
+
+    forecastReset();
+    for (int x = 0; x < 24; x++) {
+        forecastUpdate(1, MIDNIGHT_UTC + x * 3600,
+                       ((x >= 6) && (x < 18)) ? SUNNY_NW : 0);
+    }
+
+    // In daylight there's no reserve
+    TEST_ASSERT(forecastEnergyBudgetNWH(1, MIDNIGHT_UTC + 12 * 3600, energyNWH,
+                                        PROCESSOR_POWER_IDLE_NW) == energyNWH);
+
+    // At 18:00 there's twelve hours of sleep to keep back
+    reserveNWH = 12ULL * PROCESSOR_POWER_IDLE_NW;
+    TEST_ASSERT(forecastEnergyBudgetNWH(1, MIDNIGHT_UTC + 18 * 3600, energyNWH,
+                                        PROCESSOR_POWER_IDLE_NW) == energyNWH - reserveNWH);
+    // ...and at 05:30 half an hour
+    reserveNWH = PROCESSOR_POWER_IDLE_NW / 2;
+    TEST_ASSERT(forecastEnergyBudgetNWH(1, MIDNIGHT_UTC + 5 * 3600 + 1800, energyNWH,
+                                        PROCESSOR_POWER_IDLE_NW) == energyNWH - reserveNWH);
+    // ...and the budget never goes below zero
+    TEST_ASSERT(forecastEnergyBudgetNWH(1, MIDNIGHT_UTC + 18 * 3600, 1000,
+                                        PROCESSOR_POWER_IDLE_NW) == 0);
+
+    // With nothing spare at night the device hibernates
+    TEST_ASSERT(forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC + 18 * 3600, 0, 10000,
+                                              PROCESSOR_POWER_IDLE_NW) == WAKEUP_INTERVAL_MAX_SECONDS);
+
+    // In sunshine it wakes up more often than it does in the dark
+    intervalSeconds = forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC + 12 * 3600, 0, 10000,
+                                                    PROCESSOR_POWER_IDLE_NW);
+    tr_debug("Wake-up interval in sunshine %d second(s).", intervalSeconds);
+    TEST_ASSERT(intervalSeconds >= WAKEUP_INTERVAL_MIN_SECONDS);
+    TEST_ASSERT(intervalSeconds < forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC + 18 * 3600,
+                                                                0, 10000,
+                                                                PROCESSOR_POWER_IDLE_NW));
+
+    // More stored energy, shorter interval, within the limits
+    TEST_ASSERT(forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC + 12 * 3600, energyNWH, 10000,
+                                              PROCESSOR_POWER_IDLE_NW) <= intervalSeconds);
+    TEST_ASSERT(forecastWakeUpIntervalSeconds(1, MIDNIGHT_UTC + 12 * 3600, energyNWH * 1000, 10000,
+                                              PROCESSOR_POWER_IDLE_NW) == WAKEUP_INTERVAL_MIN_SECONDS);
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Learning", test_learning),
+    Case("Budget", test_budget)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
@@ -0,0 +1,246 @@
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#include "mbed.h"
+#include "eh_heap.h"
+
+using namespace utest::v1;
+
+// These are tests for the eh_heap module.
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "HEAP"
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// Somewhere to put the statistics, kept off the stack
+static DataHeapStatistics gStatistics;
+
+// Semaphores to run the other thread of the measurement
+// test in step with the measurement
+static Semaphore gGoSemaphore(0);
+static Semaphore gDoneSemaphore(0);
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// The other thread of the measurement test: allocate while
+// a measurement is going on and free again afterwards.
+static void otherThread()
+{
+    void *pMemory;
+
+    gGoSemaphore.wait();
+    pMemory = pHeapMalloc(HEAP_SITE_OTHER, 1000);
+    gDoneSemaphore.release();
+    gGoSemaphore.wait();
+    heapFree(HEAP_SITE_OTHER, pMemory, 1000);
+    gDoneSemaphore.release();
+}
+
+// ----------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------
+
+// Test counting the use of the heap from each site
+void test_count() {
+    void *pMemory1;
+    void *pMemory2;
+    DataHeapSite *pBle = &(gStatistics.site[HEAP_SITE_BLE]);
+    DataHeapSite *pThread = &(gStatistics.site[HEAP_SITE_THREAD]);
+
+    // Start from nothing
+    heapGetStatistics(&gStatistics);
+
+    pMemory1 = pHeapMalloc(HEAP_SITE_BLE, 100);
+    TEST_ASSERT(pMemory1 != NULL);
+    pMemory2 = pHeapMalloc(HEAP_SITE_BLE, 200);
+    TEST_ASSERT(pMemory2 != NULL);
+    heapCountAlloc(HEAP_SITE_THREAD, 1000);
+    heapFree(HEAP_SITE_BLE, pMemory1, 100);
+
+    heapGetStatistics(&gStatistics);
+    tr_debug("BLE: %u allocation(s), %u byte(s), %u in use, peak %u.", pBle->numAllocs,
+             pBle->bytesAllocated, pBle->bytesInUse, pBle->peakBytesInUse);
+    TEST_ASSERT(pBle->numAllocs == 2);
+    TEST_ASSERT(pBle->bytesAllocated == 300);
+    TEST_ASSERT(pBle->bytesInUse == 200);
+    TEST_ASSERT(pBle->peakBytesInUse == 300);
+    TEST_ASSERT(pThread->numAllocs == 1);
+    TEST_ASSERT(pThread->bytesInUse == 1000);
+    TEST_ASSERT(gStatistics.site[HEAP_SITE_MODEM].numAllocs == 0);
+
+    // The counts since the last report are reset, what is
+    // in use is not
+    heapGetStatistics(&gStatistics);
+    TEST_ASSERT(pBle->numAllocs == 0);
+    TEST_ASSERT(pBle->bytesAllocated == 0);
+    TEST_ASSERT(pBle->bytesInUse == 200);
+    TEST_ASSERT(pBle->peakBytesInUse == 200);
+
+    heapFree(HEAP_SITE_BLE, pMemory2, 200);
+    heapCountFree(HEAP_SITE_THREAD, 1000);
+    heapGetStatistics(&gStatistics);
+    TEST_ASSERT(pBle->bytesInUse == 0);
+    TEST_ASSERT(pThread->bytesInUse == 0);
+}
+
+// Test measuring the heap taken by something that allocates
+// internally, with and without another thread allocating at
+// the same time
+void test_measure() {
+    HeapMeasure measure;
+    HeapMeasure measureNever;
+    Thread thread;
+    void *pMemory;
+    unsigned int bytes;
+    unsigned int bytesClean;
+    DataHeapSite *pModem = &(gStatistics.site[HEAP_SITE_MODEM]);
+
+    memset(&measure, 0, sizeof(measure));
+    memset(&measureNever, 0, sizeof(measureNever));
+    heapGetStatistics(&gStatistics);
+
+    // With nothing else going on, what is taken is measured
+    heapMeasureStart(&measure);
+    pMemory = malloc(500);
+    TEST_ASSERT(pMemory != NULL);
+    bytesClean = heapMeasureEnd(&measure, HEAP_SITE_MODEM, 100);
+    tr_debug("Measured %u byte(s) with nothing else going on.", bytesClean);
+    TEST_ASSERT(bytesClean >= 500);
+    TEST_ASSERT(bytesClean < 500 + 100);
+    free(pMemory);
+    heapCountFree(HEAP_SITE_MODEM, bytesClean);
+
+    // Another thread allocating during the measurement
+    // must not be put down to what is measured: the last
+    // good measurement is used instead...
+    TEST_ASSERT(thread.start(callback(otherThread)) == osOK);
+    heapMeasureStart(&measure);
+    heapMeasureStart(&measureNever);
+    pMemory = malloc(200);
+    TEST_ASSERT(pMemory != NULL);
+    gGoSemaphore.release();
+    gDoneSemaphore.wait();
+    bytes = heapMeasureEnd(&measure, HEAP_SITE_MODEM, 100);
+    tr_debug("Measured %u byte(s) with another thread allocating.", bytes);
+    TEST_ASSERT(bytes == bytesClean);
+    // ...or the lower bound if there has never been one
+    bytes = heapMeasureEnd(&measureNever, HEAP_SITE_MODEM, 100);
+    TEST_ASSERT(bytes == 100);
+    heapCountFree(HEAP_SITE_MODEM, bytesClean);
+    heapCountFree(HEAP_SITE_MODEM, 100);
+
+    // The same for the other thread freeing
+    heapMeasureStart(&measureNever);
+    gGoSemaphore.release();
+    gDoneSemaphore.wait();
+    bytes = heapMeasureEnd(&measureNever, HEAP_SITE_MODEM, 100);
+    TEST_ASSERT(bytes == 100);
+    heapCountFree(HEAP_SITE_MODEM, 100);
+    free(pMemory);
+    thread.join();
+
+    heapGetStatistics(&gStatistics);
+    TEST_ASSERT(pModem->numAllocs == 4);
+    TEST_ASSERT(pModem->bytesInUse == 0);
+}
+
+// Test finding the largest free block and taking the fragmentation map
+void test_map() {
+    unsigned int size;
+    void *pMemory;
+
+    // The largest free block can be allocated and
+    // the search is bounded
+    size = heapLargestFreeBlock(HEAP_PROBE_MAX_BYTES);
+    tr_debug("Largest free block %u byte(s).", size);
+    TEST_ASSERT(size <= HEAP_PROBE_MAX_BYTES);
+    pMemory = malloc(size);
+    TEST_ASSERT(pMemory != NULL);
+    free(pMemory);
+    TEST_ASSERT(heapLargestFreeBlock(1024) <= 1024);
+
+    // The map is largest first, all of it no smaller than
+    // HEAP_MAP_MIN_BLOCK_BYTES, and is reported
+    size = heapMap();
+    heapGetStatistics(&gStatistics);
+    TEST_ASSERT(gStatistics.numFreeBlocks > 0);
+    TEST_ASSERT(gStatistics.numFreeBlocks <= DATA_MAX_NUM_HEAP_FREE_BLOCKS);
+    TEST_ASSERT(gStatistics.freeBlock[0] == size);
+    for (unsigned int x = 0; x < gStatistics.numFreeBlocks; x++) {
+        tr_debug("Free block %d: %u byte(s).", x, gStatistics.freeBlock[x]);
+        TEST_ASSERT(gStatistics.freeBlock[x] >= HEAP_MAP_MIN_BLOCK_BYTES);
+        if (x > 0) {
+            TEST_ASSERT(gStatistics.freeBlock[x] <= gStatistics.freeBlock[x - 1]);
+        }
+    }
+
+    // Everything was given back
+    pMemory = malloc(size);
+    TEST_ASSERT(pMemory != NULL);
+    free(pMemory);
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Count", test_count),
+    Case("Measure", test_measure),
+    Case("Map", test_map)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
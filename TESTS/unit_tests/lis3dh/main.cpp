@@ -135,6 +135,76 @@ void test_reading() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
+// Test of reading the FIFO stream
+void test_stream() {
+    unsigned int numSamples = 0;
+    short xGX1000[LIS3DH_FIFO_SIZE];
+    short yGX1000[LIS3DH_FIFO_SIZE];
+    short zGX1000[LIS3DH_FIFO_SIZE];
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    tr_debug("Print something out as tr_debug seems to allocate from the heap when first called.\n");
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Instantiate I2C
+    i2cInit(I2C_DATA, I2C_CLOCK);
+
+    // Try to do things before initialisation - should fail
+    TEST_ASSERT(lis3dhSetFifoEnable(true) == ACTION_DRIVER_ERROR_NOT_INITIALISED);
+    TEST_ASSERT(getAccelerationStream(xGX1000, yGX1000, zGX1000, LIS3DH_FIFO_SIZE,
+                                      &numSamples) == ACTION_DRIVER_ERROR_NOT_INITIALISED);
+
+    tr_debug("Initialising LIS3DH...");
+    TEST_ASSERT(lis3dhInit(LIS3DH_ADDRESS) == ACTION_DRIVER_OK);
+
+    // Without the FIFO there should be a single sample
+    TEST_ASSERT(getAccelerationStream(xGX1000, yGX1000, zGX1000, LIS3DH_FIFO_SIZE,
+                                      &numSamples) == ACTION_DRIVER_OK);
+    TEST_ASSERT(numSamples == 1);
+
+    // Enable the FIFO and wait for a few samples to be
+    // buffered (the data rate is 1 Hz)
+    TEST_ASSERT(lis3dhSetFifoEnable(true) == ACTION_DRIVER_OK);
+    wait_ms(4500);
+    TEST_ASSERT(getAccelerationStream(xGX1000, yGX1000, zGX1000, LIS3DH_FIFO_SIZE,
+                                      &numSamples) == ACTION_DRIVER_OK);
+    tr_debug("%d sample(s) read from the FIFO.", numSamples);
+    TEST_ASSERT(numSamples >= 3);
+    TEST_ASSERT(numSamples <= 5);
+    for (unsigned int x = 0; x < numSamples; x++) {
+        tr_debug("Sample %d is x: %d, y: %d, z: %d.", x, xGX1000[x], yGX1000[x], zGX1000[x]);
+    }
+
+    // Having been drained, the FIFO should now be (near enough) empty
+    TEST_ASSERT(getAccelerationStream(xGX1000, yGX1000, zGX1000, LIS3DH_FIFO_SIZE,
+                                      &numSamples) == ACTION_DRIVER_OK);
+    TEST_ASSERT(numSamples <= 1);
+
+    // Check that no more than maxSamples are returned
+    wait_ms(3500);
+    TEST_ASSERT(getAccelerationStream(xGX1000, yGX1000, zGX1000, 2,
+                                      &numSamples) == ACTION_DRIVER_OK);
+    TEST_ASSERT(numSamples == 2);
+
+    TEST_ASSERT(lis3dhSetFifoEnable(false) == ACTION_DRIVER_OK);
+
+    lis3dhDeinit();
+
+    // Shut down I2C
+    i2cDeinit();
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
 // Test of setting device sensitivity
 void test_sensitivity() {
     int x = 0;
@@ -366,6 +436,7 @@ utest::v1::status_t test_setup(const size_t number_of_cases) {
 Case cases[] = {
     Case("Initialisation", test_init),
     Case("Get acceleration", test_reading),
+    Case("Get acceleration stream", test_stream),
     Case("Sensitivity setting", test_sensitivity),
     Case("Interrupt setting", test_interrupt)
 };
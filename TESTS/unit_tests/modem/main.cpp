@@ -65,6 +65,15 @@ static Data *pCreateDataItem(DataContents *pContents, DataType type, char flags,
     } else if (type == DATA_TYPE_LOG) {
         // Need a valid number of items
         pContents->log.numItems = ARRAY_SIZE(gContents.log.log);
+    } else if (type == DATA_TYPE_I2C_STATISTICS) {
+        // Need a valid number of devices
+        pContents->i2cStatistics.numDevices = ARRAY_SIZE(gContents.i2cStatistics.device);
+    } else if (type == DATA_TYPE_LOG_PACKED) {
+        // Need a valid number of bytes
+        pContents->logPacked.numBytes = sizeof(gContents.logPacked.packed);
+    } else if (type == DATA_TYPE_HEAP_STATISTICS) {
+        // Need a valid number of free blocks
+        pContents->heapStatistics.numFreeBlocks = ARRAY_SIZE(gContents.heapStatistics.freeBlock);
     } else if (type == DATA_TYPE_WAKE_UP_REASON) {
         // Wake-up reason needs to be a valid one
         pContents->wakeUpReason.reason = WAKE_UP_ACCELERATION;
@@ -412,6 +421,98 @@ void test_send_reports() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
+// Test that the modem energy model converges on measurements
+void test_energy_calibration() {
+    unsigned int bytes;
+    bool fromOff;
+    unsigned long long int energyNWH;
+    unsigned long long int expectedNWH;
+
+    // The model only becomes active once the modem type is known
+    TEST_ASSERT(modemInit(SIM_PIN, APN, USERNAME, PASSWORD) == ACTION_DRIVER_OK)
+    modemDeinit();
+
+    modemEnergyCalibrationReset();
+    TEST_ASSERT(modemEnergyCalibrationCount() == 0);
+
+    // Feed in measurements of a modem that costs 300 uWh
+    // per session, 200 uWh to register and 50 nWh per byte
+    for (unsigned int x = 0; x < 100; x++) {
+        fromOff = ((x % 3) == 0);
+        bytes = (x * 97) % 2000;
+        energyNWH = 300000 + (fromOff ? 200000 : 0) + bytes * 50;
+        modemEnergyCalibrate(fromOff, bytes, energyNWH);
+    }
+    TEST_ASSERT(modemEnergyCalibrationCount() == 100);
+
+    // The registration case should now be within 10% of the truth
+    expectedNWH = 300000 + 200000 + 1000 * 50;
+    energyNWH = modemEnergyNWH(0, 1000);
+    tr_debug("Model gives %d nWh, expected %d nWh.", (int) energyNWH, (int) expectedNWH);
+    TEST_ASSERT(energyNWH > expectedNWH - expectedNWH / 10);
+    TEST_ASSERT(energyNWH < expectedNWH + expectedNWH / 10);
+
+    // Put things back as they were
+    modemEnergyCalibrationReset();
+    TEST_ASSERT(modemEnergyCalibrationCount() == 0);
+}
+
+// Test that the modem energy model is not thrown by sessions too
+// small to measure well, some of which come out negative
+void test_energy_calibration_noise() {
+    unsigned int bytes;
+    bool fromOff;
+    long long int energyNWH;
+    unsigned long long int modelNWH;
+    unsigned long long int expectedNWH;
+    unsigned int numNegative = 0;
+
+    // The model only becomes active once the modem type is known
+    TEST_ASSERT(modemInit(SIM_PIN, APN, USERNAME, PASSWORD) == ACTION_DRIVER_OK)
+    modemDeinit();
+
+    modemEnergyCalibrationReset();
+
+    // Feed in measurements of a modem that costs just 30 uWh
+    // per session, 200 uWh to register and 50 nWh per byte,
+    // each session measured twice, 40 uWh high and 40 uWh low
+    for (unsigned int x = 0; x < 300; x++) {
+        fromOff = (((x / 2) % 3) == 0);
+        bytes = ((x / 2) * 97) % 2000;
+        energyNWH = 30000 + (fromOff ? 200000 : 0) + bytes * 50;
+        if (x % 2) {
+            energyNWH += 40000;
+        } else {
+            energyNWH -= 40000;
+        }
+        if (energyNWH < 0) {
+            numNegative++;
+        }
+        modemEnergyCalibrate(fromOff, bytes, energyNWH);
+    }
+    tr_debug("%d measurement(s) were negative.", numNegative);
+    TEST_ASSERT(numNegative > 0);
+    TEST_ASSERT(modemEnergyCalibrationCount() == 300);
+
+    // The registration case should be within 10% of the truth
+    expectedNWH = 30000 + 200000 + 1000 * 50;
+    modelNWH = modemEnergyNWH(0, 1000);
+    tr_debug("Model gives %d nWh, expected %d nWh.", (int) modelNWH, (int) expectedNWH);
+    TEST_ASSERT(modelNWH > expectedNWH - expectedNWH / 10);
+    TEST_ASSERT(modelNWH < expectedNWH + expectedNWH / 10);
+
+    // ...and the smallest session should have been brought down
+    // from the compile-time constants close to the truth
+    modelNWH = modemEnergyNWH(1, 0);
+    tr_debug("Model gives %d nWh for an empty session, expected around 30000 nWh.",
+             (int) modelNWH);
+    TEST_ASSERT(modelNWH < 60000);
+
+    // Put things back as they were
+    modemEnergyCalibrationReset();
+    TEST_ASSERT(modemEnergyCalibrationCount() == 0);
+}
+
 // ----------------------------------------------------------------
 // TEST ENVIRONMENT
 // ----------------------------------------------------------------
@@ -431,7 +532,9 @@ Case cases[] = {
     Case("Get RX signal strengths", test_get_rx_signal_strengths),
     Case("Get TX signal strength", test_get_tx_signal_strength),
     Case("Get channel", test_get_channel),
-    Case("Send reports", test_send_reports)
+    Case("Send reports", test_send_reports),
+    Case("Energy calibration", test_energy_calibration),
+    Case("Energy calibration with noise", test_energy_calibration_noise)
 };
 
 Specification specification(test_setup, cases);
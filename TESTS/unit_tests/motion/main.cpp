@@ -0,0 +1,147 @@
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#include "mbed.h"
+#include "eh_utilities.h" // for ARRAY_SIZE
+#include "eh_data.h"
+#include "eh_motion.h"
+
+using namespace utest::v1;
+
+// These are tests for the eh_motion module.
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "MOTION"
+
+// The number of samples to use in each test
+#define NUM_SAMPLES 32
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// Sample storage
+static short gXGX1000[NUM_SAMPLES];
+static short gYGX1000[NUM_SAMPLES];
+static short gZGX1000[NUM_SAMPLES];
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// Print out a set of motion features
+static void printMotion(const DataMotion *pMotion)
+{
+    tr_debug("RMS %u, peak %u, %u sample(s), dominant axis %u, activity %u.",
+             pMotion->rmsGX1000, pMotion->peakGX1000, pMotion->numSamples,
+             pMotion->dominantAxis, pMotion->activity);
+}
+
+// ----------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------
+
+// Test feature extraction
+void test_features() {
+    DataMotion motion;
+
+    // No samples should give all zeros
+    memset(&motion, 0xFF, sizeof(motion));
+    motionExtractFeatures(gXGX1000, gYGX1000, gZGX1000, 0, &motion);
+    TEST_ASSERT(motion.numSamples == 0);
+    TEST_ASSERT(motion.rmsGX1000 == 0);
+    TEST_ASSERT(motion.peakGX1000 == 0);
+
+    // Lying flat and still: gravity only, on z
+    for (unsigned int x = 0; x < ARRAY_SIZE(gXGX1000); x++) {
+        gXGX1000[x] = 0;
+        gYGX1000[x] = 0;
+        gZGX1000[x] = 1000;
+    }
+    motionExtractFeatures(gXGX1000, gYGX1000, gZGX1000, NUM_SAMPLES, &motion);
+    printMotion(&motion);
+    TEST_ASSERT(motion.numSamples == NUM_SAMPLES);
+    TEST_ASSERT(motion.rmsGX1000 == 0);
+    TEST_ASSERT(motion.peakGX1000 == 0);
+    TEST_ASSERT(motion.activity == MOTION_ACTIVITY_STILL);
+
+    // Gentle back and forth motion on y, +/- 200 mg
+    for (unsigned int x = 0; x < ARRAY_SIZE(gYGX1000); x++) {
+        gYGX1000[x] = (x & 1) ? 200 : -200;
+    }
+    motionExtractFeatures(gXGX1000, gYGX1000, gZGX1000, NUM_SAMPLES, &motion);
+    printMotion(&motion);
+    TEST_ASSERT(motion.rmsGX1000 == 200);
+    TEST_ASSERT(motion.peakGX1000 == 200);
+    TEST_ASSERT(motion.dominantAxis == 1);
+    TEST_ASSERT(motion.activity == MOTION_ACTIVITY_MOVING);
+
+    // A single big knock on x
+    for (unsigned int x = 0; x < ARRAY_SIZE(gYGX1000); x++) {
+        gYGX1000[x] = 0;
+    }
+    gXGX1000[NUM_SAMPLES / 2] = 3200;
+    motionExtractFeatures(gXGX1000, gYGX1000, gZGX1000, NUM_SAMPLES, &motion);
+    printMotion(&motion);
+    TEST_ASSERT(motion.peakGX1000 >= MOTION_VIGOROUS_PEAK_GX1000);
+    TEST_ASSERT(motion.dominantAxis == 0);
+    TEST_ASSERT(motion.activity == MOTION_ACTIVITY_VIGOROUS);
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Features", test_features)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
@@ -7,6 +7,7 @@
 #include "eh_post.h"
 #include "eh_data.h"
 #include "eh_processor.h"
+#include "eh_statistics.h"
 #include "eh_utilities.h" // for ARRAY_SIZE()
 #include "act_si7210.h" // For si7210Deinit()
 #include "act_lis3dh.h" // For lis3dhDeinit()
@@ -87,7 +88,13 @@ static ActionType gDataToAction[] = {ACTION_TYPE_NULL, /* DATA_TYPE_NULL */
                                      ACTION_TYPE_NULL, /* DATA_TYPE_WAKE_UP_REASON */
                                      ACTION_TYPE_NULL, /* DATA_TYPE_ENERGY_SOURCE */
                                      ACTION_TYPE_NULL, /* DATA_TYPE_STATISTICS */
-                                     ACTION_TYPE_NULL /* DATA_TYPE_LOG */};
+                                     ACTION_TYPE_NULL, /* DATA_TYPE_LOG */
+                                     ACTION_TYPE_NULL, /* DATA_TYPE_VOLTAGES */
+                                     ACTION_TYPE_MEASURE_ACCELERATION, /* DATA_TYPE_MOTION */
+                                     ACTION_TYPE_NULL, /* DATA_TYPE_I2C_STATISTICS */
+                                     ACTION_TYPE_NULL, /* DATA_TYPE_ACTION_STATISTICS */
+                                     ACTION_TYPE_NULL, /* DATA_TYPE_LOG_PACKED */
+                                     ACTION_TYPE_NULL /* DATA_TYPE_HEAP_STATISTICS */};
 
 // ----------------------------------------------------------------
 // PRIVATE FUNCTIONS
@@ -163,6 +170,29 @@ static void rangeCheckData(Data *pData)
                      pData->contents.ble.batteryPercentage);
             TEST_ASSERT(pData->contents.ble.batteryPercentage <= 100);
         break;
+        case DATA_TYPE_MOTION:
+            tr_debug("MOTION: RMS: %u, peak: %u, %u sample(s), dominant axis %u, activity %u.",
+                     pData->contents.motion.rmsGX1000, pData->contents.motion.peakGX1000,
+                     pData->contents.motion.numSamples, pData->contents.motion.dominantAxis,
+                     pData->contents.motion.activity);
+            TEST_ASSERT(pData->contents.motion.numSamples <= LIS3DH_FIFO_SIZE);
+            TEST_ASSERT(pData->contents.motion.dominantAxis <= 2);
+            TEST_ASSERT(pData->contents.motion.activity < MAX_NUM_MOTION_ACTIVITIES);
+        break;
+        case DATA_TYPE_I2C_STATISTICS:
+            tr_debug("I2C STATISTICS: %u device(s).", pData->contents.i2cStatistics.numDevices);
+            TEST_ASSERT(pData->contents.i2cStatistics.numDevices <= DATA_MAX_NUM_I2C_DEVICES);
+        break;
+        case DATA_TYPE_ACTION_STATISTICS:
+            tr_debug("ACTION STATISTICS: action %d, %u completed, %u failed, %u aborted, %u deferred, waited %u ms.",
+                     pData->contents.actionStatistics.actionType,
+                     pData->contents.actionStatistics.numCompleted,
+                     pData->contents.actionStatistics.numFailed,
+                     pData->contents.actionStatistics.numAborted,
+                     pData->contents.actionStatistics.numDeferred,
+                     pData->contents.actionStatistics.mutexWaitMs);
+            TEST_ASSERT(pData->contents.actionStatistics.actionType < MAX_NUM_ACTION_TYPES);
+        break;
         default:
             tr_debug("UNHANDLED DATA TYPE (%d).", pData->type);
         break;
@@ -225,6 +255,7 @@ void test_readings() {
     int numExpected = 0;
     Desirability d[MAX_NUM_ACTION_TYPES];
     Timer timer;
+    DataI2cStatistics i2cStatistics;
 
     tr_debug("Print something with a float in it (%f) as that seems to allocate from the heap when first called.\n", 1.0);
 
@@ -261,6 +292,20 @@ void test_readings() {
     timer.stop();
     tr_debug("That took %.3f seconds.", (float) timer.read_ms() / 1000);
 
+    // Each device should have seen traffic on the I2C bus
+    statisticsGetI2c(&i2cStatistics);
+    TEST_ASSERT(i2cStatistics.numDevices > 0);
+    for (unsigned int x = 0; x < i2cStatistics.numDevices; x++) {
+        tr_debug("I2C 0x%02x: %u transaction(s), %u byte(s), %u error(s), %u retry(s), bus %u ms, wait %u ms.",
+                 i2cStatistics.device[x].i2cAddress, i2cStatistics.device[x].transactions,
+                 i2cStatistics.device[x].bytes, i2cStatistics.device[x].errors,
+                 i2cStatistics.device[x].retries, i2cStatistics.device[x].busTimeMs,
+                 i2cStatistics.device[x].waitTimeMs);
+        TEST_ASSERT(i2cStatistics.device[x].transactions > 0);
+        TEST_ASSERT(i2cStatistics.device[x].errors <= i2cStatistics.device[x].transactions);
+        TEST_ASSERT(i2cStatistics.device[x].retries <= i2cStatistics.device[x].errors);
+    }
+
     // When done, there should be a data item in the queue for each
     // of the expected action types and none for the non-expected
     // action types
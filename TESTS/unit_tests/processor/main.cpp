@@ -7,6 +7,8 @@
 #include "eh_data.h"
 #include "eh_action.h"
 #include "eh_processor.h"
+#include "eh_statistics.h"
+#include "eh_utilities.h"
 
 using namespace utest::v1;
 
@@ -81,6 +83,8 @@ void test_tasking_no_termination() {
     mbed_stats_heap_t statsHeapAfter;
     Data *pData;
     Thread *pProcessorThread;
+    DataActionStatistics actionStatistics;
+    unsigned int numTimed;
 
     tr_debug("Print something out as tr_debug seems to allocate from the heap when first called.\n");
 
@@ -93,6 +97,7 @@ void test_tasking_no_termination() {
     // Initialise things
     actionInit();
     processorInit();
+    statisticsInit();
 
     // Set the callback for thread diagnostics and fake that power is good
     processorSetThreadDiagnosticsCallback(&threadDiagosticsCallback);
@@ -119,6 +124,26 @@ void test_tasking_no_termination() {
          x < MAX_NUM_SIMULTANEOUS_ACTIONS + ACTION_TYPE_MEASURE_HUMIDITY; x++) {
         tr_debug("Action type %d was called %d time(s).\n", x, gActionCallbackCount[x]);
         TEST_ASSERT(gActionCallbackCount[x] > 0);
+        // None of them will have got as far as running so they
+        // should all have been counted as aborted, each taking
+        // at least one wait in the thread loop
+        TEST_ASSERT(statisticsGetAction((ActionType) x, &actionStatistics));
+        TEST_ASSERT(actionStatistics.actionType == x);
+        TEST_ASSERT(actionStatistics.numCompleted == 0);
+        TEST_ASSERT(actionStatistics.numFailed == 0);
+        TEST_ASSERT(actionStatistics.numAborted > 0);
+        TEST_ASSERT(actionStatistics.numDeferred == 0);
+        numTimed = 0;
+        for (unsigned int y = 0; y < ARRAY_SIZE(actionStatistics.timeHistogram); y++) {
+            // The first two buckets end below THREAD_ACTION_WAIT_TIME_MS
+            if (y < 2) {
+                TEST_ASSERT(actionStatistics.timeHistogram[y] == 0);
+            }
+            numTimed += actionStatistics.timeHistogram[y];
+        }
+        TEST_ASSERT(numTimed == actionStatistics.numAborted);
+        // Getting them again should find nothing new
+        TEST_ASSERT(!statisticsGetAction((ActionType) x, &actionStatistics));
     }
 
     // Should be no actions outstanding
@@ -38,10 +38,20 @@ using namespace utest::v1;
 // Lock for debug prints
 static Mutex gMtx;
 
+// Count of measurement completion callbacks
+static volatile int gCallbackCount = 0;
+
 // ----------------------------------------------------------------
 // PRIVATE FUNCTIONS
 // ----------------------------------------------------------------
 
+// Callback for the end of a measurement
+static void groupCallback(void *pParam)
+{
+    TEST_ASSERT(pParam == &gCallbackCount);
+    gCallbackCount++;
+}
+
 #ifdef MBED_CONF_MBED_TRACE_ENABLE
 // Locks for debug prints
 static void lock()
@@ -148,7 +158,70 @@ void test_reading() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
-// TODO: test interrupt in
+// Test of measuring all channels in one go with a completion callback
+void test_group() {
+    int x = 0;
+    Si1133Group group;
+    Timer timer;
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Instantiate I2C
+    i2cInit(I2C_DATA, I2C_CLOCK);
+
+    // Try to start a measurement before initialisation - should fail
+    TEST_ASSERT(si1133StartGroup(NULL, NULL) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+    TEST_ASSERT(si1133ReadGroup(&group) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+
+    tr_debug("Initialising SI1133...");
+    TEST_ASSERT(si1133Init(SI1133_ADDRESS) == ACTION_DRIVER_OK);
+    tr_debug("A measurement should take %d us.", si1133GetConversionTimeUs());
+    TEST_ASSERT(si1133GetConversionTimeUs() > 0);
+    TEST_ASSERT(si1133GetConversionTimeUs() < SI1133_WAIT_FOR_READING_MS * 1000);
+
+    // Nothing has been measured yet
+    TEST_ASSERT(si1133ReadGroup(&group) == ACTION_DRIVER_ERROR_NO_DATA);
+
+    // Start a measurement and wait for the callback
+    gCallbackCount = 0;
+    timer.start();
+    TEST_ASSERT(si1133StartGroup(groupCallback, (void *) &gCallbackCount) == ACTION_DRIVER_OK);
+    while ((gCallbackCount == 0) && (timer.read_ms() < SI1133_WAIT_FOR_READING_MS)) {
+        wait_ms(1);
+    }
+    timer.stop();
+    tr_debug("Callback after %d ms.", timer.read_ms());
+    TEST_ASSERT(gCallbackCount == 1);
+
+    // Read all the channels
+    x = si1133ReadGroup(&group);
+    tr_debug("Result of reading SI1133 is %d.", x);
+    TEST_ASSERT(x == ACTION_DRIVER_OK);
+    tr_debug("UV %d, visible %d/%d, IR %d: lux %d, UV index %.3f.",
+             group.uv, group.visibleHigh, group.visibleLow, group.ir,
+             group.lux, ((float) group.uvIndexX1000) / 1000);
+    TEST_ASSERT(group.lux >= 0);
+    TEST_ASSERT(group.uvIndexX1000 >= 0);
+
+    // Reading the results clears them
+    TEST_ASSERT(si1133ReadGroup(NULL) == ACTION_DRIVER_ERROR_NO_DATA);
+
+    si1133Deinit();
+
+    // Shut down I2C
+    i2cDeinit();
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
 
 // ----------------------------------------------------------------
 // TEST ENVIRONMENT
@@ -164,7 +237,8 @@ utest::v1::status_t test_setup(const size_t number_of_cases) {
 // Test cases
 Case cases[] = {
     Case("Initialisation", test_init),
-    Case("Get UV/light readings", test_reading)
+    Case("Get UV/light readings", test_reading),
+    Case("Measurement group", test_group)
 };
 
 Specification specification(test_setup, cases);
@@ -378,6 +378,75 @@ void test_interrupt() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
+// Test of setting up the filter and tamper threshold
+void test_filter() {
+    int x = 0;
+    unsigned int teslaX1000;
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Instantiate I2C
+    i2cInit(I2C_DATA, I2C_CLOCK);
+
+    // Try to set things up before initialisation - should fail
+    TEST_ASSERT(si7210SetFilter(SI7210_FILTER_IIR, 2, 0) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+    TEST_ASSERT(si7210SetTamper(0) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+
+    tr_debug("Initialising SI7210...");
+    TEST_ASSERT(si7210Init(SI7210_ADDRESS) == ACTION_DRIVER_OK);
+
+    // Try both filters, including out of range values which
+    // should be limited, and check that readings still arrive
+    for (x = 0; x < 4; x++) {
+        tr_debug("Set filter %d...", x);
+        switch (x) {
+            case 0:
+                TEST_ASSERT(si7210SetFilter(SI7210_FILTER_FIR, 0, 0) == ACTION_DRIVER_OK);
+            break;
+            case 1:
+                TEST_ASSERT(si7210SetFilter(SI7210_FILTER_FIR, SI7210_MAX_FILTER_BANDWIDTH + 1,
+                                            SI7210_MAX_BURST_SIZE + 1) == ACTION_DRIVER_OK);
+            break;
+            case 2:
+                TEST_ASSERT(si7210SetFilter(SI7210_FILTER_IIR, SI7210_MAX_FILTER_BANDWIDTH,
+                                            SI7210_MAX_BURST_SIZE) == ACTION_DRIVER_OK);
+            break;
+            default:
+                TEST_ASSERT(si7210SetFilter(SI7210_FILTER_IIR, 2, 0) == ACTION_DRIVER_OK);
+            break;
+        }
+        Thread::wait(SI7210_WAIT_FOR_FIRST_MEASUREMENT_MS);
+        TEST_ASSERT(getFieldStrength(&teslaX1000) == ACTION_DRIVER_OK);
+        tr_debug("Field strength %.3f.", ((float) teslaX1000) / 1000);
+        TEST_ASSERT(teslaX1000 < 1000);
+    }
+
+    // Set the tamper threshold, limits included, and switch it off again
+    TEST_ASSERT(si7210SetTamper(1) == ACTION_DRIVER_OK);
+    TEST_ASSERT(si7210SetTamper(10000) == ACTION_DRIVER_OK);
+    TEST_ASSERT(si7210SetTamper(100000) == ACTION_DRIVER_OK);
+    TEST_ASSERT(si7210SetTamper(0) == ACTION_DRIVER_OK);
+
+    // Check that the interrupt settings were not disturbed
+    TEST_ASSERT(si7210GetInterrupt(NULL, NULL, NULL) == ACTION_DRIVER_OK);
+
+    si7210Deinit();
+
+    // Shut down I2C
+    i2cDeinit();
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
 // ----------------------------------------------------------------
 // TEST ENVIRONMENT
 // ----------------------------------------------------------------
@@ -394,7 +463,8 @@ Case cases[] = {
     Case("Initialisation", test_init),
     Case("Get field strength reading", test_reading),
     Case("Change range", test_range),
-    Case("Interrupt setting", test_interrupt)
+    Case("Interrupt setting", test_interrupt),
+    Case("Filter and tamper setting", test_filter)
 };
 
 Specification specification(test_setup, cases);
@@ -0,0 +1,336 @@
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+#include "mbed_trace.h"
+#include "mbed.h"
+#include "eh_ubx.h"
+
+using namespace utest::v1;
+
+// These are tests for the eh_ubx module.
+//
+// ----------------------------------------------------------------
+// COMPILE-TIME MACROS
+// ----------------------------------------------------------------
+
+#define TRACE_GROUP "UBX"
+
+// The number of frames to push through the parser when checking
+// that it copes with the ring buffer wrapping
+#define NUM_FRAMES 50
+
+// ----------------------------------------------------------------
+// PRIVATE VARIABLES
+// ----------------------------------------------------------------
+
+// Lock for debug prints
+static Mutex gMtx;
+
+// The parser, static as it is quite large
+static UbxParser gParser;
+
+// Storage for a NAV-PVT frame
+static char gNavPvt[UBX_NAV_PVT_LENGTH + UBX_OVERHEAD_SIZE];
+
+// Storage for a NAV-TIMEUTC frame
+static char gNavTimeUtc[UBX_NAV_TIMEUTC_LENGTH + UBX_OVERHEAD_SIZE];
+
+// ----------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// ----------------------------------------------------------------
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+// Locks for debug prints
+static void lock()
+{
+    gMtx.lock();
+}
+
+static void unlock()
+{
+    gMtx.unlock();
+}
+#endif
+
+// Write a little-endian value of the given size.
+static void writeLittleEndian(char *pBuf, unsigned int value, int size)
+{
+    for (int x = 0; x < size; x++) {
+        *(pBuf + x) = (char) (value >> (x * 8));
+    }
+}
+
+// Put a UBX header and checksum around the payload already in pBuf,
+// returning the size of the frame.
+static int frame(char *pBuf, unsigned char cls, unsigned char id, int length)
+{
+    unsigned char checksumA = 0;
+    unsigned char checksumB = 0;
+
+    *pBuf = (char) 0xb5;
+    *(pBuf + 1) = 0x62;
+    *(pBuf + 2) = cls;
+    *(pBuf + 3) = id;
+    writeLittleEndian(pBuf + 4, length, 2);
+    for (int x = 2; x < length + UBX_HEADER_SIZE; x++) {
+        checksumA += (unsigned char) *(pBuf + x);
+        checksumB += checksumA;
+    }
+    *(pBuf + length + UBX_HEADER_SIZE) = checksumA;
+    *(pBuf + length + UBX_HEADER_SIZE + 1) = checksumB;
+
+    return length + UBX_OVERHEAD_SIZE;
+}
+
+// Make a NAV-PVT frame with a fix in it.
+static int makeNavPvt(char *pBuf)
+{
+    char *pPayload = pBuf + UBX_HEADER_SIZE;
+
+    memset(pBuf, 0, UBX_NAV_PVT_LENGTH + UBX_OVERHEAD_SIZE);
+    *(pPayload + 21) = 0x01; // gnssFixOK
+    *(pPayload + 23) = 9; // numSV
+    writeLittleEndian(pPayload + 24, (unsigned int) -1234567, 4); // lon
+    writeLittleEndian(pPayload + 28, 521234567, 4); // lat
+    writeLittleEndian(pPayload + 36, 30500, 4); // hMSL
+    writeLittleEndian(pPayload + 40, 4200, 4); // hAcc
+    writeLittleEndian(pPayload + 60, 2500, 4); // gSpeed
+
+    return frame(pBuf, 0x01, 0x07, UBX_NAV_PVT_LENGTH);
+}
+
+// Make a NAV-TIMEUTC frame for 01:02:03 on 4th May 2018.
+static int makeNavTimeUtc(char *pBuf)
+{
+    char *pPayload = pBuf + UBX_HEADER_SIZE;
+
+    memset(pBuf, 0, UBX_NAV_TIMEUTC_LENGTH + UBX_OVERHEAD_SIZE);
+    writeLittleEndian(pPayload + 12, 2018, 2);
+    *(pPayload + 14) = 5;
+    *(pPayload + 15) = 4;
+    *(pPayload + 16) = 1;
+    *(pPayload + 17) = 2;
+    *(pPayload + 18) = 3;
+    *(pPayload + 19) = 0x07; // validTOW, validWKN, validUTC
+
+    return frame(pBuf, 0x01, 0x21, UBX_NAV_TIMEUTC_LENGTH);
+}
+
+// Check the contents of a NAV-PVT frame.
+static void checkNavPvt(const UbxFrame *pFrame)
+{
+    TEST_ASSERT(ubxIsNavPvt(pFrame));
+    TEST_ASSERT(!ubxIsNavTimeUtc(pFrame));
+    TEST_ASSERT(ubxNavPvtFixOk(pFrame));
+    TEST_ASSERT(ubxNavPvtSVs(pFrame) == 9);
+    TEST_ASSERT(ubxNavPvtLongitudeX10e7(pFrame) == -1234567);
+    TEST_ASSERT(ubxNavPvtLatitudeX10e7(pFrame) == 521234567);
+    TEST_ASSERT(ubxNavPvtAltitudeMM(pFrame) == 30500);
+    TEST_ASSERT(ubxNavPvtRadiusMM(pFrame) == 4200);
+    TEST_ASSERT(ubxNavPvtSpeedMMPS(pFrame) == 2500);
+}
+
+// ----------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------
+
+// Test of the typed views
+void test_views() {
+    UbxFrame frame;
+    struct tm tmUTC;
+    int size;
+
+    ubxParserInit(&gParser);
+    size = makeNavPvt(gNavPvt);
+    TEST_ASSERT(ubxParserWrite(&gParser, gNavPvt, size) == (unsigned int) size);
+    size = makeNavTimeUtc(gNavTimeUtc);
+    TEST_ASSERT(ubxParserWrite(&gParser, gNavTimeUtc, size) == (unsigned int) size);
+
+    TEST_ASSERT(ubxParserNext(&gParser, &frame));
+    checkNavPvt(&frame);
+
+    TEST_ASSERT(ubxParserNext(&gParser, &frame));
+    TEST_ASSERT(ubxIsNavTimeUtc(&frame));
+    TEST_ASSERT(!ubxIsNavPvt(&frame));
+    TEST_ASSERT(ubxNavTimeUtc(&frame, NULL));
+    TEST_ASSERT(ubxNavTimeUtc(&frame, &tmUTC));
+    TEST_ASSERT(tmUTC.tm_year == 118);
+    TEST_ASSERT(tmUTC.tm_mon == 4);
+    TEST_ASSERT(tmUTC.tm_mday == 4);
+    TEST_ASSERT(tmUTC.tm_hour == 1);
+    TEST_ASSERT(tmUTC.tm_min == 2);
+    TEST_ASSERT(tmUTC.tm_sec == 3);
+    TEST_ASSERT(ubxAck(&frame, 0x01, 0x21) < 0);
+
+    TEST_ASSERT(!ubxParserNext(&gParser, &frame));
+    TEST_ASSERT(gParser.numFrames == 2);
+    TEST_ASSERT(gParser.numBadFrames == 0);
+    TEST_ASSERT(gParser.numDiscards == 0);
+}
+
+// Test of feeding the parser in dribs and drabs, directly into
+// its ring buffer, such that frames wrap around the end of it
+void test_streaming() {
+    UbxFrame frame;
+    unsigned int length;
+    unsigned int written;
+    char *pSpace;
+    int size;
+    int numFound = 0;
+    int chunk = 1;
+
+    ubxParserInit(&gParser);
+    size = makeNavPvt(gNavPvt);
+    for (int x = 0; x < NUM_FRAMES; x++) {
+        // Some filler, as would be read when there's nothing to send
+        for (int y = 0; y < x % 7; y++) {
+            TEST_ASSERT(ubxParserWrite(&gParser, "\xff", 1) == 1);
+        }
+        written = 0;
+        while (written < (unsigned int) size) {
+            pSpace = ubxParserSpace(&gParser, &length);
+            if (length > (unsigned int) chunk) {
+                length = chunk;
+            }
+            if (length > size - written) {
+                length = size - written;
+            }
+            if (length > 0) {
+                memcpy(pSpace, gNavPvt + written, length);
+                ubxParserCommit(&gParser, length);
+                written += length;
+            }
+            while (ubxParserNext(&gParser, &frame)) {
+                checkNavPvt(&frame);
+                numFound++;
+            }
+            chunk = (chunk % 13) + 1;
+        }
+    }
+
+    tr_debug("%d frame(s) found, %d bad, %d byte(s) discarded.", numFound,
+             gParser.numBadFrames, gParser.numDiscards);
+    TEST_ASSERT(numFound == NUM_FRAMES);
+    TEST_ASSERT(gParser.numBadFrames == 0);
+}
+
+// Test of bad frames: a corrupted checksum, a length that is too
+// large and a sync character in the middle of a bad frame
+void test_bad_frames() {
+    UbxFrame frame;
+    int size;
+    char bad[UBX_NAV_PVT_LENGTH + UBX_OVERHEAD_SIZE];
+
+    ubxParserInit(&gParser);
+    size = makeNavPvt(gNavPvt);
+
+    // Corrupted checksum
+    memcpy(bad, gNavPvt, size);
+    bad[size - 1]++;
+    TEST_ASSERT(ubxParserWrite(&gParser, bad, size) == (unsigned int) size);
+    TEST_ASSERT(!ubxParserNext(&gParser, &frame));
+    TEST_ASSERT(gParser.numBadFrames == 1);
+
+    // Length too large to be real
+    memcpy(bad, gNavPvt, UBX_HEADER_SIZE);
+    writeLittleEndian(bad + 4, UBX_RING_SIZE, 2);
+    TEST_ASSERT(ubxParserWrite(&gParser, bad, UBX_HEADER_SIZE) == UBX_HEADER_SIZE);
+    TEST_ASSERT(!ubxParserNext(&gParser, &frame));
+    TEST_ASSERT(gParser.numBadFrames == 2);
+
+    // A good frame straight after the truncated header of another
+    TEST_ASSERT(ubxParserWrite(&gParser, gNavPvt, 4) == 4);
+    TEST_ASSERT(ubxParserWrite(&gParser, gNavPvt, size) == (unsigned int) size);
+    TEST_ASSERT(ubxParserNext(&gParser, &frame));
+    checkNavPvt(&frame);
+    TEST_ASSERT(!ubxParserNext(&gParser, &frame));
+}
+
+// Test of the ring buffer filling up
+void test_full() {
+    UbxFrame frame;
+    unsigned int length;
+    int size;
+
+    ubxParserInit(&gParser);
+    size = makeNavPvt(gNavPvt);
+
+    // Fill the ring with whole frames, the last one partially
+    while (ubxParserWrite(&gParser, gNavPvt, size) == (unsigned int) size) {}
+    ubxParserSpace(&gParser, &length);
+    TEST_ASSERT(length == 0);
+
+    // Each frame pulled out makes room for more
+    TEST_ASSERT(ubxParserNext(&gParser, &frame));
+    checkNavPvt(&frame);
+    TEST_ASSERT(ubxParserNext(&gParser, &frame));
+    checkNavPvt(&frame);
+    ubxParserSpace(&gParser, &length);
+    TEST_ASSERT(length > 0);
+}
+
+// Measure the throughput of the parser
+void test_throughput() {
+    UbxFrame frame;
+    Timer timer;
+    int size;
+    unsigned int bytes = 0;
+    int numFound = 0;
+
+    ubxParserInit(&gParser);
+    size = makeNavPvt(gNavPvt);
+    timer.start();
+    for (int x = 0; x < 1000; x++) {
+        bytes += ubxParserWrite(&gParser, gNavPvt, size);
+        while (ubxParserNext(&gParser, &frame)) {
+            numFound++;
+        }
+    }
+    timer.stop();
+
+    tr_debug("%d byte(s), %d frame(s) in %d us, parser is %d bytes.",
+             bytes, numFound, timer.read_us(), sizeof(gParser));
+    TEST_ASSERT(numFound == 1000);
+}
+
+// ----------------------------------------------------------------
+// TEST ENVIRONMENT
+// ----------------------------------------------------------------
+
+// Setup the test environment
+utest::v1::status_t test_setup(const size_t number_of_cases) {
+    // Setup Greentea with a timeout
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+// Test cases
+Case cases[] = {
+    Case("Views", test_views),
+    Case("Streaming", test_streaming),
+    Case("Bad frames", test_bad_frames),
+    Case("Full", test_full),
+    Case("Throughput", test_throughput)
+};
+
+Specification specification(test_setup, cases);
+
+// ----------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------
+
+int main()
+{
+
+#ifdef MBED_CONF_MBED_TRACE_ENABLE
+    mbed_trace_init();
+
+    mbed_trace_mutex_wait_function_set(lock);
+    mbed_trace_mutex_release_function_set(unlock);
+#endif
+
+    // Run tests
+    return !Harness::run(specification);
+}
+
+// End Of File
@@ -7,6 +7,7 @@
 #include "eh_i2c.h"
 #include "act_zoem8.h"
 #include "act_position.h"
+#include "eh_ubx.h"
 
 using namespace utest::v1;
 
@@ -50,6 +51,69 @@ static void unlock()
 // TESTS
 // ----------------------------------------------------------------
 
+// Test of UBX framing, using a fake stream of bytes as would be
+// read from the ZOEM8 over I2C; this needs no hardware
+void test_ubx_framing() {
+    // Nothing to read (0xFF), the start of an NMEA sentence, a
+    // UBX-UPD-SOS response with a corrupted checksum, an ACK-ACK
+    // and then a good UBX-UPD-SOS response (command 2, acknowledged)
+    const char stream[] = {(char) 0xff, (char) 0xff, '$', 'G', 'N', 'R', 'M', 'C', ',',
+                           (char) 0xb5, 0x62, 0x09, 0x14, 0x08, 0x00,
+                           0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x27, (char) 0xac,
+                           (char) 0xb5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x00, 0x0e, 0x37,
+                           (char) 0xb5, 0x62, 0x09, 0x14, 0x08, 0x00,
+                           0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x28, (char) 0xac,
+                           (char) 0xff};
+    // A UBX-NAV-PVT poll
+    const char poll[] = {(char) 0xb5, 0x62, 0x01, 0x07, 0x00, 0x00, 0x08, 0x19};
+    static UbxParser parser;
+    UbxFrame frame;
+    char payload[ZOEM8_MGA_INI_TIME_UTC_LENGTH];
+
+    // Zero length payload, which only turns up once it's all there
+    ubxParserInit(&parser);
+    TEST_ASSERT(ubxParserWrite(&parser, poll, sizeof(poll) - 1) == sizeof(poll) - 1);
+    TEST_ASSERT(!ubxParserNext(&parser, &frame));
+    TEST_ASSERT(ubxParserWrite(&parser, poll + sizeof(poll) - 1, 1) == 1);
+    TEST_ASSERT(ubxParserNext(&parser, &frame));
+    TEST_ASSERT((frame.cls == 0x01) && (frame.id == 0x07) && (frame.length == 0));
+    TEST_ASSERT(!ubxParserNext(&parser, &frame));
+
+    // The corrupted message should be skipped, the ACK-ACK and the
+    // good message found
+    ubxParserInit(&parser);
+    TEST_ASSERT(ubxParserWrite(&parser, stream, sizeof(stream)) == sizeof(stream));
+    TEST_ASSERT(ubxParserNext(&parser, &frame));
+    TEST_ASSERT(ubxAck(&frame, 0x06, 0x00) == 1);
+    TEST_ASSERT(ubxAck(&frame, 0x06, 0x01) < 0);
+    TEST_ASSERT(ubxParserNext(&parser, &frame));
+    TEST_ASSERT((frame.cls == 0x09) && (frame.id == 0x14) && (frame.length == 8));
+    TEST_ASSERT(ubxU1(&frame, 0) == 0x02);
+    TEST_ASSERT(ubxU1(&frame, 4) == 0x01);
+    TEST_ASSERT(!ubxParserNext(&parser, &frame));
+    TEST_ASSERT(parser.numFrames == 2);
+    TEST_ASSERT(parser.numBadFrames == 1);
+
+    // UBX-MGA-INI-TIME_UTC for 01:01:01 on 2nd Jan 2018
+    TEST_ASSERT(zoem8MgaIniTimeUtc(payload, 1514768400 + (3600 * 24) + 61, 10) == ZOEM8_MGA_INI_TIME_UTC_LENGTH);
+    TEST_ASSERT(payload[0] == 0x10);
+    TEST_ASSERT(payload[3] == (char) 0x80);
+    TEST_ASSERT((payload[4] == (char) 0xe2) && (payload[5] == 0x07));
+    TEST_ASSERT((payload[6] == 1) && (payload[7] == 2));
+    TEST_ASSERT((payload[8] == 1) && (payload[9] == 1) && (payload[10] == 1));
+    TEST_ASSERT((payload[16] == 10) && (payload[17] == 0));
+
+    // UBX-MGA-INI-POS_LLH, everything little-endian, altitude and accuracy in cm
+    TEST_ASSERT(zoem8MgaIniPosLlh(payload, 521234567, -1234567, 30, 500) == ZOEM8_MGA_INI_POS_LLH_LENGTH);
+    TEST_ASSERT(payload[0] == 0x01);
+    TEST_ASSERT((payload[4] == (char) 0x87) && (payload[5] == 0x68) &&
+                (payload[6] == 0x11) && (payload[7] == 0x1f));
+    TEST_ASSERT((payload[8] == 0x79) && (payload[9] == 0x29) &&
+                (payload[10] == (char) 0xed) && (payload[11] == (char) 0xff));
+    TEST_ASSERT((payload[12] == (char) 0xb8) && (payload[13] == 0x0b));
+    TEST_ASSERT((payload[16] == 0x50) && (payload[17] == (char) 0xc3));
+}
+
 // Test of initialisation
 void test_init() {
     int x = 0;
@@ -157,6 +221,78 @@ void test_position_readings() {
     TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
 }
 
+// Callback for waitPosition(), counting how often it is called
+static bool keepGoing(void *pCount)
+{
+    (*((int *) pCount))++;
+    return true;
+}
+
+// Test of waiting for a position fix
+void test_wait_position() {
+    int x = 0;
+    int count = 0;
+    int latitudeX10e7 = 0;
+    int longitudeX10e7 = 0;
+    int radiusMetres = 0;
+    int altitudeMetres = 0;
+    unsigned char speedMPS = 0;
+    unsigned char svs = 0;
+    Timer timer;
+    mbed_stats_heap_t statsHeapBefore;
+    mbed_stats_heap_t statsHeapAfter;
+
+    tr_debug("Print something out with a float (%f) in it as tr_debug and floats allocate from the heap when first called.\n", 1.0);
+
+    // Capture the heap stats before we start
+    mbed_stats_heap_get(&statsHeapBefore);
+    tr_debug("%d byte(s) of heap used at the outset.", (int) statsHeapBefore.current_size);
+
+    // Instantiate I2C
+    i2cInit(I2C_DATA, I2C_CLOCK);
+
+    // Try to wait before initialisation - should fail
+    TEST_ASSERT(waitPosition(&latitudeX10e7, &longitudeX10e7,
+                             &radiusMetres, &altitudeMetres,
+                             &speedMPS, &svs, 1000, NULL, NULL) == ACTION_DRIVER_ERROR_NOT_INITIALISED)
+
+    tr_debug("Initialising ZOEM8...");
+    TEST_ASSERT(zoem8Init(ZOEM8_ADDRESS) == ACTION_DRIVER_OK);
+
+    // Wait for a fix, which we may not get but, either way,
+    // the timeout should be respected and the callback called
+    timer.start();
+    x = waitPosition(&latitudeX10e7, &longitudeX10e7,
+                     &radiusMetres, &altitudeMetres,
+                     &speedMPS, &svs, 30000, keepGoing, &count);
+    timer.stop();
+    tr_debug("Result of waiting for position is %d after %d ms, callback called %d time(s).",
+             x, timer.read_ms(), count);
+    TEST_ASSERT((x == ACTION_DRIVER_OK) || (x == ACTION_DRIVER_ERROR_NO_VALID_DATA));
+    TEST_ASSERT(timer.read_ms() < 30000 + ZOEM8_GET_WAIT_TIME_MS);
+    if (x == ACTION_DRIVER_OK) {
+        tr_debug("Latitude %3.6f, longitude %3.6f, radius %d metre(s), altitude %d metre(s), speed %d metres/second, %d SV(s).",
+                  ((float) latitudeX10e7) / 10000000, ((float) longitudeX10e7) / 10000000, radiusMetres,
+                  altitudeMetres, speedMPS, svs);
+        TEST_ASSERT(radiusMetres < 50000);
+        TEST_ASSERT(svs < 64);
+    } else {
+        TEST_ASSERT(count > 0);
+    }
+
+    zoem8Deinit();
+
+    // Shut down I2C
+    i2cDeinit();
+
+    // Capture the heap stats once more
+    mbed_stats_heap_get(&statsHeapAfter);
+    tr_debug("%d byte(s) of heap used at the end.", (int) statsHeapAfter.current_size);
+
+    // The heap used should be the same as at the start
+    TEST_ASSERT(statsHeapBefore.current_size == statsHeapAfter.current_size);
+}
+
 // Test of obtaining time readings
 void test_time_readings() {
     int x = 0;
@@ -225,14 +361,16 @@ void test_time_readings() {
 // Setup the test environment
 utest::v1::status_t test_setup(const size_t number_of_cases) {
     // Setup Greentea with a timeout
-    GREENTEA_SETUP(60, "default_auto");
+    GREENTEA_SETUP(120, "default_auto");
     return verbose_test_setup_handler(number_of_cases);
 }
 
 // Test cases
 Case cases[] = {
+    Case("UBX framing", test_ubx_framing),
     Case("Initialisation", test_init),
     Case("Take position readings", test_position_readings),
+    Case("Wait for position", test_wait_position),
     Case("Take time readings", test_time_readings)
 };
 
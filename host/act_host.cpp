@@ -0,0 +1,851 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Synthetic drivers behind the act_* interfaces, for a host build:
+// each measurement succeeds with a plausible, slowly varying, value,
+// at once unless actHostSetModel() has said that GNSS and the modem
+// take time, lose things or fail.  act_voltages.cpp and
+// act_energy_source.cpp are the real thing, reading the shim's
+// analogue inputs.
+
+#include <mbed.h>
+#include <act_common.h>
+#include <act_temperature_humidity_pressure.h>
+#include <act_bme280.h>
+#include <act_light.h>
+#include <act_si1133.h>
+#include <act_magnetic.h>
+#include <act_si7210.h>
+#include <act_acceleration.h>
+#include <act_lis3dh.h>
+#include <act_position.h>
+#include <act_zoem8.h>
+#include <act_cellular.h>
+#include <act_modem.h>
+#include <eh_codec.h>
+#include <eh_statistics.h>
+#include <eh_config.h> // For ACK_FOR_REPORTS
+#include <eh_timeline.h>
+#include <act_host.h>
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** A count of the readings taken, from which the values vary.
+ */
+static unsigned int gReadingCount = 0;
+
+/** The si7210 settings.
+ */
+static Si7210FieldStrengthRange gSi7210Range = SI7210_RANGE_20_MILLI_TESLAS;
+static unsigned int gSi7210ThresholdTeslaX1000 = 0;
+static unsigned int gSi7210HysteresisTeslaX1000 = 0;
+static bool gSi7210ActiveHigh = false;
+
+/** Whether the modem has been initialised and connected.
+ */
+static bool gModemInitialised = false;
+static bool gModemConnected = false;
+
+/** Whether the modem is registered, which it isn't when
+ * it has just been switched on.
+ */
+static bool gModemRegistered = false;
+
+/** The number of modem energy measurements.
+ */
+static unsigned int gModemEnergyCalibrationCount = 0;
+
+/** The lis3dh settings.
+ */
+static unsigned char gLis3dhSensitivity = 0;
+static unsigned int gLis3dhThresholdMG[2] = {0};
+static time_t gLis3dhThresholdSeconds[2] = {0};
+static bool gLis3dhInterruptEnable[2] = {false};
+
+/** How the drivers behave.
+ */
+static ActHostModel gModel = {0};
+
+/** Function to call with the energy drawn.
+ */
+static void (*gpEnergyCallback)(unsigned long long int energyNWH) = NULL;
+
+/** What the modem has done.
+ */
+static ActHostCounts gCounts = {0};
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Return true with the given percentage chance.
+static bool chance(int percent)
+{
+    return (percent > 0) && (rand() % 100 < percent);
+}
+
+// Report energy drawn from the supply.
+static void draw(unsigned long long int energyNWH)
+{
+    if (gpEnergyCallback != NULL) {
+        gpEnergyCallback(energyNWH);
+    }
+}
+
+// Take time, a second at a time while asked to keep
+// going, returning the number of seconds taken.
+static int take(int seconds, bool (*pKeepGoingCallback)(void *),
+                void *pCallbackParam)
+{
+    int x;
+
+    for (x = 0; (x < seconds) && ((pKeepGoingCallback == NULL) ||
+                                  pKeepGoingCallback(pCallbackParam)); x++) {
+        Thread::wait(1000);
+    }
+
+    return x;
+}
+
+// Return a value that wanders by up to +/- range around a centre.
+static int wander(int centre, int range)
+{
+    gReadingCount++;
+
+    return centre + (int) ((gReadingCount * 7) % (2 * range + 1)) - range;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: TEMPERATURE, HUMIDITY AND PRESSURE
+ *************************************************************************/
+
+// Initialise the BME280.
+ActionDriver bme280Init(char i2cAddress)
+{
+    (void) i2cAddress;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the BME280.
+void bme280Deinit()
+{
+}
+
+// Get the temperature.
+ActionDriver getTemperature(signed int *pTemperatureCX100)
+{
+    *pTemperatureCX100 = wander(2150, 200);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the humidity.
+ActionDriver getHumidity(unsigned char *pPercentage)
+{
+    *pPercentage = (unsigned char) wander(55, 10);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the pressure.
+ActionDriver getPressure(unsigned int *pPascalX100)
+{
+    *pPascalX100 = (unsigned int) wander(10132500, 50000);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get temperature, humidity and pressure together.
+ActionDriver getTemperatureHumidityPressure(signed int *pTemperatureCX100,
+                                            unsigned char *pPercentage,
+                                            unsigned int *pPascalX100)
+{
+    if (pTemperatureCX100 != NULL) {
+        getTemperature(pTemperatureCX100);
+    }
+    if (pPercentage != NULL) {
+        getHumidity(pPercentage);
+    }
+    if (pPascalX100 != NULL) {
+        getPressure(pPascalX100);
+    }
+
+    return ACTION_DRIVER_OK;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: LIGHT
+ *************************************************************************/
+
+// Initialise the SI1133.
+ActionDriver si1133Init(char i2cAddress)
+{
+    (void) i2cAddress;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the SI1133.
+void si1133Deinit()
+{
+}
+
+// Start a measurement, calling back at once.
+ActionDriver si1133StartGroup(void (*pCallback)(void *), void *pCallbackParam)
+{
+    if (pCallback != NULL) {
+        pCallback(pCallbackParam);
+    }
+
+    return ACTION_DRIVER_OK;
+}
+
+// Read the result of a measurement.
+ActionDriver si1133ReadGroup(Si1133Group *pGroup)
+{
+    pGroup->uv = wander(100, 50);
+    pGroup->visibleHigh = wander(1000, 500);
+    pGroup->ir = wander(500, 250);
+    pGroup->visibleLow = pGroup->visibleHigh * 16;
+    pGroup->lux = wander(500, 400);
+    pGroup->uvIndexX1000 = wander(2000, 1000);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the conversion time.
+int si1133GetConversionTimeUs()
+{
+    return 0;
+}
+
+// Get the light level.
+ActionDriver getLight(int *pLux, int *pUvIndexX1000)
+{
+    Si1133Group group;
+
+    si1133ReadGroup(&group);
+    if (pLux != NULL) {
+        *pLux = group.lux;
+    }
+    if (pUvIndexX1000 != NULL) {
+        *pUvIndexX1000 = group.uvIndexX1000;
+    }
+
+    return ACTION_DRIVER_OK;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: MAGNETIC
+ *************************************************************************/
+
+// Initialise the SI7210.
+ActionDriver si7210Init(char i2cAddress)
+{
+    (void) i2cAddress;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the SI7210.
+void si7210Deinit()
+{
+}
+
+// Set the range.
+ActionDriver si7210SetRange(Si7210FieldStrengthRange range)
+{
+    gSi7210Range = range;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the range.
+Si7210FieldStrengthRange si7210GetRange()
+{
+    return gSi7210Range;
+}
+
+// Set the interrupt; it never goes off on a host.
+ActionDriver si7210SetInterrupt(unsigned int thresholdTeslaX1000,
+                                unsigned int hysteresisTeslaX1000,
+                                bool activeHigh,
+                                EventQueue *pEventQueue,
+                                void (*pEventCallback) (EventQueue *))
+{
+    (void) pEventQueue;
+    (void) pEventCallback;
+    gSi7210ThresholdTeslaX1000 = thresholdTeslaX1000;
+    gSi7210HysteresisTeslaX1000 = hysteresisTeslaX1000;
+    gSi7210ActiveHigh = activeHigh;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the interrupt settings.
+ActionDriver si7210GetInterrupt(unsigned int *pThresholdTeslaX1000,
+                                unsigned int *pHysteresisTeslaX1000,
+                                bool *pActiveHigh)
+{
+    if (pThresholdTeslaX1000 != NULL) {
+        *pThresholdTeslaX1000 = gSi7210ThresholdTeslaX1000;
+    }
+    if (pHysteresisTeslaX1000 != NULL) {
+        *pHysteresisTeslaX1000 = gSi7210HysteresisTeslaX1000;
+    }
+    if (pActiveHigh != NULL) {
+        *pActiveHigh = gSi7210ActiveHigh;
+    }
+
+    return ACTION_DRIVER_OK;
+}
+
+// Set the filter.
+ActionDriver si7210SetFilter(Si7210Filter filter, unsigned int bandwidth,
+                             unsigned int burstSize)
+{
+    (void) filter;
+    (void) bandwidth;
+    (void) burstSize;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Set the tamper threshold.
+ActionDriver si7210SetTamper(unsigned int thresholdTeslaX1000)
+{
+    (void) thresholdTeslaX1000;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the field strength.
+ActionDriver getFieldStrength(unsigned int *pTeslaX1000)
+{
+    *pTeslaX1000 = (unsigned int) wander(50000, 5000);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the interrupt flag: never set on a host.
+bool getFieldStrengthInterruptFlag()
+{
+    return false;
+}
+
+// Clear the interrupt flag.
+void clearFieldStrengthInterruptFlag()
+{
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: ACCELERATION
+ *************************************************************************/
+
+// Initialise the LIS3DH.
+ActionDriver lis3dhInit(char i2cAddress)
+{
+    (void) i2cAddress;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the LIS3DH.
+void lis3dhDeinit()
+{
+}
+
+// Set the sensitivity.
+ActionDriver lis3dhSetSensitivity(unsigned char sensitivity)
+{
+    gLis3dhSensitivity = sensitivity;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the sensitivity.
+ActionDriver lis3dhGetSensitivity(unsigned char *pSensitivity)
+{
+    *pSensitivity = gLis3dhSensitivity;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Set an interrupt threshold.
+ActionDriver lis3dhSetInterruptThreshold(unsigned char interrupt,
+                                         unsigned int thresholdMG,
+                                         time_t seconds)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_PARAMETER;
+
+    if ((interrupt >= 1) && (interrupt <= 2)) {
+        gLis3dhThresholdMG[interrupt - 1] = thresholdMG;
+        gLis3dhThresholdSeconds[interrupt - 1] = seconds;
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Get an interrupt threshold.
+ActionDriver lis3dhGetInterruptThreshold(unsigned char interrupt,
+                                         unsigned int *pThresholdMG,
+                                         time_t *pSeconds)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_PARAMETER;
+
+    if ((interrupt >= 1) && (interrupt <= 2)) {
+        if (pThresholdMG != NULL) {
+            *pThresholdMG = gLis3dhThresholdMG[interrupt - 1];
+        }
+        if (pSeconds != NULL) {
+            *pSeconds = gLis3dhThresholdSeconds[interrupt - 1];
+        }
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Enable or disable an interrupt; it never goes off on a host.
+ActionDriver lis3dhSetInterruptEnable(unsigned char interrupt,
+                                      bool enableNotDisable,
+                                      EventQueue *pEventQueue,
+                                      void (*pEventCallback) (EventQueue *))
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_PARAMETER;
+
+    (void) pEventQueue;
+    (void) pEventCallback;
+    if ((interrupt >= 1) && (interrupt <= 2)) {
+        gLis3dhInterruptEnable[interrupt - 1] = enableNotDisable;
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Get whether an interrupt is enabled.
+ActionDriver lis3dhGetInterruptEnable(unsigned char interrupt,
+                                      bool *pEnableNotDisable)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_PARAMETER;
+
+    if ((interrupt >= 1) && (interrupt <= 2)) {
+        *pEnableNotDisable = gLis3dhInterruptEnable[interrupt - 1];
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Clear an interrupt.
+ActionDriver lis3dhClearInterrupt(unsigned char interrupt)
+{
+    return ((interrupt >= 1) && (interrupt <= 2)) ? ACTION_DRIVER_OK :
+                                                    ACTION_DRIVER_ERROR_PARAMETER;
+}
+
+// Enable or disable the FIFO.
+ActionDriver lis3dhSetFifoEnable(bool enableNotDisable)
+{
+    (void) enableNotDisable;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the acceleration: at rest, the right way up.
+ActionDriver getAcceleration(int *pXGX1000, int *pYGX1000, int *pZGX1000)
+{
+    *pXGX1000 = wander(0, 20);
+    *pYGX1000 = wander(0, 20);
+    *pZGX1000 = wander(1000, 20);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get a stream of acceleration samples.
+ActionDriver getAccelerationStream(short *pXGX1000, short *pYGX1000,
+                                   short *pZGX1000, unsigned int maxSamples,
+                                   unsigned int *pNumSamples)
+{
+    int x;
+    int y;
+    int z;
+
+    for (unsigned int s = 0; s < maxSamples; s++) {
+        getAcceleration(&x, &y, &z);
+        *(pXGX1000 + s) = (short) x;
+        *(pYGX1000 + s) = (short) y;
+        *(pZGX1000 + s) = (short) z;
+    }
+    *pNumSamples = maxSamples;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the interrupt flag: never set on a host.
+bool getAccelerationInterruptFlag()
+{
+    return false;
+}
+
+// Clear the interrupt flag.
+void clearAccelerationInterruptFlag()
+{
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: POSITION
+ *************************************************************************/
+
+// Initialise the ZOE-M8.
+ActionDriver zoem8Init(char i2cAddress)
+{
+    (void) i2cAddress;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the ZOE-M8.
+void zoem8Deinit()
+{
+}
+
+// Note that the device has moved.
+void zoem8PositionMoved()
+{
+}
+
+// Get the position: Melbourn.
+ActionDriver getPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
+                         int *pRadiusMetres, int *pAltitudeMetres,
+                         unsigned char *pSpeedMPS, unsigned char *pSVs)
+{
+    *pLatitudeX10e7 = 520832000;
+    *pLongitudeX10e7 = 277000;
+    *pRadiusMetres = wander(10, 5);
+    *pAltitudeMetres = 20;
+    *pSpeedMPS = 0;
+    *pSVs = (unsigned char) wander(8, 2);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Wait for a position, which takes the model's time to fix.
+ActionDriver waitPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
+                          int *pRadiusMetres, int *pAltitudeMetres,
+                          unsigned char *pSpeedMPS, unsigned char *pSVs,
+                          int timeoutMs,
+                          bool (*pKeepGoingCallback)(void *),
+                          void *pCallbackParam)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_TIMEOUT;
+    int seconds = gModel.gnssFixSeconds;
+    int x;
+
+    if (seconds * 1000 > timeoutMs) {
+        seconds = timeoutMs / 1000;
+    }
+    x = take(seconds, pKeepGoingCallback, pCallbackParam);
+    draw(((unsigned long long int) x) * ZOEM8_POWER_ACTIVE_NW / 3600);
+    if (x >= gModel.gnssFixSeconds) {
+        result = getPosition(pLatitudeX10e7, pLongitudeX10e7, pRadiusMetres,
+                             pAltitudeMetres, pSpeedMPS, pSVs);
+    }
+
+    return result;
+}
+
+// Get the time from GNSS: the host's.
+ActionDriver getTime(time_t *pTimeUTC)
+{
+    *pTimeUTC = time(NULL);
+
+    return ACTION_DRIVER_OK;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: CELLULAR
+ *************************************************************************/
+
+// Get the received signal.
+ActionDriver getCellularSignalRx(int *pRsrpDbm, int *pRssiDbm,
+                                 int *pRsrqDb, int *pSnrDbm)
+{
+    *pRsrpDbm = wander((gModel.modemRsrpDbm != 0) ? gModel.modemRsrpDbm : -95, 10);
+    *pRssiDbm = *pRsrpDbm + 20;
+    *pRsrqDb = -10;
+    *pSnrDbm = wander(10, 5);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the transmit power.
+ActionDriver getCellularSignalTx(int *pPowerDbm)
+{
+    *pPowerDbm = wander(10, 5);
+
+    return ACTION_DRIVER_OK;
+}
+
+// Get the channel.
+ActionDriver getCellularChannel(unsigned int *pCellId, unsigned int *pEarfcn,
+                                unsigned char *pEcl)
+{
+    *pCellId = 12345;
+    *pEarfcn = 6400;
+    *pEcl = 0;
+    if (gModel.modemRsrpDbm < CELLULAR_ECL2_RSRP_THRESHOLD_DBM) {
+        *pEcl = 2;
+    } else if (gModel.modemRsrpDbm < CELLULAR_ECL1_RSRP_THRESHOLD_DBM) {
+        *pEcl = 1;
+    }
+
+    return ACTION_DRIVER_OK;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: MODEM
+ *************************************************************************/
+
+// Initialise the modem: a SARA-R4.
+ActionDriver modemInit(const char *pSimPin, const char *pApn,
+                       const char *pUserName, const char *pPassword)
+{
+    (void) pSimPin;
+    (void) pApn;
+    (void) pUserName;
+    (void) pPassword;
+    gModemInitialised = true;
+
+    return ACTION_DRIVER_OK;
+}
+
+// Shut down the modem.
+void modemDeinit()
+{
+    gModemInitialised = false;
+    gModemConnected = false;
+    gModemRegistered = false;
+}
+
+// Get the IMEI.
+ActionDriver modemGetImei(char *pImei)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gModemInitialised) {
+        memcpy(pImei, "357520071700641", MODEM_IMEI_LENGTH);
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Connect, registering first if the modem has been off.
+ActionDriver modemConnect(bool (*pKeepGoingCallback)(void *),
+                          void *pCallbackParam,
+                          void (*pWatchdogCallback) (void))
+{
+    int seconds;
+
+    (void) pWatchdogCallback;
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_CONNECT, 0);
+    if (gModemInitialised) {
+        gCounts.numConnects++;
+        if (!gModemRegistered) {
+            seconds = take(gModel.modemRegisterSeconds, pKeepGoingCallback, pCallbackParam);
+            draw(CELLULAR_R410_POWER_REGISTRATION_NWH);
+            gModemRegistered = (seconds >= gModel.modemRegisterSeconds);
+        }
+        gModemConnected = gModemRegistered && !chance(gModel.modemConnectFailPercent);
+        if (!gModemConnected) {
+            gCounts.numConnectFailures++;
+        }
+    }
+    TIMELINE_END(TIMELINE_ID_MODEM_CONNECT, gModemConnected);
+
+    return gModemConnected ? ACTION_DRIVER_OK : ACTION_DRIVER_ERROR_NOT_INITIALISED;
+}
+
+// Get the last connect error code.
+int modemGetLastConnectErrorCode()
+{
+    return 0;
+}
+
+// Get the time from NTP: the host's.
+ActionDriver modemGetTime(time_t *pTimeUTC)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gModemConnected) {
+        *pTimeUTC = time(NULL);
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Send reports over the model's link: each datagram takes the
+// model's latency and may be lost, data needing an ack staying
+// queued if it is.  With the default model the link is perfect.
+ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
+                              const char *pIdString,
+                              bool (keepingGoingCallback(void *)),
+                              void *pCallbackParam)
+{
+    static char buf[CODEC_ENCODE_BUFFER_MIN_SIZE];
+    ActionDriver result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+    unsigned int energyPerByteNWH;
+    int rsrpDbm;
+    int rssiDbm;
+    int rsrqDb;
+    int snrDb;
+    int x;
+
+    (void) pServerAddress;
+    (void) serverPort;
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_SEND_REPORTS, 0);
+    if (gModemConnected) {
+        result = ACTION_DRIVER_OK;
+        getCellularSignalRx(&rsrpDbm, &rssiDbm, &rsrqDb, &snrDb);
+        energyPerByteNWH = modemEnergyPerByteNWH(rsrpDbm, 0, 0);
+        draw(CELLULAR_R410_ENERGY_TX_NWH(0));
+        codecPrepareData();
+        while (((keepingGoingCallback == NULL) || keepingGoingCallback(pCallbackParam)) &&
+               (CODEC_SIZE(x = codecEncodeData(pIdString, buf, sizeof(buf), ACK_FOR_REPORTS)) > 0) &&
+               ((CODEC_FLAGS(x) & (CODEC_FLAG_NOT_ENOUGH_ROOM_FOR_HEADER |
+                                   CODEC_FLAG_NOT_ENOUGH_ROOM_FOR_EVEN_ONE_DATA)) == 0)) {
+            TIMELINE_BEGIN(TIMELINE_ID_MODEM_SEND, CODEC_SIZE(x));
+            if (gModel.modemLatencyMs > 0) {
+                Thread::wait(gModel.modemLatencyMs);
+            }
+            TIMELINE_END(TIMELINE_ID_MODEM_SEND, CODEC_SIZE(x));
+            statisticsAddTransmitted(CODEC_SIZE(x));
+            draw(((unsigned long long int) CODEC_SIZE(x)) * energyPerByteNWH);
+            gCounts.numDatagramsSent++;
+            if (!chance(gModel.modemLossPercent)) {
+                gCounts.numDatagramsDelivered++;
+                gCounts.numBytesDelivered += CODEC_SIZE(x);
+                if ((CODEC_FLAGS(x) & CODEC_FLAG_NEEDS_ACK) > 0) {
+                    codecAckDataIndex(codecGetLastIndex());
+                }
+            }
+        }
+    }
+    TIMELINE_END(TIMELINE_ID_MODEM_SEND_REPORTS, result);
+
+    return result;
+}
+
+// The modem is a SARA-R4.
+bool modemIsN2()
+{
+    return false;
+}
+
+// The modem is a SARA-R4.
+bool modemIsR4()
+{
+    return true;
+}
+
+// The energy consumed by the modem, from the compile-time constants.
+unsigned long long int modemEnergyNWH(unsigned int idleTimeSeconds,
+                                      unsigned int bytesTransmitted)
+{
+    unsigned long long int energyNWH = CELLULAR_R410_ENERGY_TX_NWH(bytesTransmitted);
+
+    if (idleTimeSeconds > 0) {
+        energyNWH += ((unsigned long long int) idleTimeSeconds) * CELLULAR_R410_POWER_IDLE_NW / 3600;
+    } else {
+        energyNWH += CELLULAR_R410_POWER_REGISTRATION_NWH;
+    }
+
+    return energyNWH;
+}
+
+// Measurements are counted but the model is not refined.
+void modemEnergyCalibrate(bool fromOff, unsigned int bytesTransmitted,
+                          long long int energyNWH)
+{
+    (void) fromOff;
+    (void) bytesTransmitted;
+    (void) energyNWH;
+    gModemEnergyCalibrationCount++;
+}
+
+// Reset the energy model.
+void modemEnergyCalibrationReset()
+{
+    gModemEnergyCalibrationCount = 0;
+}
+
+// Get the number of energy measurements.
+unsigned int modemEnergyCalibrationCount()
+{
+    return gModemEnergyCalibrationCount;
+}
+
+// The energy cost of transmitting a byte.
+unsigned int modemEnergyPerByteNWH(int rsrpDbm, int transmitPowerDbm,
+                                   unsigned char ecl)
+{
+    unsigned int energyNWH = CELLULAR_R410_ENERGY_TX_PER_BYTE_NWH;
+
+    (void) transmitPowerDbm;
+    (void) ecl;
+    if (rsrpDbm < CELLULAR_ECL2_RSRP_THRESHOLD_DBM) {
+        energyNWH *= CELLULAR_ECL2_TX_ENERGY_MULTIPLIER;
+    } else if (rsrpDbm < CELLULAR_ECL1_RSRP_THRESHOLD_DBM) {
+        energyNWH *= CELLULAR_ECL1_TX_ENERGY_MULTIPLIER;
+    }
+
+    return energyNWH;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: HOST EXTENSIONS
+ *************************************************************************/
+
+// Set how the drivers behave.
+void actHostSetModel(const ActHostModel *pModel)
+{
+    if (pModel != NULL) {
+        gModel = *pModel;
+    } else {
+        memset(&gModel, 0, sizeof(gModel));
+    }
+}
+
+// Set a function to be called with the energy drawn.
+void actHostSetEnergyCallback(void (*pCallback)(unsigned long long int energyNWH))
+{
+    gpEnergyCallback = pCallback;
+}
+
+// Get what the modem has done.
+void actHostGetCounts(ActHostCounts *pCounts)
+{
+    *pCounts = gCounts;
+}
+
+// End of file
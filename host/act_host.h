@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _ACT_HOST_H_
+#define _ACT_HOST_H_
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** How the synthetic drivers of act_host.cpp behave in time; the
+ * defaults (all zero) are instant and perfect.
+ */
+typedef struct {
+    int gnssFixSeconds;           //!< The time GNSS takes to get a fix.
+    int modemRegisterSeconds;     //!< The time the modem takes to register from off.
+    int modemConnectFailPercent;  //!< The chance of a connection failing.
+    int modemLatencyMs;           //!< The time to send a datagram and get its ack.
+    int modemLossPercent;         //!< The chance of a datagram, or its ack, being lost.
+    int modemRsrpDbm;             //!< The received signal strength, zero for the default.
+} ActHostModel;
+
+/** What the synthetic modem has done.
+ */
+typedef struct {
+    unsigned int numConnects;           //!< Connection attempts.
+    unsigned int numConnectFailures;    //!< Connection attempts that failed.
+    unsigned int numDatagramsSent;      //!< Datagrams sent.
+    unsigned int numDatagramsDelivered; //!< Datagrams that reached the server.
+    unsigned int numBytesDelivered;     //!< Bytes in those datagrams.
+} ActHostCounts;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Set how the synthetic drivers behave; time taken is waited for
+ * with Thread::wait(), i.e. on the host clock.
+ *
+ * @param pModel the model, NULL for the defaults.
+ */
+void actHostSetModel(const ActHostModel *pModel);
+
+/** Set a function to be called with the energy that the synthetic
+ * GNSS and modem draw from the supply as they draw it, the true cost
+ * against which the application's estimates can be judged.
+ *
+ * @param pCallback the function, NULL to remove it.
+ */
+void actHostSetEnergyCallback(void (*pCallback)(unsigned long long int energyNWH));
+
+/** Get what the synthetic modem has done since start-up.
+ *
+ * @param pCounts a place to put the counts.
+ */
+void actHostGetCounts(ActHostCounts *pCounts);
+
+#endif // _ACT_HOST_H_
+
+// End Of File
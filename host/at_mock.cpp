@@ -0,0 +1,410 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A mock modem for the host: implements the ATCmdParser class of the
+// shim ATCmdParser.h, recording what is sent and giving back scripted
+// responses a line at a time, with out of band handling.
+
+#include <mbed.h>
+#include <ATCmdParser.h>
+#include <at_mock.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The longest line or format that is handled.
+ */
+#define AT_MOCK_MAX_LINE_SIZE 256
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** An out of band handler.
+ */
+typedef struct {
+    const char *pPrefix;
+    Callback<void()> callback;
+} AtMockOob;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** What has been sent.
+ */
+static char gSent[AT_MOCK_MAX_SENT_SIZE + 1];
+static int gSentSize = 0;
+
+/** The sizes of the writes.
+ */
+static int gWriteSize[AT_MOCK_MAX_NUM_WRITES];
+static int gNumWrites = 0;
+
+/** The sizes of the reads.
+ */
+static int gReadSize[AT_MOCK_MAX_NUM_READS];
+static int gNumReads = 0;
+
+/** The responses and how far through them we are.
+ */
+static char gResponse[AT_MOCK_MAX_RESPONSE_SIZE + 1];
+static int gResponseSize = 0;
+static int gResponseIndex = 0;
+
+/** The out of band handlers.
+ */
+static AtMockOob gOob[AT_MOCK_MAX_NUM_OOBS];
+static int gNumOobs = 0;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Record something sent as one write.
+static int sent(const char *pData, int size)
+{
+    if (size > AT_MOCK_MAX_SENT_SIZE - gSentSize) {
+        size = AT_MOCK_MAX_SENT_SIZE - gSentSize;
+    }
+    memcpy(gSent + gSentSize, pData, size);
+    gSentSize += size;
+    gSent[gSentSize] = 0;
+    if (gNumWrites < AT_MOCK_MAX_NUM_WRITES) {
+        gWriteSize[gNumWrites] = size;
+        gNumWrites++;
+    }
+
+    return size;
+}
+
+// Get the next non-empty line of the responses, without its
+// line ending, returning false if there are none left.
+static bool nextLine(char *pLine, int size)
+{
+    int length = 0;
+    char c;
+
+    while ((length == 0) && (gResponseIndex < gResponseSize)) {
+        while ((gResponseIndex < gResponseSize) &&
+               ((c = gResponse[gResponseIndex++]) != '\n')) {
+            if ((c != '\r') && (length < size - 1)) {
+                pLine[length] = c;
+                length++;
+            }
+        }
+    }
+    pLine[length] = 0;
+
+    return length > 0;
+}
+
+// Put the remains of a line back at the front of the responses.
+static void pushBack(const char *pRemains)
+{
+    int length = strlen(pRemains) + 1;
+
+    if (length <= gResponseIndex) {
+        gResponseIndex -= length;
+        memcpy(gResponse + gResponseIndex, pRemains, length - 1);
+        gResponse[gResponseIndex + length - 1] = '\n';
+    }
+}
+
+// If a line starts with the prefix of an out of band handler, put
+// the rest of it back and call the handler, returning true if so.
+static bool handleOob(const char *pLine)
+{
+    bool handled = false;
+
+    for (int x = 0; !handled && (x < gNumOobs); x++) {
+        if (strncmp(pLine, gOob[x].pPrefix, strlen(gOob[x].pPrefix)) == 0) {
+            pushBack(pLine + strlen(gOob[x].pPrefix));
+            gOob[x].callback();
+            handled = true;
+        }
+    }
+
+    return handled;
+}
+
+// Make a copy of a format with all of its conversions suppressed
+// and "%n" on the end, returning the number of conversions.
+static int suppress(const char *pFormat, char *pSuppressed, int size)
+{
+    int numConversions = 0;
+    int length = 0;
+
+    while ((*pFormat != 0) && (length < size - 4)) {
+        pSuppressed[length] = *pFormat;
+        length++;
+        if (*pFormat == '%') {
+            pFormat++;
+            if (*pFormat == '%') {
+                pSuppressed[length] = *pFormat;
+                length++;
+                pFormat++;
+            } else if (*pFormat != '*') {
+                pSuppressed[length] = '*';
+                length++;
+                numConversions++;
+            }
+        } else {
+            pFormat++;
+        }
+    }
+    strcpy(pSuppressed + length, "%n");
+
+    return numConversions;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: ATCMDPARSER
+ *************************************************************************/
+
+// Constructor.
+ATCmdParser::ATCmdParser(FileHandle *fh, const char *output_delimiter,
+                         int buffer_size, int timeout, bool debug)
+{
+    (void) fh;
+    (void) buffer_size;
+    (void) timeout;
+    (void) debug;
+    _delimiter = output_delimiter;
+    _aborted = false;
+    gNumOobs = 0;
+}
+
+// Send a command, followed by the delimiter.
+bool ATCmdParser::vsend(const char *command, va_list args)
+{
+    char buffer[AT_MOCK_MAX_LINE_SIZE];
+    int length;
+
+    length = vsnprintf(buffer, sizeof(buffer) - strlen(_delimiter), command, args);
+    if (length > (int) (sizeof(buffer) - strlen(_delimiter) - 1)) {
+        length = sizeof(buffer) - strlen(_delimiter) - 1;
+    }
+    strcpy(buffer + length, _delimiter);
+    length += strlen(_delimiter);
+
+    return sent(buffer, length) == length;
+}
+
+bool ATCmdParser::send(const char *command, ...)
+{
+    va_list args;
+    bool success;
+
+    va_start(args, command);
+    success = vsend(command, args);
+    va_end(args);
+
+    return success;
+}
+
+// Receive a response, a line at a time: each line of the response
+// format is matched against the lines of the responses, throwing
+// away those that don't match and are not out of band.
+bool ATCmdParser::vrecv(const char *response, va_list args)
+{
+    char format[AT_MOCK_MAX_LINE_SIZE];
+    char suppressed[AT_MOCK_MAX_LINE_SIZE];
+    char line[AT_MOCK_MAX_LINE_SIZE];
+    const char *pEnd;
+    int length;
+    int numConversions;
+    int matched;
+    bool success = true;
+    va_list argsCopy;
+
+    _aborted = false;
+    while (success && (*response != 0)) {
+        // Take the next line of the format
+        pEnd = strchr(response, '\n');
+        length = (pEnd != NULL) ? pEnd - response : strlen(response);
+        if (length > (int) sizeof(format) - 1) {
+            length = sizeof(format) - 1;
+        }
+        memcpy(format, response, length);
+        format[length] = 0;
+        response += (pEnd != NULL) ? length + 1 : length;
+        numConversions = suppress(format, suppressed, sizeof(suppressed));
+        if (length > 0) {
+            // Find the line of the responses that matches it
+            matched = -1;
+            while (success && (matched <= 0)) {
+                success = nextLine(line, sizeof(line));
+                if (success && !handleOob(line)) {
+                    sscanf(line, suppressed, &matched);
+                } else {
+                    success = success && !_aborted;
+                }
+            }
+            if (success) {
+                // Leave what follows the match, e.g. the data
+                // of a read, for whatever comes next
+                if (line[matched] != 0) {
+                    pushBack(line + matched);
+                }
+                va_copy(argsCopy, args);
+                vsscanf(line, format, argsCopy);
+                va_end(argsCopy);
+                for (int x = 0; x < numConversions; x++) {
+                    va_arg(args, void *);
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+bool ATCmdParser::recv(const char *response, ...)
+{
+    va_list args;
+    bool success;
+
+    va_start(args, response);
+    success = vrecv(response, args);
+    va_end(args);
+
+    return success;
+}
+
+// Send a character.
+int ATCmdParser::putc(char c)
+{
+    return sent(&c, 1) == 1 ? c : -1;
+}
+
+// Get a character of the responses.
+int ATCmdParser::getc()
+{
+    return (gResponseIndex < gResponseSize) ? (unsigned char) gResponse[gResponseIndex++] : -1;
+}
+
+// Send data.
+int ATCmdParser::write(const char *data, int size)
+{
+    return sent(data, size);
+}
+
+// Read data from the responses.
+int ATCmdParser::read(char *data, int size)
+{
+    int length = 0;
+
+    while ((length < size) && (gResponseIndex < gResponseSize)) {
+        data[length] = gResponse[gResponseIndex];
+        gResponseIndex++;
+        length++;
+    }
+    if (gNumReads < AT_MOCK_MAX_NUM_READS) {
+        gReadSize[gNumReads] = size;
+        gNumReads++;
+    }
+
+    return (length == size) ? length : -1;
+}
+
+// Set an out of band handler.
+void ATCmdParser::oob(const char *prefix, Callback<void()> func)
+{
+    if (gNumOobs < AT_MOCK_MAX_NUM_OOBS) {
+        gOob[gNumOobs].pPrefix = prefix;
+        gOob[gNumOobs].callback = func;
+        gNumOobs++;
+    }
+}
+
+// Handle the next line of the responses if it is out of band.
+bool ATCmdParser::process_oob()
+{
+    char line[AT_MOCK_MAX_LINE_SIZE];
+    int index = gResponseIndex;
+    bool handled = false;
+
+    if (nextLine(line, sizeof(line))) {
+        handled = handleOob(line);
+        if (!handled) {
+            gResponseIndex = index;
+        }
+    }
+
+    return handled;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: MOCK
+ *************************************************************************/
+
+// Reset the mock modem.
+void atMockReset()
+{
+    gSentSize = 0;
+    gSent[0] = 0;
+    gNumWrites = 0;
+    gNumReads = 0;
+    gResponseSize = 0;
+    gResponseIndex = 0;
+}
+
+// Add to the responses.
+bool atMockAddResponse(const char *pResponse)
+{
+    int length = strlen(pResponse);
+    bool success = false;
+
+    // Move what is left to the start to make room
+    memmove(gResponse, gResponse + gResponseIndex, gResponseSize - gResponseIndex);
+    gResponseSize -= gResponseIndex;
+    gResponseIndex = 0;
+    if (length <= AT_MOCK_MAX_RESPONSE_SIZE - gResponseSize) {
+        memcpy(gResponse + gResponseSize, pResponse, length);
+        gResponseSize += length;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get what has been sent.
+int atMockGetSent(const char **ppSent)
+{
+    *ppSent = gSent;
+
+    return gSentSize;
+}
+
+// Get the sizes of the writes.
+int atMockGetWrites(const int **ppSizes)
+{
+    *ppSizes = gWriteSize;
+
+    return gNumWrites;
+}
+
+// Get the sizes of the reads.
+int atMockGetReads(const int **ppSizes)
+{
+    *ppSizes = gReadSize;
+
+    return gNumReads;
+}
+
+// End of file
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _AT_MOCK_H_
+#define _AT_MOCK_H_
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The most characters that are recorded as sent to the mock modem.
+ */
+#define AT_MOCK_MAX_SENT_SIZE 8192
+
+/** The most characters of responses that can be waiting.
+ */
+#define AT_MOCK_MAX_RESPONSE_SIZE 2048
+
+/** The most separate writes to the mock modem that are recorded.
+ */
+#define AT_MOCK_MAX_NUM_WRITES 256
+
+/** The most separate reads from the mock modem that are recorded.
+ */
+#define AT_MOCK_MAX_NUM_READS 256
+
+/** The most out of band handlers that can be set.
+ */
+#define AT_MOCK_MAX_NUM_OOBS 16
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Reset the mock modem: clear what has been sent and any responses
+ * that are waiting.  The out of band handlers of the ATCmdParser
+ * are kept.
+ */
+void atMockReset();
+
+/** Add to the responses that the mock modem will give, in order,
+ * one line after another as ATCmdParser::recv() asks for them,
+ * e.g. "0,10\r\nOK\r\n".  The lines that are not asked for are
+ * thrown away, unless they start with the prefix of an out of
+ * band handler, which is then called, as on a real modem.  What
+ * follows the part of a line that ATCmdParser::recv() matched is
+ * left for ATCmdParser::read(), getc() or the next recv().
+ *
+ * @param pResponse the response, a null-terminated string.
+ * @return          true if there was room for it, else false.
+ */
+bool atMockAddResponse(const char *pResponse);
+
+/** Get everything that has been sent to the mock modem.
+ *
+ * @param ppSent a place to put a pointer to what was sent,
+ *               which is null-terminated.
+ * @return       the number of characters sent.
+ */
+int atMockGetSent(const char **ppSent);
+
+/** Get the sizes of the separate writes to the mock modem: each
+ * call to ATCmdParser::send(), write() or putc() is one.
+ *
+ * @param ppSizes a place to put a pointer to the sizes.
+ * @return        the number of writes.
+ */
+int atMockGetWrites(const int **ppSizes);
+
+/** Get the sizes of the separate calls to ATCmdParser::read()
+ * of the mock modem.
+ *
+ * @param ppSizes a place to put a pointer to the sizes.
+ * @return        the number of reads.
+ */
+int atMockGetReads(const int **ppSizes);
+
+#endif // _AT_MOCK_H_
+
+// End Of File
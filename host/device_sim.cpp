@@ -0,0 +1,642 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host simulator of the whole device: the real processor, action,
+// data, codec, statistics and forecast code is driven through
+// wake-up after wake-up in virtual time, with the synthetic drivers
+// of act_host.cpp (GNSS and a SARA-R4 modem that take time, lose
+// datagrams and fail to connect as told) and a model of the supercap
+// and secondary cell behind VBAT_OK, charged from a harvest trace.
+// One line of CSV is written per simulated day so that two builds,
+// e.g. before and after a change to processorHandleWakeup() or
+// processorActionList(), can be compared.
+//
+// Built by the CMake project in this directory (see CMakeLists.txt),
+// with the peripheral code of eh_processor.cpp compiled in as for a
+// board without BLE (TARGET_UBLOX_C030_U201).  Run with -h for the
+// options.  The harvest trace has the format used by forecast_sim:
+// lines of "seconds,nW" giving the harvest rate of the energy source
+// ENERGY_SOURCE_DEFAULT from that many seconds after midnight UTC on
+// the first day; the other energy sources harvest nothing.  With no
+// trace a synthetic one is made, as forecast_sim does.
+//
+// Virtual time: the shim's host clock is run hostClockSetScale()
+// times faster than real time while the device is awake and is moved
+// on by hostClockAdvance() while it sleeps.  Thread scheduling on the
+// host adds a little to the time the device appears to be awake at
+// high scales, making the results slightly pessimistic.
+
+#include <math.h>   // For sin() and sqrt()
+#include <unistd.h> // For getopt()
+#include <mbed.h>
+#include <mbed_events.h>
+#include <log.h>
+#include <eh_utilities.h> // For ARRAY_SIZE
+#include <eh_config.h>
+#include <eh_debug.h>
+#include <eh_action.h>
+#include <eh_data.h>
+#include <eh_statistics.h>
+#include <eh_processor.h>
+#include <eh_timeline.h>
+#include <act_voltages.h>
+#include <act_energy_source.h>
+#include <act_bme280.h>
+#include <act_lis3dh.h>
+#include <act_si1133.h>
+#include <act_si7210.h>
+#include <act_host.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The maximum number of points in a trace.
+ */
+#define MAX_NUM_POINTS 100000
+
+/** When the simulation starts: the trace is taken to begin at
+ * midnight UTC on this day (1st July 2018).
+ */
+#define START_TIME_UTC 1530403200
+
+/** The default number of days to simulate.
+ */
+#define DEFAULT_DAYS 14
+
+/** The default number of virtual seconds per real second
+ * while the device is awake.
+ */
+#define DEFAULT_CLOCK_SCALE 100
+
+/** The peak harvest rate of the synthetic trace, on a sunny day.
+ */
+#define SYNTHETIC_PEAK_NW 1500000
+
+/** The highest voltage the supercap charges to; any more
+ * harvest goes to the secondary cell or is spilled.
+ */
+#define SUPERCAP_FULL_MV 4200
+
+/** The voltage at which the secondary cell holds the supercap
+ * while it has charge: loads are met by the supercap down to this
+ * and by the secondary cell after that, the supercap only sagging
+ * further once the secondary cell is flat.  This is above
+ * VBAT_OK_GOOD_THRESHOLD_MV, where getEnergyAvailableNWH() assumes
+ * that the secondary cell is charged.
+ */
+#define SECONDARY_MV 4000
+
+/** The power drawn while asleep: the processor and the
+ * sensors that are always on.
+ */
+#define SLEEP_NW (PROCESSOR_POWER_IDLE_NW + BME280_POWER_IDLE_NW + \
+                  LIS3DH_POWER_IDLE_NW + SI1133_POWER_IDLE_NW +    \
+                  SI7210_POWER_IDLE_NW)
+
+/** The power drawn while awake, before the actions.
+ */
+#define AWAKE_NW (PROCESSOR_POWER_ACTIVE_NW + SLEEP_NW - PROCESSOR_POWER_IDLE_NW)
+
+/** VIN when the energy source in use is harvesting.
+ */
+#define VIN_HARVESTING_MV 3000
+
+/** nW microseconds per nWh.
+ */
+#define NW_US_PER_NWH 3600000000.0
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A point in a harvest trace.
+ */
+typedef struct {
+    int seconds;
+    int harvestNW;
+} Point;
+
+/** What happened on a day.
+ */
+typedef struct {
+    unsigned int numWakeUps;
+    unsigned int numEnergeticWakeUps;
+    unsigned int numReports;
+    unsigned int numConnectFailures;
+    unsigned int numSendFailures;
+    unsigned int numDropped;
+    unsigned int numRemovedQueue;
+    unsigned int numRemovedEnergy;
+    unsigned int numDatagramsSent;
+    unsigned int numDatagramsDelivered;
+    unsigned int numBytesDelivered;
+    unsigned int queuePercentMax;
+    unsigned int queuePercentEnd; //!< At the end of the last wake-up.
+    int vBatOkMinMV;
+    unsigned int secondsFlat;
+    double harvestedNWH;
+    double usedNWH;
+    double spilledNWH;
+} Day;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The trace.
+ */
+static Point gPoints[MAX_NUM_POINTS];
+
+/** The number of points in the trace.
+ */
+static int gNumPoints = 0;
+
+/** The index of the trace point last used.
+ */
+static int gPointIndex = 0;
+
+/** The buffer for the data queue, as main.cpp has it.
+ */
+static int gDataBuffer[DATA_MAX_SIZE_WORDS];
+
+/** The timeline store, as main.cpp has it.
+ */
+static int gTimelineStore[TIMELINE_STORE_SIZE / 4];
+
+/** Lock for everything below.
+ */
+static std::mutex gMtx;
+
+/** The energy in the supercap and in the secondary cell.
+ */
+static double gSupercapNWH;
+static double gSecondaryNWH;
+
+/** The host clock time up to which the energy model has been run.
+ */
+static long long int gModelUs;
+
+/** The host clock time at which the simulation started.
+ */
+static long long int gStartUs;
+
+/** True while the device is awake.
+ */
+static bool gAwake = false;
+
+/** Today.
+ */
+static Day gDay;
+
+/** The day number of gDay.
+ */
+static int gDayNumber = 0;
+
+/** The modem counts at the start of the day.
+ */
+static ActHostCounts gCountsStart;
+
+/** Where the CSV goes.
+ */
+static FILE *gpCsv = NULL;
+
+/**************************************************************************
+ * STATIC FUNCTIONS: HARVEST TRACE
+ *************************************************************************/
+
+// Read a trace from file, returning the number of points.
+static int readTrace(const char *pFileName)
+{
+    FILE *pFile = fopen(pFileName, "r");
+    char line[128];
+    int seconds;
+    int harvestNW;
+
+    gNumPoints = 0;
+    if (pFile != NULL) {
+        while ((gNumPoints < MAX_NUM_POINTS) && (fgets(line, sizeof(line), pFile) != NULL)) {
+            if ((line[0] != '#') && (sscanf(line, "%d,%d", &seconds, &harvestNW) == 2)) {
+                gPoints[gNumPoints].seconds = seconds;
+                gPoints[gNumPoints].harvestNW = harvestNW;
+                gNumPoints++;
+            }
+        }
+        fclose(pFile);
+    } else {
+        fprintf(stderr, "Unable to open \"%s\".\n", pFileName);
+    }
+
+    return gNumPoints;
+}
+
+// Make a synthetic trace, a point every ten minutes, as
+// forecast_sim does.
+static int makeTrace(int days)
+{
+    double sun;
+    double cloud = 1;
+    double dayCloud = 1;
+    int seconds;
+
+    gNumPoints = 0;
+    for (seconds = 0; (seconds < days * 3600 * 24) && (gNumPoints < MAX_NUM_POINTS); seconds += 600) {
+        if (seconds % (3600 * 24) == 0) {
+            // One day in three is dull
+            dayCloud = (rand() % 3 == 0) ? 0.1 : 0.4 + (rand() % 60) / 100.0;
+        }
+        if (seconds % 3600 == 0) {
+            cloud = dayCloud * (0.5 + (rand() % 50) / 100.0);
+        }
+        sun = sin(3.14159265 * ((seconds % (3600 * 24)) - 5 * 3600) / (16 * 3600));
+        gPoints[gNumPoints].seconds = seconds;
+        gPoints[gNumPoints].harvestNW = (sun > 0) ? (int) (SYNTHETIC_PEAK_NW * sun * cloud) : 0;
+        gNumPoints++;
+    }
+
+    return gNumPoints;
+}
+
+// Return the harvest rate at a time into the trace.
+static int traceNW(int seconds)
+{
+    if (gPointIndex >= gNumPoints) {
+        gPointIndex = 0;
+    }
+    while ((gPointIndex + 1 < gNumPoints) && (gPoints[gPointIndex + 1].seconds <= seconds)) {
+        gPointIndex++;
+    }
+
+    return (gNumPoints > 0) ? gPoints[gPointIndex].harvestNW : 0;
+}
+
+/**************************************************************************
+ * STATIC FUNCTIONS: ENERGY MODEL
+ *************************************************************************/
+
+// The voltage of the supercap holding the given energy,
+// the inverse of the sum in getEnergyAvailableNWH().
+static int supercapMV(double energyNWH)
+{
+    return (int) sqrt(energyNWH * 1000 * 3600 * 2 / SUPERCAP_MICROFARADS);
+}
+
+// The energy in the supercap at the given voltage.
+static double supercapNWH(int mV)
+{
+    return ((double) SUPERCAP_MICROFARADS) / 2 * mV * mV / 1000 / 3600;
+}
+
+// The ADC reading for a voltage, the inverse of READING_TO_MV()
+// in act_voltages.cpp.
+static unsigned short reading(int mV)
+{
+    int x = (mV > 0) ? mV * 14200 / 1000 + 60 : 0;
+
+    return (unsigned short) ((x > 0xFFFF) ? 0xFFFF : x);
+}
+
+// Move energy between the supercap and the secondary cell: the
+// secondary cell holds the supercap up at SECONDARY_MV while it
+// has charge and soaks up what the supercap, when full, can't take.
+static void balance()
+{
+    double holdNWH = supercapNWH(SECONDARY_MV);
+    double fullNWH = supercapNWH(SUPERCAP_FULL_MV);
+    double energyNWH;
+
+    if ((gSupercapNWH < holdNWH) && (gSecondaryNWH > 0)) {
+        energyNWH = holdNWH - gSupercapNWH;
+        if (energyNWH > gSecondaryNWH) {
+            energyNWH = gSecondaryNWH;
+        }
+        gSecondaryNWH -= energyNWH;
+        gSupercapNWH += energyNWH;
+    }
+    if (gSupercapNWH > fullNWH) {
+        gSecondaryNWH += gSupercapNWH - fullNWH;
+        gSupercapNWH = fullNWH;
+        if (gSecondaryNWH > SECONDARY_BATTERY_CAPACITY_NWH) {
+            gDay.spilledNWH += gSecondaryNWH - SECONDARY_BATTERY_CAPACITY_NWH;
+            gSecondaryNWH = SECONDARY_BATTERY_CAPACITY_NWH;
+        }
+    }
+    if (gSupercapNWH < 0) {
+        gSupercapNWH = 0;
+    }
+}
+
+// Write out a day and start the next.
+static void dayEnd()
+{
+    ActHostCounts counts;
+    unsigned int x;
+
+    actHostGetCounts(&counts);
+    gDay.numDatagramsSent = counts.numDatagramsSent - gCountsStart.numDatagramsSent;
+    gDay.numDatagramsDelivered = counts.numDatagramsDelivered - gCountsStart.numDatagramsDelivered;
+    gDay.numBytesDelivered = counts.numBytesDelivered - gCountsStart.numBytesDelivered;
+    fprintf(gpCsv, "%d,%u,%u,%.0f,%.0f,%.0f,%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+            gDayNumber, gDay.numWakeUps, gDay.numEnergeticWakeUps,
+            gDay.harvestedNWH / 1000, gDay.usedNWH / 1000, gDay.spilledNWH / 1000,
+            gDay.vBatOkMinMV, gDay.secondsFlat, gDay.numReports,
+            gDay.numDatagramsSent, gDay.numDatagramsDelivered, gDay.numBytesDelivered,
+            gDay.queuePercentMax, gDay.queuePercentEnd, gDay.numDropped,
+            gDay.numRemovedQueue, gDay.numRemovedEnergy,
+            gDay.numConnectFailures, gDay.numSendFailures);
+    fflush(gpCsv);
+
+    gCountsStart = counts;
+    x = gDay.queuePercentEnd;
+    memset(&gDay, 0, sizeof(gDay));
+    gDay.queuePercentEnd = x;
+    gDay.vBatOkMinMV = supercapMV(gSupercapNWH);
+    gDayNumber++;
+}
+
+// Run the energy model up to the host clock time, harvesting
+// and drawing the sleeping or awake load, and set VBAT_OK and
+// VIN from it.  Must be called with gMtx locked.
+static void modelRun(long long int toUs)
+{
+    long long int us;
+    int seconds;
+    int nW;
+    int mV;
+    double energyNWH;
+    double badNWH = supercapNWH(VBAT_OK_BAD_THRESHOLD_MV);
+
+    while (gModelUs < toUs) {
+        // A second at a time, or to the next second boundary
+        seconds = (int) ((gModelUs - gStartUs) / 1000000);
+        if (seconds / (3600 * 24) > gDayNumber) {
+            dayEnd();
+        }
+        us = gStartUs + ((long long int) seconds + 1) * 1000000;
+        if (us > toUs) {
+            us = toUs;
+        }
+        us -= gModelUs;
+
+        // Harvest, if the energy source in use is the one in the trace
+        nW = (getEnergySource() == ENERGY_SOURCE_DEFAULT) ? traceNW(seconds) : 0;
+        energyNWH = ((double) nW) * us / NW_US_PER_NWH;
+        gDay.harvestedNWH += energyNWH;
+        gSupercapNWH += energyNWH;
+
+        // Load
+        energyNWH = ((double) (gAwake ? AWAKE_NW : SLEEP_NW)) * us / NW_US_PER_NWH;
+        gDay.usedNWH += energyNWH;
+        gSupercapNWH -= energyNWH;
+
+        balance();
+
+        mV = supercapMV(gSupercapNWH);
+        if (mV < gDay.vBatOkMinMV) {
+            gDay.vBatOkMinMV = mV;
+        }
+        if ((gSupercapNWH < badNWH) && (us == 1000000)) {
+            gDay.secondsFlat++;
+        }
+        hostAnalogInSet(PIN_ANALOGUE_VBAT_OK, reading(mV));
+        hostAnalogInSet(PIN_ANALOGUE_VIN, reading((nW > 0) ? VIN_HARVESTING_MV : 0));
+        gModelUs += us;
+    }
+}
+
+// Called by the synthetic drivers with the energy they draw.
+static void energyDrawn(unsigned long long int energyNWH)
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+
+    modelRun(hostClockUs());
+    gDay.usedNWH += energyNWH;
+    gSupercapNWH -= energyNWH;
+    balance();
+    hostAnalogInSet(PIN_ANALOGUE_VBAT_OK, reading(supercapMV(gSupercapNWH)));
+}
+
+// Called with each event that is logged.
+static void logged(LogEvent event, int parameter)
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+
+    switch (event) {
+        case EVENT_PROCESSOR_RUNNING:
+            gDay.numEnergeticWakeUps++;
+        break;
+        case EVENT_ACTION_THREAD_STARTED:
+            if ((parameter == ACTION_TYPE_REPORT) ||
+                (parameter == ACTION_TYPE_GET_TIME_AND_REPORT)) {
+                gDay.numReports++;
+            }
+        break;
+        case EVENT_CONNECT_FAILURE:
+            gDay.numConnectFailures++;
+        break;
+        case EVENT_SEND_FAILURE:
+            gDay.numSendFailures++;
+        break;
+        case EVENT_DATA_ITEM_ALLOC_FAILURE:
+            gDay.numDropped++;
+        break;
+        case EVENT_ACTION_REMOVED_QUEUE_LIMIT:
+            gDay.numRemovedQueue++;
+        break;
+        case EVENT_ACTION_REMOVED_ENERGY_LIMIT:
+            gDay.numRemovedEnergy++;
+        break;
+        default:
+        break;
+    }
+}
+
+// Write the timeline, as timelinePrint() would print it.
+static bool writeTimeline(const char *pFileName)
+{
+    static TimelineRecord records[TIMELINE_STORE_SIZE / sizeof(TimelineRecord)];
+    FILE *pFile;
+    int numRecords;
+
+    pFile = fopen(pFileName, "w");
+    if (pFile != NULL) {
+        numRecords = timelineGet(records, ARRAY_SIZE(records));
+        for (int x = 0; x < numRecords; x++) {
+            fprintf(pFile, "TIMELINE,%u,%d,%d,%d,%d\n", records[x].timeUs, records[x].id,
+                    records[x].phaseThread >> TIMELINE_PHASE_SHIFT,
+                    records[x].phaseThread & TIMELINE_THREAD_MASK,
+                    records[x].param);
+        }
+        fclose(pFile);
+    }
+
+    return (pFile != NULL);
+}
+
+// Print the options.
+static void usage(const char *pName)
+{
+    printf("Usage: %s [options] [trace file]\n"
+           "  -d days      number of days to simulate (default %d).\n"
+           "  -o file      write the CSV to a file rather than stdout.\n"
+           "  -s seed      seed for the random number generator (default 1).\n"
+           "  -x scale     virtual seconds per real second while awake (default %d).\n"
+           "  -g seconds   time for GNSS to get a fix (default 0).\n"
+           "  -r seconds   time for the modem to register from off (default 0).\n"
+           "  -f percent   chance of a connection failing (default 0).\n"
+           "  -L ms        time to send a datagram and get its ack (default 0).\n"
+           "  -l percent   chance of a datagram or its ack being lost (default 0).\n"
+           "  -p dBm       received signal strength (default -95).\n"
+           "  -t file      write the timeline at the end to a file, for timeline-decode.py.\n"
+           "  -v           print each log event as it happens.\n",
+           pName, DEFAULT_DAYS, DEFAULT_CLOCK_SCALE);
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static EventQueue eventQueue(10 * EVENTS_EVENT_SIZE);
+    ActHostModel model;
+    const char *pTimelineFileName = NULL;
+    int days = DEFAULT_DAYS;
+    unsigned int seed = 1;
+    unsigned int scale = DEFAULT_CLOCK_SCALE;
+    long long int endUs;
+    int interval;
+    int x;
+
+    memset(&model, 0, sizeof(model));
+    gpCsv = stdout;
+    while ((x = getopt(argc, argv, "d:o:s:x:g:r:f:L:l:p:t:vh")) != -1) {
+        switch (x) {
+            case 'd': days = atoi(optarg); break;
+            case 'o':
+                gpCsv = fopen(optarg, "w");
+                if (gpCsv == NULL) {
+                    fprintf(stderr, "Unable to open \"%s\".\n", optarg);
+                    return 1;
+                }
+            break;
+            case 's': seed = (unsigned int) atoi(optarg); break;
+            case 'x': scale = (unsigned int) atoi(optarg); break;
+            case 'g': model.gnssFixSeconds = atoi(optarg); break;
+            case 'r': model.modemRegisterSeconds = atoi(optarg); break;
+            case 'f': model.modemConnectFailPercent = atoi(optarg); break;
+            case 'L': model.modemLatencyMs = atoi(optarg); break;
+            case 'l': model.modemLossPercent = atoi(optarg); break;
+            case 'p': model.modemRsrpDbm = atoi(optarg); break;
+            case 't': pTimelineFileName = optarg; break;
+            case 'v': hostLogPrint(true); break;
+            default:
+                usage(argv[0]);
+                return (x == 'h') ? 0 : 1;
+        }
+    }
+
+    srand(seed);
+    if (optind < argc) {
+        readTrace(argv[optind]);
+    } else {
+        makeTrace(days);
+    }
+    if (gNumPoints < 1) {
+        fprintf(stderr, "Need a trace of at least one point.\n");
+        return 1;
+    }
+
+    // Start up as main.cpp does, full of energy
+    set_time(START_TIME_UTC);
+    hostClockSetScale(scale);
+    initLog(NULL);
+    timelineInit((char *) gTimelineStore);
+    dataInit(gDataBuffer);
+    debugInit(NULL);
+    actionInit();
+    statisticsInit();
+    setEnergySource(ENERGY_SOURCE_DEFAULT);
+    gSupercapNWH = supercapNWH(SECONDARY_MV);
+    gSecondaryNWH = SECONDARY_BATTERY_CAPACITY_NWH;
+    gStartUs = hostClockUs();
+    gModelUs = gStartUs;
+    memset(&gDay, 0, sizeof(gDay));
+    gDay.vBatOkMinMV = SECONDARY_MV;
+    modelRun(gStartUs);
+    actHostSetModel(&model);
+    actHostSetEnergyCallback(energyDrawn);
+    hostLogCallback(logged);
+    processorInit();
+
+    fprintf(gpCsv, "day,wake_ups,energetic_wake_ups,harvested_uwh,used_uwh,spilled_uwh,"
+                   "min_vbat_ok_mv,seconds_flat,reports,datagrams_sent,datagrams_delivered,"
+                   "bytes_delivered,queue_percent_max,queue_percent_end,dropped,"
+                   "removed_queue_limit,removed_energy_limit,connect_failures,send_failures\n");
+
+    endUs = gStartUs + ((long long int) days) * 3600 * 24 * 1000000;
+    while (hostClockUs() < endUs) {
+        // Wake up
+        gMtx.lock();
+        modelRun(hostClockUs());
+        gDay.numWakeUps++;
+        gAwake = true;
+        gMtx.unlock();
+
+        processorHandleWakeup(&eventQueue);
+
+        gMtx.lock();
+        modelRun(hostClockUs());
+        gAwake = false;
+        gMtx.unlock();
+        x = dataGetPercentageBytesUsed();
+        gMtx.lock();
+        gDay.queuePercentEnd = x;
+        if (x > (int) gDay.queuePercentMax) {
+            gDay.queuePercentMax = x;
+        }
+        gMtx.unlock();
+
+        // Sleep
+        interval = processorWakeUpIntervalSeconds();
+        if (interval <= 0) {
+            interval = WAKEUP_INTERVAL_SECONDS;
+        }
+        hostClockAdvance(((long long int) interval) * 1000000);
+        gMtx.lock();
+        modelRun(hostClockUs());
+        gMtx.unlock();
+    }
+
+    // The last day, unless the last sleep finished it off
+    gMtx.lock();
+    if (gDayNumber < days) {
+        dayEnd();
+    }
+    gMtx.unlock();
+    hostLogCallback(NULL);
+    actHostSetEnergyCallback(NULL);
+    if ((pTimelineFileName != NULL) && !writeTimeline(pTimelineFileName)) {
+        fprintf(stderr, "Unable to write \"%s\".\n", pTimelineFileName);
+    }
+    if (gpCsv != stdout) {
+        fclose(gpCsv);
+    }
+
+    return 0;
+}
+
+// End of file
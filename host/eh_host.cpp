@@ -0,0 +1,154 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// eh_debug and eh_watchdog for a host build: there is no LED, no
+// watchdog and no non-volatile memory, and the RAM figures come from
+// the C library heap.
+
+#include <mbed.h>
+#include <mbed_stats.h>
+#include <eh_debug.h>
+#include <eh_watchdog.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The heap the target has, against which the heap left is worked out.
+ */
+#define HOST_HEAP_SIZE 32768
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The heap in use when debug was initialised.
+ */
+static uint32_t gHeapBase = 0;
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: DEBUG
+ *************************************************************************/
+
+// Initialise debug.
+void debugInit(mbed_error_hook_t fatalErrorHook)
+{
+    mbed_stats_heap_t stats;
+
+    (void) fatalErrorHook;
+    mbed_stats_heap_get(&stats);
+    gHeapBase = stats.current_size;
+}
+
+// Pulse the debug LED.
+void debugPulseLed(int milliseconds)
+{
+    (void) milliseconds;
+}
+
+// Flash the victory LED.
+void debugVictoryLed(int count)
+{
+    (void) count;
+}
+
+// Indicate that something bad has happened.
+void debugBad(int pulses)
+{
+    printf("debugBad(%d)\n", pulses);
+}
+
+// Get the heap left, as if the target's heap were in use.
+int debugGetHeapLeft()
+{
+    mbed_stats_heap_t stats;
+
+    mbed_stats_heap_get(&stats);
+
+    return HOST_HEAP_SIZE - (int) (stats.current_size - gHeapBase);
+}
+
+// Get the minimum heap left.
+int debugGetHeapMinLeft()
+{
+    mbed_stats_heap_t stats;
+
+    mbed_stats_heap_get(&stats);
+
+    return HOST_HEAP_SIZE - (int) (stats.max_size - gHeapBase);
+}
+
+// Get the minimum stack left: not known on a host.
+int debugGetStackMinLeft()
+{
+    return -1;
+}
+
+// Print the RAM stats.
+void debugPrintRamStats()
+{
+    printf("Heap left: %d byte(s), minimum %d byte(s).\n",
+           debugGetHeapLeft(), debugGetHeapMinLeft());
+}
+
+// Write error information to non-volatile memory: there is none.
+void debugWriteErrorNV(RestartReason reason,
+                       time_t restartTime,
+                       unsigned int lR,
+                       const mbed_error_ctx *pErrorContext)
+{
+    (void) reason;
+    (void) restartTime;
+    (void) lR;
+    (void) pErrorContext;
+}
+
+// Read error information from non-volatile memory: there is none.
+RestartReason debugReadErrorNV(time_t *pRestartTime,
+                               unsigned int *pLR,
+                               mbed_error_ctx *pErrorContext)
+{
+    (void) pRestartTime;
+    (void) pLR;
+    (void) pErrorContext;
+
+    return RESTART_REASON_NO_RESTART;
+}
+
+// Reset the error information in non-volatile memory.
+void debugResetErrorNV()
+{
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS: WATCHDOG
+ *************************************************************************/
+
+// Initialise the watchdog: there isn't one.
+bool initWatchdog(int timeoutSeconds, void (*pInterruptCallback)(void))
+{
+    (void) timeoutSeconds;
+    (void) pInterruptCallback;
+
+    return true;
+}
+
+// Feed the watchdog.
+void feedWatchdog()
+{
+}
+
+// End of file
@@ -0,0 +1,298 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host simulator of the harvest forecaster: replays a harvest trace
+// into a model of the supercap and compares waking up at the fixed
+// WAKEUP_INTERVAL_SECONDS with waking up when eh_forecast says to.
+// Built by the CMake project in this directory (see CMakeLists.txt)
+// and run with the name of a trace file, lines of "seconds,nW"
+// giving the harvest rate from that many seconds into the trace
+// (lines beginning with # are ignored), e.g. recorded from the
+// HARVEST_ESTIMATE_NW log points of a device, or with no argument
+// for a synthetic two weeks of changeable weather on a solar cell.
+
+#include <math.h> // For sin()
+#include <mbed.h>
+#include <eh_utilities.h> // For ARRAY_SIZE
+#include <eh_config.h>
+#include <eh_forecast.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The maximum number of points in a trace.
+ */
+#define MAX_NUM_POINTS 100000
+
+/** When the simulation starts: the trace is taken to begin at
+ * midnight UTC on this day (1st July 2018).
+ */
+#define START_TIME_UTC 1530403200
+
+/** The length of the synthetic trace.
+ */
+#define SYNTHETIC_DAYS 14
+
+/** The peak harvest rate of the synthetic trace, on a sunny day.
+ */
+#define SYNTHETIC_PEAK_NW 1500000
+
+/** The power used while asleep, as PROCESSOR_POWER_IDLE_NW.
+ */
+#define IDLE_NW 16200
+
+/** The energy an energetic wake-up costs: three seconds with the
+ * processor active, as PROCESSOR_POWER_ACTIVE_NW, plus the actions.
+ */
+#define WAKE_UP_ENERGY_NWH (3ULL * 7200000 / 3600 + 8000)
+
+/** The energy a wake-up which finds too little energy costs: 50 ms
+ * with the processor active.
+ */
+#define WAKE_UP_SHORT_ENERGY_NWH (50ULL * 7200000 / 3600000)
+
+/** The energy in the 470 mF supercap, above VBAT_OK_BAD_THRESHOLD_MV
+ * (3.0 V), when it is full (4.2 V).
+ */
+#define SUPERCAP_FULL_NWH (470000ULL / 2 * (4200ULL * 4200 - 3000ULL * 3000) / 1000 / 3600)
+
+/** The energy in the supercap, above VBAT_OK_BAD_THRESHOLD_MV,
+ * at VBAT_OK_BEARABLE_THRESHOLD_MV (3.3 V).
+ */
+#define SUPERCAP_BEARABLE_NWH (470000ULL / 2 * (3300ULL * 3300 - 3000ULL * 3000) / 1000 / 3600)
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A point in a harvest trace.
+ */
+typedef struct {
+    int seconds;
+    int harvestNW;
+} Point;
+
+/** The ways of choosing when to wake up.
+ */
+typedef enum {
+    POLICY_FIXED,
+    POLICY_FORECAST,
+    MAX_NUM_POLICIES
+} Policy;
+
+/** The outcome of a simulation.
+ */
+typedef struct {
+    unsigned int numWakeUps;
+    unsigned int numEnergeticWakeUps;
+    unsigned int numTooLittleEnergy;
+    unsigned int secondsFlat;
+    unsigned int longestGapSeconds;
+    unsigned long long int spilledNWH;
+    unsigned long long int harvestedNWH;
+} Outcome;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The trace.
+ */
+static Point gPoints[MAX_NUM_POINTS];
+
+/** The number of points in the trace.
+ */
+static int gNumPoints = 0;
+
+/** The names of the policies.
+ */
+static const char *gpPolicyName[] = {"fixed", "forecast"};
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Read a trace from file, returning the number of points.
+static int readTrace(const char *pFileName)
+{
+    FILE *pFile = fopen(pFileName, "r");
+    char line[128];
+    int seconds;
+    int harvestNW;
+
+    gNumPoints = 0;
+    if (pFile != NULL) {
+        while ((gNumPoints < MAX_NUM_POINTS) && (fgets(line, sizeof(line), pFile) != NULL)) {
+            if ((line[0] != '#') && (sscanf(line, "%d,%d", &seconds, &harvestNW) == 2)) {
+                gPoints[gNumPoints].seconds = seconds;
+                gPoints[gNumPoints].harvestNW = harvestNW;
+                gNumPoints++;
+            }
+        }
+        fclose(pFile);
+    } else {
+        printf("Unable to open \"%s\".\n", pFileName);
+    }
+
+    return gNumPoints;
+}
+
+// Make a synthetic trace, a point every ten minutes: daylight from
+// 05:00 to 21:00 UTC, shaped as a half sine, with the weather
+// changing from day to day and hour to hour.
+static int makeTrace()
+{
+    double sun;
+    double cloud = 1;
+    double dayCloud = 1;
+    int seconds;
+
+    srand(1);
+    gNumPoints = 0;
+    for (seconds = 0; seconds < SYNTHETIC_DAYS * 3600 * 24; seconds += 600) {
+        if (seconds % (3600 * 24) == 0) {
+            // One day in three is dull
+            dayCloud = (rand() % 3 == 0) ? 0.1 : 0.4 + (rand() % 60) / 100.0;
+        }
+        if (seconds % 3600 == 0) {
+            cloud = dayCloud * (0.5 + (rand() % 50) / 100.0);
+        }
+        sun = sin(3.14159265 * ((seconds % (3600 * 24)) - 5 * 3600) / (16 * 3600));
+        gPoints[gNumPoints].seconds = seconds;
+        gPoints[gNumPoints].harvestNW = (sun > 0) ? (int) (SYNTHETIC_PEAK_NW * sun * cloud) : 0;
+        gNumPoints++;
+    }
+
+    return gNumPoints;
+}
+
+// Return the harvest rate at a time into the trace.
+static int harvestNW(int seconds, int *pIndex)
+{
+    while ((*pIndex + 1 < gNumPoints) && (gPoints[*pIndex + 1].seconds <= seconds)) {
+        (*pIndex)++;
+    }
+
+    return gPoints[*pIndex].harvestNW;
+}
+
+// Run the trace through the supercap model with the given
+// policy.
+static void simulate(Policy policy, Outcome *pOutcome)
+{
+    long long int energyNWH = SUPERCAP_FULL_NWH / 2;
+    long long int energyNWS = 0; // Remainder, in nanoWatt seconds
+    unsigned long long int budgetNWH;
+    int endSeconds = gPoints[gNumPoints - 1].seconds;
+    int nextWakeUpSeconds = 0;
+    int lastEnergeticSeconds = 0;
+    int intervalSeconds = WAKEUP_INTERVAL_SECONDS;
+    int index = 0;
+    int nW;
+
+    memset(pOutcome, 0, sizeof(*pOutcome));
+    forecastReset();
+
+    for (int seconds = 0; seconds < endSeconds; seconds++) {
+        // Harvest and sleep for a second
+        nW = harvestNW(seconds, &index);
+        pOutcome->harvestedNWH += nW;
+        energyNWS += nW - IDLE_NW;
+        energyNWH += energyNWS / 3600;
+        energyNWS %= 3600;
+        if (energyNWH > (long long int) SUPERCAP_FULL_NWH) {
+            pOutcome->spilledNWH += energyNWH - SUPERCAP_FULL_NWH;
+            energyNWH = SUPERCAP_FULL_NWH;
+        }
+        if (energyNWH <= 0) {
+            energyNWH = 0;
+            energyNWS = 0;
+            pOutcome->secondsFlat++;
+        }
+
+        if (seconds >= nextWakeUpSeconds) {
+            pOutcome->numWakeUps++;
+            budgetNWH = energyNWH;
+            if (policy == POLICY_FORECAST) {
+                budgetNWH = forecastEnergyBudgetNWH(1, START_TIME_UTC + seconds,
+                                                    energyNWH, IDLE_NW);
+            }
+            if ((energyNWH >= (long long int) SUPERCAP_BEARABLE_NWH) &&
+                (budgetNWH >= WAKE_UP_ENERGY_NWH)) {
+                pOutcome->numEnergeticWakeUps++;
+                energyNWH -= WAKE_UP_ENERGY_NWH;
+                if (seconds - lastEnergeticSeconds > (int) pOutcome->longestGapSeconds) {
+                    pOutcome->longestGapSeconds = seconds - lastEnergeticSeconds;
+                }
+                lastEnergeticSeconds = seconds;
+                // The device measures what it harvested while awake
+                forecastUpdate(1, START_TIME_UTC + seconds, nW);
+            } else {
+                pOutcome->numTooLittleEnergy++;
+                energyNWH -= WAKE_UP_SHORT_ENERGY_NWH;
+            }
+            if (policy == POLICY_FORECAST) {
+                intervalSeconds = forecastWakeUpIntervalSeconds(1, START_TIME_UTC + seconds,
+                                                                energyNWH > 0 ? energyNWH : 0,
+                                                                WAKE_UP_ENERGY_NWH, IDLE_NW);
+            }
+            nextWakeUpSeconds = seconds + intervalSeconds;
+        }
+    }
+    if (endSeconds - lastEnergeticSeconds > (int) pOutcome->longestGapSeconds) {
+        pOutcome->longestGapSeconds = endSeconds - lastEnergeticSeconds;
+    }
+    pOutcome->harvestedNWH /= 3600;
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    Outcome outcome;
+
+    if (argc > 1) {
+        readTrace(argv[1]);
+    } else {
+        makeTrace();
+    }
+
+    if (gNumPoints > 1) {
+        printf("%d point(s) over %.1f day(s), supercap %llu uWh full, wake-up %llu nWh,"
+               " interval %d s fixed or %d to %d s.\n", gNumPoints,
+               (double) gPoints[gNumPoints - 1].seconds / (3600 * 24),
+               SUPERCAP_FULL_NWH / 1000, WAKE_UP_ENERGY_NWH, WAKEUP_INTERVAL_SECONDS,
+               WAKEUP_INTERVAL_MIN_SECONDS, WAKEUP_INTERVAL_MAX_SECONDS);
+        for (int policy = 0; policy < MAX_NUM_POLICIES; policy++) {
+            simulate((Policy) policy, &outcome);
+            printf("  %-8s: %6u wake-up(s), %6u doing work, %6u too little energy,"
+                   " longest gap %5u s, flat %6u s, spilled %6llu of %6llu uWh.\n",
+                   gpPolicyName[policy], outcome.numWakeUps, outcome.numEnergeticWakeUps,
+                   outcome.numTooLittleEnergy, outcome.longestGapSeconds,
+                   outcome.secondsFlat, outcome.spilledNWH / 1000,
+                   outcome.harvestedNWH / 1000);
+        }
+    } else {
+        printf("Need a trace of at least two points.\n");
+    }
+
+    return 0;
+}
+
+// End of file
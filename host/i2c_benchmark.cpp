@@ -0,0 +1,295 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of the I2C bus occupancy of a wake-up, using the
+// eh_i2c transaction engine over a mock bus.  Built by the CMake
+// project in this directory (see CMakeLists.txt).
+//
+// The same registers are read four ways: one register per blocking
+// i2cSendReceive() call, as a driver that doesn't burst-read would,
+// one burst per block, as the drivers do at best, one register per
+// i2cSubmit() while the bus is busy, as several action threads would,
+// leaving the engine to merge them, and one register per transaction
+// of an i2cSendReceiveMany() call per block, as a driver reading
+// several registers together does.
+//
+// Every register must arrive in the right place and the statistics
+// kept by eh_i2c must agree with what the mock bus saw, else this
+// exits non-zero; ctest runs it as a test.
+
+#include <mbed.h>
+#include <eh_utilities.h> // For ARRAY_SIZE
+#include <eh_i2c.h>
+#include <i2c_mock.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The most registers read in one block.
+ */
+#define MAX_BLOCK_SIZE 16
+
+/** The most registers read in a wake-up.
+ */
+#define MAX_NUM_REGISTERS 64
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A block of adjacent registers read from a device in a wake-up.
+ */
+typedef struct {
+    const char *pName;
+    char i2cAddress;
+    char firstRegister;
+    int numRegisters;
+} Block;
+
+/** The ways of reading the blocks.
+ */
+typedef enum {
+    MODE_REGISTER_AT_A_TIME,
+    MODE_BURST,
+    MODE_QUEUED,
+    MODE_MANY,
+    MAX_NUM_MODES
+} Mode;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The measurement registers a wake-up reads: BME280 pressure,
+ * temperature and humidity, Si1133 IRQ status and four channels,
+ * Si7210 field and LIS3DH X/Y/Z (bit 7 asking it to auto-increment).
+ */
+static const Block gBlocks[] = {{"BME280", 0x76, (char) 0xf7, 8},
+                                {"SI1133", 0x52, 0x12, 13},
+                                {"SI7210", 0x33, (char) 0xc1, 2},
+                                {"LIS3DH", 0x18, (char) 0xa8, 6}};
+
+/** The names of the modes.
+ */
+static const char *gpModeName[] = {"register at a time", "burst", "queued", "many"};
+
+/** A transaction and its buffers for each register.
+ */
+static I2CTransaction gTransactions[MAX_NUM_REGISTERS];
+static char gRegisterAddress[MAX_NUM_REGISTERS];
+static char gData[MAX_NUM_REGISTERS];
+
+/** The number of transactions to submit from the hook.
+ */
+static int gNumToSubmit = 0;
+
+/** The number of transactions that have completed.
+ */
+static int gNumCompleted = 0;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Transaction callback.
+static void completed(I2CTransaction *pTransaction, void *pParam)
+{
+    (void) pTransaction;
+    (void) pParam;
+    gNumCompleted++;
+}
+
+// Mock bus hook: submit the transactions while the bus is busy,
+// as other threads would.
+static void hook(void *pParam)
+{
+    (void) pParam;
+    for (int x = 1; x < gNumToSubmit; x++) {
+        i2cSubmit(&(gTransactions[x]));
+    }
+    gNumToSubmit = 0;
+}
+
+// Read all of the blocks in the given way, returning the number
+// of registers read.
+static int readBlocks(Mode mode)
+{
+    char block[MAX_BLOCK_SIZE];
+    int numRegisters = 0;
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(gBlocks); x++) {
+        switch (mode) {
+            case MODE_REGISTER_AT_A_TIME:
+                for (int y = 0; y < gBlocks[x].numRegisters; y++) {
+                    gRegisterAddress[numRegisters] = gBlocks[x].firstRegister + y;
+                    i2cSendReceive(gBlocks[x].i2cAddress, &(gRegisterAddress[numRegisters]), 1,
+                                   &(gData[numRegisters]), 1);
+                    numRegisters++;
+                }
+            break;
+            case MODE_BURST:
+                i2cSendReceive(gBlocks[x].i2cAddress, &(gBlocks[x].firstRegister), 1,
+                               block, gBlocks[x].numRegisters);
+                memcpy(&(gData[numRegisters]), block, gBlocks[x].numRegisters);
+                numRegisters += gBlocks[x].numRegisters;
+            break;
+            case MODE_QUEUED:
+            case MODE_MANY:
+                for (int y = 0; y < gBlocks[x].numRegisters; y++) {
+                    gRegisterAddress[numRegisters] = gBlocks[x].firstRegister + y;
+                    memset(&(gTransactions[numRegisters]), 0, sizeof(gTransactions[numRegisters]));
+                    gTransactions[numRegisters].i2cAddress = gBlocks[x].i2cAddress;
+                    gTransactions[numRegisters].pSend = &(gRegisterAddress[numRegisters]);
+                    gTransactions[numRegisters].bytesToSend = 1;
+                    gTransactions[numRegisters].pReceive = &(gData[numRegisters]);
+                    gTransactions[numRegisters].bytesToReceive = 1;
+                    gTransactions[numRegisters].flags = I2C_FLAG_REGISTER_AUTO_INCREMENT;
+                    gTransactions[numRegisters].pCallback = completed;
+                    numRegisters++;
+                }
+                if (mode == MODE_MANY) {
+                    i2cSendReceiveMany(&(gTransactions[numRegisters - gBlocks[x].numRegisters]),
+                                       gBlocks[x].numRegisters);
+                }
+            break;
+            default:
+            break;
+        }
+    }
+
+    if (mode == MODE_QUEUED) {
+        // Submit the first and have the rest arrive while it is on the bus
+        gNumCompleted = 0;
+        gNumToSubmit = numRegisters;
+        i2cMockSetHook(hook, NULL);
+        i2cSubmit(&(gTransactions[0]));
+        i2cMockSetHook(NULL, NULL);
+        if (gNumCompleted != numRegisters) {
+            printf("Only %d of %d transaction(s) completed.\n", gNumCompleted, numRegisters);
+        }
+    }
+
+    return numRegisters;
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main()
+{
+    const I2CMockRecord *pRecords;
+    char *pRegisters;
+    int numRecords;
+    int numRegisters;
+    int numBad;
+    int frequencyHz[] = {100000, 400000};
+    int transactions;
+    int bytes;
+    int mockTransactions;
+    int mockBytes;
+    int numFailures = 0;
+    unsigned long long int busyNs;
+    I2CStatistics statistics[I2C_STATISTICS_MAX_NUM_DEVICES];
+    int numStatistics;
+    unsigned int errors;
+
+    for (unsigned int f = 0; f < ARRAY_SIZE(frequencyHz); f++) {
+        printf("Bus at %d kHz:\n", frequencyHz[f] / 1000);
+        for (int mode = 0; mode < MAX_NUM_MODES; mode++) {
+            i2cMockReset();
+            for (unsigned int x = 0; x < ARRAY_SIZE(gBlocks); x++) {
+                pRegisters = pI2cMockAddDevice(gBlocks[x].i2cAddress);
+                for (int y = 0; y < I2C_MOCK_NUM_REGISTERS; y++) {
+                    pRegisters[y] = (char) (y ^ gBlocks[x].i2cAddress);
+                }
+            }
+            i2cInit(0, 0);
+            i2cSetFrequency(frequencyHz[f]);
+            i2cClearStatistics();
+            memset(gData, 0, sizeof(gData));
+
+            numRegisters = readBlocks((Mode) mode);
+
+            // Check that every register arrived in the right place
+            numBad = 0;
+            numRegisters = 0;
+            for (unsigned int x = 0; x < ARRAY_SIZE(gBlocks); x++) {
+                for (int y = 0; y < gBlocks[x].numRegisters; y++) {
+                    if (gData[numRegisters] != (char) (((unsigned char) (gBlocks[x].firstRegister + y)) ^
+                                                       gBlocks[x].i2cAddress)) {
+                        numBad++;
+                    }
+                    numRegisters++;
+                }
+            }
+
+            printf("  %s:\n", gpModeName[mode]);
+            numRecords = i2cMockGetRecords(&pRecords);
+            mockTransactions = 0;
+            mockBytes = 0;
+            for (unsigned int x = 0; x < ARRAY_SIZE(gBlocks); x++) {
+                transactions = 0;
+                bytes = 0;
+                busyNs = 0;
+                for (int y = 0; y < numRecords; y++) {
+                    if (pRecords[y].i2cAddress == gBlocks[x].i2cAddress) {
+                        if (!pRecords[y].isRead) {
+                            transactions++;
+                        }
+                        bytes += pRecords[y].numBytes;
+                        busyNs += pRecords[y].durationNs;
+                    }
+                }
+                printf("    %s (0x%02x): %3d transaction(s), %3d byte(s), %6llu us.\n",
+                       gBlocks[x].pName, gBlocks[x].i2cAddress, transactions, bytes,
+                       busyNs / 1000);
+                mockTransactions += transactions;
+                mockBytes += bytes;
+            }
+            printf("    total %llu us on the bus for %d register(s), %d wrong.\n",
+                   i2cMockGetBusyNs() / 1000, numRegisters, numBad);
+
+            // Cross-check the statistics kept by eh_i2c
+            numStatistics = i2cGetStatistics(statistics, ARRAY_SIZE(statistics));
+            transactions = 0;
+            bytes = 0;
+            errors = 0;
+            for (int x = 0; x < numStatistics; x++) {
+                transactions += statistics[x].transactions;
+                bytes += statistics[x].bytesSent + statistics[x].bytesReceived;
+                errors += statistics[x].errors;
+            }
+            printf("    eh_i2c counted %d device(s), %d transaction(s), %d byte(s), %u error(s).\n",
+                   numStatistics, transactions, bytes, errors);
+            if ((numBad > 0) || (errors > 0) || (numStatistics != (int) ARRAY_SIZE(gBlocks)) ||
+                (transactions != mockTransactions) || (bytes != mockBytes)) {
+                printf("    FAILED: the mock bus saw %d transaction(s), %d byte(s).\n",
+                       mockTransactions, mockBytes);
+                numFailures++;
+            }
+
+            i2cDeinit();
+        }
+    }
+
+    printf("%d failure(s).\n", numFailures);
+
+    return (numFailures == 0) ? 0 : 1;
+}
+
+// End of file
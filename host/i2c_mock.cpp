@@ -0,0 +1,261 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A mock I2C bus for the host: implements the I2C class of the
+// shim mbed.h, with simple register-file devices, and records the
+// time each operation would hold a real bus.
+
+#include <mbed.h>
+#include <i2c_mock.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The default bus clock, as for mbed.
+ */
+#define I2C_MOCK_DEFAULT_FREQUENCY_HZ 100000
+
+/** The number of bit times for a start (or repeated start) condition.
+ */
+#define I2C_MOCK_START_BITS 1
+
+/** The number of bit times for a stop condition.
+ */
+#define I2C_MOCK_STOP_BITS 1
+
+/** The number of bit times for a byte, including its ack.
+ */
+#define I2C_MOCK_BYTE_BITS 9
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A mock device.
+ */
+typedef struct {
+    char i2cAddress;
+    unsigned char pointer;
+    char registers[I2C_MOCK_NUM_REGISTERS];
+} I2CMockDevice;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The devices.
+ */
+static I2CMockDevice gDevices[I2C_MOCK_MAX_NUM_DEVICES];
+
+/** The number of devices.
+ */
+static int gNumDevices = 0;
+
+/** The records.
+ */
+static I2CMockRecord gRecords[I2C_MOCK_MAX_NUM_RECORDS];
+
+/** The number of records.
+ */
+static int gNumRecords = 0;
+
+/** The bus clock frequency.
+ */
+static int gFrequencyHz = I2C_MOCK_DEFAULT_FREQUENCY_HZ;
+
+/** The time on the bus clock.
+ */
+static unsigned long long int gNowNs = 0;
+
+/** The total time the bus has been busy.
+ */
+static unsigned long long int gBusyNs = 0;
+
+/** Set when the last operation ended in a repeated start.
+ */
+static bool gRepeatedStart = false;
+
+/** Hook to call on each operation and its parameter.
+ */
+static void (*gpHook) (void *) = NULL;
+static void *gpHookParam = NULL;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Find a device by its 7-bit address.
+static I2CMockDevice *pFindDevice(char i2cAddress)
+{
+    I2CMockDevice *pDevice = NULL;
+
+    for (int x = 0; (pDevice == NULL) && (x < gNumDevices); x++) {
+        if (gDevices[x].i2cAddress == i2cAddress) {
+            pDevice = &(gDevices[x]);
+        }
+    }
+
+    return pDevice;
+}
+
+// Account for an operation on the bus.
+static void record(char i2cAddress, bool isRead, int numBytes, bool acked,
+                   bool repeated)
+{
+    int bits = I2C_MOCK_START_BITS + (1 + numBytes) * I2C_MOCK_BYTE_BITS;
+    unsigned long long int durationNs;
+
+    if (!repeated) {
+        bits += I2C_MOCK_STOP_BITS;
+    }
+    durationNs = ((unsigned long long int) bits) * 1000000000ULL / gFrequencyHz;
+
+    if (gNumRecords < I2C_MOCK_MAX_NUM_RECORDS) {
+        gRecords[gNumRecords].i2cAddress = i2cAddress;
+        gRecords[gNumRecords].isRead = isRead;
+        gRecords[gNumRecords].numBytes = numBytes;
+        gRecords[gNumRecords].acked = acked;
+        gRecords[gNumRecords].startNs = gNowNs;
+        gRecords[gNumRecords].durationNs = durationNs;
+        gNumRecords++;
+    }
+    gNowNs += durationNs;
+    gBusyNs += durationNs;
+    gRepeatedStart = repeated;
+
+    if (gpHook != NULL) {
+        gpHook(gpHookParam);
+    }
+}
+
+/**************************************************************************
+ * CLASSES: I2C
+ *************************************************************************/
+
+// Constructor.
+I2C::I2C(PinName sda, PinName scl)
+{
+    (void) sda;
+    (void) scl;
+    gFrequencyHz = I2C_MOCK_DEFAULT_FREQUENCY_HZ;
+}
+
+// Set the bus clock.
+void I2C::frequency(int hz)
+{
+    gFrequencyHz = hz;
+}
+
+// Write to a device, mbed style: 8-bit address, zero on success.
+int I2C::write(int address, const char *data, int length, bool repeated)
+{
+    I2CMockDevice *pDevice = pFindDevice((char) (address >> 1));
+
+    if (pDevice != NULL) {
+        for (int x = 0; x < length; x++) {
+            if (x == 0) {
+                pDevice->pointer = (unsigned char) data[x];
+            } else {
+                pDevice->registers[pDevice->pointer] = data[x];
+                pDevice->pointer++;
+            }
+        }
+    }
+    record((char) (address >> 1), false, length, pDevice != NULL, repeated);
+
+    return (pDevice != NULL) ? 0 : -1;
+}
+
+// Read from a device, mbed style: 8-bit address, zero on success.
+int I2C::read(int address, char *data, int length, bool repeated)
+{
+    I2CMockDevice *pDevice = pFindDevice((char) (address >> 1));
+
+    if (pDevice != NULL) {
+        for (int x = 0; x < length; x++) {
+            data[x] = pDevice->registers[pDevice->pointer];
+            pDevice->pointer++;
+        }
+    }
+    record((char) (address >> 1), true, length, pDevice != NULL, repeated);
+
+    return (pDevice != NULL) ? 0 : -1;
+}
+
+// Send a stop condition.
+void I2C::stop()
+{
+    if (gRepeatedStart) {
+        gNowNs += ((unsigned long long int) I2C_MOCK_STOP_BITS) * 1000000000ULL / gFrequencyHz;
+        gBusyNs += ((unsigned long long int) I2C_MOCK_STOP_BITS) * 1000000000ULL / gFrequencyHz;
+        gRepeatedStart = false;
+    }
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Reset the mock bus.
+void i2cMockReset()
+{
+    gNumDevices = 0;
+    gNumRecords = 0;
+    gNowNs = 0;
+    gBusyNs = 0;
+    gRepeatedStart = false;
+    gpHook = NULL;
+    gpHookParam = NULL;
+}
+
+// Add a device.
+char *pI2cMockAddDevice(char i2cAddress)
+{
+    char *pRegisters = NULL;
+
+    if (gNumDevices < I2C_MOCK_MAX_NUM_DEVICES) {
+        memset(&(gDevices[gNumDevices]), 0, sizeof(gDevices[gNumDevices]));
+        gDevices[gNumDevices].i2cAddress = i2cAddress;
+        pRegisters = gDevices[gNumDevices].registers;
+        gNumDevices++;
+    }
+
+    return pRegisters;
+}
+
+// Set the hook.
+void i2cMockSetHook(void (*pHook) (void *), void *pParam)
+{
+    gpHook = pHook;
+    gpHookParam = pParam;
+}
+
+// Get the records.
+int i2cMockGetRecords(const I2CMockRecord **ppRecords)
+{
+    *ppRecords = gRecords;
+
+    return gNumRecords;
+}
+
+// Get the time the bus has been busy.
+unsigned long long int i2cMockGetBusyNs()
+{
+    return gBusyNs;
+}
+
+// End of file
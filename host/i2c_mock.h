@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _I2C_MOCK_H_
+#define _I2C_MOCK_H_
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The maximum number of devices on the mock bus.
+ */
+#define I2C_MOCK_MAX_NUM_DEVICES 8
+
+/** The size of the register space of each mock device.
+ */
+#define I2C_MOCK_NUM_REGISTERS 256
+
+/** The maximum number of bus operations that are recorded.
+ */
+#define I2C_MOCK_MAX_NUM_RECORDS 4096
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A record of one operation (a write or a read) on the mock bus.
+ */
+typedef struct {
+    char i2cAddress;                 //!< The 7-bit address.
+    bool isRead;                     //!< True for a read, false for a write.
+    int numBytes;                    //!< The number of data bytes moved.
+    bool acked;                      //!< False if no device answered.
+    unsigned long long int startNs;  //!< When the operation started on the bus clock.
+    unsigned long long int durationNs; //!< How long the operation held the bus.
+} I2CMockRecord;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Reset the mock bus: remove all devices, clear all records and
+ * set the bus clock back to zero.
+ */
+void i2cMockReset();
+
+/** Add a device to the mock bus.  The device has a register address
+ * pointer which is set by the first byte of a write, the following
+ * bytes of the write being written to the registers, and which
+ * auto-increments as the registers are read.
+ *
+ * @param i2cAddress the 7-bit address of the device.
+ * @return           a pointer to the registers of the device, which
+ *                   may be written to set the values it returns,
+ *                   or NULL if there is no room.
+ */
+char *pI2cMockAddDevice(char i2cAddress);
+
+/** Set a function to be called each time an operation is performed
+ * on the mock bus, e.g. to submit more transactions while the bus
+ * is busy.
+ *
+ * @param pHook  the function, NULL to remove it.
+ * @param pParam a parameter to pass to the function.
+ */
+void i2cMockSetHook(void (*pHook) (void *), void *pParam);
+
+/** Get the records of the operations performed on the mock bus.
+ *
+ * @param ppRecords a place to put a pointer to the records.
+ * @return          the number of records.
+ */
+int i2cMockGetRecords(const I2CMockRecord **ppRecords);
+
+/** Get the total time for which the mock bus has been busy.
+ *
+ * @return the time in nanoseconds.
+ */
+unsigned long long int i2cMockGetBusyNs();
+
+#endif // _I2C_MOCK_H_
+
+// End Of File
@@ -0,0 +1,323 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host test of the SARA-N2xx socket send, which streams the payload
+// to the modem as hex in chunks rather than converting all of it in
+// one heap buffer, and of the socket receive, which reads the hex of
+// AT+NSORF back in chunks and decodes it straight into the caller's
+// buffer, against the mock modem of at_mock.cpp.  Built by the CMake
+// project in this directory (see CMakeLists.txt) and run by ctest;
+// exits non-zero if any check fails.
+
+#include <mbed.h>
+#include <eh_utilities.h> // For ARRAY_SIZE
+#include <UbloxATCellularInterfaceN2xx.h>
+#include <at_mock.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The largest payload sent.
+ */
+#define MAX_PAYLOAD_SIZE 1100
+
+/** The most hex characters the driver should write in one go
+ * (SENDTO_CHUNK_SIZE in UbloxATCellularInterfaceN2xx.cpp).
+ */
+#define MAX_HEX_WRITE_SIZE 50
+
+/** The most hex characters the driver should read in one go
+ * (RECVFROM_CHUNK_SIZE in UbloxATCellularInterfaceN2xx.cpp).
+ */
+#define MAX_HEX_READ_SIZE 64
+
+/** The buffer that received data is read into.
+ */
+#define RECEIVE_BUFFER_SIZE 512
+
+/** The room for an AT+NSORF response from the mock modem.
+ */
+#define MAX_RESPONSE_SIZE 320
+
+/** The value of the bytes after the end of a receive buffer,
+ * which the driver should never write.
+ */
+#define GUARD_VALUE 0x5a
+
+/** The address sent to.
+ */
+#define ADDRESS "1.2.3.4"
+#define PORT 5000
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The driver, with the socket calls that UDPSocket would make
+ * opened up.
+ */
+class N2xx : public UbloxATCellularInterfaceN2xx {
+public:
+    N2xx() : UbloxATCellularInterfaceN2xx(MDMTXD, MDMRXD) {}
+    using UbloxATCellularInterfaceN2xx::socket_open;
+    using UbloxATCellularInterfaceN2xx::socket_close;
+    using UbloxATCellularInterfaceN2xx::socket_sendto;
+    using UbloxATCellularInterfaceN2xx::socket_recvfrom;
+    // Handle the URCs from the mock modem, as the event
+    // thread would.
+    void urc() { _at->process_oob(); }
+};
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The payload and the hex AT commands it should be sent as.
+ */
+static char gPayload[MAX_PAYLOAD_SIZE];
+static char gExpected[AT_MOCK_MAX_SENT_SIZE];
+
+/** Where received data goes, with room for guard bytes after it.
+ */
+static char gReceived[RECEIVE_BUFFER_SIZE + 16];
+
+/** The number of checks that failed.
+ */
+static int gNumFailures = 0;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Record the outcome of a check.
+static void check(bool ok, const char *pWhat)
+{
+    if (!ok) {
+        printf("    FAILED: %s.\n", pWhat);
+        gNumFailures++;
+    }
+}
+
+// Append the AT+NSOSTF command that sends size bytes of payload,
+// as hex, to gExpected.
+static void expect(int socket, const char *pPayload, int size)
+{
+    int length = strlen(gExpected);
+
+    length += sprintf(gExpected + length, "AT+NSOSTF=%d,\"%s\",%d,0x0,%d,\"",
+                      socket, ADDRESS, PORT, size);
+    for (int x = 0; x < size; x++) {
+        length += sprintf(gExpected + length, "%02X", (unsigned char) *(pPayload + x));
+    }
+    strcpy(gExpected + length, "\"\r");
+}
+
+// Send size bytes of payload with the modem accepting them in
+// blocks of blockSize, checking what the driver wrote.
+static void sendAndCheck(N2xx *pN2xx, nsapi_socket_t handle, int size, int blockSize)
+{
+    SocketAddress address(ADDRESS, PORT);
+    char response[32];
+    const char *pSent;
+    const int *pWriteSize;
+    int numWrites;
+    int numHexWrites = 0;
+    int largestHexWrite = 0;
+    int offset = 0;
+    int sent;
+
+    printf("  %d byte(s):\n", size);
+    atMockReset();
+    gExpected[0] = 0;
+    for (int x = 0; x < size; x += blockSize) {
+        sprintf(response, "0,%d\r\nOK\r\n", (size - x < blockSize) ? size - x : blockSize);
+        atMockAddResponse(response);
+        expect(0, gPayload + x, (size - x < blockSize) ? size - x : blockSize);
+    }
+
+    sent = pN2xx->socket_sendto(handle, address, gPayload, size);
+    printf("    sent %d, ", sent);
+    atMockGetSent(&pSent);
+    numWrites = atMockGetWrites(&pWriteSize);
+    // Everything but the start of each AT command is hex
+    for (int x = 0; x < numWrites; x++) {
+        if (strncmp(pSent + offset, "AT+", 3) != 0) {
+            numHexWrites++;
+            if (pWriteSize[x] > largestHexWrite) {
+                largestHexWrite = pWriteSize[x];
+            }
+        }
+        offset += pWriteSize[x];
+    }
+    printf("%d write(s) of hex, the largest %d character(s).\n", numHexWrites, largestHexWrite);
+
+    check(sent == size, "the wrong number of bytes was sent");
+    check(strcmp(pSent, gExpected) == 0, "the AT commands were wrong");
+    check(largestHexWrite <= MAX_HEX_WRITE_SIZE, "the hex was written in chunks that were too large");
+}
+
+// Have the mock modem say that size bytes have arrived and then
+// give them back, as the hex string pHex, to AT+NSORF, receiving
+// them into the first bufferSize bytes of gReceived and checking
+// that the driver asked for the right amount, read the hex in
+// whole bytes no more than a chunk at a time and wrote nothing
+// beyond the buffer; returns what socket_recvfrom() returned.
+static int receiveAndCheck(N2xx *pN2xx, nsapi_socket_t handle, int size,
+                           const char *pHex, int bufferSize)
+{
+    SocketAddress address;
+    char response[MAX_RESPONSE_SIZE];
+    const char *pSent;
+    const int *pReadSize;
+    int numReads;
+    int numHexReads = 0;
+    int largestHexRead = 0;
+    bool oddRead = false;
+    bool guardOk = true;
+    int received;
+
+    atMockReset();
+    memset(gReceived, GUARD_VALUE, sizeof(gReceived));
+    sprintf(response, "+NSONMI:0,%d\r\n", size);
+    atMockAddResponse(response);
+    pN2xx->urc();
+    snprintf(response, sizeof(response), "0,\"%s\",%d,%d,\"%s\",0\r\nOK\r\n",
+             ADDRESS, PORT, size, pHex);
+    atMockAddResponse(response);
+
+    received = pN2xx->socket_recvfrom(handle, &address, gReceived, bufferSize);
+    printf("    received %d, ", received);
+    atMockGetSent(&pSent);
+    numReads = atMockGetReads(&pReadSize);
+    // The first read is the opening quote, the rest are hex
+    for (int x = 1; x < numReads; x++) {
+        numHexReads++;
+        if (pReadSize[x] & 1) {
+            oddRead = true;
+        }
+        if (pReadSize[x] > largestHexRead) {
+            largestHexRead = pReadSize[x];
+        }
+    }
+    printf("%d read(s) of hex, the largest %d character(s).\n", numHexReads, largestHexRead);
+    for (unsigned int x = bufferSize; x < sizeof(gReceived); x++) {
+        if (gReceived[x] != GUARD_VALUE) {
+            guardOk = false;
+        }
+    }
+
+    sprintf(response, "AT+NSORF=0,%d\r", bufferSize);
+    check(strcmp(pSent, response) == 0, "the wrong AT command was sent");
+    check(!oddRead, "the hex was read in part bytes");
+    check(largestHexRead <= MAX_HEX_READ_SIZE, "the hex was read in chunks that were too large");
+    check(guardOk, "data was written beyond the end of the buffer");
+    if (received >= 0) {
+        check((strcmp(address.get_ip_address(), ADDRESS) == 0) &&
+              (address.get_port() == PORT), "the address was wrong");
+    }
+
+    return received;
+}
+
+// Receive size bytes of payload, checking that they arrive intact.
+static void receiveGood(N2xx *pN2xx, nsapi_socket_t handle, int size)
+{
+    char hex[MAX_RESPONSE_SIZE];
+
+    printf("  %d byte(s):\n", size);
+    for (int x = 0; x < size; x++) {
+        sprintf(hex + x * 2, "%02X", (unsigned char) gPayload[x]);
+    }
+    check(receiveAndCheck(pN2xx, handle, size, hex, RECEIVE_BUFFER_SIZE) == size,
+          "the wrong number of bytes was received");
+    check(memcmp(gReceived, gPayload, size) == 0, "the bytes received were wrong");
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main()
+{
+    N2xx *pN2xx = new N2xx();
+    nsapi_socket_t handle = NULL;
+    SocketAddress address(ADDRESS, PORT);
+    // One byte, an exact chunk, several chunks and a part one,
+    // and more than the modem takes in one go (MAX_WRITE_SIZE_N2XX)
+    int size[] = {1, MAX_HEX_WRITE_SIZE / 2, 137, 600, MAX_PAYLOAD_SIZE};
+    const char *pSent;
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(gPayload); x++) {
+        gPayload[x] = (char) (x * 7 + 3);
+    }
+
+    printf("Opening socket:\n");
+    atMockReset();
+    atMockAddResponse("0\r\nOK\r\n");
+    check(pN2xx->socket_open(&handle, NSAPI_UDP) == NSAPI_ERROR_OK, "socket not opened");
+    atMockGetSent(&pSent);
+    check(strcmp(pSent, "AT+NSOCR=\"DGRAM\",17,10000\r") == 0, "the wrong AT command was sent");
+
+    if (handle != NULL) {
+        printf("Sending:\n");
+        for (unsigned int x = 0; x < ARRAY_SIZE(size); x++) {
+            sendAndCheck(pN2xx, handle, size[x], MAX_WRITE_SIZE_N2XX);
+        }
+
+        printf("Sending, modem says ERROR:\n");
+        atMockReset();
+        atMockAddResponse("ERROR\r\n");
+        check(pN2xx->socket_sendto(handle, address, gPayload, 10) < 0,
+              "an error was not reported");
+
+        printf("Sending, modem says nothing:\n");
+        atMockReset();
+        check(pN2xx->socket_sendto(handle, address, gPayload, 10) < 0,
+              "an error was not reported");
+
+        // A payload of several chunks and one with a single byte
+        // in its last chunk
+        printf("Receiving:\n");
+        receiveGood(pN2xx, handle, 100);
+        receiveGood(pN2xx, handle, MAX_HEX_READ_SIZE / 2 + 1);
+
+        printf("Receiving, hex of odd length:\n");
+        check(receiveAndCheck(pN2xx, handle, 4, "0102030", RECEIVE_BUFFER_SIZE) < 0,
+              "an error was not reported");
+
+        printf("Receiving, a character that is not hex:\n");
+        check(receiveAndCheck(pN2xx, handle, 4, "01G20304", RECEIVE_BUFFER_SIZE) < 0,
+              "an error was not reported");
+
+        printf("Receiving, modem reports more than the buffer holds:\n");
+        check(receiveAndCheck(pN2xx, handle, 20, "000102030405060708090A0B0C0D0E0F10111213", 10) < 0,
+              "an error was not reported");
+
+        printf("Closing socket:\n");
+        atMockReset();
+        atMockAddResponse("OK\r\n");
+        check(pN2xx->socket_close(handle) == NSAPI_ERROR_OK, "socket not closed");
+    }
+
+    delete pN2xx;
+
+    printf("%d failure(s).\n", gNumFailures);
+
+    return (gNumFailures == 0) ? 0 : 1;
+}
+
+// End of file
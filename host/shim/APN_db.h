@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_APN_DB_H_
+#define _HOST_SHIM_APN_DB_H_
+
+// The mbed APN database on a host: empty.
+
+#include <stddef.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Get the next field of an APN configuration string and move on.
+ */
+#define _APN_GET(cfg) \
+    *cfg ? cfg : NULL; \
+    cfg  += strlen(cfg) + 1
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Find the APN configuration for an IMSI: there is none.
+ */
+inline const char *apnconfig(const char *imsi)
+{
+    (void) imsi;
+    return NULL;
+}
+
+#endif // _HOST_SHIM_APN_DB_H_
+
+// End Of File
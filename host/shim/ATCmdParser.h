@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_AT_CMD_PARSER_H_
+#define _HOST_SHIM_AT_CMD_PARSER_H_
+
+// The mbed ATCmdParser on a host, implemented by at_mock.cpp: what
+// is sent is recorded and what is received is scripted, see
+// at_mock.h.
+
+#include <stdarg.h>
+#include <mbed.h>
+#include <FileHandle.h>
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** AT command parser.
+ */
+class ATCmdParser {
+public:
+    ATCmdParser(FileHandle *fh, const char *output_delimiter = "\r",
+                int buffer_size = 256, int timeout = 8000, bool debug = false);
+    void set_timeout(int timeout) { (void) timeout; }
+    void setTimeout(int timeout) { set_timeout(timeout); }
+    void set_delimiter(const char *output_delimiter) { _delimiter = output_delimiter; }
+    void debug_on(unsigned char on) { (void) on; }
+    bool send(const char *command, ...);
+    bool vsend(const char *command, va_list args);
+    bool recv(const char *response, ...);
+    bool vrecv(const char *response, va_list args);
+    int putc(char c);
+    int getc();
+    int write(const char *data, int size);
+    int read(char *data, int size);
+    void oob(const char *prefix, Callback<void()> func);
+    bool process_oob();
+    void flush() {}
+    void abort() { _aborted = true; }
+
+private:
+    const char *_delimiter;
+    bool _aborted;
+};
+
+#endif // _HOST_SHIM_AT_CMD_PARSER_H_
+
+// End Of File
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_CELLULAR_BASE_H_
+#define _HOST_SHIM_CELLULAR_BASE_H_
+
+// The mbed CellularBase network interface on a host, for a driver
+// to implement.
+
+#include <mbed.h>
+#include <NetworkStack.h>
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** A cellular network interface.
+ */
+class CellularBase {
+public:
+    virtual ~CellularBase() {}
+    virtual void set_credentials(const char *apn, const char *uname = 0,
+                                 const char *pwd = 0) = 0;
+    virtual void set_sim_pin(const char *sim_pin) = 0;
+    virtual nsapi_error_t connect(const char *sim_pin, const char *apn = 0,
+                                  const char *uname = 0, const char *pwd = 0) = 0;
+    virtual nsapi_error_t connect() = 0;
+    virtual nsapi_error_t disconnect() = 0;
+    virtual bool is_connected() = 0;
+    virtual const char *get_ip_address() = 0;
+    virtual const char *get_netmask() = 0;
+    virtual const char *get_gateway() = 0;
+
+protected:
+    virtual NetworkStack *get_stack() = 0;
+};
+
+#endif // _HOST_SHIM_CELLULAR_BASE_H_
+
+// End Of File
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_FILE_HANDLE_H_
+#define _HOST_SHIM_FILE_HANDLE_H_
+
+// The mbed FileHandle on a host: only as much as the cellular
+// drivers need to hold one, the AT traffic itself going through
+// the mock ATCmdParser.
+
+#include <sys/types.h> // For ssize_t
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** A file handle: reads nothing, writes go nowhere.
+ */
+class FileHandle {
+public:
+    virtual ~FileHandle() {}
+    virtual ssize_t read(void *pBuffer, size_t size) { (void) pBuffer; (void) size; return 0; }
+    virtual ssize_t write(const void *pBuffer, size_t size) { (void) pBuffer; return size; }
+    virtual short poll(short events) const { (void) events; return 0; }
+};
+
+#endif // _HOST_SHIM_FILE_HANDLE_H_
+
+// End Of File
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_NETWORK_STACK_H_
+#define _HOST_SHIM_NETWORK_STACK_H_
+
+// The mbed NetworkStack on a host, for a driver to implement.
+
+#include <nsapi.h>
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** A network stack: the socket operations of a driver.
+ */
+class NetworkStack {
+public:
+    virtual ~NetworkStack() {}
+    virtual const char *get_ip_address() = 0;
+    virtual nsapi_error_t gethostbyname(const char *host, SocketAddress *address,
+                                        nsapi_version_t version = NSAPI_UNSPEC) {
+        (void) host; (void) address; (void) version;
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t setsockopt(nsapi_socket_t handle, int level,
+                                     int optname, const void *optval, unsigned optlen) {
+        (void) handle; (void) level; (void) optname; (void) optval; (void) optlen;
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t getsockopt(nsapi_socket_t handle, int level,
+                                     int optname, void *optval, unsigned *optlen) {
+        (void) handle; (void) level; (void) optname; (void) optval; (void) optlen;
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+protected:
+    virtual nsapi_error_t socket_open(nsapi_socket_t *handle, nsapi_protocol_t proto) = 0;
+    virtual nsapi_error_t socket_close(nsapi_socket_t handle) = 0;
+    virtual nsapi_error_t socket_bind(nsapi_socket_t handle, const SocketAddress &address) = 0;
+    virtual nsapi_error_t socket_listen(nsapi_socket_t handle, int backlog) = 0;
+    virtual nsapi_error_t socket_connect(nsapi_socket_t handle, const SocketAddress &address) = 0;
+    virtual nsapi_error_t socket_accept(nsapi_socket_t server, nsapi_socket_t *handle,
+                                        SocketAddress *address = 0) = 0;
+    virtual nsapi_size_or_error_t socket_send(nsapi_socket_t handle,
+                                              const void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_recv(nsapi_socket_t handle,
+                                              void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_sendto(nsapi_socket_t handle, const SocketAddress &address,
+                                                const void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_recvfrom(nsapi_socket_t handle, SocketAddress *address,
+                                                  void *data, nsapi_size_t size) = 0;
+    virtual void socket_attach(nsapi_socket_t handle, void (*callback)(void *), void *data) = 0;
+};
+
+#endif // _HOST_SHIM_NETWORK_STACK_H_
+
+// End Of File
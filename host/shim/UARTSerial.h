@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_UART_SERIAL_H_
+#define _HOST_SHIM_UART_SERIAL_H_
+
+// The mbed UARTSerial on a host: a FileHandle that remembers its
+// baud rate, the AT traffic going through the mock ATCmdParser.
+
+#include <mbed.h>
+#include <FileHandle.h>
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** A buffered serial port.
+ */
+class UARTSerial : public FileHandle {
+public:
+    UARTSerial(PinName tx, PinName rx, int baud) : _baud(baud) { (void) tx; (void) rx; }
+    void set_baud(int baud) { _baud = baud; }
+private:
+    int _baud;
+};
+
+#endif // _HOST_SHIM_UART_SERIAL_H_
+
+// End Of File
@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_GREENTEA_METRICS_H_
+#define _HOST_SHIM_GREENTEA_METRICS_H_
+
+// Greentea metrics are not collected on a host.
+
+#endif // _HOST_SHIM_GREENTEA_METRICS_H_
+
+// End Of File
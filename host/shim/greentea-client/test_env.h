@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_TEST_ENV_H_
+#define _HOST_SHIM_TEST_ENV_H_
+
+// There is no greentea host test on a host: the timeout is left to
+// ctest.
+
+#define GREENTEA_SETUP(timeout, host_test) do { (void) (timeout); (void) (host_test); } while (0)
+
+#endif // _HOST_SHIM_TEST_ENV_H_
+
+// End Of File
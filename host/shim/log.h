@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_LOG_H_
+#define _HOST_SHIM_LOG_H_
+
+// The interface of the log-client library, implemented on a host
+// by log_host.cpp.  As the library's own does, it brings in mbed.h.
+
+#include <mbed.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The version of the log client.
+ */
+#define LOG_VERSION 1
+
+/** The number of entries in the log store.
+ */
+#define MAX_NUM_LOG_ENTRIES 500
+
+/** The size of the log store.
+ */
+#define LOG_STORE_SIZE (sizeof(LogEntry) * MAX_NUM_LOG_ENTRIES)
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The log events: the application's, after those of the client's
+ * own that the application uses; the numbering differs from the
+ * target's.
+ */
+typedef enum {
+    EVENT_NONE,
+    EVENT_LOG_START,
+    EVENT_LOG_STOP,
+    EVENT_BUILD_TIME_UNIX_FORMAT,
+    EVENT_CURRENT_TIME_UTC,
+    EVENT_SEND_FAILURE,
+#include <log_enum_app.h>
+    , MAX_NUM_LOG_EVENTS
+} LogEvent;
+
+/** A log entry.
+ */
+typedef struct {
+    unsigned int timestamp;
+    LogEvent event;
+    int parameter;
+} LogEntry;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Start logging into the store; on a host the store is internal
+ * and pBuffer is not used.
+ */
+void initLog(void *pBuffer);
+
+/** Stop logging.
+ */
+void deinitLog();
+
+/** Log an event, without and with a mutex; they are the same on a host.
+ */
+void LOG(LogEvent event, int parameter);
+void LOGX(LogEvent event, int parameter);
+
+/** Suspend logging, e.g. while asleep, and resume it, adding the
+ * time asleep to the timestamp.
+ */
+void suspendLog();
+void resumeLog(unsigned int intervalUSeconds);
+
+/** Take up to numEntries from the store, returning the number taken.
+ */
+int getLog(LogEntry *pEntries, int numEntries);
+
+/** Get the number of entries in the store.
+ */
+int getNumLogEntries();
+
+/** Print the entries in the store.
+ */
+void printLog();
+
+/** Host extension: print each event as it is logged.
+ */
+void hostLogPrint(bool onNotOff);
+
+/** Host extension: call a function with each event as it is logged,
+ * e.g. to count events in a simulation; the function must not itself
+ * log anything.  NULL to stop.
+ */
+void hostLogCallback(void (*pCallback)(LogEvent event, int parameter));
+
+#endif // _HOST_SHIM_LOG_H_
+
+// End Of File
@@ -0,0 +1,198 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The log-client interface on a host: a circular store of entries
+// timestamped from the host's monotonic clock.
+
+#include <mbed.h>
+#include <log.h>
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The names of the events.
+ */
+static const char *gpLogStrings[] = {"  EMPTY",
+                                     "  LOG_START",
+                                     "  LOG_STOP",
+                                     "  BUILD_TIME_UNIX_FORMAT",
+                                     "  CURRENT_TIME_UTC",
+                                     "* SEND_FAILURE",
+#include <log_strings_app.h>
+};
+
+/** The log store.
+ */
+static LogEntry gLog[MAX_NUM_LOG_ENTRIES];
+
+/** The index of the oldest entry in the store.
+ */
+static int gLogOldest = 0;
+
+/** The number of entries in the store.
+ */
+static int gNumLogEntries = 0;
+
+/** Lock for the store.
+ */
+static std::mutex gMtx;
+
+/** The time for the log timestamps.
+ */
+static Timer gTimer;
+
+/** The time spent suspended.
+ */
+static unsigned int gSuspendedUs = 0;
+
+/** Print each event as it is logged.
+ */
+static bool gPrint = false;
+
+/** Function to call with each event as it is logged.
+ */
+static void (*gpCallback)(LogEvent event, int parameter) = NULL;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Print an entry.
+static void printEntry(const LogEntry *pEntry)
+{
+    printf("%10u: %s %d (%#x)\n", pEntry->timestamp,
+           ((unsigned int) pEntry->event < sizeof(gpLogStrings) / sizeof(gpLogStrings[0])) ?
+           gpLogStrings[pEntry->event] : "  UNKNOWN",
+           pEntry->parameter, pEntry->parameter);
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Start logging.
+void initLog(void *pBuffer)
+{
+    (void) pBuffer;
+    gMtx.lock();
+    gLogOldest = 0;
+    gNumLogEntries = 0;
+    gSuspendedUs = 0;
+    gTimer.reset();
+    gTimer.start();
+    gMtx.unlock();
+    LOG(EVENT_LOG_START, LOG_VERSION);
+}
+
+// Stop logging.
+void deinitLog()
+{
+    LOG(EVENT_LOG_STOP, LOG_VERSION);
+    gTimer.stop();
+}
+
+// Log an event.
+void LOG(LogEvent event, int parameter)
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+    LogEntry *pEntry;
+
+    gTimer.start();
+    pEntry = &(gLog[(gLogOldest + gNumLogEntries) % MAX_NUM_LOG_ENTRIES]);
+    pEntry->timestamp = (unsigned int) gTimer.read_us() + gSuspendedUs;
+    pEntry->event = event;
+    pEntry->parameter = parameter;
+    if (gNumLogEntries < MAX_NUM_LOG_ENTRIES) {
+        gNumLogEntries++;
+    } else {
+        gLogOldest = (gLogOldest + 1) % MAX_NUM_LOG_ENTRIES;
+    }
+    if (gPrint) {
+        printEntry(pEntry);
+    }
+    if (gpCallback != NULL) {
+        gpCallback(event, parameter);
+    }
+}
+
+// Log an event with a mutex: the same on a host.
+void LOGX(LogEvent event, int parameter)
+{
+    LOG(event, parameter);
+}
+
+// Suspend logging.
+void suspendLog()
+{
+    gTimer.stop();
+}
+
+// Resume logging.
+void resumeLog(unsigned int intervalUSeconds)
+{
+    gSuspendedUs += intervalUSeconds;
+    gTimer.start();
+}
+
+// Take entries from the store.
+int getLog(LogEntry *pEntries, int numEntries)
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+    int x;
+
+    for (x = 0; (x < numEntries) && (gNumLogEntries > 0); x++) {
+        *(pEntries + x) = gLog[gLogOldest];
+        gLogOldest = (gLogOldest + 1) % MAX_NUM_LOG_ENTRIES;
+        gNumLogEntries--;
+    }
+
+    return x;
+}
+
+// Get the number of entries in the store.
+int getNumLogEntries()
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+
+    return gNumLogEntries;
+}
+
+// Print the store.
+void printLog()
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+
+    for (int x = 0; x < gNumLogEntries; x++) {
+        printEntry(&(gLog[(gLogOldest + x) % MAX_NUM_LOG_ENTRIES]));
+    }
+}
+
+// Print each event as it is logged.
+void hostLogPrint(bool onNotOff)
+{
+    gPrint = onNotOff;
+}
+
+// Call a function with each event as it is logged.
+void hostLogCallback(void (*pCallback)(LogEvent event, int parameter))
+{
+    std::lock_guard<std::mutex> lock(gMtx);
+
+    gpCallback = pCallback;
+}
+
+// End of file
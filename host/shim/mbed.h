@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_MBED_H_
+#define _HOST_SHIM_MBED_H_
+
+// Just enough of mbed to build the hardware-independent parts of
+// the application on a host.  The classes behave as their mbed
+// namesakes do, RTOS objects being implemented with the C++
+// standard library; I2C is a mock, see i2c_mock.h, analogue inputs
+// return whatever hostAnalogInSet() was given and digital outputs
+// go nowhere.  Anything that is not inline is in mbed_host.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <mbed_stats.h>
+#include <nsapi.h> // The network socket types come with mbed.h on target
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+#define MBED_ASSERT(x) do { if (!(x)) { printf("Assert \"%s\" failed at %s:%d.\n", #x, __FILE__, __LINE__); abort(); } } while (0)
+
+#define MBED_UNUSED __attribute__((__unused__))
+
+#define MBED_DEPRECATED(message) __attribute__((deprecated(message)))
+
+/** The default thread stack size; on a host this is only
+ * remembered, not used.
+ */
+#define OS_STACK_SIZE 4096
+
+/** Wait forever for an RTOS object.
+ */
+#define osWaitForever 0xFFFFFFFFU
+
+/**************************************************************************
+ * TYPES: PINS
+ *************************************************************************/
+
+/** Pin names are just numbers.
+ */
+typedef int PinName;
+
+/** The pull of an input pin.
+ */
+typedef enum {
+    PullNone,
+    PullUp,
+    PullDown
+} PinMode;
+
+/** The NINA-B1 pins that eh_config.h refers to.
+ */
+enum {
+    NC = -1,
+    NINA_B1_GPIO_1 = 1,
+    NINA_B1_GPIO_2 = 2,
+    NINA_B1_GPIO_3 = 3,
+    NINA_B1_GPIO_4 = 4,
+    NINA_B1_GPIO_5 = 5,
+    NINA_B1_GPIO_7 = 7,
+    NINA_B1_GPIO_8 = 8,
+    NINA_B1_GPIO_16 = 16,
+    NINA_B1_GPIO_17 = 17,
+    NINA_B1_GPIO_18 = 18,
+    NINA_B1_GPIO_20 = 20,
+    NINA_B1_GPIO_21 = 21,
+    NINA_B1_GPIO_22 = 22,
+    NINA_B1_GPIO_23 = 23,
+    NINA_B1_GPIO_24 = 24,
+    NINA_B1_GPIO_25 = 25,
+    NINA_B1_GPIO_27 = 27,
+    NINA_B1_GPIO_28 = 28,
+    NINA_B1_GPIO_29 = 29,
+    HOST_NUM_PINS
+};
+
+/** The nRF5 GPIO configuration values used by the application.
+ */
+enum {
+    NRF_GPIO_PIN_DIR_INPUT,
+    NRF_GPIO_PIN_DIR_OUTPUT,
+    NRF_GPIO_PIN_INPUT_CONNECT,
+    NRF_GPIO_PIN_INPUT_DISCONNECT,
+    NRF_GPIO_PIN_NOPULL,
+    NRF_GPIO_PIN_PULLDOWN,
+    NRF_GPIO_PIN_PULLUP,
+    NRF_GPIO_PIN_S0S1,
+    NRF_GPIO_PIN_S0D1,
+    NRF_GPIO_PIN_NOSENSE
+};
+
+/**************************************************************************
+ * TYPES: CMSIS-RTOS
+ *************************************************************************/
+
+/** RTOS status codes.
+ */
+typedef enum {
+    osOK = 0,
+    osEventSignal = 0x08,
+    osEventTimeout = 0x40,
+    osErrorParameter = 0x80,
+    osErrorResource = 0x81,
+    osErrorNoMemory = 0x85
+} osStatus;
+
+/** Thread priorities; on a host these are only remembered.
+ */
+typedef enum {
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = 1,
+    osPriorityHigh = 2,
+    osPriorityRealtime = 3
+} osPriority;
+
+/** The outcome of waiting for a signal.
+ */
+typedef struct {
+    osStatus status;
+    union {
+        uint32_t v;
+        int32_t signals;
+    } value;
+} osEvent;
+
+/** A thread ID.
+ */
+typedef void *osThreadId;
+
+/** Fatal error context, as passed to an error hook.
+ */
+typedef struct {
+    unsigned int error_status;
+    unsigned int error_address;
+    unsigned int error_value;
+    unsigned int thread_id;
+    unsigned int thread_entry_address;
+    unsigned int thread_stack_size;
+    unsigned int thread_stack_mem;
+    unsigned int thread_current_sp;
+} mbed_error_ctx;
+
+/** A fatal error hook.
+ */
+typedef void (*mbed_error_hook_t)(const mbed_error_ctx *error_ctx);
+
+/**************************************************************************
+ * FUNCTIONS: HOST CLOCK
+ *************************************************************************/
+
+/** Get the host clock: everything in this shim that measures time or
+ * waits for it does so on this clock, which is the host's monotonic
+ * clock unless hostClockSetScale() or hostClockAdvance() have been
+ * called, e.g. by a simulation running in virtual time.
+ *
+ * @return the time since start-up in microseconds.
+ */
+long long int hostClockUs();
+
+/** Convert a period on the host clock into real time, i.e. the time
+ * that std::chrono waits should be given.
+ *
+ * @param us the period on the host clock in microseconds.
+ * @return   the period in real time.
+ */
+std::chrono::microseconds hostClockToReal(long long int us);
+
+/** Make the host clock run faster than real time.
+ *
+ * @param scale the number of host clock seconds per real second,
+ *              1 (the default) being real time.
+ */
+void hostClockSetScale(unsigned int scale);
+
+/** Move the host clock (and hence the RTC) on, as if that much time
+ * had passed in an instant.  Running Timers see the jump, waits
+ * that are in progress don't.
+ *
+ * @param us the time to move the host clock on by in microseconds.
+ */
+void hostClockAdvance(long long int us);
+
+/**************************************************************************
+ * CLASSES: CALLBACK
+ *************************************************************************/
+
+template <typename F> class Callback;
+
+/** Callback, over std::function.
+ */
+template <typename R, typename... A>
+class Callback<R(A...)> {
+public:
+    Callback() {}
+    Callback(R (*pFunction)(A...)) {
+        if (pFunction != NULL) {
+            _function = pFunction;
+        }
+    }
+    Callback(const std::function<R(A...)> &function) : _function(function) {}
+    template <typename T>
+    Callback(T *pObject, R (T::*pMethod)(A...)) {
+        _function = [pObject, pMethod](A... a) { return (pObject->*pMethod)(a...); };
+    }
+    R call(A... a) const { return _function(a...); }
+    R operator()(A... a) const { return _function(a...); }
+    operator bool() const { return (bool) _function; }
+private:
+    std::function<R(A...)> _function;
+};
+
+/** Make a callback from a function.
+ */
+template <typename R>
+Callback<R()> callback(R (*pFunction)())
+{
+    return Callback<R()>(pFunction);
+}
+
+/** Make a callback from a function and the argument to call it with.
+ */
+template <typename R, typename T, typename U>
+Callback<R()> callback(R (*pFunction)(T), U argument)
+{
+    return Callback<R()>(std::function<R()>([pFunction, argument]() { return pFunction(argument); }));
+}
+
+/** Make a callback from an object and a method.
+ */
+template <typename R, typename T>
+Callback<R()> callback(T *pObject, R (T::*pMethod)())
+{
+    return Callback<R()>(pObject, pMethod);
+}
+
+/**************************************************************************
+ * CLASSES: RTOS
+ *************************************************************************/
+
+namespace rtos {
+
+/** Mutex, recursive as the mbed one is.
+ */
+class Mutex {
+public:
+    osStatus lock(uint32_t millisec = osWaitForever) {
+        osStatus status = osOK;
+        if (millisec == osWaitForever) {
+            _mutex.lock();
+        } else if (!_mutex.try_lock_for(hostClockToReal(((long long int) millisec) * 1000))) {
+            status = osErrorResource;
+        }
+        return status;
+    }
+    bool trylock() { return _mutex.try_lock(); }
+    osStatus unlock() { _mutex.unlock(); return osOK; }
+private:
+    std::recursive_timed_mutex _mutex;
+};
+
+/** Counting semaphore.
+ */
+class Semaphore {
+public:
+    Semaphore(int count = 0) : _count(count) {}
+    int wait(uint32_t millisec = osWaitForever) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (millisec == osWaitForever) {
+            _condition.wait(lock, [this] { return _count > 0; });
+        } else {
+            _condition.wait_for(lock, hostClockToReal(((long long int) millisec) * 1000),
+                                [this] { return _count > 0; });
+        }
+        int tokens = _count;
+        if (_count > 0) {
+            _count--;
+        }
+        return tokens;
+    }
+    osStatus release() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _count++;
+        _condition.notify_one();
+        return osOK;
+    }
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    int _count;
+};
+
+/** Thread, over std::thread.  Threads can't be killed on a host
+ * so terminate() is not supported: a thread should be asked to
+ * end, e.g. with a signal, and then joined.  A thread that is
+ * deleted before it ends is detached.
+ */
+class Thread {
+public:
+    enum State {
+        Inactive,
+        Ready,
+        Running,
+        WaitingDelay,
+        WaitingJoin,
+        WaitingThreadFlag,
+        WaitingEventFlag,
+        WaitingMutex,
+        WaitingSemaphore,
+        WaitingMemoryPool,
+        WaitingMessageGet,
+        WaitingMessagePut,
+        WaitingInterval,
+        WaitingOr,
+        WaitingAnd,
+        WaitingMailbox,
+        Deleted
+    };
+
+    Thread(osPriority priority = osPriorityNormal,
+           uint32_t stack_size = OS_STACK_SIZE,
+           unsigned char *stack_mem = NULL, const char *name = NULL);
+    ~Thread();
+    osStatus start(Callback<void()> task);
+    osStatus join();
+    osStatus terminate();
+    int32_t signal_set(int32_t signals);
+    State get_state();
+    osPriority get_priority() { return _priority; }
+    uint32_t stack_size() { return _stackSize; }
+    static osEvent signal_wait(int32_t signals, uint32_t millisec = osWaitForever);
+    static osStatus wait(uint32_t millisec);
+    static osStatus yield();
+    static osThreadId gettid();
+
+    /** The state shared between a Thread object and the thread
+     * itself, which may outlive it.
+     */
+    struct Shared {
+        std::mutex mutex;
+        std::condition_variable condition;
+        int32_t signals;
+        bool started;
+        bool ended;
+        Shared() : signals(0), started(false), ended(false) {}
+    };
+
+private:
+    static std::shared_ptr<Shared> &current();
+    std::shared_ptr<Shared> _shared;
+    std::thread _thread;
+    osPriority _priority;
+    uint32_t _stackSize;
+};
+
+}
+
+using namespace rtos;
+
+/** The stack used by a thread: no way to tell on a host.
+ */
+inline uint32_t osThreadGetStackSize(osThreadId threadId) { (void) threadId; return 0; }
+inline uint32_t osThreadGetStackSpace(osThreadId threadId) { (void) threadId; return 0; }
+
+/**************************************************************************
+ * CLASSES: DRIVERS
+ *************************************************************************/
+
+/** Timer, on the host clock.
+ */
+class Timer {
+public:
+    Timer() : _running(false), _elapsedUs(0), _startUs(0) {}
+    void start() {
+        if (!_running) {
+            _startUs = hostClockUs();
+            _running = true;
+        }
+    }
+    void stop() {
+        _elapsedUs = read_us();
+        _running = false;
+    }
+    void reset() {
+        _startUs = hostClockUs();
+        _elapsedUs = 0;
+    }
+    int read_us() {
+        long long int us = _elapsedUs;
+        if (_running) {
+            us += hostClockUs() - _startUs;
+        }
+        return (int) us;
+    }
+    int read_ms() { return read_us() / 1000; }
+    float read() { return (float) read_us() / 1000000; }
+private:
+    bool _running;
+    long long int _elapsedUs;
+    long long int _startUs;
+};
+
+/** Ticker: the callback is made from a thread of the ticker's own
+ * rather than from an interrupt.
+ */
+class Ticker {
+public:
+    Ticker() : _running(false) {}
+    ~Ticker() { detach(); }
+    void attach(Callback<void()> function, float seconds) {
+        attach_us(function, (uint64_t) (seconds * 1000000));
+    }
+    void attach_us(Callback<void()> function, uint64_t us);
+    void detach();
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::thread _thread;
+    bool _running;
+};
+
+/** Timeout: as Ticker but the callback is made only once.
+ */
+class Timeout {
+public:
+    Timeout() : _running(false) {}
+    ~Timeout() { detach(); }
+    void attach(Callback<void()> function, float seconds) {
+        attach_us(function, (uint64_t) (seconds * 1000000));
+    }
+    void attach_us(Callback<void()> function, uint64_t us);
+    void detach();
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::thread _thread;
+    bool _running;
+};
+
+/** Interrupt input: the fall() function is called by
+ * hostInterruptInFall() rather than by a pin, from the thread
+ * that calls it.
+ */
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : _pin(pin) {}
+    ~InterruptIn() { fall(NULL); }
+    void mode(PinMode pull) { (void) pull; }
+    void fall(Callback<void()> function);
+private:
+    PinName _pin;
+};
+
+/** Digital output: remembers its value and nothing more.
+ */
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int value = 0) : _pin(pin), _value(value) {}
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    DigitalOut &operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+private:
+    PinName _pin;
+    int _value;
+};
+
+/** Analogue input: returns what hostAnalogInSet() was given for
+ * the pin.
+ */
+class AnalogIn {
+public:
+    AnalogIn(PinName pin) : _pin(pin) {}
+    unsigned short read_u16();
+    float read() { return (float) read_u16() / 0xFFFF; }
+private:
+    PinName _pin;
+};
+
+/** I2C, implemented by i2c_mock.cpp.
+ */
+class I2C {
+public:
+    I2C(PinName sda, PinName scl);
+    void frequency(int hz);
+    int write(int address, const char *data, int length, bool repeated = false);
+    int read(int address, char *data, int length, bool repeated = false);
+    void stop();
+};
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Waits.
+ */
+inline void wait_us(int us) { std::this_thread::sleep_for(hostClockToReal(us)); }
+inline void wait_ms(int ms) { std::this_thread::sleep_for(hostClockToReal(((long long int) ms) * 1000)); }
+inline void wait(float seconds) { wait_us((int) (seconds * 1000000)); }
+
+/** Debug prints, if the condition is true.
+ */
+inline void debug_if(int condition, const char *pFormat, ...)
+{
+    va_list args;
+
+    if (condition) {
+        va_start(args, pFormat);
+        vprintf(pFormat, args);
+        va_end(args);
+    }
+}
+
+/** The microsecond ticker: the host clock, wrapping at 32 bits.
+ */
+inline uint32_t us_ticker_read() { return (uint32_t) hostClockUs(); }
+
+/** Critical sections: one lock for everything, standing in for
+ * disabling interrupts.
+ */
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+/** nRF5 GPIO configuration: nothing to do on a host.
+ */
+inline void nrf_gpio_cfg(uint32_t pin, int dir, int input, int pull, int drive, int sense)
+{
+    (void) pin; (void) dir; (void) input; (void) pull; (void) drive; (void) sense;
+}
+inline void nrf_gpio_pin_set(uint32_t pin) { (void) pin; }
+inline void nrf_gpio_pin_clear(uint32_t pin) { (void) pin; }
+
+/** Reset: on a host, exit.
+ */
+inline void NVIC_SystemReset() { exit(0); }
+
+/** Set the RTC.
+ */
+void set_time(time_t timeUTC);
+
+/** The RTC, as set by set_time(); this replaces the C library
+ * time() for everything that includes this file.
+ */
+time_t hostTime(time_t *pTimeUTC);
+#define time(x) hostTime(x)
+
+/**************************************************************************
+ * FUNCTIONS: HOST EXTENSIONS
+ *************************************************************************/
+
+/** Set the value an analogue input pin returns from read_u16().
+ *
+ * @param pin   the pin.
+ * @param value the 16-bit ADC reading.
+ */
+void hostAnalogInSet(PinName pin, unsigned short value);
+
+/** Drive an interrupt input pin low, calling the fall() function
+ * of the InterruptIn on that pin, if there is one.
+ *
+ * @param pin the pin.
+ */
+void hostInterruptInFall(PinName pin);
+
+#endif // _HOST_SHIM_MBED_H_
+
+// End Of File
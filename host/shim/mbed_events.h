@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_MBED_EVENTS_H_
+#define _HOST_SHIM_MBED_EVENTS_H_
+
+// Just enough of mbed events for the application to run on a host:
+// an event queue that dispatches in whichever thread calls
+// dispatch(), as the mbed one does.
+
+#include <list>
+#include <mbed.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The size of an event; on a host the size of a queue is only
+ * used to limit the number of events in it.
+ */
+#define EVENTS_EVENT_SIZE 64
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** Event queue.
+ */
+class EventQueue {
+public:
+    EventQueue(unsigned int size = 32 * EVENTS_EVENT_SIZE, unsigned char *buffer = NULL);
+
+    /** Call a function as soon as possible, after a delay or
+     * periodically; the return value is an ID for cancel(), zero
+     * if the queue is full.
+     */
+    int call(Callback<void()> function) { return post(0, -1, function); }
+    int call_in(int ms, Callback<void()> function) { return post(ms, -1, function); }
+    int call_every(int ms, Callback<void()> function) { return post(ms, ms, function); }
+    template <typename F, typename A>
+    int call(F function, A argument) { return call(callback(function, argument)); }
+    template <typename F, typename A>
+    int call_in(int ms, F function, A argument) { return call_in(ms, callback(function, argument)); }
+    template <typename F, typename A>
+    int call_every(int ms, F function, A argument) { return call_every(ms, callback(function, argument)); }
+
+    /** Cancel an event, if it has not yet been dispatched.
+     */
+    void cancel(int id);
+
+    /** Dispatch events for a time, or until break_dispatch() is
+     * called if ms is negative.
+     */
+    void dispatch(int ms = -1);
+    void dispatch_forever() { dispatch(-1); }
+    void break_dispatch();
+
+private:
+    typedef struct {
+        int id;
+        std::chrono::steady_clock::time_point due;
+        int periodMs;
+        Callback<void()> function;
+    } Event;
+
+    int post(int delayMs, int periodMs, Callback<void()> function);
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::list<Event> _events;
+    unsigned int _maxNumEvents;
+    int _nextId;
+    bool _break;
+};
+
+#endif // _HOST_SHIM_MBED_EVENTS_H_
+
+// End Of File
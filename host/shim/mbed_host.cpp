@@ -0,0 +1,627 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The parts of the host mbed shim that are not inline.
+
+#include <malloc.h> // For malloc_usable_size()
+#include <atomic>
+#include <mbed.h>
+#include <mbed_events.h>
+#include <mbed_stats.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The number of threads to start and stop before main(), more than
+ * are ever running at once under test.
+ */
+#define HOST_START_UP_NUM_THREADS 16
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The lock standing in for disabling interrupts.
+ */
+static std::recursive_mutex gCriticalSection;
+
+/** The values returned by the analogue inputs.
+ */
+static unsigned short gAnalogIn[HOST_NUM_PINS];
+
+/** The fall() functions of the interrupt inputs and a lock for them.
+ */
+static std::mutex gInterruptInMutex;
+static Callback<void()> gInterruptInFall[HOST_NUM_PINS];
+
+/** The difference between the RTC and the host clock.
+ */
+static time_t gTimeOffset = (::time)(NULL);
+
+/** The host clock: the real time at which it was last
+ * rebased, the host clock time then and its scale.
+ */
+static std::mutex gClockMutex;
+static std::chrono::steady_clock::time_point gClockRealBase = std::chrono::steady_clock::now();
+static long long int gClockBaseUs = 0;
+static std::atomic<unsigned int> gClockScale(1);
+
+/** The heap statistics, kept by the allocation wrappers below as
+ * mbed keeps them, so that a test sees only what it allocates.
+ */
+static std::atomic<uint32_t> gHeapCurrentSize(0);
+static std::atomic<uint32_t> gHeapMaxSize(0);
+static std::atomic<uint32_t> gHeapAllocCount(0);
+static std::atomic<uint32_t> gHeapAllocFailCount(0);
+
+/**************************************************************************
+ * CLASSES: THREAD
+ *************************************************************************/
+
+// The state of the calling thread.
+std::shared_ptr<Thread::Shared> &Thread::current()
+{
+    static thread_local std::shared_ptr<Shared> shared;
+
+    if (!shared) {
+        // A thread not started by Thread, e.g. main()
+        shared = std::make_shared<Shared>();
+        shared->started = true;
+    }
+
+    return shared;
+}
+
+// Constructor.
+Thread::Thread(osPriority priority, uint32_t stack_size,
+               unsigned char *stack_mem, const char *name)
+{
+    (void) stack_mem;
+    (void) name;
+    _priority = priority;
+    _stackSize = stack_size;
+    _shared = std::make_shared<Shared>();
+}
+
+// Destructor: a thread that hasn't ended is left to itself.
+Thread::~Thread()
+{
+    if (_thread.joinable()) {
+        if (get_state() == Deleted) {
+            _thread.join();
+        } else {
+            _thread.detach();
+        }
+    }
+}
+
+// Start the thread.
+osStatus Thread::start(Callback<void()> task)
+{
+    std::shared_ptr<Shared> shared = _shared;
+    osStatus status = osErrorParameter;
+
+    if (!_shared->started) {
+        _shared->started = true;
+        _thread = std::thread([shared, task]() {
+            current() = shared;
+            task();
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->ended = true;
+        });
+        status = osOK;
+    }
+
+    return status;
+}
+
+// Wait for the thread to end.
+osStatus Thread::join()
+{
+    osStatus status = osErrorResource;
+
+    if (_thread.joinable()) {
+        _thread.join();
+        status = osOK;
+    }
+
+    return status;
+}
+
+// Terminate the thread: not possible on a host.
+osStatus Thread::terminate()
+{
+    return osErrorResource;
+}
+
+// Set signals on the thread.
+int32_t Thread::signal_set(int32_t signals)
+{
+    std::lock_guard<std::mutex> lock(_shared->mutex);
+
+    _shared->signals |= signals;
+    _shared->condition.notify_all();
+
+    return _shared->signals;
+}
+
+// Get the state of the thread.
+Thread::State Thread::get_state()
+{
+    std::lock_guard<std::mutex> lock(_shared->mutex);
+    State state = Inactive;
+
+    if (_shared->ended) {
+        state = Deleted;
+    } else if (_shared->started) {
+        state = Running;
+    }
+
+    return state;
+}
+
+// Wait for signals to be set on the calling thread: all of those
+// given or, if signals is zero, any.
+osEvent Thread::signal_wait(int32_t signals, uint32_t millisec)
+{
+    std::shared_ptr<Shared> shared = current();
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    osEvent event;
+    auto isSet = [shared, signals]() {
+        return (signals == 0) ? (shared->signals != 0) :
+                                ((shared->signals & signals) == signals);
+    };
+
+    if (millisec == osWaitForever) {
+        shared->condition.wait(lock, isSet);
+    } else if (millisec > 0) {
+        shared->condition.wait_for(lock, hostClockToReal(((long long int) millisec) * 1000), isSet);
+    }
+
+    event.value.signals = shared->signals;
+    if (isSet()) {
+        event.status = osEventSignal;
+        shared->signals &= (signals == 0) ? 0 : ~signals;
+    } else {
+        event.status = (millisec == 0) ? osOK : osEventTimeout;
+    }
+
+    return event;
+}
+
+// Wait.
+osStatus Thread::wait(uint32_t millisec)
+{
+    std::this_thread::sleep_for(hostClockToReal(((long long int) millisec) * 1000));
+
+    return osOK;
+}
+
+// Yield.
+osStatus Thread::yield()
+{
+    std::this_thread::yield();
+
+    return osOK;
+}
+
+// Get the ID of the calling thread.
+osThreadId Thread::gettid()
+{
+    return (osThreadId) current().get();
+}
+
+/**************************************************************************
+ * CLASSES: TICKER
+ *************************************************************************/
+
+// Call a function periodically.
+void Ticker::attach_us(Callback<void()> function, uint64_t us)
+{
+    detach();
+    _running = true;
+    _thread = std::thread([this, function, us]() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto next = std::chrono::steady_clock::now();
+        while (_running) {
+            next += hostClockToReal(us);
+            if (!_condition.wait_until(lock, next, [this] { return !_running; })) {
+                lock.unlock();
+                function();
+                lock.lock();
+            }
+        }
+    });
+}
+
+// Stop calling the function.
+void Ticker::detach()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+        _condition.notify_all();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+/**************************************************************************
+ * CLASSES: TIMEOUT
+ *************************************************************************/
+
+// Call a function once, after a delay.
+void Timeout::attach_us(Callback<void()> function, uint64_t us)
+{
+    detach();
+    _running = true;
+    _thread = std::thread([this, function, us]() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_condition.wait_for(lock, hostClockToReal(us), [this] { return !_running; })) {
+            _running = false;
+            lock.unlock();
+            function();
+        }
+    });
+}
+
+// Cancel the call, if it has not been made.
+void Timeout::detach()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+        _condition.notify_all();
+    }
+    if (_thread.joinable()) {
+        if (_thread.get_id() == std::this_thread::get_id()) {
+            // Called from the callback itself
+            _thread.detach();
+        } else {
+            _thread.join();
+        }
+    }
+}
+
+/**************************************************************************
+ * CLASSES: INTERRUPT INPUT
+ *************************************************************************/
+
+// Set the function to call on a falling edge.
+void InterruptIn::fall(Callback<void()> function)
+{
+    std::lock_guard<std::mutex> lock(gInterruptInMutex);
+
+    if ((_pin >= 0) && (_pin < HOST_NUM_PINS)) {
+        gInterruptInFall[_pin] = function;
+    }
+}
+
+/**************************************************************************
+ * CLASSES: ANALOGUE INPUT
+ *************************************************************************/
+
+// Read the analogue input.
+unsigned short AnalogIn::read_u16()
+{
+    return ((_pin >= 0) && (_pin < HOST_NUM_PINS)) ? gAnalogIn[_pin] : 0;
+}
+
+/**************************************************************************
+ * CLASSES: EVENT QUEUE
+ *************************************************************************/
+
+// Constructor.
+EventQueue::EventQueue(unsigned int size, unsigned char *buffer)
+{
+    (void) buffer;
+    _maxNumEvents = size / EVENTS_EVENT_SIZE;
+    _nextId = 1;
+    _break = false;
+}
+
+// Add an event to the queue.
+int EventQueue::post(int delayMs, int periodMs, Callback<void()> function)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Event event;
+    int id = 0;
+
+    if (_events.size() < _maxNumEvents) {
+        event.id = _nextId;
+        event.due = std::chrono::steady_clock::now() + hostClockToReal(((long long int) delayMs) * 1000);
+        event.periodMs = periodMs;
+        event.function = function;
+        _events.push_back(event);
+        id = _nextId;
+        _nextId++;
+        _condition.notify_all();
+    }
+
+    return id;
+}
+
+// Cancel an event.
+void EventQueue::cancel(int id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _events.remove_if([id](const Event &event) { return event.id == id; });
+}
+
+// Dispatch events.
+void EventQueue::dispatch(int ms)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto end = std::chrono::steady_clock::now() + hostClockToReal(((long long int) ms) * 1000);
+    std::list<Event>::iterator next;
+    Callback<void()> function;
+
+    _break = false;
+    while (!_break && ((ms < 0) || (std::chrono::steady_clock::now() < end))) {
+        next = _events.end();
+        for (auto x = _events.begin(); x != _events.end(); x++) {
+            if ((next == _events.end()) || (x->due < next->due)) {
+                next = x;
+            }
+        }
+        if ((next != _events.end()) && (next->due <= std::chrono::steady_clock::now())) {
+            function = next->function;
+            if (next->periodMs >= 0) {
+                next->due += hostClockToReal(((long long int) next->periodMs) * 1000);
+            } else {
+                _events.erase(next);
+            }
+            lock.unlock();
+            function();
+            lock.lock();
+        } else if (next != _events.end()) {
+            if ((ms >= 0) && (end < next->due)) {
+                _condition.wait_until(lock, end);
+            } else {
+                _condition.wait_until(lock, next->due);
+            }
+        } else if (ms >= 0) {
+            _condition.wait_until(lock, end);
+        } else {
+            _condition.wait(lock);
+        }
+    }
+}
+
+// Stop dispatching events.
+void EventQueue::break_dispatch()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _break = true;
+    _condition.notify_all();
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Enter a critical section.
+void core_util_critical_section_enter()
+{
+    gCriticalSection.lock();
+}
+
+// Leave a critical section.
+void core_util_critical_section_exit()
+{
+    gCriticalSection.unlock();
+}
+
+// Get the host clock.
+long long int hostClockUs()
+{
+    std::lock_guard<std::mutex> lock(gClockMutex);
+
+    return gClockBaseUs + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                gClockRealBase).count() * gClockScale;
+}
+
+// Convert a period on the host clock into real time.
+std::chrono::microseconds hostClockToReal(long long int us)
+{
+    return std::chrono::microseconds(us / gClockScale);
+}
+
+// Make the host clock run faster than real time.
+void hostClockSetScale(unsigned int scale)
+{
+    long long int us = hostClockUs();
+    std::lock_guard<std::mutex> lock(gClockMutex);
+
+    gClockRealBase = std::chrono::steady_clock::now();
+    gClockBaseUs = us;
+    gClockScale = (scale > 0) ? scale : 1;
+}
+
+// Move the host clock on.
+void hostClockAdvance(long long int us)
+{
+    std::lock_guard<std::mutex> lock(gClockMutex);
+
+    gClockBaseUs += us;
+}
+
+// Set the RTC.
+void set_time(time_t timeUTC)
+{
+    gTimeOffset = timeUTC - (time_t) (hostClockUs() / 1000000);
+}
+
+// Read the RTC.
+time_t hostTime(time_t *pTimeUTC)
+{
+    time_t timeUTC = (time_t) (hostClockUs() / 1000000) + gTimeOffset;
+
+    if (pTimeUTC != NULL) {
+        *pTimeUTC = timeUTC;
+    }
+
+    return timeUTC;
+}
+
+// Set the value an analogue input returns.
+void hostAnalogInSet(PinName pin, unsigned short value)
+{
+    if ((pin >= 0) && (pin < HOST_NUM_PINS)) {
+        gAnalogIn[pin] = value;
+    }
+}
+
+// Drive an interrupt input low.
+void hostInterruptInFall(PinName pin)
+{
+    Callback<void()> function;
+
+    if ((pin >= 0) && (pin < HOST_NUM_PINS)) {
+        gInterruptInMutex.lock();
+        function = gInterruptInFall[pin];
+        gInterruptInMutex.unlock();
+        if (function) {
+            function();
+        }
+    }
+}
+
+// Get the heap statistics.
+void mbed_stats_heap_get(mbed_stats_heap_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->current_size = gHeapCurrentSize;
+    stats->max_size = gHeapMaxSize;
+    stats->alloc_cnt = gHeapAllocCount;
+    stats->alloc_fail_cnt = gHeapAllocFailCount;
+}
+
+// Get the stack statistics.
+void mbed_stats_stack_get(mbed_stats_stack_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**************************************************************************
+ * START-UP
+ *************************************************************************/
+
+/** The C library allocates things the first time they are needed and
+ * keeps them, e.g. its time-zone state and the thread-local storage
+ * that it caches with each thread's stack: need them all up front, before
+ * main(), so that a test measuring the heap before and after sees only
+ * what the code under test has allocated.
+ */
+static struct HostStartUp {
+    HostStartUp()
+    {
+        time_t t = 0;
+        std::thread threads[HOST_START_UP_NUM_THREADS];
+
+        gmtime(&t);
+        localtime(&t);
+        for (unsigned int x = 0; x < sizeof(threads) / sizeof(threads[0]); x++) {
+            threads[x] = std::thread([]() {});
+        }
+        for (unsigned int x = 0; x < sizeof(threads) / sizeof(threads[0]); x++) {
+            threads[x].join();
+        }
+    }
+} gHostStartUp;
+
+/**************************************************************************
+ * ALLOCATION WRAPPERS
+ *************************************************************************/
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pMem, size_t size);
+void __libc_free(void *pMem);
+
+// Account for a block allocated.
+static void *heapAdd(void *pMem)
+{
+    uint32_t maxSize;
+    uint32_t currentSize;
+
+    if (pMem != NULL) {
+        currentSize = (gHeapCurrentSize += (uint32_t) malloc_usable_size(pMem));
+        maxSize = gHeapMaxSize;
+        while ((currentSize > maxSize) &&
+               !gHeapMaxSize.compare_exchange_weak(maxSize, currentSize)) {}
+        gHeapAllocCount++;
+    } else {
+        gHeapAllocFailCount++;
+    }
+
+    return pMem;
+}
+
+// Account for a block about to be freed.
+static void heapRemove(void *pMem)
+{
+    if (pMem != NULL) {
+        gHeapCurrentSize -= (uint32_t) malloc_usable_size(pMem);
+        gHeapAllocCount--;
+    }
+}
+
+// malloc() with heap statistics.
+void *malloc(size_t size)
+{
+    return heapAdd(__libc_malloc(size));
+}
+
+// calloc() with heap statistics.
+void *calloc(size_t count, size_t size)
+{
+    return heapAdd(__libc_calloc(count, size));
+}
+
+// realloc() with heap statistics.
+void *realloc(void *pMem, size_t size)
+{
+    void *pNew;
+
+    heapRemove(pMem);
+    pNew = __libc_realloc(pMem, size);
+    if ((pNew == NULL) && (pMem != NULL) && (size > 0)) {
+        // The original block is still there
+        heapAdd(pMem);
+    } else if (pNew != NULL) {
+        heapAdd(pNew);
+    }
+
+    return pNew;
+}
+
+// free() with heap statistics.
+void free(void *pMem)
+{
+    heapRemove(pMem);
+    __libc_free(pMem);
+}
+
+}
+
+// End of file
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_MBED_POLL_H_
+#define _HOST_SHIM_MBED_POLL_H_
+
+// mbed poll() on a host: nothing ever arrives unasked for, the
+// responses of the mock ATCmdParser only being read by recv().
+
+#include <mbed.h>
+#include <FileHandle.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** How long poll() waits at most, so that a thread polling in
+ * a loop notices quickly when it is asked to stop.
+ */
+#define HOST_POLL_MAX_WAIT_MS 10
+
+#define POLLIN  0x0001
+#define POLLOUT 0x0010
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A file handle and the events to poll it for.
+ */
+typedef struct {
+    FileHandle *fh;
+    short events;
+    short revents;
+} pollfh;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Poll: waits, up to HOST_POLL_MAX_WAIT_MS, and returns no events.
+ */
+inline int poll(pollfh fhs[], unsigned int nfhs, int timeout)
+{
+    for (unsigned int x = 0; x < nfhs; x++) {
+        fhs[x].revents = 0;
+    }
+    if ((timeout < 0) || (timeout > HOST_POLL_MAX_WAIT_MS)) {
+        timeout = HOST_POLL_MAX_WAIT_MS;
+    }
+    wait_ms(timeout);
+
+    return 0;
+}
+
+#endif // _HOST_SHIM_MBED_POLL_H_
+
+// End Of File
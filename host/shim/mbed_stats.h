@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_MBED_STATS_H_
+#define _HOST_SHIM_MBED_STATS_H_
+
+// The mbed heap and stack statistics, from the C library
+// allocator on a host.
+
+#include <stdint.h>
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** Heap statistics.
+ */
+typedef struct {
+    uint32_t current_size;
+    uint32_t max_size;
+    uint32_t total_size;
+    uint32_t reserved_size;
+    uint32_t alloc_cnt;
+    uint32_t alloc_fail_cnt;
+} mbed_stats_heap_t;
+
+/** Stack statistics: not available on a host.
+ */
+typedef struct {
+    uint32_t thread_id;
+    uint32_t max_size;
+    uint32_t reserved_size;
+    uint32_t stack_cnt;
+} mbed_stats_stack_t;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Get the heap statistics: current_size is the number of bytes
+ * allocated from the C library heap.
+ */
+void mbed_stats_heap_get(mbed_stats_heap_t *stats);
+
+/** Get the stack statistics: all zero.
+ */
+void mbed_stats_stack_get(mbed_stats_stack_t *stats);
+
+#endif // _HOST_SHIM_MBED_STATS_H_
+
+// End Of File
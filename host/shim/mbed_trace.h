@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_MBED_TRACE_H_
+#define _HOST_SHIM_MBED_TRACE_H_
+
+// mbed trace on a host: the trace goes to stdout, under the
+// same mutex functions as on the target.
+
+#include <stdio.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Trace at the given level, prefixed with the level and TRACE_GROUP.
+ */
+#define HOST_TRACE(level, ...) do {                                        \
+    if (gpHostTraceWait != NULL) {                                         \
+        gpHostTraceWait();                                                 \
+    }                                                                      \
+    printf("[" level "][%s]: ", TRACE_GROUP);                              \
+    printf(__VA_ARGS__);                                                   \
+    printf("\n");                                                          \
+    if (gpHostTraceRelease != NULL) {                                      \
+        gpHostTraceRelease();                                              \
+    }                                                                      \
+} while (0)
+#define tr_debug(...) HOST_TRACE("DBG ", __VA_ARGS__)
+#define tr_info(...) HOST_TRACE("INFO", __VA_ARGS__)
+#define tr_warn(...) HOST_TRACE("WARN", __VA_ARGS__)
+#define tr_error(...) HOST_TRACE("ERR ", __VA_ARGS__)
+
+/**************************************************************************
+ * VARIABLES
+ *************************************************************************/
+
+/** The trace mutex functions.
+ */
+static void (*gpHostTraceWait)() = NULL;
+static void (*gpHostTraceRelease)() = NULL;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Initialise trace.
+ */
+inline int mbed_trace_init()
+{
+    return 0;
+}
+
+/** Set the trace mutex functions.
+ */
+inline void mbed_trace_mutex_wait_function_set(void (*pWait)())
+{
+    gpHostTraceWait = pWait;
+}
+inline void mbed_trace_mutex_release_function_set(void (*pRelease)())
+{
+    gpHostTraceRelease = pRelease;
+}
+
+#endif // _HOST_SHIM_MBED_TRACE_H_
+
+// End Of File
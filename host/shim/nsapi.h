@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_NSAPI_H_
+#define _HOST_SHIM_NSAPI_H_
+
+// The mbed network socket API types on a host, and a SocketAddress
+// that holds an address as the string it was given.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Room for an IP address string.
+ */
+#define NSAPI_IP_SIZE 46
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** Errors, as for mbed.
+ */
+enum nsapi_error {
+    NSAPI_ERROR_OK                  =  0,
+    NSAPI_ERROR_WOULD_BLOCK         = -3001,
+    NSAPI_ERROR_UNSUPPORTED         = -3002,
+    NSAPI_ERROR_PARAMETER           = -3003,
+    NSAPI_ERROR_NO_CONNECTION       = -3004,
+    NSAPI_ERROR_NO_SOCKET           = -3005,
+    NSAPI_ERROR_NO_ADDRESS          = -3006,
+    NSAPI_ERROR_NO_MEMORY           = -3007,
+    NSAPI_ERROR_NO_SSID             = -3008,
+    NSAPI_ERROR_DNS_FAILURE         = -3009,
+    NSAPI_ERROR_DHCP_FAILURE        = -3010,
+    NSAPI_ERROR_AUTH_FAILURE        = -3011,
+    NSAPI_ERROR_DEVICE_ERROR        = -3012,
+    NSAPI_ERROR_IN_PROGRESS         = -3013,
+    NSAPI_ERROR_ALREADY             = -3014,
+    NSAPI_ERROR_IS_CONNECTED        = -3015,
+    NSAPI_ERROR_CONNECTION_LOST     = -3016,
+    NSAPI_ERROR_CONNECTION_TIMEOUT  = -3017
+};
+
+typedef signed int nsapi_error_t;
+typedef unsigned int nsapi_size_t;
+typedef signed int nsapi_size_or_error_t;
+typedef void *nsapi_socket_t;
+
+/** Security types.
+ */
+typedef enum nsapi_security {
+    NSAPI_SECURITY_NONE = 0x0,
+    NSAPI_SECURITY_WEP = 0x1,
+    NSAPI_SECURITY_WPA = 0x2,
+    NSAPI_SECURITY_WPA2 = 0x3,
+    NSAPI_SECURITY_WPA_WPA2 = 0x4,
+    NSAPI_SECURITY_PAP = 0x5,
+    NSAPI_SECURITY_CHAP = 0x6,
+    NSAPI_SECURITY_UNKNOWN = 0xFF
+} nsapi_security_t;
+
+/** IP versions.
+ */
+typedef enum nsapi_version {
+    NSAPI_UNSPEC,
+    NSAPI_IPv4,
+    NSAPI_IPv6
+} nsapi_version_t;
+
+/** Protocols.
+ */
+typedef enum nsapi_protocol {
+    NSAPI_TCP,
+    NSAPI_UDP
+} nsapi_protocol_t;
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** A socket address: an IP address string and a port.
+ */
+class SocketAddress {
+public:
+    SocketAddress(const char *pAddress = NULL, uint16_t port = 0) : _port(port) {
+        set_ip_address(pAddress);
+    }
+    bool set_ip_address(const char *pAddress) {
+        _address[0] = 0;
+        if (pAddress != NULL) {
+            snprintf(_address, sizeof(_address), "%s", pAddress);
+        }
+        return true;
+    }
+    void set_port(uint16_t port) { _port = port; }
+    const char *get_ip_address() const { return (_address[0] != 0) ? _address : NULL; }
+    uint16_t get_port() const { return _port; }
+    nsapi_version_t get_ip_version() const { return (_address[0] != 0) ? NSAPI_IPv4 : NSAPI_UNSPEC; }
+    operator bool() const { return _address[0] != 0; }
+private:
+    char _address[NSAPI_IP_SIZE];
+    uint16_t _port;
+};
+
+#endif // _HOST_SHIM_NSAPI_H_
+
+// End Of File
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_ONBOARD_MODEM_API_H_
+#define _HOST_SHIM_ONBOARD_MODEM_API_H_
+
+// The mbed on-board modem power control on a host: there is
+// no modem to power.
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+inline void onboard_modem_init() {}
+inline void onboard_modem_deinit() {}
+inline void onboard_modem_power_up() {}
+inline void onboard_modem_power_down() {}
+
+#endif // _HOST_SHIM_ONBOARD_MODEM_API_H_
+
+// End Of File
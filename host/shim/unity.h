@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_UNITY_H_
+#define _HOST_SHIM_UNITY_H_
+
+// The unity assertions used by the unit tests; on a host a failed
+// assertion is printed and thrown, to be caught by Harness::run().
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** Thrown by a failed assertion.
+ */
+struct UnityFailure {
+    const char *pFile;
+    int line;
+};
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Fail the test case.
+ */
+#define TEST_FAIL_MESSAGE(message) {                                       \
+    printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, message);              \
+    throw UnityFailure {__FILE__, __LINE__};                               \
+}
+
+/** The assertions; like unity's own, these are if/else statements
+ * so a missing semicolon goes unnoticed, as it does on the target.
+ */
+#define TEST_ASSERT(condition) if (condition) {} else TEST_FAIL_MESSAGE(#condition)
+#define TEST_ASSERT_TRUE(condition) TEST_ASSERT(condition)
+#define TEST_ASSERT_FALSE(condition) TEST_ASSERT(!(condition))
+#define TEST_ASSERT_EQUAL(expected, actual) TEST_ASSERT((expected) == (actual))
+#define TEST_ASSERT_EQUAL_INT(expected, actual) TEST_ASSERT((expected) == (actual))
+#define TEST_ASSERT_INT32_WITHIN(delta, expected, actual)                  \
+    TEST_ASSERT(labs((long) (actual) - (long) (expected)) <= (long) (delta))
+
+#endif // _HOST_SHIM_UNITY_H_
+
+// End Of File
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _HOST_SHIM_UTEST_H_
+#define _HOST_SHIM_UTEST_H_
+
+// Just enough of utest for the unit tests to run on a host: the
+// cases are run in order and the result printed.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <unity.h>
+
+namespace utest {
+namespace v1 {
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The status returned by a setup handler.
+ */
+typedef enum {
+    STATUS_CONTINUE = 0,
+    STATUS_ABORT = -1
+} status_t;
+
+/** A test case.
+ */
+class Case {
+public:
+    Case(const char *pDescription, void (*pHandler)()) :
+        _pDescription(pDescription), _pHandler(pHandler) {}
+
+    const char *_pDescription;
+    void (*_pHandler)();
+};
+
+/** A test specification: a setup handler and the cases.
+ */
+class Specification {
+public:
+    template <size_t N>
+    Specification(status_t (*pSetup)(const size_t), Case (&cases)[N]) :
+        _pSetup(pSetup), _pCases(cases), _numCases(N) {}
+
+    status_t (*_pSetup)(const size_t);
+    Case *_pCases;
+    size_t _numCases;
+};
+
+/**************************************************************************
+ * CLASSES
+ *************************************************************************/
+
+/** Run a specification, returning true if every case passed.
+ */
+class Harness {
+public:
+    static bool run(const Specification &specification)
+    {
+        size_t numFailed = 0;
+
+        if ((specification._pSetup != NULL) &&
+            (specification._pSetup(specification._numCases) != STATUS_CONTINUE)) {
+            return false;
+        }
+        for (size_t x = 0; x < specification._numCases; x++) {
+            const Case *pCase = &(specification._pCases[x]);
+            printf(">>> Running case #%u: '%s'...\n", (unsigned int) (x + 1), pCase->_pDescription);
+            try {
+                pCase->_pHandler();
+                printf(">>> '%s': passed\n", pCase->_pDescription);
+            } catch (const UnityFailure &) {
+                printf(">>> '%s': FAILED\n", pCase->_pDescription);
+                numFailed++;
+            }
+        }
+        printf(">>> %u passed, %u failed\n", (unsigned int) (specification._numCases - numFailed),
+               (unsigned int) numFailed);
+
+        return numFailed == 0;
+    }
+};
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** The setup handler the unit tests chain to.
+ */
+inline status_t verbose_test_setup_handler(const size_t number_of_cases)
+{
+    printf(">>> Running %u test cases...\n", (unsigned int) number_of_cases);
+
+    return STATUS_CONTINUE;
+}
+
+} // namespace v1
+} // namespace utest
+
+#endif // _HOST_SHIM_UTEST_H_
+
+// End Of File
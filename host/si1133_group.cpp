@@ -0,0 +1,314 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host test of the Si1133 driver reading all four channels as a
+// group, against a mock Si1133 on the mock bus of i2c_mock.cpp.  As
+// on the real chip the channels are measured one at a time, each
+// setting its bit of IRQ_STATUS, the interrupt output goes low when
+// any enabled bit is set and reading IRQ_STATUS clears it.  The
+// mock's oscillator is slow, so the last channel ends after the time
+// the driver works out from its ADC settings.  Built twice by the
+// CMake project in this directory (see CMakeLists.txt), once with
+// the end of a measurement signalled by the interrupt output
+// (PIN_INT_LIGHT) and once timed, and run by ctest; exits non-zero
+// if any check fails.
+
+#include <mbed.h>
+#include <eh_config.h> // For PIN_INT_LIGHT
+#include <eh_i2c.h>
+#include <act_light.h>
+#include <act_si1133.h>
+#include <i2c_mock.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The registers of the Si1133 that the mock acts on.
+ */
+#define REG_COMMAND     0x0b
+#define REG_IRQ_ENABLE  0x0f
+#define REG_RESPONSE0   0x11
+#define REG_IRQ_STATUS  0x12
+#define REG_HOSTOUT0    0x13
+
+/** The commands the mock acts on.
+ */
+#define CMD_RESET       0x01
+#define CMD_FORCE_CH    0x11
+
+/** RESPONSE0 with the chip asleep and a zero command counter.
+ */
+#define RSP0_SLEEP      0x20
+
+/** The number of channels measured.
+ */
+#define NUM_CHANNELS    4
+
+/** How much slower than the driver expects the mock measures, as
+ * a percentage.
+ */
+#define SLOW_PERCENT    300
+
+/** How often the interrupt output of the mock is checked.
+ */
+#define TICK_US         500
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The state of the mock Si1133.
+ */
+typedef struct {
+    char *pRegisters;
+    int counter;              //!< The command counter in RESPONSE0.
+    long long int forceUs;    //!< When CMD_FORCE_CH was sent, -1 if never.
+    int channelUs;            //!< How long each channel takes.
+    int numChannelsDone;      //!< How many channels have been measured.
+    char irqStatus;           //!< The bits of IRQ_STATUS not yet cleared.
+    bool intLow;              //!< The state of the interrupt output.
+    long long int lastDoneUs; //!< When the last channel was measured.
+} MockSi1133;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The mock Si1133 and a lock for it: it is driven both by the
+ * operations on the bus and by a ticker.
+ */
+static MockSi1133 gMock;
+static std::mutex gMockMutex;
+
+/** The channel values the mock measures.
+ */
+static const int gChannel[NUM_CHANNELS] = {0x000123, 0x004567, 0x0089ab, 0x000cde};
+
+/** The number of measurement completion callbacks.
+ */
+static volatile int gCallbackCount = 0;
+
+/** When the last measurement completion callback was made.
+ */
+static volatile long long int gCallbackUs = 0;
+
+/** The number of checks that failed.
+ */
+static int gNumFailures = 0;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Record the outcome of a check.
+static void check(bool ok, const char *pWhat)
+{
+    if (!ok) {
+        printf("    FAILED: %s.\n", pWhat);
+        gNumFailures++;
+    }
+}
+
+// Measure the channels that are due, with gMockMutex locked,
+// returning true if the interrupt output has just gone low.
+static bool mockUpdate()
+{
+    long long int nowUs = hostClockUs();
+    bool fall = false;
+
+    while ((gMock.forceUs >= 0) && (gMock.numChannelsDone < NUM_CHANNELS) &&
+           (nowUs >= gMock.forceUs + ((long long int) gMock.numChannelsDone + 1) * gMock.channelUs)) {
+        gMock.irqStatus |= 1 << gMock.numChannelsDone;
+        gMock.numChannelsDone++;
+        gMock.lastDoneUs = nowUs;
+    }
+
+    if (gMock.irqStatus & gMock.pRegisters[REG_IRQ_ENABLE]) {
+        fall = !gMock.intLow;
+        gMock.intLow = true;
+    } else {
+        gMock.intLow = false;
+    }
+
+    return fall;
+}
+
+// Act on an operation on the bus and update the registers
+// that the next operation will see.
+static void mockHook(void *pParam)
+{
+    const I2CMockRecord *pRecords;
+    const I2CMockRecord *pLast;
+    int numRecords;
+    char command;
+    int channel;
+    bool fall;
+
+    (void) pParam;
+    gMockMutex.lock();
+    numRecords = i2cMockGetRecords(&pRecords);
+    pLast = &(pRecords[numRecords - 1]);
+    if (pLast->isRead) {
+        // Only the results are read 13 bytes at a time: reading
+        // IRQ_STATUS clears what was read
+        if (pLast->numBytes == 13) {
+            gMock.irqStatus &= ~gMock.pRegisters[REG_IRQ_STATUS];
+        }
+    } else if (pLast->numBytes == 3) {
+        // Setting a parameter: HOSTIN0 then the parameter
+        // command in COMMAND
+        gMock.pRegisters[REG_COMMAND] = 0;
+        gMock.counter++;
+    } else if ((pLast->numBytes == 2) && (gMock.pRegisters[REG_COMMAND] != 0)) {
+        command = gMock.pRegisters[REG_COMMAND];
+        gMock.pRegisters[REG_COMMAND] = 0;
+        if (command == CMD_RESET) {
+            gMock.counter = 0;
+        } else {
+            gMock.counter++;
+            if (command == CMD_FORCE_CH) {
+                gMock.forceUs = hostClockUs();
+                gMock.numChannelsDone = 0;
+                gMock.irqStatus = 0;
+            }
+        }
+    }
+    fall = mockUpdate();
+
+    gMock.pRegisters[REG_RESPONSE0] = RSP0_SLEEP | (gMock.counter & 0x1f);
+    gMock.pRegisters[REG_IRQ_STATUS] = gMock.irqStatus;
+    for (channel = 0; channel < gMock.numChannelsDone; channel++) {
+        gMock.pRegisters[REG_HOSTOUT0 + channel * 3] = (char) (gChannel[channel] >> 16);
+        gMock.pRegisters[REG_HOSTOUT0 + channel * 3 + 1] = (char) (gChannel[channel] >> 8);
+        gMock.pRegisters[REG_HOSTOUT0 + channel * 3 + 2] = (char) gChannel[channel];
+    }
+    gMockMutex.unlock();
+
+#ifdef PIN_INT_LIGHT
+    if (fall) {
+        hostInterruptInFall(PIN_INT_LIGHT);
+    }
+#else
+    (void) fall;
+#endif
+}
+
+// Measure the channels that fall due between operations on the
+// bus, as the interrupt output would.
+static void mockTick()
+{
+    bool fall;
+
+    gMockMutex.lock();
+    fall = mockUpdate();
+    gMockMutex.unlock();
+
+#ifdef PIN_INT_LIGHT
+    if (fall) {
+        hostInterruptInFall(PIN_INT_LIGHT);
+    }
+#else
+    (void) fall;
+#endif
+}
+
+// Callback for the end of a measurement.
+static void groupCallback(void *pParam)
+{
+    (void) pParam;
+    gCallbackUs = hostClockUs();
+    gCallbackCount++;
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main()
+{
+    Ticker ticker;
+    Si1133Group group;
+    Timer timer;
+    int lux = -1;
+    int uvIndexX1000 = -1;
+    ActionDriver result;
+
+#ifdef PIN_INT_LIGHT
+    printf("Si1133 group, end signalled by the interrupt output:\n");
+#else
+    printf("Si1133 group, end timed:\n");
+#endif
+    i2cMockReset();
+    memset(&gMock, 0, sizeof(gMock));
+    gMock.pRegisters = pI2cMockAddDevice(SI1133_DEFAULT_ADDRESS);
+    gMock.pRegisters[REG_RESPONSE0] = RSP0_SLEEP;
+    gMock.forceUs = -1;
+    i2cMockSetHook(mockHook, NULL);
+    i2cInit(PIN_I2C_SDA, PIN_I2C_SCL);
+
+    check(si1133Init(SI1133_DEFAULT_ADDRESS) == ACTION_DRIVER_OK, "not initialised");
+    gMock.channelUs = si1133GetConversionTimeUs() * SLOW_PERCENT / 100 / NUM_CHANNELS;
+    printf("  a measurement should take %d us, the mock takes %d us.\n",
+           si1133GetConversionTimeUs(), gMock.channelUs * NUM_CHANNELS);
+    check(si1133ReadGroup(&group) == ACTION_DRIVER_ERROR_NO_DATA, "there was data before a measurement");
+    ticker.attach_us(callback(mockTick), TICK_US);
+
+    printf("  start, callback, read:\n");
+    gCallbackCount = 0;
+    timer.start();
+    check(si1133StartGroup(groupCallback, NULL) == ACTION_DRIVER_OK, "measurement not started");
+    while ((gCallbackCount == 0) && (timer.read_ms() < SI1133_WAIT_FOR_READING_MS)) {
+        wait_ms(1);
+    }
+    printf("    callback after %d ms.\n", timer.read_ms());
+    check(gCallbackCount == 1, "there was no callback");
+    // Read until all of the channels are there, as
+    // getLight() does, clearing IRQ_STATUS each time
+    while (((result = si1133ReadGroup(&group)) == ACTION_DRIVER_ERROR_NO_DATA) &&
+           (timer.read_ms() < SI1133_WAIT_FOR_READING_MS)) {
+        wait_ms(SI1133_READING_CHECK_INTERVAL_MS);
+    }
+    printf("    result %d after %d ms, UV %d, visible %d/%d, IR %d.\n", result,
+           timer.read_ms(), group.uv, group.visibleHigh, group.visibleLow, group.ir);
+    check(result == ACTION_DRIVER_OK, "the measurement was not read");
+#ifdef PIN_INT_LIGHT
+    check(gCallbackUs >= gMock.lastDoneUs, "the callback came before the last channel was measured");
+#endif
+    check((group.uv == gChannel[0]) && (group.visibleHigh == gChannel[1]) &&
+          (group.ir == gChannel[2]) && (group.visibleLow == gChannel[3]),
+          "the channels were wrong");
+    check(si1133ReadGroup(NULL) == ACTION_DRIVER_ERROR_NO_DATA, "reading the results did not clear them");
+
+    printf("  getLight():\n");
+    timer.reset();
+    result = getLight(&lux, &uvIndexX1000);
+    printf("    result %d after %d ms, lux %d, UV index x 1000 %d.\n", result,
+           timer.read_ms(), lux, uvIndexX1000);
+    check(result == ACTION_DRIVER_OK, "there was no reading");
+    check(timer.read_ms() < SI1133_WAIT_FOR_READING_MS, "the reading took until the time-out");
+    check((lux >= 0) && (uvIndexX1000 >= 0), "the reading was wrong");
+
+    ticker.detach();
+    si1133Deinit();
+    i2cDeinit();
+
+    printf("%d failure(s).\n", gNumFailures);
+
+    return (gNumFailures == 0) ? 0 : 1;
+}
+
+// End of file
@@ -0,0 +1,206 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of the eh_ubx parser.  Built by the CMake project in
+// this directory (see CMakeLists.txt).
+//
+// Run with no arguments to parse a synthesised session or pass the
+// name of a file containing raw bytes as read from the REGSTREAM
+// register of a ZOE-M8 over I2C (0xFF filler and all).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+#include <eh_ubx.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The number of navigation epochs in a synthesised session.
+ */
+#define NUM_EPOCHS 3600
+
+/** The most bytes to read from the GNSS chip in one go, as the driver
+ * would over I2C.
+ */
+#define MAX_READ_SIZE 64
+
+/** The number of times to parse the stream.
+ */
+#define NUM_PASSES 100
+
+/** The RAM used on the receive side by the code this replaced: a
+ * 256 byte message buffer plus a 256 byte receive pipe.
+ */
+#define PREVIOUS_RX_RAM_BYTES 512
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Read a time-stamp: CPU cycles where available, else nanoseconds.
+static unsigned long long int stamp()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long int) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Append a UBX frame with the given payload to pBuf, returning its size.
+static int appendFrame(unsigned char *pBuf, unsigned char cls, unsigned char id,
+                       const unsigned char *pPayload, int length)
+{
+    unsigned char checksumA = 0;
+    unsigned char checksumB = 0;
+
+    pBuf[0] = 0xb5;
+    pBuf[1] = 0x62;
+    pBuf[2] = cls;
+    pBuf[3] = id;
+    pBuf[4] = (unsigned char) length;
+    pBuf[5] = (unsigned char) (length >> 8);
+    memcpy(pBuf + UBX_HEADER_SIZE, pPayload, length);
+    for (int x = 2; x < length + UBX_HEADER_SIZE; x++) {
+        checksumA += pBuf[x];
+        checksumB += checksumA;
+    }
+    pBuf[length + UBX_HEADER_SIZE] = checksumA;
+    pBuf[length + UBX_HEADER_SIZE + 1] = checksumB;
+
+    return length + UBX_OVERHEAD_SIZE;
+}
+
+// Synthesise what the driver would read from a ZOE-M8 over a
+// session: a NAV-PVT every epoch (no fix for the first minute),
+// a NAV-TIMEUTC every tenth, some 0xFF filler from reads made while
+// there was nothing to send and the odd corrupted byte.
+static int synthesise(unsigned char *pBuf, int size)
+{
+    unsigned char payload[UBX_NAV_PVT_LENGTH];
+    int length = 0;
+
+    srand(1);
+    for (int x = 0; (x < NUM_EPOCHS) &&
+                    (length + 256 < size); x++) {
+        memset(payload, 0, sizeof(payload));
+        payload[21] = (x >= 60) ? 0x01 : 0x00;
+        payload[23] = (unsigned char) (x % 12);
+        payload[28] = (unsigned char) x;
+        length += appendFrame(pBuf + length, 0x01, 0x07, payload, UBX_NAV_PVT_LENGTH);
+        if (x % 10 == 0) {
+            memset(payload, 0, UBX_NAV_TIMEUTC_LENGTH);
+            payload[19] = 0x07;
+            length += appendFrame(pBuf + length, 0x01, 0x21, payload, UBX_NAV_TIMEUTC_LENGTH);
+        }
+        if (rand() % 50 == 0) {
+            pBuf[length - 1 - (rand() % 20)] ^= 0x55;
+        }
+        for (int y = rand() % 16; y > 0; y--) {
+            pBuf[length] = 0xff;
+            length++;
+        }
+    }
+
+    return length;
+}
+
+/**************************************************************************
+ * MAIN
+ *************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static unsigned char stream[NUM_EPOCHS * 160];
+    static UbxParser parser;
+    UbxFrame frame;
+    FILE *pFile;
+    int length;
+    int offset;
+    unsigned int space;
+    unsigned int chunk;
+    char *pSpace;
+    unsigned int numFrames = 0;
+    unsigned int numFixes = 0;
+    unsigned long long int start;
+    unsigned long long int duration;
+
+    if (argc > 1) {
+        pFile = fopen(argv[1], "rb");
+        if (pFile == NULL) {
+            printf("Unable to open \"%s\".\n", argv[1]);
+            return 1;
+        }
+        length = (int) fread(stream, 1, sizeof(stream), pFile);
+        fclose(pFile);
+        printf("Read %d byte(s) from \"%s\".\n", length, argv[1]);
+    } else {
+        length = synthesise(stream, sizeof(stream));
+        printf("Synthesised %d byte(s) over %d epoch(s).\n", length, NUM_EPOCHS);
+    }
+
+    start = stamp();
+    for (int pass = 0; pass < NUM_PASSES; pass++) {
+        ubxParserInit(&parser);
+        offset = 0;
+        while (offset < length) {
+            // Read straight into the ring, as the driver does
+            pSpace = ubxParserSpace(&parser, &space);
+            chunk = length - offset;
+            if (chunk > space) {
+                chunk = space;
+            }
+            if (chunk > MAX_READ_SIZE) {
+                chunk = MAX_READ_SIZE;
+            }
+            memcpy(pSpace, stream + offset, chunk);
+            ubxParserCommit(&parser, chunk);
+            offset += chunk;
+            while (ubxParserNext(&parser, &frame)) {
+                numFrames++;
+                if (ubxIsNavPvt(&frame) && ubxNavPvtFixOk(&frame)) {
+                    numFixes++;
+                }
+            }
+        }
+    }
+    duration = stamp() - start;
+
+    printf("%u frame(s) (%u with a fix), %u bad, %u byte(s) discarded per pass.\n",
+           numFrames / NUM_PASSES, numFixes / NUM_PASSES,
+           parser.numBadFrames, parser.numDiscards);
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%.3f byte(s) per cycle.\n",
+           ((double) length) * NUM_PASSES / duration);
+#else
+    printf("%.3f byte(s) per nanosecond.\n",
+           ((double) length) * NUM_PASSES / duration);
+#endif
+    printf("Receive RAM: %d byte(s) (parser) versus %d byte(s) previously.\n",
+           (int) sizeof(parser), PREVIOUS_RX_RAM_BYTES);
+
+    return 0;
+}
+
+// End of file
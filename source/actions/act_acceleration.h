@@ -35,6 +35,26 @@
  */
 ActionDriver getAcceleration(int *pXGX100, int *pYGX1000, int *pZGX1000);
 
+/** Get the stream of acceleration samples that the device has
+ * buffered up since this was last called, oldest first, in
+ * a single read.  If the device is not buffering samples then
+ * a single sample is returned.
+ *
+ * @param pXGX1000     a place to put the X-axis samples, measured
+ *                     in milli-g; must have room for maxSamples.
+ * @param pYGX1000     a place to put the Y-axis samples, measured
+ *                     in milli-g; must have room for maxSamples.
+ * @param pZGX1000     a place to put the Z-axis samples, measured
+ *                     in milli-g; must have room for maxSamples.
+ * @param maxSamples   the maximum number of samples to return.
+ * @param pNumSamples  a place to put the number of samples returned,
+ *                     may be NULL.
+ * @return             zero on success or negative error code on failure.
+ */
+ActionDriver getAccelerationStream(short *pXGX1000, short *pYGX1000,
+                                   short *pZGX1000, unsigned int maxSamples,
+                                   unsigned int *pNumSamples);
+
 /** Get whether there has been an interrupt from the accelerometer.
  *
  * @return  true if there was an interrupt, else false.
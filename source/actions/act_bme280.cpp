@@ -7,7 +7,7 @@
 
 #include <mbed.h>
 #include <eh_debug.h>
-#include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK()
+#include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK() and ARRAY_SIZE()
 #include <eh_i2c.h>
 #include <act_temperature_humidity_pressure.h>
 #include <act_bme280.h>
@@ -78,51 +78,193 @@ static ActionDriver setForcedMode()
     return result;
 }
 
-// Get the temperature from the BME280.
+// Wait for a measurement to complete after being forced.
 // Note: this does not lock the mutex or check for initialisation.
-static ActionDriver _getTemperature(int *pTemperature)
+static ActionDriver waitMeasurement()
 {
-    ActionDriver result = setForcedMode();
-    unsigned int temperatureRaw;
-    int temperatureLocal;
+    ActionDriver result = ACTION_DRIVER_ERROR_TIMEOUT;
     bool measured = false;
     Timer timer;
-    char data[4];
+    char data[2];
 
-    if (result == ACTION_DRIVER_OK) {
-        result = ACTION_DRIVER_ERROR_TIMEOUT;
-        // Wait for a measurement to emerge after being forced
-        data[0] = 0xf3; // Status register
-        timer.start();
-        while (!measured && (timer.read_ms() < BME280_MEASUREMENT_WAIT_MS)) {
-            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
-                // Check for bit 3 (measuring) and bit 0 (NVM update) being low
-                measured = ((data[1] & 0x09) == 0);
-                Thread::wait(10);  // Relax a bit
-            }
+    data[0] = 0xf3; // Status register
+    timer.start();
+    while (!measured && (timer.read_ms() < BME280_MEASUREMENT_WAIT_MS)) {
+        if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
+            // Check for bit 3 (measuring) and bit 0 (NVM update) being low
+            measured = ((data[1] & 0x09) == 0);
+            Thread::wait(10);  // Relax a bit
         }
-        timer.stop();
+    }
+    timer.stop();
 
-        if (measured) {
-            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-            data[0] = 0xfa; // temp_msb (3 bytes)
-            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 3) == 3) {
+    if (measured) {
+        result = ACTION_DRIVER_OK;
+    }
 
-                temperatureRaw = (data[1] << 12) | (data[2] << 4) | (data[3] >> 4);
+    return result;
+}
 
-                temperatureLocal =
-                (((((temperatureRaw >> 3) - (gDigT1 << 1))) * gDigT2) >> 11) +
-                ((((((temperatureRaw >> 4) - gDigT1) * ((temperatureRaw >> 4) - gDigT1)) >> 12) * gDigT3) >> 14);
+// Read the calibration registers: dig_T (6 bytes from 0x88), dig_P
+// (18 bytes from 0x8E, which follow on, so the two are read in one
+// go), dig_H1 (0xA1) and the rest of dig_H (7 bytes from 0xE1).
+// Note: this does not lock the mutex or check for initialisation.
+static ActionDriver readCalibration()
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+    I2CTransaction transactions[4];
+    const char registers[] = {0x88, (char) 0x8E, (char) 0xA1, (char) 0xE1};
+    const int sizes[] = {6, 18, 1, 7};
+    char digT[6];
+    char digP[18];
+    char digH[8];
+    char *pReceive[] = {digT, digP, digH, &(digH[1])};
+    bool success = true;
+
+    memset(transactions, 0, sizeof(transactions));
+    for (unsigned int x = 0; x < ARRAY_SIZE(transactions); x++) {
+        transactions[x].i2cAddress = gI2cAddress;
+        transactions[x].pSend = &(registers[x]);
+        transactions[x].bytesToSend = 1;
+        transactions[x].pReceive = pReceive[x];
+        transactions[x].bytesToReceive = sizes[x];
+        transactions[x].flags = I2C_FLAG_REGISTER_AUTO_INCREMENT;
+    }
 
-                gTFine = temperatureLocal;
+    if (i2cSendReceiveMany(transactions, ARRAY_SIZE(transactions)) == I2C_RESULT_OK) {
+        for (unsigned int x = 0; x < ARRAY_SIZE(transactions); x++) {
+            success = success && (transactions[x].result == sizes[x]);
+        }
+        if (success) {
+            gDigT1 = (digT[1] << 8) | digT[0];
+            gDigT2 = (digT[3] << 8) | digT[2];
+            gDigT3 = (digT[5] << 8) | digT[4];
+            gDigP1 = (digP[ 1] << 8) | digP[ 0];
+            gDigP2 = (digP[ 3] << 8) | digP[ 2];
+            gDigP3 = (digP[ 5] << 8) | digP[ 4];
+            gDigP4 = (digP[ 7] << 8) | digP[ 6];
+            gDigP5 = (digP[ 9] << 8) | digP[ 8];
+            gDigP6 = (digP[11] << 8) | digP[10];
+            gDigP7 = (digP[13] << 8) | digP[12];
+            gDigP8 = (digP[15] << 8) | digP[14];
+            gDigP9 = (digP[17] << 8) | digP[16];
+            gDigH1 = digH[0];
+            gDigH2 = (digH[2] << 8) | digH[1];
+            gDigH3 = digH[3];
+            gDigH4 = (digH[4] << 4) | (digH[5] & 0x0f);
+            gDigH5 = (digH[6] << 4) | ((digH[5] >> 4) & 0x0f);
+            gDigH6 = digH[7];
+            result = ACTION_DRIVER_OK;
+        }
+    }
 
-                temperatureLocal = (temperatureLocal * 5 + 128) >> 8;
+    return result;
+}
 
-                if (pTemperature != NULL) {
-                    *pTemperature = temperatureLocal;
-                }
+// Compensate a raw temperature reading, updating gTFine,
+// and return the temperature in 100ths of a degree C.
+static int compensateTemperature(unsigned int temperatureRaw)
+{
+    int temperatureLocal;
+
+    temperatureLocal =
+    (((((temperatureRaw >> 3) - (gDigT1 << 1))) * gDigT2) >> 11) +
+    ((((((temperatureRaw >> 4) - gDigT1) * ((temperatureRaw >> 4) - gDigT1)) >> 12) * gDigT3) >> 14);
+
+    gTFine = temperatureLocal;
+
+    return (temperatureLocal * 5 + 128) >> 8;
+}
+
+// Compensate a raw humidity reading, using gTFine,
+// and return the humidity as a percentage.
+static unsigned char compensateHumidity(unsigned int humidityRaw)
+{
+    int vX1;
+
+    vX1 = gTFine - 76800;
+    vX1 =  (((((humidityRaw << 14) - (((int) gDigH4) << 20) - (((int) gDigH5) * vX1)) +
+               ((int) 16384)) >> 15) * (((((((vX1 * (int) gDigH6) >> 10) *
+                                            (((vX1 * ((int) gDigH3)) >> 11) + 32768)) >> 10) + 2097152) *
+                                            (int) gDigH2 + 8192) >> 14));
+    vX1 = (vX1 - (((((vX1 >> 15) * (vX1 >> 15)) >> 7) * (int) gDigH1) >> 4));
+    vX1 = (vX1 < 0 ? 0 : vX1);
+    vX1 = (vX1 > 419430400 ? 419430400 : vX1);
 
+    return (unsigned char) ((vX1 >> 12) / 1024);
+}
+
+// Compensate a raw pressure reading, using gTFine, and
+// return the pressure in 100ths of a Pascal.
+static ActionDriver compensatePressure(unsigned int pressureRaw,
+                                       unsigned int *pPascalX100)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_CALCULATION;
+    int var1;
+    int var2;
+    unsigned int pressure;
+
+    var1 = (gTFine >> 1) - 64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * gDigP6;
+    var2 = var2 + ((var1 * gDigP5) << 1);
+    var2 = (var2 >> 2) + (gDigP4 << 16);
+    var1 = (((gDigP3 * (((var1 >> 2)*(var1 >> 2)) >> 13)) >> 3) + ((gDigP2 * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * gDigP1) >> 15;
+
+    if (var1 != 0) {
+
+        pressure = (((1048576 - pressureRaw) - (var2 >> 12))) * 3125;
+        if (pressure < 0x80000000) {
+            pressure = (pressure << 1) / var1;
+        } else {
+            pressure = (pressure / var1) * 2;
+        }
+
+        var1 = ((int) gDigP9 * ((int) (((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
+        var2 = (((int) (pressure >> 2)) * (int) gDigP8) >> 13;
+        pressure = (pressure + ((var1 + var2 + gDigP7) >> 4));
+
+        if (pPascalX100 != NULL) {
+            *pPascalX100 = (unsigned int) pressure;
+        }
+
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Perform a single forced conversion and read all of the
+// results in one burst from press_msb (0xf7) to hum_lsb (0xfe).
+// Any of the pointers may be NULL.
+// Note: this does not lock the mutex or check for initialisation.
+static ActionDriver _getTemperatureHumidityPressure(signed int *pCX100,
+                                                    unsigned char *pPercentage,
+                                                    unsigned int *pPascalX100)
+{
+    ActionDriver result = setForcedMode();
+    int temperature;
+    char data[9];
+
+    if (result == ACTION_DRIVER_OK) {
+        result = waitMeasurement();
+        if (result == ACTION_DRIVER_OK) {
+            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+            data[0] = 0xf7; // press_msb (8 bytes: pressure, temperature, humidity)
+            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 8) == 8) {
+                // Temperature always first as it sets gTFine
+                temperature = compensateTemperature((data[4] << 12) | (data[5] << 4) | (data[6] >> 4));
+                if (pCX100 != NULL) {
+                    *pCX100 = (signed int) temperature;
+                }
+                if (pPercentage != NULL) {
+                    *pPercentage = compensateHumidity((data[7] << 8) | data[8]);
+                }
                 result = ACTION_DRIVER_OK;
+                if (pPascalX100 != NULL) {
+                    result = compensatePressure((data[1] << 12) | (data[2] << 4) | (data[3] >> 4),
+                                                pPascalX100);
+                }
             }
         }
     }
@@ -138,7 +280,7 @@ static ActionDriver _getTemperature(int *pTemperature)
 ActionDriver bme280Init(char i2cAddress)
 {
     ActionDriver result;
-    char data[18];
+    char data[2];
 
     MTX_LOCK(gMtx);
 
@@ -170,51 +312,8 @@ ActionDriver bme280Init(char i2cAddress)
                     result = ACTION_DRIVER_ERROR_I2C_WRITE;
                 }
 
-                data[0] = 0x88; // read dig_T regs (6 bytes)
-                if (result == ACTION_DRIVER_OK) {
-                    if (i2cSendReceive(gI2cAddress, data, 1, data, 6) == 6) {
-                        gDigT1 = (data[1] << 8) | data[0];
-                        gDigT2 = (data[3] << 8) | data[2];
-                        gDigT3 = (data[5] << 8) | data[4];
-                    } else {
-                        result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-                    }
-                }
-
-                data[0] = 0x8E; // read dig_P regs (18 bytes)
                 if (result == ACTION_DRIVER_OK) {
-                    if (i2cSendReceive(gI2cAddress, data, 1, data, 18) == 18) {
-                        gDigP1 = (data[ 1] << 8) | data[ 0];
-                        gDigP2 = (data[ 3] << 8) | data[ 2];
-                        gDigP3 = (data[ 5] << 8) | data[ 4];
-                        gDigP4 = (data[ 7] << 8) | data[ 6];
-                        gDigP5 = (data[ 9] << 8) | data[ 8];
-                        gDigP6 = (data[11] << 8) | data[10];
-                        gDigP7 = (data[13] << 8) | data[12];
-                        gDigP8 = (data[15] << 8) | data[14];
-                        gDigP9 = (data[17] << 8) | data[16];
-                    } else {
-                        result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-                    }
-                }
-
-                data[0] = 0xA1; // read dig_H regs (1 byte)
-                if (result == ACTION_DRIVER_OK) {
-                    if (i2cSendReceive(gI2cAddress, data, 1, data, 1) == 1) {
-                        data[1] = 0xE1; // read dig_H regs to follow this in data[] (another 7 bytes)
-                        if (i2cSendReceive(gI2cAddress, &(data[1]), 1, &(data[1]), 7) == 7) {
-                            gDigH1 = data[0];
-                            gDigH2 = (data[2] << 8) | data[1];
-                            gDigH3 = data[3];
-                            gDigH4 = (data[4] << 4) | (data[5] & 0x0f);
-                            gDigH5 = (data[6] << 4) | ((data[5] >> 4) & 0x0f);
-                            gDigH6 = data[7];
-                        } else {
-                            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-                        }
-                    } else {
-                        result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-                    }
+                    result = readCalibration();
                 }
 
                 data[0] = 0xf4; // ctrl_meas
@@ -244,132 +343,45 @@ void bme280Deinit()
 // Get the temperature from the BME280.
 ActionDriver getTemperature(signed int *pCX100)
 {
-    ActionDriver result;
-    int temperature;
-
-    MTX_LOCK(gMtx);
-
-    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
-
-    if (gInitialised) {
-        result = _getTemperature(&temperature);
-
-        if ((result == ACTION_DRIVER_OK) && (pCX100 != NULL)) {
-            // temperature is in 100ths of a degree
-            *pCX100 = (signed int) temperature;
-        }
-    }
-
-    MTX_UNLOCK(gMtx);
-
-    return result;
+    return getTemperatureHumidityPressure(pCX100, NULL, NULL);
 }
 
 // Get the humidity from the BME280.
 ActionDriver getHumidity(unsigned char *pPercentage)
 {
-    ActionDriver result;
-    unsigned int humidityRaw;
-    int vX1;
-    char data[3];
-
-    MTX_LOCK(gMtx);
-
-    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
-
-    if (gInitialised) {
-        // Need to have a recent temperature reading if gTFine is
-        // to be up to date
-        result = _getTemperature(NULL);
-        if (result == ACTION_DRIVER_OK) {
-            data[0] = 0xfd; // hum_msb (2 bytes)
-            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 2) == 2) {
-                humidityRaw = (data[1] << 8) | data[2];
-
-                vX1 = gTFine - 76800;
-                vX1 =  (((((humidityRaw << 14) - (((int) gDigH4) << 20) - (((int) gDigH5) * vX1)) +
-                           ((int) 16384)) >> 15) * (((((((vX1 * (int) gDigH6) >> 10) *
-                                                        (((vX1 * ((int) gDigH3)) >> 11) + 32768)) >> 10) + 2097152) *
-                                                        (int) gDigH2 + 8192) >> 14));
-                vX1 = (vX1 - (((((vX1 >> 15) * (vX1 >> 15)) >> 7) * (int) gDigH1) >> 4));
-                vX1 = (vX1 < 0 ? 0 : vX1);
-                vX1 = (vX1 > 419430400 ? 419430400 : vX1);
-
-                if (pPercentage != NULL) {
-                    *pPercentage = (unsigned char) ((vX1 >> 12) / 1024);
-                }
-
-                result = ACTION_DRIVER_OK;
-
-            } else {
-                result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-            }
-        }
-    }
+    unsigned char percentage;
 
-    MTX_UNLOCK(gMtx);
-
-    return result;
+    // Always ask for the result as otherwise this
+    // would only be a temperature measurement
+    return getTemperatureHumidityPressure(NULL,
+                                          (pPercentage != NULL) ? pPercentage : &percentage,
+                                          NULL);
 }
 
 // Get the pressure from the BME280.
 ActionDriver getPressure(unsigned int *pPascalX100)
+{
+    unsigned int pascalX100;
+
+    // Always ask for the result as otherwise this
+    // would only be a temperature measurement
+    return getTemperatureHumidityPressure(NULL, NULL,
+                                          (pPascalX100 != NULL) ? pPascalX100 : &pascalX100);
+}
+
+// Get temperature, humidity and pressure from the BME280.
+ActionDriver getTemperatureHumidityPressure(signed int *pCX100,
+                                            unsigned char *pPercentage,
+                                            unsigned int *pPascalX100)
 {
     ActionDriver result;
-    unsigned int pressureRaw;
-    int var1;
-    int var2;
-    unsigned int pressure;
-    char data[4];
 
     MTX_LOCK(gMtx);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
 
     if (gInitialised) {
-        // Need to have a recent temperature reading if gTFine is
-        // to be up to date
-        result = _getTemperature(NULL);
-        if (result == ACTION_DRIVER_OK) {
-            data[0] = 0xf7; // press_msb (3 bytes)
-            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 3) == 3) {
-
-                pressureRaw = (data[1] << 12) | (data[2] << 4) | (data[3] >> 4);
-
-                var1 = (gTFine >> 1) - 64000;
-                var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * gDigP6;
-                var2 = var2 + ((var1 * gDigP5) << 1);
-                var2 = (var2 >> 2) + (gDigP4 << 16);
-                var1 = (((gDigP3 * (((var1 >> 2)*(var1 >> 2)) >> 13)) >> 3) + ((gDigP2 * var1) >> 1)) >> 18;
-                var1 = ((32768 + var1) * gDigP1) >> 15;
-
-                if (var1 != 0) {
-
-                    pressure = (((1048576 - pressureRaw) - (var2 >> 12))) * 3125;
-                    if (pressure < 0x80000000) {
-                        pressure = (pressure << 1) / var1;
-                    } else {
-                        pressure = (pressure / var1) * 2;
-                    }
-
-                    var1 = ((int) gDigP9 * ((int) (((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
-                    var2 = (((int) (pressure >> 2)) * (int) gDigP8) >> 13;
-                    pressure = (pressure + ((var1 + var2 + gDigP7) >> 4));
-
-                    if (pPascalX100 != NULL) {
-                        // temperature is hecto-Pascals
-                        *pPascalX100 = (unsigned int) pressure;
-                    }
-
-                    result = ACTION_DRIVER_OK;
-
-                } else {
-                    result = ACTION_DRIVER_ERROR_CALCULATION;
-                }
-            }
-        } else {
-            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-        }
+        result = _getTemperatureHumidityPressure(pCX100, pPercentage, pPascalX100);
     }
 
     MTX_UNLOCK(gMtx);
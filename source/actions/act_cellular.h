@@ -51,7 +51,12 @@
  *                          + RRC Wait time @ 98mA (assumed 6 seconds)
  *                          + RRC Release 185 uWh
  */
-#define CELLULAR_R410_ENERGY_TX_NWH(x) (((unsigned long long int) x) * 25UL + 17500UL + 588000UL + 185000UL)
+#define CELLULAR_R410_ENERGY_TX_NWH(x) (((unsigned long long int) x) * CELLULAR_R410_ENERGY_TX_PER_BYTE_NWH + 17500UL + 588000UL + 185000UL)
+
+/** The incremental energy required, in nWh, for the R410 modem to
+ * transmit one byte (from Phil's calculator above).
+ */
+#define CELLULAR_R410_ENERGY_TX_PER_BYTE_NWH 25UL
 
 /** The energy required, in nWh, for the N2xx modem to transmit x bytes.
  *
@@ -61,7 +66,43 @@
  * Send X Bytes = 0.05894 * X + 11.54 uWh
  *                + RRC wait time @ 48mA (assumed 6 seconds)
  */
-#define CELLULAR_N2XX_ENERGY_TX_NWH(x) (34000UL + ((unsigned long long int) x) * 59UL + 11540UL + 288000UL)
+#define CELLULAR_N2XX_ENERGY_TX_NWH(x) (34000UL + ((unsigned long long int) x) * CELLULAR_N2XX_ENERGY_TX_PER_BYTE_NWH + 11540UL + 288000UL)
+
+/** The incremental energy required, in nWh, for the N2xx modem to
+ * transmit one byte (from Phil's calculator above).
+ */
+#define CELLULAR_N2XX_ENERGY_TX_PER_BYTE_NWH 59UL
+
+/** The maximum transmit power of the modems in dBm (power class 3).
+ */
+#define CELLULAR_TX_POWER_MAX_DBM 23
+
+/** The percentage of the transmit energy at maximum transmit power
+ * that is down to the power amplifier (and so scales with transmit
+ * power); the rest is baseband/RF overhead which does not.
+ */
+#define CELLULAR_TX_POWER_AMPLIFIER_PERCENT 60
+
+/** The multiplier applied to the energy cost of transmission in
+ * coverage class 1, representing the number of repetitions required
+ * (typical network configurations use 4 to 8, err on the low side).
+ */
+#define CELLULAR_ECL1_TX_ENERGY_MULTIPLIER 4
+
+/** The multiplier applied to the energy cost of transmission in
+ * coverage class 2 (typically 16 to 32 repetitions).
+ */
+#define CELLULAR_ECL2_TX_ENERGY_MULTIPLIER 16
+
+/** For modems that do not report coverage class, the RSRP
+ * below which coverage class 1 is assumed.
+ */
+#define CELLULAR_ECL1_RSRP_THRESHOLD_DBM -110
+
+/** For modems that do not report coverage class, the RSRP
+ * below which coverage class 2 is assumed.
+ */
+#define CELLULAR_ECL2_RSRP_THRESHOLD_DBM -120
 
 /**************************************************************************
  * TYPES
@@ -53,6 +53,14 @@ static void (*gpEventCallback) (EventQueue *);
  */
 static unsigned char gSensitivity = 0;
 
+/** Flag to indicate that the FIFO is in stream mode.
+ */
+static bool gFifoEnabled = false;
+
+/** Buffer into which the FIFO is drained: six bytes per sample.
+ */
+static char gFifoBuffer[LIS3DH_FIFO_SIZE * 6];
+
 /** The interrupt threshold LSB value (in milli-g) for a given full-scale
  * value.
  */
@@ -405,6 +413,68 @@ ActionDriver getAcceleration(int *pXGX100, int *pYGX1000, int *pZGX1000)
     return result;
 }
 
+// Get the stream of acceleration values buffered in the FIFO.
+ActionDriver getAccelerationStream(short *pXGX1000, short *pYGX1000,
+                                   short *pZGX1000, unsigned int maxSamples,
+                                   unsigned int *pNumSamples)
+{
+    ActionDriver result;
+    unsigned int numSamples = 0;
+    char data[2];
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+        numSamples = 1;
+        data[0] = 0x2f; // FIFO_SRC_REG
+        if (!gFifoEnabled || (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1)) {
+            if (gFifoEnabled) {
+                // OVRN_FIFO (bit 6) means full, EMPTY (bit 5) means
+                // empty, otherwise FSS (bits 0 to 4) is the count
+                numSamples = data[1] & 0x1f;
+                if (data[1] & 0x40) {
+                    numSamples = LIS3DH_FIFO_SIZE;
+                } else if (data[1] & 0x20) {
+                    numSamples = 0;
+                }
+            }
+            if (numSamples > maxSamples) {
+                numSamples = maxSamples;
+            }
+            result = ACTION_DRIVER_OK;
+            if (numSamples > 0) {
+                result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+                // With the FIFO enabled the register address rolls over
+                // from OUT_Z_H back to OUT_X_L, so the whole lot can be
+                // read in one go
+                data[0] = 0x28 | 0x80; // Start of data registers but with MSB set
+                                       // in order to perform multi-byte read
+                if (i2cSendReceive(gI2cAddress, data, 1, gFifoBuffer,
+                                   numSamples * 6) == (int) numSamples * 6) {
+                    // Note that in low power mode the result is only 8 bits
+                    for (unsigned int x = 0; x < numSamples; x++) {
+                        *(pXGX1000 + x) = (short) readingToMG(gFifoBuffer[(x * 6) + 1]);
+                        *(pYGX1000 + x) = (short) readingToMG(gFifoBuffer[(x * 6) + 3]);
+                        *(pZGX1000 + x) = (short) readingToMG(gFifoBuffer[(x * 6) + 5]);
+                    }
+                    result = ACTION_DRIVER_OK;
+                }
+            }
+        }
+    }
+
+    if ((result == ACTION_DRIVER_OK) && (pNumSamples != NULL)) {
+        *pNumSamples = numSamples;
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
 // Get whether there has been an interrupt from the accelerometer.
 bool getAccelerationInterruptFlag()
 {
@@ -482,6 +552,7 @@ void lis3dhDeinit()
         data[0] = 0x20; // CTRL_REG1
         data[1] = 0x07; // power down mode
         i2cSendReceive(gI2cAddress, data, 2, NULL, 0);
+        gFifoEnabled = false;
         gInitialised = false;
     }
 
@@ -795,4 +866,51 @@ ActionDriver lis3dhClearInterrupt(unsigned char interrupt)
     return result;
 }
 
+// Enable or disable the FIFO in stream mode.
+ActionDriver lis3dhSetFifoEnable(bool enableNotDisable)
+{
+    ActionDriver result;
+    char data[2];
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = ACTION_DRIVER_ERROR_I2C_WRITE;
+        // Always go through bypass mode, which empties the FIFO
+        data[0] = 0x2e; // FIFO_CTRL_REG
+        data[1] = 0x00; // Bypass mode
+        if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+            data[0] = 0x24; // CTRL_REG5
+            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
+                // FIFO_EN is bit 6
+                data[1] &= ~0x40;
+                if (enableNotDisable) {
+                    data[1] |= 0x40;
+                }
+                result = ACTION_DRIVER_ERROR_I2C_WRITE;
+                if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+                    gFifoEnabled = false;
+                    result = ACTION_DRIVER_OK;
+                    if (enableNotDisable) {
+                        result = ACTION_DRIVER_ERROR_I2C_WRITE;
+                        data[0] = 0x2e; // FIFO_CTRL_REG
+                        data[1] = 0x80; // Stream mode
+                        if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+                            gFifoEnabled = true;
+                            result = ACTION_DRIVER_OK;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
 // End of file
@@ -43,6 +43,10 @@
  */
 #define LIS3DH_ENERGY_READING_NWH 0
 
+/** The number of samples the LIS3DH FIFO can hold.
+ */
+#define LIS3DH_FIFO_SIZE 32
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -179,6 +183,18 @@ ActionDriver lis3dhGetInterruptEnable(unsigned char interrupt,
  */
 ActionDriver lis3dhClearInterrupt(unsigned char interrupt);
 
+/** Enable or disable the FIFO in stream mode: when enabled the
+ * LIS3DH keeps the most recent LIS3DH_FIFO_SIZE samples (at the
+ * 1 Hz data rate set by lis3dhInit()) without any involvement of
+ * the processor, to be read with getAccelerationStream().
+ *
+ * @param enableNotDisable true to enable the FIFO, false to
+ *                         disable it.
+ * @return                 zero on success or negative error
+ *                         code on failure.
+ */
+ActionDriver lis3dhSetFifoEnable(bool enableNotDisable);
+
 #endif // _ACT_LIS3DH_H_
 
 // End Of File
@@ -17,6 +17,7 @@
 
 #include <mbed.h>
 #include <math.h> // for log10() and pow()
+#include <stddef.h> // for offsetof()
 #include <errno.h>
 #include <UbloxATCellularInterfaceN2xx.h>
 #include <UbloxATCellularInterface.h>
@@ -24,7 +25,9 @@
 #include <eh_debug.h>
 #include <eh_config.h>
 #include <eh_statistics.h>
+#include <eh_heap.h>
 #include <eh_codec.h>
+#include <eh_timeline.h>
 #include <act_cellular.h>
 #include <act_modem.h>
 
@@ -32,10 +35,57 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+/** Marker to show that the retained modem energy model is valid.
+ */
+#define MODEM_ENERGY_MODEL_MAGIC 0x4D454E31
+
+/** The number of coefficients in the modem energy model: a fixed
+ * cost per session, the additional cost of registering when
+ * the modem started from off and the cost per byte transmitted.
+ * The model is held in units of microWatt hours and kilobytes
+ * so that the numbers stay well within single-precision float.
+ */
+#define MODEM_ENERGY_MODEL_NUM_COEFFS 3
+
+/** The forgetting factor for the recursive least squares fit
+ * of the modem energy model: the closer to 1 the longer the
+ * memory (0.98 is an effective window of around 50 sessions).
+ */
+#define MODEM_ENERGY_MODEL_FORGETTING_FACTOR 0.98f
+
+/** The initial variance of each coefficient of the modem
+ * energy model, i.e. how far we trust the compile-time
+ * constants: roughly the square of the cost itself.
+ */
+#define MODEM_ENERGY_MODEL_VARIANCE_FIXED_UWH2  (1.0e6f)
+#define MODEM_ENERGY_MODEL_VARIANCE_REG_UWH2    (1.0e6f)
+#define MODEM_ENERGY_MODEL_VARIANCE_PER_KB_UWH2 (1.0e4f)
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The modem energy model, fitted from measurements and retained
+ * across resets.
+ */
+typedef struct {
+    unsigned int magic;
+    bool isN2xx;
+    unsigned int numSamples;
+    float coeffs[MODEM_ENERGY_MODEL_NUM_COEFFS];
+    float covariance[MODEM_ENERGY_MODEL_NUM_COEFFS][MODEM_ENERGY_MODEL_NUM_COEFFS];
+    unsigned int checksum;
+} ModemEnergyModel;
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
 
+/** The modem energy model, in an uninitialised RAM area so that it
+ * survives a reset.
+ */
+static ModemEnergyModel gEnergyModel NOINIT;
+
 /** Output pin to switch on power to the cellular modem.
  */
 static DigitalOut gEnableCdc(PIN_ENABLE_CDC, 0);
@@ -44,6 +94,16 @@ static DigitalOut gEnableCdc(PIN_ENABLE_CDC, 0);
  */
 static void *gpInterface = NULL;
 
+/** The heap counted against the cellular interface driver.
+ */
+static unsigned int gInterfaceHeapBytes = 0;
+
+/** The measurements of the heap taken by each cellular
+ * interface driver.
+ */
+static HeapMeasure gHeapMeasureSaraN2;
+static HeapMeasure gHeapMeasureSaraR4;
+
 /** Mutex to protect the against multiple accessors.
  */
 static Mutex gMtx;
@@ -106,6 +166,115 @@ static char gAckBuf[CODEC_DECODE_BUFFER_MIN_SIZE];
  * STATIC FUNCTIONS
  *************************************************************************/
 
+// Fill in the modem energy model coefficients from the
+// compile-time constants (noting that nWh per byte is the
+// same as uWh per kilobyte).
+static void energyModelDefaults(float *pCoeffs)
+{
+    if (gUseN2xxModem) {
+        pCoeffs[0] = ((float) CELLULAR_N2XX_ENERGY_TX_NWH(0)) / 1000;
+        pCoeffs[1] = ((float) CELLULAR_N2XX_POWER_REGISTRATION_NWH) / 1000;
+        pCoeffs[2] = (float) CELLULAR_N2XX_ENERGY_TX_PER_BYTE_NWH;
+    } else {
+        pCoeffs[0] = ((float) CELLULAR_R410_ENERGY_TX_NWH(0)) / 1000;
+        pCoeffs[1] = ((float) CELLULAR_R410_POWER_REGISTRATION_NWH) / 1000;
+        pCoeffs[2] = (float) CELLULAR_R410_ENERGY_TX_PER_BYTE_NWH;
+    }
+}
+
+// Return true if the retained modem energy model is intact.
+static bool energyModelIsValid()
+{
+    return (gEnergyModel.magic == MODEM_ENERGY_MODEL_MAGIC) &&
+           (gEnergyModel.checksum == utilitiesChecksum(&gEnergyModel,
+                                                       offsetof(ModemEnergyModel, checksum)));
+}
+
+// Set the modem energy model back to the compile-time constants.
+static void energyModelReset()
+{
+    memset(&gEnergyModel, 0, sizeof(gEnergyModel));
+    gEnergyModel.magic = MODEM_ENERGY_MODEL_MAGIC;
+    gEnergyModel.isN2xx = gUseN2xxModem;
+    energyModelDefaults(gEnergyModel.coeffs);
+    gEnergyModel.covariance[0][0] = MODEM_ENERGY_MODEL_VARIANCE_FIXED_UWH2;
+    gEnergyModel.covariance[1][1] = MODEM_ENERGY_MODEL_VARIANCE_REG_UWH2;
+    gEnergyModel.covariance[2][2] = MODEM_ENERGY_MODEL_VARIANCE_PER_KB_UWH2;
+    gEnergyModel.checksum = utilitiesChecksum(&gEnergyModel,
+                                              offsetof(ModemEnergyModel, checksum));
+}
+
+// Make sure that the modem energy model is valid and for the
+// modem that is attached, returning false if the type of modem
+// attached is not yet known (in which case the retained model
+// is left well alone).
+static bool energyModelCheck()
+{
+    if (gInitialisedOnce &&
+        (!energyModelIsValid() || (gEnergyModel.isN2xx != gUseN2xxModem))) {
+        energyModelReset();
+    }
+
+    return gInitialisedOnce;
+}
+
+// Update the modem energy model with a measurement, where pX points
+// to the inputs for each coefficient, using recursive least squares.
+static void energyModelUpdate(const float *pX, float energyUWH)
+{
+    float px[MODEM_ENERGY_MODEL_NUM_COEFFS];
+    float gain[MODEM_ENERGY_MODEL_NUM_COEFFS];
+    float denominator = MODEM_ENERGY_MODEL_FORGETTING_FACTOR;
+    float error = energyUWH;
+    float trace = 0;
+
+    // Work out the gain vector...
+    for (unsigned int i = 0; i < MODEM_ENERGY_MODEL_NUM_COEFFS; i++) {
+        px[i] = 0;
+        for (unsigned int j = 0; j < MODEM_ENERGY_MODEL_NUM_COEFFS; j++) {
+            px[i] += gEnergyModel.covariance[i][j] * pX[j];
+        }
+        denominator += pX[i] * px[i];
+        error -= gEnergyModel.coeffs[i] * pX[i];
+    }
+    for (unsigned int i = 0; i < MODEM_ENERGY_MODEL_NUM_COEFFS; i++) {
+        gain[i] = px[i] / denominator;
+    }
+
+    // ...update the coefficients, none of which can be negative...
+    for (unsigned int i = 0; i < MODEM_ENERGY_MODEL_NUM_COEFFS; i++) {
+        gEnergyModel.coeffs[i] += gain[i] * error;
+        if (gEnergyModel.coeffs[i] < 0) {
+            gEnergyModel.coeffs[i] = 0;
+        }
+    }
+
+    // ...and the covariance, which is symmetric
+    for (unsigned int i = 0; i < MODEM_ENERGY_MODEL_NUM_COEFFS; i++) {
+        for (unsigned int j = 0; j < MODEM_ENERGY_MODEL_NUM_COEFFS; j++) {
+            gEnergyModel.covariance[i][j] = (gEnergyModel.covariance[i][j] - gain[i] * px[j]) /
+                                            MODEM_ENERGY_MODEL_FORGETTING_FACTOR;
+        }
+        trace += gEnergyModel.covariance[i][i];
+    }
+
+    // Stop the covariance winding up when the measurements
+    // don't tell us much (e.g. always the same number of bytes)
+    if (trace > MODEM_ENERGY_MODEL_VARIANCE_FIXED_UWH2 +
+                MODEM_ENERGY_MODEL_VARIANCE_REG_UWH2 +
+                MODEM_ENERGY_MODEL_VARIANCE_PER_KB_UWH2) {
+        for (unsigned int i = 0; i < MODEM_ENERGY_MODEL_NUM_COEFFS; i++) {
+            for (unsigned int j = 0; j < MODEM_ENERGY_MODEL_NUM_COEFFS; j++) {
+                gEnergyModel.covariance[i][j] *= MODEM_ENERGY_MODEL_FORGETTING_FACTOR;
+            }
+        }
+    }
+
+    gEnergyModel.numSamples++;
+    gEnergyModel.checksum = utilitiesChecksum(&gEnergyModel,
+                                              offsetof(ModemEnergyModel, checksum));
+}
+
 #ifndef TARGET_UBLOX_C030
 
 #ifdef __cplusplus
@@ -229,15 +398,21 @@ static void modemInterfaceOff()
 static void *pGetSaraN2(const char *pSimPin, const char *pApn,
                         const char *pUserName, const char *pPassword)
 {
-    UbloxATCellularInterfaceN2xx *pInterface = new UbloxATCellularInterfaceN2xx(MDMTXD,
-                                                                                MDMRXD,
+    UbloxATCellularInterfaceN2xx *pInterface;
+
+    // The driver allocates its serial port, AT parser and buffer,
+    // event thread and more internally, so the size of the driver
+    // object itself is only the lower bound of what it takes
+    heapMeasureStart(&gHeapMeasureSaraN2);
+    pInterface = new UbloxATCellularInterfaceN2xx(MDMTXD,
+                                              MDMRXD,
 #if CELLULAR_N211_OFF_WHEN_NOT_IN_USE
 // Can run the serial port at a higher rate (but not quite 115200) if we're not power saving
-                                                                                57600,
+                                              57600,
 #else
-                                                                                MBED_CONF_UBLOX_CELL_N2XX_BAUD_RATE,
+                                              MBED_CONF_UBLOX_CELL_N2XX_BAUD_RATE,
 #endif
-                                                                                MODEM_DEBUG);
+                                              MODEM_DEBUG);
     if (pInterface != NULL) {
         pInterface->set_credentials(pApn, pUserName, pPassword);
         // Best to have this off if we're not going into power saving
@@ -253,6 +428,8 @@ static void *pGetSaraN2(const char *pSimPin, const char *pApn,
                                               CELLULAR_ACTIVE_TIME_SECONDS,
                                               modemEnteredPsmCallback);
 #endif
+            gInterfaceHeapBytes = heapMeasureEnd(&gHeapMeasureSaraN2, HEAP_SITE_MODEM,
+                                                 sizeof(UbloxATCellularInterfaceN2xx));
         } else {
             delete pInterface;
             pInterface = NULL;
@@ -266,10 +443,14 @@ static void *pGetSaraN2(const char *pSimPin, const char *pApn,
 static void *pGetSaraR4(const char *pSimPin, const char *pApn,
                         const char *pUserName, const char *pPassword)
 {
-    UbloxATCellularInterface *pInterface = new UbloxATCellularInterface(MDMTXD,
-                                                                        MDMRXD,
-                                                                        MBED_CONF_UBLOX_CELL_BAUD_RATE,
-                                                                        MODEM_DEBUG);
+    UbloxATCellularInterface *pInterface;
+
+    // As for pGetSaraN2(), the driver object is only the lower bound
+    heapMeasureStart(&gHeapMeasureSaraR4);
+    pInterface = new UbloxATCellularInterface(MDMTXD,
+                                              MDMRXD,
+                                              MBED_CONF_UBLOX_CELL_BAUD_RATE,
+                                              MODEM_DEBUG);
 
     if (pInterface != NULL) {
         pInterface->set_credentials(pApn, pUserName, pPassword);
@@ -282,7 +463,10 @@ static void *pGetSaraR4(const char *pSimPin, const char *pApn,
         pInterface->set_cscon_callback(modemCsconCallback);
         pInterface->set_radio_config(CELLULAR_R4_RAT,
                                      CELLULAR_R4_BAND_MASK);
-        if (!pInterface->init(pSimPin)) {
+        if (pInterface->init(pSimPin)) {
+            gInterfaceHeapBytes = heapMeasureEnd(&gHeapMeasureSaraR4, HEAP_SITE_MODEM,
+                                                 sizeof(UbloxATCellularInterface));
+        } else {
             delete pInterface;
             pInterface = NULL;
         }
@@ -593,8 +777,14 @@ ActionDriver modemInit(const char *pSimPin, const char *pApn,
                        const char *pUserName, const char *pPassword)
 {
     ActionDriver result;
+    unsigned int waitStartUs;
 
+    waitStartUs = us_ticker_read();
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
     MTX_LOCK(gMtx);
+    TIMELINE_END(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
+    statisticsAddMutexWait(us_ticker_read() - waitStartUs);
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_INIT, 0);
 
     result = ACTION_DRIVER_OK;
 
@@ -616,6 +806,16 @@ ActionDriver modemInit(const char *pSimPin, const char *pApn,
             } else {
                 gpInterface = pGetSaraR4(pSimPin, pApn, pUserName, pPassword);
             }
+        } else if (energyModelIsValid() && gEnergyModel.isN2xx) {
+            // The energy model has survived a reset and was made for
+            // an N2 modem, so try that first rather than waiting for
+            // an R4 modem that isn't there, falling back to the R4
+            gpInterface = pGetSaraN2(pSimPin, pApn, pUserName, pPassword);
+            if (gpInterface != NULL) {
+                gUseN2xxModem = true;
+            } else {
+                gpInterface = pGetSaraR4(pSimPin, pApn, pUserName, pPassword);
+            }
         } else {
             // Attempt to power up the R4 modem first: if the N2 modem is
             // connected instead it will not respond since it works at 9600
@@ -632,6 +832,9 @@ ActionDriver modemInit(const char *pSimPin, const char *pApn,
 
         if (gpInterface != NULL) {
             gInitialisedOnce = true;
+            // Now that we know the modem type, pick up
+            // the right energy model
+            energyModelCheck();
         } else {
             // Return the modem interface to its off state, since we aren't going
             // to go through the modemDeinit() procedure
@@ -640,6 +843,7 @@ ActionDriver modemInit(const char *pSimPin, const char *pApn,
         }
     }
 
+    TIMELINE_END(TIMELINE_ID_MODEM_INIT, result);
     MTX_UNLOCK(gMtx);
 
     return result;
@@ -660,6 +864,8 @@ void modemDeinit()
             ((UbloxATCellularInterface *) gpInterface)->deinit();
             delete (UbloxATCellularInterface *) gpInterface;
         }
+        heapCountFree(HEAP_SITE_MODEM, gInterfaceHeapBytes);
+        gInterfaceHeapBytes = 0;
 
         modemInterfaceOff();
 
@@ -712,8 +918,14 @@ ActionDriver modemConnect(bool (*pKeepGoingCallback)(void *),
 {
     ActionDriver result;
     int x = 0;
+    unsigned int waitStartUs;
 
+    waitStartUs = us_ticker_read();
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
     MTX_LOCK(gMtx);
+    TIMELINE_END(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
+    statisticsAddMutexWait(us_ticker_read() - waitStartUs);
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_CONNECT, 0);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
 
@@ -739,6 +951,7 @@ ActionDriver modemConnect(bool (*pKeepGoingCallback)(void *),
         }
     }
 
+    TIMELINE_END(TIMELINE_ID_MODEM_CONNECT, result);
     MTX_UNLOCK(gMtx);
 
     return result;
@@ -760,19 +973,27 @@ ActionDriver modemGetTime(time_t *pTimeUTC)
     Timer ackTimeout;
     time_t timeUTC;
     int x;
+    unsigned int waitStartUs;
 
+    waitStartUs = us_ticker_read();
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
     MTX_LOCK(gMtx);
+    TIMELINE_END(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
+    statisticsAddMutexWait(us_ticker_read() - waitStartUs);
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_GET_TIME, 0);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
     timeUTC = 0;
 
     if (gpInterface != NULL) {
         result = ACTION_DRIVER_ERROR_PARAMETER;
+        TIMELINE_BEGIN(TIMELINE_ID_MODEM_DNS, 0);
         if (gUseN2xxModem) {
             x = ((UbloxATCellularInterfaceN2xx *) gpInterface)->gethostbyname(NTP_SERVER_IP_ADDRESS, &udpServer);
         } else {
             x = ((UbloxATCellularInterface *) gpInterface)->gethostbyname(NTP_SERVER_IP_ADDRESS, &udpServer);
         }
+        TIMELINE_END(TIMELINE_ID_MODEM_DNS, x);
 
         if (x == 0){
             result = ACTION_DRIVER_ERROR_OUT_OF_MEMORY;
@@ -783,13 +1004,18 @@ ActionDriver modemGetTime(time_t *pTimeUTC)
                 *gBuf = '\x1b';
                 // Send the request
                 result = ACTION_DRIVER_ERROR_NO_DATA;
-                if (sockUdp.sendto(udpServer, (void *) gBuf, 48) == 48) {
+                TIMELINE_BEGIN(TIMELINE_ID_MODEM_SEND, 48);
+                x = sockUdp.sendto(udpServer, (void *) gBuf, 48);
+                TIMELINE_END(TIMELINE_ID_MODEM_SEND, x);
+                if (x == 48) {
                     statisticsAddTransmitted(48);
                     result = ACTION_DRIVER_ERROR_NO_VALID_DATA;
                     ackTimeout.start();
                     while ((ackTimeout.read_ms() < ACK_TIMEOUT_MS) &&
                            (result != ACTION_DRIVER_OK)) {
+                        TIMELINE_BEGIN(TIMELINE_ID_MODEM_RECEIVE, 0);
                         x = sockUdp.recvfrom(&udpSenderAddress, gBuf, sizeof (gBuf));
+                        TIMELINE_END(TIMELINE_ID_MODEM_RECEIVE, x);
                         // If there's enough data, it's a response
                         if (x >= 43) {
                             statisticsAddReceived(x);
@@ -811,6 +1037,7 @@ ActionDriver modemGetTime(time_t *pTimeUTC)
         }
     }
 
+    TIMELINE_END(TIMELINE_ID_MODEM_GET_TIME, result);
     MTX_UNLOCK(gMtx);
 
     return result;
@@ -830,19 +1057,28 @@ ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
     CodecErrorOrIndex index;
     unsigned int numNeedingAck;
     unsigned int numAcked;
+    int sent;
     int x;
+    unsigned int waitStartUs;
 
+    waitStartUs = us_ticker_read();
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
     MTX_LOCK(gMtx);
+    TIMELINE_END(TIMELINE_ID_MODEM_MUTEX_WAIT, 0);
+    statisticsAddMutexWait(us_ticker_read() - waitStartUs);
+    TIMELINE_BEGIN(TIMELINE_ID_MODEM_SEND_REPORTS, 0);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
 
     if (gpInterface != NULL) {
         result = ACTION_DRIVER_ERROR_PARAMETER;
+        TIMELINE_BEGIN(TIMELINE_ID_MODEM_DNS, 0);
         if (gUseN2xxModem) {
             x = ((UbloxATCellularInterfaceN2xx *) gpInterface)->gethostbyname(pServerAddress, &udpServer);
         } else {
             x = ((UbloxATCellularInterface *) gpInterface)->gethostbyname(pServerAddress, &udpServer);
         }
+        TIMELINE_END(TIMELINE_ID_MODEM_DNS, x);
 
         if (x == 0) {
             numNeedingAck = 0;
@@ -866,7 +1102,10 @@ ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
                     MBED_ASSERT((CODEC_FLAGS(x) &
                                  (CODEC_FLAG_NOT_ENOUGH_ROOM_FOR_HEADER |
                                   CODEC_FLAG_NOT_ENOUGH_ROOM_FOR_EVEN_ONE_DATA)) == 0);
-                    if (sockUdp.sendto(udpServer, (void *) gBuf, CODEC_SIZE(x)) == CODEC_SIZE(x)) {
+                    TIMELINE_BEGIN(TIMELINE_ID_MODEM_SEND, CODEC_SIZE(x));
+                    sent = sockUdp.sendto(udpServer, (void *) gBuf, CODEC_SIZE(x));
+                    TIMELINE_END(TIMELINE_ID_MODEM_SEND, sent);
+                    if (sent == CODEC_SIZE(x)) {
                         debugPulseLed(20);
                         statisticsAddTransmitted(CODEC_SIZE(x));
                         if ((CODEC_FLAGS(x) & CODEC_FLAG_NEEDS_ACK) > 0) {
@@ -880,7 +1119,10 @@ ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
                                 ackTimeout.reset();
                                 ackTimeout.start();
                                 while (ackTimeout.read_ms() < 2000) {
-                                    if ((x = sockUdp.recvfrom(&udpSenderAddress, (void *) gAckBuf, sizeof(gAckBuf))) > 0) {
+                                    TIMELINE_BEGIN(TIMELINE_ID_MODEM_RECEIVE, 0);
+                                    x = sockUdp.recvfrom(&udpSenderAddress, (void *) gAckBuf, sizeof(gAckBuf));
+                                    TIMELINE_END(TIMELINE_ID_MODEM_RECEIVE, x);
+                                    if (x > 0) {
                                         statisticsAddReceived(x);
                                         index = codecDecodeAck(gAckBuf, x, pIdString);
                                         if (index >= 0) {
@@ -906,7 +1148,10 @@ ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
                 ackTimeout.start();
                 while ((numAcked < numNeedingAck) &&
                        (ackTimeout.read_ms() < ACK_TIMEOUT_MS)) {
-                    if ((x = sockUdp.recvfrom(&udpSenderAddress, (void *) gAckBuf, sizeof(gAckBuf))) > 0) {
+                    TIMELINE_BEGIN(TIMELINE_ID_MODEM_RECEIVE, 0);
+                    x = sockUdp.recvfrom(&udpSenderAddress, (void *) gAckBuf, sizeof(gAckBuf));
+                    TIMELINE_END(TIMELINE_ID_MODEM_RECEIVE, x);
+                    if (x > 0) {
                         statisticsAddReceived(x);
                         index = codecDecodeAck(gAckBuf, x, pIdString);
                         if (index >= 0) {
@@ -922,6 +1167,7 @@ ActionDriver modemSendReports(const char *pServerAddress, int serverPort,
         }
     }
 
+    TIMELINE_END(TIMELINE_ID_MODEM_SEND_REPORTS, result);
     MTX_UNLOCK(gMtx);
 
     return result;
@@ -944,21 +1190,123 @@ unsigned long long int modemEnergyNWH(unsigned int idleTimeSeconds,
                                       unsigned int bytesTransmitted)
 {
     unsigned long long int energyNWH = 0;
+    float coeffs[MODEM_ENERGY_MODEL_NUM_COEFFS];
+    float activeUWH;
 
-    if (gUseN2xxModem) {
-        if (idleTimeSeconds > 0) {
+    MTX_LOCK(gMtx);
+
+    // Idle energy can't be measured so comes from the constants,
+    // the rest from the fitted model (which starts out as the
+    // constants)
+    if (energyModelCheck()) {
+        memcpy(coeffs, gEnergyModel.coeffs, sizeof(coeffs));
+    } else {
+        energyModelDefaults(coeffs);
+    }
+    if (idleTimeSeconds > 0) {
+        if (gUseN2xxModem) {
             energyNWH += ((unsigned long long int) idleTimeSeconds) * CELLULAR_N2XX_POWER_IDLE_NW / 3600;
         } else {
-            energyNWH += CELLULAR_N2XX_POWER_REGISTRATION_NWH;
+            energyNWH += ((unsigned long long int) idleTimeSeconds) * CELLULAR_R410_POWER_IDLE_NW / 3600;
         }
-        energyNWH += CELLULAR_N2XX_ENERGY_TX_NWH(bytesTransmitted);
+        activeUWH = 0;
     } else {
-        if (idleTimeSeconds > 0) {
-            energyNWH += ((unsigned long long int) idleTimeSeconds) * CELLULAR_R410_POWER_IDLE_NW / 3600;
-        } else {
-            energyNWH += CELLULAR_R410_POWER_REGISTRATION_NWH;
+        activeUWH = coeffs[1];
+    }
+    activeUWH += coeffs[0] + coeffs[2] * bytesTransmitted / 1000;
+    if (activeUWH > 0) {
+        energyNWH += (unsigned long long int) (activeUWH * 1000);
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return energyNWH;
+}
+
+// Update the modem energy model with a measurement.
+void modemEnergyCalibrate(bool fromOff, unsigned int bytesTransmitted,
+                          long long int energyNWH)
+{
+    float x[MODEM_ENERGY_MODEL_NUM_COEFFS];
+
+    x[0] = 1;
+    x[1] = fromOff ? 1 : 0;
+    x[2] = ((float) bytesTransmitted) / 1000;
+
+    MTX_LOCK(gMtx);
+
+    // Can't do anything without knowing the modem type
+    if (energyModelCheck()) {
+        energyModelUpdate(x, ((float) energyNWH) / 1000);
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Reset the modem energy model to the compile-time constants.
+void modemEnergyCalibrationReset()
+{
+    MTX_LOCK(gMtx);
+    energyModelReset();
+    MTX_UNLOCK(gMtx);
+}
+
+// Get the number of measurements in the modem energy model.
+unsigned int modemEnergyCalibrationCount()
+{
+    unsigned int numSamples = 0;
+
+    MTX_LOCK(gMtx);
+    if (energyModelCheck()) {
+        numSamples = gEnergyModel.numSamples;
+    }
+    MTX_UNLOCK(gMtx);
+
+    return numSamples;
+}
+
+// Estimate the energy cost of transmitting one byte.
+unsigned int modemEnergyPerByteNWH(int rsrpDbm, int transmitPowerDbm,
+                                   unsigned char ecl)
+{
+    unsigned int energyNWH;
+    unsigned int powerAmplifierPercent = 100;
+
+    if (gUseN2xxModem) {
+        energyNWH = CELLULAR_N2XX_ENERGY_TX_PER_BYTE_NWH;
+    } else {
+        energyNWH = CELLULAR_R410_ENERGY_TX_PER_BYTE_NWH;
+        // SARA-R4 reports neither ECL nor transmit power
+        // so infer the former from RSRP and assume the worst
+        // for the latter
+        ecl = 0;
+        if (rsrpDbm < 0) {
+            if (rsrpDbm < CELLULAR_ECL2_RSRP_THRESHOLD_DBM) {
+                ecl = 2;
+            } else if (rsrpDbm < CELLULAR_ECL1_RSRP_THRESHOLD_DBM) {
+                ecl = 1;
+            }
         }
-        energyNWH += CELLULAR_R410_ENERGY_TX_NWH(bytesTransmitted);
+        transmitPowerDbm = CELLULAR_TX_POWER_MAX_DBM;
+    }
+
+    // Repetitions in the higher coverage classes
+    if (ecl == 1) {
+        energyNWH *= CELLULAR_ECL1_TX_ENERGY_MULTIPLIER;
+    } else if (ecl >= 2) {
+        energyNWH *= CELLULAR_ECL2_TX_ENERGY_MULTIPLIER;
+    }
+
+    // The power amplifier part of the cost roughly halves
+    // for every 3 dB below maximum transmit power
+    for (int x = CELLULAR_TX_POWER_MAX_DBM;
+         (x > transmitPowerDbm) && (powerAmplifierPercent > 0); x -= 3) {
+        powerAmplifierPercent >>= 1;
+    }
+    energyNWH = energyNWH * ((100 - CELLULAR_TX_POWER_AMPLIFIER_PERCENT) +
+                             (CELLULAR_TX_POWER_AMPLIFIER_PERCENT * powerAmplifierPercent / 100)) / 100;
+    if (energyNWH == 0) {
+        energyNWH = 1;
     }
 
     return energyNWH;
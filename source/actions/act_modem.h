@@ -116,6 +116,10 @@ bool modemIsN2();
 bool modemIsR4();
 
 /** Determine the energy consumed by the modem in nanoWatt hours.
+ * The idle cost comes from compile-time constants while the cost
+ * of registering and transmitting comes from a model which starts
+ * out with compile-time constants and is then refined by
+ * modemEnergyCalibrate().
  * Note: this is, of course, rather approximate!
  *
  * @param idleTimeSeconds  the time spent idle (not transmitting
@@ -130,6 +134,54 @@ bool modemIsR4();
 unsigned long long int modemEnergyNWH(unsigned int idleTimeSeconds,
                                       unsigned int bytesTransmitted);
 
+/** Refine the model used by modemEnergyNWH() with a measurement
+ * of the energy actually consumed by a modem session (e.g. from the
+ * droop in VBAT_OK), using a recursive least squares fit.  The model
+ * is retained across a reset.  Every session should be fed in, not
+ * just those large enough to measure well: the noise averages out
+ * but leaving out the small ones would bias the fit upwards.
+ *
+ * @param fromOff          true if the modem started the session from
+ *                         off and so had to register.
+ * @param bytesTransmitted the number of bytes transmitted during the
+ *                         session.
+ * @param energyNWH        the energy measured in nanoWatt hours,
+ *                         which may be negative where the noise in
+ *                         the measurement exceeds the energy used.
+ */
+void modemEnergyCalibrate(bool fromOff, unsigned int bytesTransmitted,
+                          long long int energyNWH);
+
+/** Reset the model used by modemEnergyNWH() to the compile-time
+ * constants.
+ */
+void modemEnergyCalibrationReset();
+
+/** Get the number of measurements that have been fed into the
+ * model used by modemEnergyNWH() since it was last reset.
+ *
+ * @return the number of measurements.
+ */
+unsigned int modemEnergyCalibrationCount();
+
+/** Estimate the energy that would be consumed by the modem, in
+ * nanoWatt hours, to transmit a single byte under the given radio
+ * conditions, as returned by getCellularSignalRx(),
+ * getCellularSignalTx() and getCellularChannel().  SARA-R4 does not
+ * report ECL or transmit power so, for that modem, the coverage
+ * class is inferred from RSRP and maximum transmit power is assumed.
+ * Note: this is, of course, rather approximate but it is useful
+ * in comparing one set of radio conditions with another.
+ *
+ * @param rsrpDbm          the RSRP in dBm, 0 if not known.
+ * @param transmitPowerDbm the transmit power in dBm.
+ * @param ecl              the coverage class (0 to 2).
+ * @return                 the estimated energy cost of transmitting
+ *                         one byte in nanoWatt hours.
+ */
+unsigned int modemEnergyPerByteNWH(int rsrpDbm, int transmitPowerDbm,
+                                   unsigned char ecl);
+
 #endif // _ACT_MODEM_H_
 
 // End Of File
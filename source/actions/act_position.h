@@ -23,10 +23,6 @@
  */
 #define POSITION_TIMEOUT_MS 60000
 
-/** How long to wait between checks for a position fix.
- */
-#define POSITION_CHECK_INTERVAL_MS 5000
-
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -35,7 +31,8 @@
  * FUNCTIONS
  *************************************************************************/
 
-/** Get the position from GNSS.
+/** Get the position from GNSS: this is the next position report
+ * from the GNSS chip, fix or no fix.
  *
  * @param pLatitudeX10e7   a place to put latitude (in 1000000ths of a degree).
  * @param pLongitudeX10e7  a place to put longitude (in 1000000ths of a degree).
@@ -50,6 +47,31 @@ ActionDriver getPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
                          int *pRadiusMetres, int *pAltitudeMetres,
                          unsigned char *pSpeedMPS, unsigned char *pSVs);
 
+/** Wait for a position fix from GNSS, sleeping while the GNSS
+ * chip works on it rather than repeatedly asking it for a position.
+ *
+ * @param pLatitudeX10e7     a place to put latitude (in 1000000ths of a degree).
+ * @param pLongitudeX10e7    a place to put longitude (in 1000000ths of a degree).
+ * @param pRadiusMetres      a place to put the radius of position (in metres).
+ * @param pAltitudeMetres    a place to put the altitude (in metres).
+ * @param pSpeedMPS          a place to put the speed (in metres per second).
+ * @parma pSVs               a place to store the number of space vehicles used
+ *                           in the solution.
+ * @param timeoutMs          how long to wait for a fix.
+ * @param pKeepGoingCallback a function to call back which will return
+ *                           true if it's OK to keep going, else false;
+ *                           may be NULL.
+ * @param pCallbackParam     a parameter to pass to pKeepGoingCallback()
+ *                           when it is called.
+ * @return                   zero on success or negative error code on failure.
+ */
+ActionDriver waitPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
+                          int *pRadiusMetres, int *pAltitudeMetres,
+                          unsigned char *pSpeedMPS, unsigned char *pSVs,
+                          int timeoutMs,
+                          bool (*pKeepGoingCallback)(void *),
+                          void *pCallbackParam);
+
 /** Get the time from GNSS: best to only call this if getPosition() has succeeded.
  *
  * @param pTimeUTC a place to put the (Unix) UTC time.
@@ -7,6 +7,7 @@
 
 #include <mbed.h>
 #include <eh_utilities.h> // For ARRAY_SIZE and MTX_LOCK()/MTX_UNLOCK()
+#include <eh_config.h> // for PIN_INT_LIGHT
 #include <eh_debug.h>
 #include <eh_i2c.h>
 #include <act_light.h>
@@ -34,6 +35,26 @@
 #define NUMCOEFF_LOW            9
 #define NUMCOEFF_HIGH           4
 
+/** The time one ADC measurement takes with HW_GAIN of zero and the
+ * default decimation rate, in nanoseconds, see the description of
+ * ADCSENSx in section 5.6 of the Si1133 datasheet.
+ */
+#define ADC_BASE_TIME_NS        24400
+
+/** Margin to add to the worked-out measurement time, in microseconds,
+ * to allow for the internal oscillator being slow.
+ */
+#define ADC_MARGIN_US           2000
+
+/** The bit of REG_IRQ_STATUS, and of REG_IRQ_ENABLE, for channel 3:
+ * the channels are measured in order so, when this is set, all four
+ * have been.  It is the only interrupt enabled since the interrupt
+ * output goes low as soon as any enabled channel has been measured
+ * and reading REG_IRQ_STATUS clears it, so the bits of the earlier
+ * channels may have been read and cleared already.
+ */
+#define IRQ_STATUS_LAST_CHANNEL 0x08
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -78,6 +99,30 @@ static char gI2cAddress = 0;
  */
 static Mutex gMtx;
 
+/** How long a measurement of all the channels takes, worked out
+ * from initPairs.
+ */
+static int gConversionTimeUs = 0;
+
+/** Function to call when a measurement has ended, and its parameter.
+ */
+static void (*gpCallback)(void *) = NULL;
+static void *gpCallbackParam = NULL;
+
+#ifdef PIN_INT_LIGHT
+/** The interrupt output of the SI1133.
+ */
+static InterruptIn gInterrupt(PIN_INT_LIGHT);
+#else
+/** Timer for the end of a measurement.
+ */
+static Timeout gConversionTimeout;
+#endif
+
+/** Semaphore released when a measurement started by getLight() has ended.
+ */
+static Semaphore gReadingSemaphore(0);
+
 /** Coefficients for lux calculation
  */
 static const LuxCoeff lk = {
@@ -248,6 +293,63 @@ static ActionDriver sendCommand(char command)
     return result;
 }
 
+// Work out how long a measurement of all the channels in initPairs
+// takes: for each channel, the base time doubles with each step of
+// HW_GAIN (ADCSENSx bits 3 to 0), SW_GAIN (ADCSENSx bits 6 to 4) is
+// the log2 of the number of measurements accumulated and DECIM_RATE
+// (ADCCONFIGx bits 6 and 5) selects 1024, 2048, 4096 or 512 ADC clocks.
+static int conversionTimeUs()
+{
+    // Decimation in 512 clock units, indexed by DECIM_RATE
+    const int decimation[] = {2, 4, 8, 1};
+    char channelList = 0;
+    char adcConfig[6] = {0};
+    char adcSens[6] = {0};
+    int channel;
+    long long int timeNs = 0;
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(initPairs); x += 2) {
+        if (initPairs[x] == 0x01) { // PARAM_CH_LIST
+            channelList = initPairs[x + 1];
+        } else if (initPairs[x] >= 0x02) {
+            // Parameters for each channel come in groups of four,
+            // starting with PARAM_ADCCONFIG0
+            channel = (initPairs[x] - 0x02) >> 2;
+            if (channel < (int) ARRAY_SIZE(adcConfig)) {
+                if (((initPairs[x] - 0x02) & 0x03) == 0) {
+                    adcConfig[channel] = initPairs[x + 1];
+                } else if (((initPairs[x] - 0x02) & 0x03) == 1) {
+                    adcSens[channel] = initPairs[x + 1];
+                }
+            }
+        }
+    }
+
+    for (channel = 0; channel < (int) ARRAY_SIZE(adcConfig); channel++) {
+        if (channelList & (1 << channel)) {
+            timeNs += ((((long long int) ADC_BASE_TIME_NS) << (adcSens[channel] & 0x0f)) / 2) *
+                      decimation[(adcConfig[channel] >> 5) & 0x03] *
+                      (1 << ((adcSens[channel] >> 4) & 0x07));
+        }
+    }
+
+    return (int) ((timeNs / 1000) + ((timeNs / 1000) >> 3)) + ADC_MARGIN_US;
+}
+
+// Called at the end of a measurement, in interrupt context.
+static void conversionComplete()
+{
+    if (gpCallback != NULL) {
+        gpCallback(gpCallbackParam);
+    }
+}
+
+// Callback used by getLight().
+static void readingCallback(void *pParam)
+{
+    ((Semaphore *) pParam)->release();
+}
+
 // Read the measurement results from the chip.
 static ActionDriver readResults(Samples *pSamples)
 {
@@ -401,6 +503,51 @@ static int getUvIndex(int uv)
                                uk);
 }
 
+// Force a measurement of all channels, calling pCallback when done.
+static ActionDriver startGroup(void (*pCallback)(void *), void *pCallbackParam)
+{
+    ActionDriver result;
+
+    // Set the callback up first as the measurement may end
+    // before sendCommand() returns
+    gpCallback = pCallback;
+    gpCallbackParam = pCallbackParam;
+    result = sendCommand(0x11); // CMD_FORCE_CH
+#ifndef PIN_INT_LIGHT
+    if (result == ACTION_DRIVER_OK) {
+        gConversionTimeout.attach_us(&conversionComplete, gConversionTimeUs);
+    }
+#endif
+
+    return result;
+}
+
+// Read all channels in one go and, if the measurement has
+// ended, work out lux and UV index.
+static ActionDriver readGroup(Si1133Group *pGroup)
+{
+    ActionDriver result;
+    Samples samples;
+
+    result = readResults(&samples);
+    if (result == ACTION_DRIVER_OK) {
+        if (samples.irqStatus & IRQ_STATUS_LAST_CHANNEL) {
+            if (pGroup != NULL) {
+                pGroup->uv = samples.ch0;
+                pGroup->visibleHigh = samples.ch1;
+                pGroup->ir = samples.ch2;
+                pGroup->visibleLow = samples.ch3;
+                pGroup->lux = getLux(samples.ch1, samples.ch3, samples.ch2) / (1 << LUX_OUTPUT_FRACTION);
+                pGroup->uvIndexX1000 = (getUvIndex(samples.ch0) * 1000) / (1 << UV_OUTPUT_FRACTION);
+            }
+        } else {
+            result = ACTION_DRIVER_ERROR_NO_DATA;
+        }
+    }
+
+    return result;
+}
+
 /**************************************************************************
  * PUBLIC FUNCTIONS
  *************************************************************************/
@@ -434,9 +581,14 @@ ActionDriver si1133Init(char i2cAddress)
             }
 
             data[0] = 0x0f; // REG_IRQ_ENABLE
-            data[1] = 0x0f;
+            data[1] = IRQ_STATUS_LAST_CHANNEL;
             if (result == ACTION_DRIVER_OK) {
                 if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+                    gConversionTimeUs = conversionTimeUs();
+#ifdef PIN_INT_LIGHT
+                    gInterrupt.mode(PullUp);
+                    gInterrupt.fall(&conversionComplete);
+#endif
                     gInitialised = true;
                 } else {
                     result = ACTION_DRIVER_ERROR_I2C_WRITE;
@@ -458,6 +610,12 @@ void si1133Deinit()
     MTX_LOCK(gMtx);
 
     if (gInitialised) {
+#ifdef PIN_INT_LIGHT
+        gInterrupt.fall(NULL);
+#else
+        gConversionTimeout.detach();
+#endif
+        gpCallback = NULL;
         // Set PARAM_CH_LIST
         setParameter(0x01, 0x3f);
         // Send CMD_PAUSE_CH
@@ -475,51 +633,58 @@ ActionDriver getLight(int *pLux, int *pUvIndexX1000)
 {
     ActionDriver result;
     Timer timer;
-    Samples samples;
-    char data[2];
+    Si1133Group group;
 
     MTX_LOCK(gMtx);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
 
     if (gInitialised) {
+        // Throw away any left-over release of the semaphore
+        while (gReadingSemaphore.wait(0) > 0) {}
 
-        // Force a measurement
-        result = sendCommand(0x11);
-
+        timer.reset();
+        timer.start();
+        result = startGroup(&readingCallback, &gReadingSemaphore);
         if (result == ACTION_DRIVER_OK) {
-            // Wait for the answer measurement to complete
-            data[0] = 0x12; // REG_IRQ_STATUS
-            data[1] = 0;
-            result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-            timer.reset();
-            timer.start();
-            while ((i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) &&
-                   (data[1] != 0x0f) &&
+            // Sleep until the measurement should have ended, then
+            // read all of the results in one go; only if they are
+            // not there yet check again, every so often
+            gReadingSemaphore.wait(SI1133_WAIT_FOR_READING_MS);
+            while (((result = readGroup(&group)) == ACTION_DRIVER_ERROR_NO_DATA) &&
                    (timer.read_ms() < SI1133_WAIT_FOR_READING_MS)) {
-                Thread::wait(100); // Relax a little
+                Thread::wait(SI1133_READING_CHECK_INTERVAL_MS);
             }
-            timer.stop();
-
-            // If we have a measurement, go get the result
-            if (data[1] == 0x0f) {
-                result = readResults(&samples);
-                if (result == ACTION_DRIVER_OK) {
-                    // Convert readings to lux
-                    if (pLux != NULL) {
-                        *pLux = (getLux(samples.ch1, samples.ch3, samples.ch2)) / (1 << LUX_OUTPUT_FRACTION);
-                    }
-                    // Convert readings to UV Index
-                    if (pUvIndexX1000 != NULL) {
-                        *pUvIndexX1000 = (getUvIndex(samples.ch0) * 1000) / (1 << UV_OUTPUT_FRACTION);
-                    }
+            if (result == ACTION_DRIVER_OK) {
+                if (pLux != NULL) {
+                    *pLux = group.lux;
                 }
-            } else {
-                if (timer.read_ms() >= SI1133_WAIT_FOR_READING_MS) {
-                    result = ACTION_DRIVER_ERROR_TIMEOUT;
+                if (pUvIndexX1000 != NULL) {
+                    *pUvIndexX1000 = group.uvIndexX1000;
                 }
+            } else if (result == ACTION_DRIVER_ERROR_NO_DATA) {
+                result = ACTION_DRIVER_ERROR_TIMEOUT;
             }
         }
+        timer.stop();
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
+// Start a measurement of all channels.
+ActionDriver si1133StartGroup(void (*pCallback)(void *), void *pCallbackParam)
+{
+    ActionDriver result;
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = startGroup(pCallback, pCallbackParam);
     }
 
     MTX_UNLOCK(gMtx);
@@ -527,4 +692,28 @@ ActionDriver getLight(int *pLux, int *pUvIndexX1000)
     return result;
 }
 
+// Read the results of a measurement of all channels.
+ActionDriver si1133ReadGroup(Si1133Group *pGroup)
+{
+    ActionDriver result;
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = readGroup(pGroup);
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
+// Get how long a measurement of all channels should take.
+int si1133GetConversionTimeUs()
+{
+    return gConversionTimeUs;
+}
+
 // End of file
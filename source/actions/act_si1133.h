@@ -30,6 +30,11 @@
  */
 #define SI1133_WAIT_FOR_READING_MS 1000
 
+/** How often to check for the end of a reading, in ms, if it
+ * has not ended by the time it was expected to.
+ */
+#define SI1133_READING_CHECK_INTERVAL_MS 10
+
 /** How long to wait for the device to return to sleep in ms.
  */
 #define SI1133_WAIT_FOR_SLEEP_MS 1000
@@ -58,6 +63,18 @@
  * TYPES
  *************************************************************************/
 
+/** The readings from one measurement of all of the channels of the
+ * SI1133, captured in a single burst read.
+ */
+typedef struct {
+    int uv;           //!< Raw reading of channel 0, the UV photodiode.
+    int visibleHigh;  //!< Raw reading of channel 1, visible light at low gain.
+    int ir;           //!< Raw reading of channel 2, infra-red light.
+    int visibleLow;   //!< Raw reading of channel 3, visible light at high gain.
+    int lux;          //!< The light level in lux derived from the above.
+    int uvIndexX1000; //!< The UV index in 1000ths of a unit derived from the above.
+} Si1133Group;
+
 /**************************************************************************
  * FUNCTIONS
  *************************************************************************/
@@ -75,6 +92,40 @@ ActionDriver si1133Init(char i2cAddress);
  */
 void si1133Deinit();
 
+/** Start a measurement of all of the channels of the SI1133 and
+ * return without waiting for it to end.  The end of the measurement
+ * is signalled by the interrupt output of the SI1133 if PIN_INT_LIGHT
+ * is defined, else after the time the measurement should take given
+ * the ADC settings (see si1133GetConversionTimeUs()).  Call
+ * si1133ReadGroup() to read the results.
+ *
+ * @param pCallback      a function to call when the measurement has
+ *                       ended, NULL if this is not required; the
+ *                       function is called in interrupt context and
+ *                       so should do no more than, e.g., release a
+ *                       semaphore.
+ * @param pCallbackParam a parameter to pass to pCallback.
+ * @return               zero on success or negative error code on failure.
+ */
+ActionDriver si1133StartGroup(void (*pCallback)(void *), void *pCallbackParam);
+
+/** Read the results of a measurement started with si1133StartGroup(),
+ * all channels in a single I2C transaction.
+ *
+ * @param pGroup a place to put the readings, may be NULL.
+ * @return       zero on success, ACTION_DRIVER_ERROR_NO_DATA if the
+ *               measurement has not yet ended, else negative error code.
+ */
+ActionDriver si1133ReadGroup(Si1133Group *pGroup);
+
+/** Get how long a measurement of all of the channels of the SI1133
+ * should take, worked out from the ADC settings when the SI1133 was
+ * initialised.
+ *
+ * @return the measurement time in microseconds.
+ */
+int si1133GetConversionTimeUs();
+
 #endif // _ACT_SI1133_H_
 
 // End Of File
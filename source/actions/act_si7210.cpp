@@ -17,6 +17,11 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+/** The value of sw_tamper (see section 4.1.3 of the si7210 data
+ * sheet) which switches tamper detection off.
+ */
+#define SW_TAMPER_OFF 0x3f
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
@@ -394,12 +399,24 @@ static ActionDriver _getInterrupt(unsigned int *pThresholdTeslaX1000,
     unsigned int hysteresis;
     bool activeHigh;
     char data[4];
+    I2CTransaction transactions[2];
 
-    // Read SI72XX_CTRL1 and SI72XX_CTRL2
+    // Read SI72XX_CTRL1 and SI72XX_CTRL2, which are adjacent so,
+    // arautoinc having been set in si7210Init(), the I2C driver
+    // reads them in one go
     data[0] = 0xc6; // SI72XX_CTRL1
     data[2] = 0xc7; // SI72XX_CTRL2
-    if ((i2cSendReceive(gI2cAddress, &(data[0]), 1, &(data[1]), 1) == 1) &&
-        (i2cSendReceive(gI2cAddress, &(data[2]), 1, &(data[3]), 1)) == 1) {
+    memset(transactions, 0, sizeof(transactions));
+    for (unsigned int x = 0; x < ARRAY_SIZE(transactions); x++) {
+        transactions[x].i2cAddress = gI2cAddress;
+        transactions[x].pSend = &(data[x * 2]);
+        transactions[x].bytesToSend = 1;
+        transactions[x].pReceive = &(data[(x * 2) + 1]);
+        transactions[x].bytesToReceive = 1;
+        transactions[x].flags = I2C_FLAG_REGISTER_AUTO_INCREMENT;
+    }
+    if ((i2cSendReceiveMany(transactions, ARRAY_SIZE(transactions)) == I2C_RESULT_OK) &&
+        (transactions[0].result == 1) && (transactions[1].result == 1)) {
 
         // Threshold is bits 0 to 6 of SI72XX_CTRL1
         threshold = ((int) (16 + (data[1] & 0x0F))) << ((data[1] & 0x70) >> 4);
@@ -450,6 +467,85 @@ static ActionDriver _getInterrupt(unsigned int *pThresholdTeslaX1000,
     return result;
 }
 
+// Set up the digital filter.
+// See section 4.1.3 of the si7210 data sheet.
+static ActionDriver _setFilter(Si7210Filter filter, unsigned int bandwidth,
+                               unsigned int burstSize)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_I2C_WRITE;
+    char data[2];
+
+    // SI72XX_CTRL4 holds df_burstsize in bits 5 to 7,
+    // df_bw in bits 1 to 4 and df_iir in bit 0
+    if (bandwidth > SI7210_MAX_FILTER_BANDWIDTH) {
+        bandwidth = SI7210_MAX_FILTER_BANDWIDTH;
+    }
+    if (burstSize > SI7210_MAX_BURST_SIZE) {
+        burstSize = SI7210_MAX_BURST_SIZE;
+    }
+    data[0] = 0xcd; // SI72XX_CTRL4
+    data[1] = (burstSize << 5) | (bandwidth << 1);
+    if (filter == SI7210_FILTER_IIR) {
+        data[1] |= 0x01;
+    }
+    if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+        result = ACTION_DRIVER_OK;
+    }
+
+    return result;
+}
+
+// Set up the tamper threshold.
+// See section 4.1.3 of the si7210 data sheet.
+static ActionDriver _setTamper(unsigned int threshold)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
+    int x;
+    int y;
+    char data[2];
+
+    // Account for the range
+    threshold /= 5;
+    if (gRange == SI7210_RANGE_200_MILLI_TESLAS) {
+        threshold /= 10;
+    }
+    // sw_tamper codes (16 + bits 0 to 3) << (bits 4 and 5 + 5),
+    // so 512 to 7680 are valid thresholds, the all-ones
+    // value meaning that there is no tamper threshold
+    if (threshold != 0) {
+        if (threshold > 7680) {
+            threshold = 7680;
+        } else if (threshold < 512) {
+            threshold = 512;
+        }
+    }
+
+    // Read-modify-write SI72XX_CTRL3, sw_tamper being bits 2 to 7
+    data[0] = 0xc9; // SI72XX_CTRL3
+    if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
+        data[1] &= 0x03;
+        if (threshold == 0) {
+            data[1] |= SW_TAMPER_OFF << 2;
+        } else {
+            x = 0;
+            y = (int) threshold >> 5;
+            // Shift it down until y - 16 is
+            // less than 0xF (4 bits)
+            while ((y - 16) > 0xF) {
+                y >>= 1;
+                x++;
+            }
+            data[1] |= ((y - 16) | (x << 4)) << 2;
+        }
+        result = ACTION_DRIVER_ERROR_I2C_WRITE;
+        if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) == 0) {
+            result = ACTION_DRIVER_OK;
+        }
+    }
+
+    return result;
+}
+
 /**************************************************************************
  * PUBLIC FUNCTIONS: GENERIC
  *************************************************************************/
@@ -459,7 +555,7 @@ ActionDriver getFieldStrength(unsigned int *pTeslaX1000)
 {
     ActionDriver result;
     int rawFieldStrength;
-    char data[2];
+    char data[3];
 
     MTX_LOCK(gMtx);
 
@@ -469,29 +565,25 @@ ActionDriver getFieldStrength(unsigned int *pTeslaX1000)
         result = wakeUp();
         if (result == ACTION_DRIVER_OK) {
             result = ACTION_DRIVER_ERROR_I2C_WRITE_READ;
-            // Read SI72XX_DSPSIGM
+            // Read SI72XX_DSPSIGM and SI72XX_DSPSIGL in one go,
+            // arautoinc having been set in si7210Init()
             data[0] = 0xc1; // SI72XX_DSPSIGM
-            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
-                // If the data is new, clear the old and read the other half in
+            if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 2) == 2) {
+                // If the data is new, use it
                 if ((data[1] & 0x80) != 0) {
-                    rawFieldStrength = (((unsigned int) data[1]) & 0x7f) << 8;
-                    data[0] = 0xC2; // SI72XX_DSPSIGL
-                    if (i2cSendReceive(gI2cAddress, data, 1, &(data[1]), 1) == 1) {
-                        rawFieldStrength += (unsigned char) data[1];
-                        // 0x4000 is zero, the field being negative below this value
-                        // and positive above, but we are only interested in the
-                        // absolute value
-                        rawFieldStrength -= 0x4000;
-                        if (rawFieldStrength < 0) {
-                            rawFieldStrength = -rawFieldStrength;
-                        }
-                        gRawFieldStrength = rawFieldStrength;
-                        result = ACTION_DRIVER_OK;
+                    rawFieldStrength = ((((unsigned int) data[1]) & 0x7f) << 8) +
+                                       (unsigned char) data[2];
+                    // 0x4000 is zero, the field being negative below this value
+                    // and positive above, but we are only interested in the
+                    // absolute value
+                    rawFieldStrength -= 0x4000;
+                    if (rawFieldStrength < 0) {
+                        rawFieldStrength = -rawFieldStrength;
                     }
-                } else {
-                    // Just return the existing data
-                    result = ACTION_DRIVER_OK;
+                    gRawFieldStrength = rawFieldStrength;
                 }
+                // Otherwise just return the existing data
+                result = ACTION_DRIVER_OK;
             }
 
             if ((result == ACTION_DRIVER_OK) && (pTeslaX1000 != NULL)) {
@@ -565,6 +657,15 @@ ActionDriver si7210Init(char i2cAddress)
                     // parameters
                     gRange = SI7210_RANGE_20_MILLI_TESLAS;
                     result = copyCompensationParameters(0x21);
+                    if (result == ACTION_DRIVER_OK) {
+                        // Set arautoinc so that the two signal registers
+                        // can be read in a single transaction
+                        data[0] = 0xc5; // SI72XX_ARAUTOINC
+                        data[1] = 0x01;
+                        if (i2cSendReceive(gI2cAddress, data, 2, NULL, 0) != 0) {
+                            result = ACTION_DRIVER_ERROR_I2C_WRITE;
+                        }
+                    }
                     if (result == ACTION_DRIVER_OK) {
                         // Return to sleep with the measurement timer running
                         result = sleep(true);
@@ -734,4 +835,51 @@ ActionDriver si7210GetInterrupt(unsigned int *pThresholdTeslaX1000,
     return result;
 }
 
+// Set up the digital filter.
+ActionDriver si7210SetFilter(Si7210Filter filter, unsigned int bandwidth,
+                             unsigned int burstSize)
+{
+    ActionDriver result;
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = wakeUp();
+        if (result == ACTION_DRIVER_OK) {
+            result = _setFilter(filter, bandwidth, burstSize);
+            // Return to sleep with the measurement timer running
+            sleep(true);
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
+// Set up the tamper threshold.
+ActionDriver si7210SetTamper(unsigned int thresholdTeslaX1000)
+{
+    ActionDriver result;
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gInitialised) {
+        result = wakeUp();
+        if (result == ACTION_DRIVER_OK) {
+            result = _setTamper(thresholdTeslaX1000);
+            // Return to sleep with the measurement timer running
+            sleep(true);
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
 // End of file
@@ -43,6 +43,14 @@
  */
 #define SI7210_WAIT_FOR_OTP_DATA_MS 1000
 
+/** The largest value of the bandwidth parameter to si7210SetFilter().
+ */
+#define SI7210_MAX_FILTER_BANDWIDTH 12
+
+/** The largest value of the burstSize parameter to si7210SetFilter().
+ */
+#define SI7210_MAX_BURST_SIZE 7
+
 /** The power consumed, in nanoWatts, while the device is off.
  */
 #define SI7210_POWER_OFF_NW 0
@@ -71,6 +79,13 @@ typedef enum {
     SI7210_RANGE_200_MILLI_TESLAS = 1
 } Si7210FieldStrengthRange;
 
+/** The digital filters that may be applied to measurements.
+ */
+typedef enum {
+    SI7210_FILTER_FIR = 0, //!< A moving average.
+    SI7210_FILTER_IIR = 1  //!< A first-order low-pass filter.
+} Si7210Filter;
+
 /**************************************************************************
  * FUNCTIONS
  *************************************************************************/
@@ -153,6 +168,38 @@ ActionDriver si7210GetInterrupt(unsigned int *pThresholdTeslaX1000,
                                 unsigned int *pHysteresisTeslaX1000,
                                 bool *pActiveHigh);
 
+/** Set up the digital filter that the SI7210 applies, while it
+ * samples autonomously, to the measurements that are compared with
+ * the interrupt threshold and returned by getFieldStrength().
+ * See section 4.1.3 of the si7210 data sheet.
+ *
+ * @param filter    the filter type.
+ * @param bandwidth for SI7210_FILTER_FIR the filter averages 2^bandwidth
+ *                  samples, for SI7210_FILTER_IIR the filter weights each
+ *                  new sample by 2 / (1 + 2^bandwidth); 0 switches filtering
+ *                  off, values above SI7210_MAX_FILTER_BANDWIDTH are limited.
+ * @param burstSize each measurement is the average of a burst of
+ *                  2^burstSize samples, values above SI7210_MAX_BURST_SIZE
+ *                  are limited; larger bursts cost more energy.
+ * @return          zero on success or negative error code on failure.
+ */
+ActionDriver si7210SetFilter(Si7210Filter filter, unsigned int bandwidth,
+                             unsigned int burstSize);
+
+/** Set the tamper threshold: a field stronger than this, e.g. from
+ * a large magnet held against the device, drives the interrupt output
+ * to its inactive level whatever the interrupt threshold.  The
+ * threshold can be 2560 to 38400 for the 20 milli-Tesla range (x10
+ * for the 200 milli-Tesla range), values outside this being limited.
+ * Note: changing the range does not recalculate the tamper threshold.
+ *
+ * @param thresholdTeslaX1000 the tamper threshold in milli-Tesla, 0
+ *                            to switch tamper detection off.
+ * @return                    zero on success or negative error code
+ *                            on failure.
+ */
+ActionDriver si7210SetTamper(unsigned int thresholdTeslaX1000);
+
 #endif // _ACT_SI7210_H_
 
 // End Of File
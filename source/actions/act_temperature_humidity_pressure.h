@@ -50,6 +50,25 @@ ActionDriver getHumidity(unsigned char *pPercentage);
  */
 ActionDriver getPressure(unsigned int *pPascalX100);
 
+/** Get temperature, humidity and atmospheric pressure from a single
+ * measurement; this is cheaper than calling getTemperature(),
+ * getHumidity() and getPressure() one after the other.
+ *
+ * @param pTemperatureCX100 a pointer to a place to put the temperature
+ *                          reading (in units of 1/100th of a degree
+ *                          Celsius), may be NULL.
+ * @param pPercentage       a pointer to a place to put the humidity
+ *                          reading (as a percentage), may be NULL.
+ * @param pPascalX100       a pointer to a place to put the atmospheric
+ *                          pressure reading (in units of 100ths of a
+ *                          Pascal), may be NULL.
+ * @return                  zero on success or negative error code on
+ *                          failure.
+ */
+ActionDriver getTemperatureHumidityPressure(signed int *pTemperatureCX100,
+                                            unsigned char *pPercentage,
+                                            unsigned int *pPascalX100);
+
 #endif // _ACT_TEMPERATURE_HUMIDITY_PRESSURE_H_
 
 // End Of File
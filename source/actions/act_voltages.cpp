@@ -16,6 +16,8 @@
 
 #include <mbed.h>
 #include <eh_config.h>
+#include <eh_utilities.h> // For ARRAY_SIZE() and MTX_LOCK()/MTX_UNLOCK()
+#include <eh_heap.h>
 #include <act_voltages.h>
 
 /**************************************************************************
@@ -50,6 +52,18 @@
 // Set the voltage divider pin to its "not in use" state
 #define DISABLE_VOLTAGE_MEASUREMENT    DISCONNECT_PIN(PIN_ENABLE_VOLTAGE_DIVIDERS);
 
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+// A reading from the background voltage sampler.
+typedef struct {
+    int timeMs;
+    int vBatOkMV;
+    int vInMV;
+    int segment;
+} VoltageSample;
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
@@ -60,25 +74,216 @@ static bool gVoltageFakeIsGood = false;
 // Fake power is bad.
 static bool gVoltageFakeIsBad = false;
 
+// The analogue pins, in the order they are scanned.
+static const PinName gPins[] = {PIN_ANALOGUE_VBAT_OK,
+                                PIN_ANALOGUE_VIN,
+                                PIN_ANALOGUE_VPRIMARY};
+
+// The analogue inputs, kept for good rather than created for each
+// reading, in the same order as gPins.
+static AnalogIn gVBatOk(PIN_ANALOGUE_VBAT_OK);
+static AnalogIn gVIn(PIN_ANALOGUE_VIN);
+static AnalogIn gVPrimary(PIN_ANALOGUE_VPRIMARY);
+static AnalogIn * const gpAnalogIn[] = {&gVBatOk, &gVIn, &gVPrimary};
+
+// Mutex so that only one thread at a time drives the
+// voltage dividers.
+static Mutex gMtx;
+
+// The background voltage sampler thread.
+static Thread *gpSamplerThread = NULL;
+
+// Set while the background voltage sampler should run.
+static volatile bool gSamplerRunning = false;
+
+// Ticker that kicks the background voltage sampler.
+static Ticker gSamplerTicker;
+
+// Semaphore the ticker releases to kick the background
+// voltage sampler.
+static Semaphore gSamplerSemaphore(0);
+
+// Timer for the background voltage sampler readings.
+static Timer gSamplerTimer;
+
+// The most recent readings of the background voltage sampler
+// taken with no load on, the latest reading and the running
+// totals, only touched in a critical section.
+static VoltageSample gSamplerRing[VOLTAGE_SAMPLER_RING_SIZE];
+static unsigned int gSamplerNumIdleSamples = 0;
+static VoltageSample gSamplerLatest;
+static unsigned int gSamplerNumSamples = 0;
+static long long int gSamplerTotalVBatOkMV = 0;
+static long long int gSamplerTotalVInMV = 0;
+static int gSamplerMinVBatOkMV = 0;
+static int gSamplerMinVInMV = 0;
+
+// The number of loads on, see voltageSamplerLoad(), and the
+// number of the current run of readings with no load on,
+// only touched in a critical section.
+static int gSamplerNumLoads = 0;
+static int gSamplerSegment = 0;
+
 /**************************************************************************
  * STATIC FUNCTIONS
  *************************************************************************/
 
-// Go through the operations to read a pin.
-int getVoltage(PinName pin)
+// Get the analogue input for one of gPins.
+static AnalogIn *pAnalogIn(PinName pin)
 {
-    int reading;
-    AnalogIn *pV = new AnalogIn(pin);
+    AnalogIn *pV = NULL;
+
+    for (unsigned int x = 0; (pV == NULL) && (x < ARRAY_SIZE(gPins)); x++) {
+        if (gPins[x] == pin) {
+            pV = gpAnalogIn[x];
+        }
+    }
+    MBED_ASSERT(pV != NULL);
+
+    return pV;
+}
+
+// Go through the operations to read a set of pins (at most
+// ARRAY_SIZE(gPins) of them, each one of gPins), enabling the voltage dividers
+// once and averaging VOLTAGE_NUM_SAMPLES readings from each.
+static void getVoltagesMV(const PinName *pPins, int *pMV, int numPins)
+{
+    AnalogIn *pV[ARRAY_SIZE(gPins)];
+    unsigned int total[ARRAY_SIZE(gPins)];
+
+    MBED_ASSERT(numPins <= (int) ARRAY_SIZE(gPins));
+
+    MTX_LOCK(gMtx);
+
+    for (int x = 0; x < numPins; x++) {
+        pV[x] = pAnalogIn(*(pPins + x));
+        total[x] = 0;
+    }
 
     ENABLE_VOLTAGE_MEASUREMENT;
 
-    Thread::wait(10);
-    reading = pV->read_u16();
-    reading = READING_TO_MV(reading);
+    Thread::wait(VOLTAGE_SETTLING_TIME_MS);
+    // Scan the pins in turn, rather than taking all
+    // the readings of one and then the next, so that
+    // the voltages are all of the same moment
+    for (int y = 0; y < VOLTAGE_NUM_SAMPLES; y++) {
+        for (int x = 0; x < numPins; x++) {
+            total[x] += pV[x]->read_u16();
+        }
+    }
 
     DISABLE_VOLTAGE_MEASUREMENT;
-    delete pV;
-    DISCONNECT_PIN(pin);
+
+    for (int x = 0; x < numPins; x++) {
+        DISCONNECT_PIN(*(pPins + x));
+        *(pMV + x) = READING_TO_MV(total[x] / VOLTAGE_NUM_SAMPLES);
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Ticker callback for the background voltage sampler.
+static void samplerTick()
+{
+    gSamplerSemaphore.release();
+}
+
+// The background voltage sampler thread.
+static void samplerThread()
+{
+    VoltageSample sample;
+    int mV[2];
+    bool idle;
+
+    while (gSamplerRunning) {
+        gSamplerSemaphore.wait();
+        if (gSamplerRunning) {
+            core_util_critical_section_enter();
+            idle = (gSamplerNumLoads == 0);
+            sample.segment = gSamplerSegment;
+            core_util_critical_section_exit();
+            // VBAT_OK and VIN are the first two pins
+            getVoltagesMV(gPins, mV, ARRAY_SIZE(mV));
+            sample.timeMs = gSamplerTimer.read_ms();
+            sample.vBatOkMV = mV[0];
+            sample.vInMV = mV[1];
+
+            core_util_critical_section_enter();
+            // Only a reading with no load on for the whole of it
+            // is of use in working out the slope
+            if (idle && (gSamplerNumLoads == 0) && (sample.segment == gSamplerSegment)) {
+                gSamplerRing[gSamplerNumIdleSamples % ARRAY_SIZE(gSamplerRing)] = sample;
+                gSamplerNumIdleSamples++;
+            }
+            gSamplerLatest = sample;
+            if ((gSamplerNumSamples == 0) || (sample.vBatOkMV < gSamplerMinVBatOkMV)) {
+                gSamplerMinVBatOkMV = sample.vBatOkMV;
+            }
+            if ((gSamplerNumSamples == 0) || (sample.vInMV < gSamplerMinVInMV)) {
+                gSamplerMinVInMV = sample.vInMV;
+            }
+            gSamplerTotalVBatOkMV += sample.vBatOkMV;
+            gSamplerTotalVInMV += sample.vInMV;
+            gSamplerNumSamples++;
+            core_util_critical_section_exit();
+        }
+    }
+}
+
+// Work out the least-squares slope, in microVolts per second,
+// of one of the voltages in a set of readings; the slope is fitted
+// within each run of readings with no load on and the runs pooled,
+// so that a step in the voltage while a load was on does not count.
+// The number of readings that contributed is also returned.
+static int slopeUVPerSecond(const VoltageSample *pSamples, int numSamples,
+                            bool vBatOk, int *pNumUsed)
+{
+    long long int meanTimeMs;
+    long long int meanMV;
+    long long int numerator = 0;
+    long long int denominator = 0;
+    long long int t;
+    int numInRun;
+    int slope = 0;
+
+    *pNumUsed = 0;
+    for (int x = 0; x < numSamples; x += numInRun) {
+        meanTimeMs = 0;
+        meanMV = 0;
+        numInRun = 0;
+        while ((x + numInRun < numSamples) &&
+               ((pSamples + x + numInRun)->segment == (pSamples + x)->segment)) {
+            meanTimeMs += (pSamples + x + numInRun)->timeMs;
+            meanMV += vBatOk ? (pSamples + x + numInRun)->vBatOkMV : (pSamples + x + numInRun)->vInMV;
+            numInRun++;
+        }
+        if (numInRun > 1) {
+            meanTimeMs /= numInRun;
+            meanMV /= numInRun;
+            for (int y = x; y < x + numInRun; y++) {
+                t = (pSamples + y)->timeMs - meanTimeMs;
+                numerator += t * ((vBatOk ? (pSamples + y)->vBatOkMV : (pSamples + y)->vInMV) - meanMV);
+                denominator += t * t;
+            }
+            *pNumUsed += numInRun;
+        }
+    }
+    if (denominator > 0) {
+        // mV per ms is the same as 1000000 uV per second
+        slope = (int) (numerator * 1000000 / denominator);
+    } else {
+        *pNumUsed = 0;
+    }
+
+    return slope;
+}
+
+// Go through the operations to read a pin.
+int getVoltage(PinName pin)
+{
+    int reading;
+
+    getVoltagesMV(&pin, &reading, 1);
 
     return reading;
 }
@@ -87,6 +292,146 @@ int getVoltage(PinName pin)
  * PUBLIC FUNCTIONS
  *************************************************************************/
 
+// Start the background voltage sampler.
+bool voltageSamplerStart()
+{
+    if (gpSamplerThread == NULL) {
+        core_util_critical_section_enter();
+        gSamplerNumSamples = 0;
+        gSamplerNumIdleSamples = 0;
+        gSamplerNumLoads = 0;
+        gSamplerTotalVBatOkMV = 0;
+        gSamplerTotalVInMV = 0;
+        core_util_critical_section_exit();
+        while (gSamplerSemaphore.wait(0) > 0) {}
+        gSamplerTimer.reset();
+        gSamplerTimer.start();
+        gSamplerRunning = true;
+        gpSamplerThread = new Thread(osPriorityBelowNormal, VOLTAGE_SAMPLER_STACK_SIZE);
+        if (gpSamplerThread != NULL) {
+            heapCountAlloc(HEAP_SITE_THREAD, sizeof(Thread) + VOLTAGE_SAMPLER_STACK_SIZE);
+            if (gpSamplerThread->start(callback(samplerThread)) == osOK) {
+                // Take the first reading straight away
+                gSamplerSemaphore.release();
+                gSamplerTicker.attach_us(callback(samplerTick), VOLTAGE_SAMPLER_INTERVAL_MS * 1000);
+            } else {
+                heapCountFree(HEAP_SITE_THREAD, sizeof(Thread) + VOLTAGE_SAMPLER_STACK_SIZE);
+                delete gpSamplerThread;
+                gpSamplerThread = NULL;
+            }
+        }
+        if (gpSamplerThread == NULL) {
+            gSamplerRunning = false;
+            gSamplerTimer.stop();
+        }
+    }
+
+    return gpSamplerThread != NULL;
+}
+
+// Stop the background voltage sampler.
+void voltageSamplerStop()
+{
+    if (gpSamplerThread != NULL) {
+        gSamplerTicker.detach();
+        gSamplerRunning = false;
+        gSamplerSemaphore.release();
+        gpSamplerThread->join();
+        heapCountFree(HEAP_SITE_THREAD, sizeof(Thread) + VOLTAGE_SAMPLER_STACK_SIZE);
+        delete gpSamplerThread;
+        gpSamplerThread = NULL;
+        gSamplerTimer.stop();
+    }
+}
+
+// Note a load going on or off.
+void voltageSamplerLoad(bool on)
+{
+    core_util_critical_section_enter();
+    if (on) {
+        if (gSamplerNumLoads == 0) {
+            gSamplerSegment++;
+        }
+        gSamplerNumLoads++;
+    } else if (gSamplerNumLoads > 0) {
+        gSamplerNumLoads--;
+    }
+    core_util_critical_section_exit();
+}
+
+// Get the latest VBAT_OK reading of the running sampler.
+int voltageSamplerVBatOkMV()
+{
+    int vBatOkMV = -1;
+
+    core_util_critical_section_enter();
+    if (gSamplerRunning && (gSamplerNumSamples > 0)) {
+        vBatOkMV = gSamplerLatest.vBatOkMV;
+    }
+    core_util_critical_section_exit();
+
+    return vBatOkMV;
+}
+
+// Get the statistics from the background voltage sampler.
+void voltageSamplerGet(VoltageSamplerStatistics *pStatistics)
+{
+    VoltageSample samples[VOLTAGE_SAMPLER_RING_SIZE];
+    VoltageSample latest;
+    unsigned int numSamples;
+    unsigned int numIdleSamples;
+    int numRecent;
+    int numUsed;
+    long long int totalVBatOkMV;
+    long long int totalVInMV;
+    int minVBatOkMV;
+    int minVInMV;
+
+    // Take a copy of everything, then work it out at leisure
+    core_util_critical_section_enter();
+    numSamples = gSamplerNumSamples;
+    numIdleSamples = gSamplerNumIdleSamples;
+    latest = gSamplerLatest;
+    totalVBatOkMV = gSamplerTotalVBatOkMV;
+    totalVInMV = gSamplerTotalVInMV;
+    minVBatOkMV = gSamplerMinVBatOkMV;
+    minVInMV = gSamplerMinVInMV;
+    // Copy the recent readings with no load on out oldest first
+    numRecent = numIdleSamples;
+    if (numRecent > (int) ARRAY_SIZE(samples)) {
+        numRecent = ARRAY_SIZE(samples);
+    }
+    for (int x = 0; x < numRecent; x++) {
+        samples[x] = gSamplerRing[(numIdleSamples - numRecent + x) % ARRAY_SIZE(gSamplerRing)];
+    }
+    core_util_critical_section_exit();
+
+    memset(pStatistics, 0, sizeof(*pStatistics));
+    pStatistics->numSamples = numSamples;
+    if (numSamples > 0) {
+        pStatistics->vBatOk.meanMV = (int) (totalVBatOkMV / numSamples);
+        pStatistics->vBatOk.minMV = minVBatOkMV;
+        pStatistics->vBatOk.latestMV = latest.vBatOkMV;
+        pStatistics->vBatOk.slopeUVPerSecond = slopeUVPerSecond(samples, numRecent, true, &numUsed);
+        pStatistics->numSlopeSamples = numUsed;
+        pStatistics->vIn.meanMV = (int) (totalVInMV / numSamples);
+        pStatistics->vIn.minMV = minVInMV;
+        pStatistics->vIn.latestMV = latest.vInMV;
+        pStatistics->vIn.slopeUVPerSecond = slopeUVPerSecond(samples, numRecent, false, &numUsed);
+    }
+}
+
+// Get VBAT_OK, VIN and VPRIMARY in one go.
+void getVoltages(Voltages *pVoltages)
+{
+    int mV[ARRAY_SIZE(gPins)];
+
+    getVoltagesMV(gPins, mV, ARRAY_SIZE(mV));
+    pVoltages->vBatOkMV = mV[0];
+    pVoltages->vInMV = mV[1];
+    pVoltages->vPrimaryMV = mV[2];
+}
+
 // Get the value of VBAT_OK.
 int getVBatOkMV()
 {
@@ -155,43 +500,56 @@ unsigned long long int getEnergyAvailableNWH()
     return energyNWH;
 }
 
-// Check if VBAT_SEC is good enough to run everything from
-bool voltageIsGood()
+// Work out the energy drawn from the supercap.
+unsigned long long int getEnergyDrawnNWH(int vBatOkBeforeMV, int vBatOkAfterMV)
 {
-    bool vBatOk = false;
+    unsigned long long int energyNWH = 0;
 
-    // Check against the upper threshold for VBAT_OK.
-    if (getVBatOkMV() >= VBAT_OK_GOOD_THRESHOLD_MV) {
-        vBatOk = true;
+    // Same sums as getEnergyAvailableNWH(), just with
+    // different voltages
+    if ((vBatOkAfterMV > 0) && (vBatOkBeforeMV > vBatOkAfterMV)) {
+        energyNWH = SUPERCAP_MICROFARADS / 2 *
+                    (((unsigned long long int) vBatOkBeforeMV * vBatOkBeforeMV) -
+                     ((unsigned long long int) vBatOkAfterMV * vBatOkAfterMV)) / 1000 / 3600;
     }
 
-    return (vBatOk || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
+    return energyNWH;
 }
 
-// Check if VBAT_SEC is good enough to run something from
-bool voltageIsBearable()
+// Check if a VBAT_OK reading is good enough to run everything from.
+bool voltageIsGoodMV(int vBatOkMV)
 {
-    bool vBatOk = false;
+    return ((vBatOkMV >= VBAT_OK_GOOD_THRESHOLD_MV) || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
+}
 
-    // Check against the mid threshold for VBAT_OK.
-    if (getVBatOkMV() >= VBAT_OK_BEARABLE_THRESHOLD_MV) {
-        vBatOk = true;
-    }
+// Check if a VBAT_OK reading is good enough to run something from.
+bool voltageIsBearableMV(int vBatOkMV)
+{
+    return ((vBatOkMV >= VBAT_OK_BEARABLE_THRESHOLD_MV) || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
+}
 
-    return (vBatOk || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
+// Check if a VBAT_OK reading is STILL good enough to run something from.
+bool voltageIsNotBadMV(int vBatOkMV)
+{
+    return ((vBatOkMV >= VBAT_OK_BAD_THRESHOLD_MV) || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
 }
 
-// Check if VBAT_SEC is STILL good enough to run something from
-bool voltageIsNotBad()
+// Check if VBAT_SEC is good enough to run everything from
+bool voltageIsGood()
 {
-    bool vBatNotBad = false;
+    return voltageIsGoodMV(getVBatOkMV());
+}
 
-    // Check against the lower threshold for VBAT_OK.
-    if (getVBatOkMV() >= VBAT_OK_BAD_THRESHOLD_MV) {
-        vBatNotBad = true;
-    }
+// Check if VBAT_SEC is good enough to run something from
+bool voltageIsBearable()
+{
+    return voltageIsBearableMV(getVBatOkMV());
+}
 
-    return (vBatNotBad || gVoltageFakeIsGood) && !gVoltageFakeIsBad;
+// Check if VBAT_SEC is STILL good enough to run something from
+bool voltageIsNotBad()
+{
+    return voltageIsNotBadMV(getVBatOkMV());
 }
 
 // Fake power being good.
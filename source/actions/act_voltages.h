@@ -38,10 +38,120 @@
  */
 #define SECONDARY_BATTERY_CAPACITY_NWH 300000000ULL
 
+/** The number of readings of each voltage that are averaged.
+ */
+#define VOLTAGE_NUM_SAMPLES 8
+
+/** The time for the voltage dividers to settle once enabled.
+ */
+#define VOLTAGE_SETTLING_TIME_MS 10
+
+/** The interval at which the background voltage sampler takes
+ * readings of VBAT_OK and VIN.
+ */
+#define VOLTAGE_SAMPLER_INTERVAL_MS 500
+
+/** The number of the most recent readings taken with no load on
+ * that the background voltage sampler keeps for working out the
+ * slope.
+ */
+#define VOLTAGE_SAMPLER_RING_SIZE 16
+
+/** The stack size of the background voltage sampler thread.
+ */
+#define VOLTAGE_SAMPLER_STACK_SIZE 1024
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A snapshot of the supply voltages, all taken with the voltage
+ * dividers enabled just the once.
+ */
+typedef struct {
+    int vBatOkMV;   //!< VBAT_OK in milliVolts.
+    int vInMV;      //!< VIN in milliVolts.
+    int vPrimaryMV; //!< VPRIMARY in milliVolts.
+} Voltages;
+
+/** Statistics for one voltage from the background voltage sampler.
+ */
+typedef struct {
+    int meanMV;            //!< The mean of all readings.
+    int minMV;             //!< The lowest reading.
+    int latestMV;          //!< The most recent reading.
+    int slopeUVPerSecond;  //!< The rate of change over the recent readings
+                           //!< taken with no load on.
+} VoltageStatistics;
+
+/** The statistics from the background voltage sampler.
+ */
+typedef struct {
+    unsigned int numSamples;      //!< The number of readings taken.
+    unsigned int numSlopeSamples; //!< The number of readings the slopes
+                                  //!< are worked out from, zero if
+                                  //!< there is no slope.
+    VoltageStatistics vBatOk;     //!< Statistics for VBAT_OK.
+    VoltageStatistics vIn;        //!< Statistics for VIN.
+} VoltageSamplerStatistics;
+
 /**************************************************************************
  * FUNCTIONS
  *************************************************************************/
 
+/** Get VBAT_OK, VIN and VPRIMARY together: the voltage dividers
+ * are enabled and allowed to settle once, then the three inputs
+ * are scanned in turn VOLTAGE_NUM_SAMPLES times and the readings
+ * for each averaged.  This takes little longer than reading any
+ * one of them with getVBatOkMV(), getVInMV() or getVPrimaryMV().
+ *
+ * @param pVoltages a place to put the voltages.
+ */
+void getVoltages(Voltages *pVoltages);
+
+/** Start the background voltage sampler: a timer kicks a low
+ * priority thread to read VBAT_OK and VIN every
+ * VOLTAGE_SAMPLER_INTERVAL_MS, so that the statistics of
+ * the supply while actions are running are available from
+ * voltageSamplerGet() without the caller having to poll.
+ * Any statistics from a previous run are reset.
+ *
+ * @return true if the sampler is running, else false.
+ */
+bool voltageSamplerStart();
+
+/** Stop the background voltage sampler; the statistics
+ * remain available from voltageSamplerGet().
+ */
+void voltageSamplerStop();
+
+/** Note a load that draws enough to swamp the rate of change of
+ * VBAT_OK, e.g. a radio, going on or off; loads may overlap.
+ * Readings taken while any load is on are left out of the slopes
+ * and the slopes are worked out only within the runs of readings
+ * between loads, so that the slope of VBAT_OK is the rate at which
+ * the supercap is charging with only the processor running.
+ *
+ * @param on true if a load is going on, false if it is going off.
+ */
+void voltageSamplerLoad(bool on);
+
+/** Get the latest reading of VBAT_OK taken by the background
+ * voltage sampler, without waiting for the voltage dividers to
+ * settle as getVBatOkMV() does.
+ *
+ * @return VBAT_OK in milliVolts, -1 if the sampler is not running
+ *         or has yet to take a reading.
+ */
+int voltageSamplerVBatOkMV();
+
+/** Get the statistics from the background voltage sampler.  May
+ * be called while the sampler is running.
+ *
+ * @param pStatistics a place to put the statistics.
+ */
+void voltageSamplerGet(VoltageSamplerStatistics *pStatistics);
+
 /** Get the value of VBAT_OK.
  *
  * @return VBAT_OK in milliVolts.
@@ -94,6 +204,18 @@ int getVPrimaryMV();
  */
 unsigned long long int getEnergyAvailableNWH();
 
+/** Work out the energy drawn from the supercap given the value
+ * of VBAT_OK before and after some activity.  Note that this
+ * takes no account of energy harvested, or drawn from the
+ * secondary cell, in the meantime.
+ *
+ * @param vBatOkBeforeMV VBAT_OK before the activity in milliVolts.
+ * @param vBatOkAfterMV  VBAT_OK after the activity in milliVolts.
+ * @return               the energy drawn in NWH, zero if VBAT_OK
+ *                       did not fall.
+ */
+unsigned long long int getEnergyDrawnNWH(int vBatOkBeforeMV, int vBatOkAfterMV);
+
 /** Check if VBAT_OK indicates that the secondary battery is charged enough to
  * run everything from.
  *
@@ -118,6 +240,34 @@ bool voltageIsBearable();
  */
 bool voltageIsNotBad();
 
+/** As voltageIsGood() but for a reading of VBAT_OK that has already
+ * been taken, e.g. by getVoltages() or the background voltage sampler,
+ * rather than measuring it again.
+ *
+ * @param vBatOkMV VBAT_OK in milliVolts.
+ * @return         true if the secondary battery is charged enough to
+ *                 run everything, else false.
+ */
+bool voltageIsGoodMV(int vBatOkMV);
+
+/** As voltageIsBearable() but for a reading of VBAT_OK that has already
+ * been taken.
+ *
+ * @param vBatOkMV VBAT_OK in milliVolts.
+ * @return         true if the secondary battery has enough charge to
+ *                 run something, else false.
+ */
+bool voltageIsBearableMV(int vBatOkMV);
+
+/** As voltageIsNotBad() but for a reading of VBAT_OK that has already
+ * been taken.
+ *
+ * @param vBatOkMV VBAT_OK in milliVolts.
+ * @return         true if the secondary battery still has enough charge
+ *                 to run something, else false.
+ */
+bool voltageIsNotBadMV(int vBatOkMV);
+
 /** Fake power being good; required during unit testing.
  *
  * @param if true powerIsGood() is faked to true, else it is not.
@@ -15,9 +15,13 @@
  */
 
 #include <mbed.h>
+#include <stddef.h> // For offsetof()
 #include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK()
 #include <eh_i2c.h>
+#include <eh_config.h>
 #include <gnss.h> // For GnssParser
+#include <eh_ubx.h>
+#include <eh_clock.h> // For clockPredictedErrorSeconds()
 #include <act_position.h>
 #include <act_zoem8.h>
 
@@ -25,13 +29,61 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
-/** The default message buffer size when getting a position fix.
+/** The size of the buffer used to build messages to send to the
+ * GNSS chip: big enough for the 20 byte CFG-PRT message.
  */
-#define DEFAULT_BUFFER_SIZE 256
+#define TX_BUFFER_SIZE 20
 
-/** The offset at the start of a UBX protocol message.
+/** Used in place of a UBX class or message id to match any.
  */
-#define UBX_PROTOCOL_HEADER_SIZE 6
+#define UBX_ANY 0xFF
+
+/** How often to check for data from the GNSS chip while waiting
+ * for a message if there is no TX-ready line to tell us.
+ */
+#define ZOEM8_STREAM_CHECK_INTERVAL_MS 500
+
+/** How long to wait for the TX-ready line before checking for data
+ * from the GNSS chip anyway, a little longer than the navigation
+ * period so that an edge missed for any reason doesn't stall us.
+ */
+#define ZOEM8_TX_READY_WAIT_MS 1500
+
+/** The number of bytes the GNSS chip must have queued before it
+ * raises TX-ready: just short of a NAV-PVT message (which is 100
+ * bytes including the UBX protocol overhead).
+ */
+#define ZOEM8_TX_READY_THRESHOLD_BYTES 96
+
+/** Marker to show that the retained GNSS assistance data is valid.
+ */
+#define ZOEM8_RETAINED_MAGIC 0x5A4F4531
+
+/** How long to wait for the response to a UBX-UPD-SOS command.
+ */
+#define ZOEM8_SOS_WAIT_TIME_MS 1000
+
+/** The earliest (Unix) UTC time that is taken to mean that the RTC
+ * has been set and so is worth passing to the GNSS chip as a hint
+ * (1st Jan 2018).
+ */
+#define ZOEM8_ASSIST_MIN_TIME_UTC 1514764800
+
+/** The accuracy to claim for the RTC when passing it to the GNSS
+ * chip as a hint, if clockPredictedErrorSeconds() can't say.
+ */
+#define ZOEM8_ASSIST_TIME_ACCURACY_SECONDS 10
+
+/** The uncertainty to add to the radius of the last fix when passing
+ * it to the GNSS chip as a hint, allowing for movement that was too
+ * gentle to trip the accelerometer.
+ */
+#define ZOEM8_ASSIST_POSITION_MARGIN_METRES 500
+
+/** The uncertainty to add to the last fix when passing it to the
+ * GNSS chip as a hint if we know that the device has moved.
+ */
+#define ZOEM8_ASSIST_POSITION_MOVED_METRES 50000
 
 /**************************************************************************
  * TYPES
@@ -45,9 +97,8 @@ public:
     /** Constructor.
      *
      * @param i2cAddress the I2C address of the GNSS chip.
-     * @param rxSize     the length of RX buffer to use.
      */
-    XGnssParser(char i2cAddress, int rxSize = DEFAULT_BUFFER_SIZE);
+    XGnssParser(char i2cAddress);
 
     /** Destructor.
      */
@@ -57,11 +108,12 @@ public:
      */
     virtual bool init(PinName pn = NC);
 
-    /** Get a message from the GNSS chip.
+    /** Get a message from the GNSS chip, copying it out: only
+     * here to complete GnssParser, use waitUbx() instead.
      *
      * @param pBuf to put the message into.
      * @param len  the length of pBuf.
-     * @return     the number of bytes retrieved.
+     * @return     the protocol and the number of bytes retrieved.
      */
     virtual int getMessage(char *pBuf, int len);
 
@@ -92,6 +144,26 @@ public:
      */
     bool checkUbxAck(unsigned char cls, unsigned char id);
 
+    /** Wait for a UBX message to arrive from the GNSS chip,
+     * sleeping while it has nothing to send and discarding any
+     * other messages.
+     *
+     * @param cls                the UBX class id, UBX_ANY for any.
+     * @param id                 the UBX message id, UBX_ANY for any.
+     * @param pFrame             a place to put a view of the message,
+     *                           valid until this is next called.
+     * @param timeoutMs          how long to wait.
+     * @param pKeepGoingCallback a function to call back which will
+     *                           return true if it's OK to keep going,
+     *                           else false; may be NULL.
+     * @param pCallbackParam     a parameter to pass to
+     *                           pKeepGoingCallback() when it is called.
+     * @return                   true if the message arrived.
+     */
+    bool waitUbx(unsigned char cls, unsigned char id, UbxFrame *pFrame,
+                 int timeoutMs, bool (*pKeepGoingCallback)(void *) = NULL,
+                 void *pCallbackParam = NULL);
+
 protected:
     /** Flag so that we know if we've been initialised.
      */
@@ -101,10 +173,6 @@ protected:
      */
     char _i2cAddress;
 
-    /** The receive pipe.
-     */
-    Pipe<char> _pipe;
-
     /** Write bytes to the chip.
      *
      * @param pBuf the buffer of bytes to write.
@@ -113,14 +181,30 @@ protected:
      */
     virtual int _send(const void *pBuf, int len);
 
-    /** Read bytes from the chip.
-     * @param pBuf the buffer to read into.
-     * @param len  size of the read buffer .
-     * @return     bytes read.
+    /** Move whatever the GNSS chip has queued straight into
+     * the ring buffer of the UBX parser, without waiting.
+     *
+     * @return the number of bytes moved.
      */
-    int _get(char *pBuf, int len);
+    int _fill();
 };
 
+/** State retained across a reset (and across the GNSS chip being
+ * switched off) that allows the next start to be a hot one.
+ */
+typedef struct {
+    unsigned int magic;
+    bool sosNotSupported;
+    bool backupSaved;
+    bool positionValid;
+    bool moved;
+    int latitudeX10e7;
+    int longitudeX10e7;
+    int altitudeMetres;
+    int radiusMetres;
+    unsigned int checksum;
+} Zoem8Retained;
+
 
 /**************************************************************************
  * LOCAL VARIABLES
@@ -134,25 +218,39 @@ static XGnssParser *gpGnssParser = NULL;
  */
 static Mutex gMtx;
 
-/** A general purpose buffer, used to receive
- * a position fix from the GNSS module.
+/** A buffer used to build messages to send to the GNSS module.
  */
-static char gMsgBuffer[DEFAULT_BUFFER_SIZE];
+static char gMsgBuffer[TX_BUFFER_SIZE];
 
-/** A buffer for _pipe to use.
+/** The parser for what is received from the GNSS module.
  */
-static char gPipeBuffer[DEFAULT_BUFFER_SIZE];
+static UbxParser gUbxParser;
+
+/** The GNSS assistance state, in an uninitialised RAM area so
+ * that it survives a reset.
+ */
+static Zoem8Retained gRetained NOINIT;
+
+#ifdef PIN_GNSS_TX_READY
+/** The TX-ready line from the GNSS chip.
+ */
+static InterruptIn gTxReady(PIN_GNSS_TX_READY);
+
+/** Semaphore released when the GNSS chip has data for us.
+ */
+static Semaphore gTxReadySemaphore(0);
+#endif
 
 /**************************************************************************
  * CLASSES
  *************************************************************************/
 
 // Constructor.
-XGnssParser::XGnssParser(char i2cAddress, int rxSize) :
-        _pipe(sizeof(gPipeBuffer), gPipeBuffer)
+XGnssParser::XGnssParser(char i2cAddress)
 {
     _i2cAddress = i2cAddress;
     _initialised = false;
+    ubxParserInit(&gUbxParser);
 }
 
 // Destructor
@@ -184,6 +282,13 @@ bool XGnssParser::init(PinName pn)
             // to save bandwidth (see section 32.11.23.5 of the u-blox
             // M8 receiver manual)
             memset(gMsgBuffer, 0, 20);
+#ifdef PIN_GNSS_TX_READY
+            // Raise TX-ready (active high) on the wired-up PIO once
+            // there's most of a NAV-PVT message waiting for us
+            gMsgBuffer[2] = (char) (0x01 | (GNSS_TX_READY_PIO << 2) |
+                                    ((ZOEM8_TX_READY_THRESHOLD_BYTES / 8) << 7));
+            gMsgBuffer[3] = (char) ((ZOEM8_TX_READY_THRESHOLD_BYTES / 8) >> 1);
+#endif
             gMsgBuffer[4] = _i2cAddress << 1; // The I2C address
             gMsgBuffer[12] = 0x01; // UBX protocol only
             gMsgBuffer[14] = 0x01; // UBX protocol only
@@ -196,6 +301,23 @@ bool XGnssParser::init(PinName pn)
             }
             x++;
         }
+
+        if (gotAck) {
+            gotAck = false;
+            x = 0;
+            while (!gotAck && (x < 3)) {
+                // Have NAV-PVT sent on this port with every navigation
+                // solution so that we don't have to poll for it (see
+                // section 32.10.18.3 of the u-blox M8 receiver manual)
+                gMsgBuffer[0] = 0x01; // NAV
+                gMsgBuffer[1] = 0x07; // PVT
+                gMsgBuffer[2] = 0x01; // Every solution
+                if (sendUbx(0x06, 0x01, gMsgBuffer, 3) > 0) {
+                    gotAck = checkUbxAck(0x06, 0x01);
+                }
+                x++;
+            }
+        }
         _initialised = gotAck;
     }
 
@@ -205,21 +327,19 @@ bool XGnssParser::init(PinName pn)
 // Get a message from the GNSS chip.
 int XGnssParser::getMessage(char *pBuf, int len)
 {
-    int sz;
     int returnValue = NOT_FOUND;
-
-    if (_initialised) {
-        // Fill the pipe
-        sz = _pipe.free();
-        if (sz) {
-            sz = _get(pBuf, sz);
-        }
-        if (sz) {
-            _pipe.put(pBuf, sz);
+    UbxFrame frame;
+    int length;
+
+    if (waitUbx(UBX_ANY, UBX_ANY, &frame, ZOEM8_GET_WAIT_TIME_MS)) {
+        length = frame.length + UBX_OVERHEAD_SIZE;
+        if (length <= len) {
+            // Copy the whole frame out, header and checksum included
+            for (int x = 0; x < length; x++) {
+                *(pBuf + x) = frame.pRing[(frame.payloadIndex - UBX_HEADER_SIZE + x) & (UBX_RING_SIZE - 1)];
+            }
+            returnValue = UBX | length;
         }
-
-        // Now parse it
-        returnValue = _getMessage(&_pipe, pBuf, sz);
     }
 
     return returnValue;
@@ -262,55 +382,78 @@ int XGnssParser::sendUbx(unsigned char cls, unsigned char id, const void *pBuf,
 // Check an ack.
 bool XGnssParser::checkUbxAck(unsigned char cls, unsigned char id)
 {
-    bool success = false;
-    int returnCode;
-
-    returnCode = getMessage(gMsgBuffer, sizeof(gMsgBuffer));
-    if (PROTOCOL(returnCode) == GnssParser::UBX) {
-        returnCode = LENGTH(returnCode);
-        // The ack is 10 bytes long and contains the message
-        // class and message ID of the original message,
-        // see section 32.9 of the u-blox M8 receiver manual
-        // Ack is  0xb5-62-05-00-02-00-cls-id-crcA-crcB
-        // Nack is 0xb5-62-05-01-02-00-cls-id-crcA-crcB
-        if ((returnCode == 10) && (gMsgBuffer[3] == 0x01) &&
-            (gMsgBuffer[4] == 0x02) && (gMsgBuffer[5] == 0x00) &&
-            (gMsgBuffer[6] == cls) && (gMsgBuffer[7] == id) && (gMsgBuffer[2] == 0x05)) {
-            success = true;
-        }
+    int ack = -1;
+    UbxFrame frame;
+
+    // Skip anything that isn't the ACK-ACK or ACK-NAK for our message
+    while ((ack < 0) && waitUbx(0x05, UBX_ANY, &frame, ZOEM8_GET_WAIT_TIME_MS)) {
+        ack = ubxAck(&frame, cls, id);
     }
 
-    return success;
+    return (ack == 1);
 }
 
-// Fetch up to len characters into pBuf
-int XGnssParser::_get(char *pBuf, int len)
+// Wait for a UBX message.
+bool XGnssParser::waitUbx(unsigned char cls, unsigned char id, UbxFrame *pFrame,
+                          int timeoutMs, bool (*pKeepGoingCallback)(void *),
+                          void *pCallbackParam)
 {
-    int read = 0;
-    int size = 0;
-    char data[3];
+    bool found = false;
     Timer timer;
 
     if (_initialised) {
         timer.reset();
         timer.start();
+        do {
+            _fill();
+            while (!found && ubxParserNext(&gUbxParser, pFrame)) {
+                found = ((cls == UBX_ANY) || (pFrame->cls == cls)) &&
+                        ((id == UBX_ANY) || (pFrame->id == id));
+            }
+            if (!found && (timer.read_ms() < timeoutMs)) {
+                // Sleep until there's something more to read
+#ifdef PIN_GNSS_TX_READY
+                gTxReadySemaphore.wait(ZOEM8_TX_READY_WAIT_MS);
+#else
+                Thread::wait(ZOEM8_STREAM_CHECK_INTERVAL_MS);
+#endif
+            }
+        } while (!found && (timer.read_ms() < timeoutMs) &&
+                 ((pKeepGoingCallback == NULL) || pKeepGoingCallback(pCallbackParam)));
+        timer.stop();
+    }
+
+    return found;
+}
+
+// Move whatever the GNSS chip has queued into the UBX parser.
+int XGnssParser::_fill()
+{
+    int read = 0;
+    unsigned int size;
+    unsigned int available;
+    char *pSpace;
+    char data[3];
+
+    if (_initialised) {
+        pSpace = ubxParserSpace(&gUbxParser, &size);
         data[0] = 0xFD; // REGLEN
-        while ((size == 0) && (timer.read_ms() < ZOEM8_GET_WAIT_TIME_MS)) {
-            if (i2cSendReceive(_i2cAddress, data, 1, &(data[1]), 2) == 2) {
-                size = (((unsigned int) data[1]) << 8) + data[2];
-                if (size > len) {
-                    size = len;
-                }
-                if (size > 0) {
-                    data[0] = 0xFF; // REGSTREAM
-                    if (i2cSendReceive(_i2cAddress, data, 1, pBuf, size) == size) {
-                        read = size;
-                    }
+        if ((size > 0) && (i2cSendReceive(_i2cAddress, data, 1, &(data[1]), 2) == 2)) {
+            available = (((unsigned int) data[1]) << 8) + data[2];
+            if (available < size) {
+                size = available;
+            }
+            if (size > 0) {
+                // Read straight into the parser's ring buffer; if the
+                // space stops at the end of the ring the rest will be
+                // read next time
+                data[0] = 0xFF; // REGSTREAM
+                if (i2cSendReceive(_i2cAddress, data, 1, pSpace, size) == (int) size) {
+                    ubxParserCommit(&gUbxParser, size);
+                    read = size;
                 }
             }
-            Thread::wait(100); // Relax a little
         }
-        timer.stop();
     }
 
     return read;
@@ -332,18 +475,192 @@ int XGnssParser::_send(const void *pBuf, int len)
  * STATIC FUNCTIONS
  *************************************************************************/
 
-/// Return an unsigned int from a pointer to a little-endian unsigned int
-// in memory.
-static unsigned int littleEndianUint(char *pByte)
+// Write a little-endian unsigned int to memory.
+static void littleEndianUintWrite(char *pByte, unsigned int value)
+{
+    *pByte = (char) value;
+    *(pByte + 1) = (char) (value >> 8);
+    *(pByte + 2) = (char) (value >> 16);
+    *(pByte + 3) = (char) (value >> 24);
+}
+
+// Make sure that the retained GNSS assistance state is valid,
+// starting again if it is not.
+static void retainedCheck()
+{
+    if ((gRetained.magic != ZOEM8_RETAINED_MAGIC) ||
+        (gRetained.checksum != utilitiesChecksum(&gRetained, offsetof(Zoem8Retained, checksum)))) {
+        memset(&gRetained, 0, sizeof(gRetained));
+        gRetained.magic = ZOEM8_RETAINED_MAGIC;
+        gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(Zoem8Retained, checksum));
+    }
+}
+
+// Update the checksum of the retained GNSS assistance state
+// after it has been changed.
+static void retainedUpdate()
+{
+    gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(Zoem8Retained, checksum));
+}
+
+#ifdef PIN_GNSS_TX_READY
+// Interrupt from the TX-ready line.
+static void txReadyInterrupt()
+{
+    gTxReadySemaphore.release();
+}
+#endif
+
+// Decode a NAV-PVT message, keeping any fix as a hint for the
+// next start.
+static ActionDriver navPvtDecode(const UbxFrame *pFrame,
+                                 int *pLatitudeX10e7, int *pLongitudeX10e7,
+                                 int *pRadiusMetres, int *pAltitudeMetres,
+                                 unsigned char *pSpeedMPS, unsigned char *pSVs)
+{
+    ActionDriver result = ACTION_DRIVER_ERROR_NO_VALID_DATA;
+
+    // See ublox8-M8_ReceiverDescrProtSpec, section 32.18.14 (NAV-PVT)
+    if (ubxIsNavPvt(pFrame) && ubxNavPvtFixOk(pFrame)) {
+        result = ACTION_DRIVER_OK;
+        // Keep the fix as a hint for the next start
+        retainedCheck();
+        gRetained.positionValid = true;
+        gRetained.moved = false;
+        gRetained.longitudeX10e7 = ubxNavPvtLongitudeX10e7(pFrame);
+        gRetained.latitudeX10e7 = ubxNavPvtLatitudeX10e7(pFrame);
+        gRetained.altitudeMetres = ubxNavPvtAltitudeMM(pFrame) / 1000;
+        gRetained.radiusMetres = ubxNavPvtRadiusMM(pFrame) / 1000;
+        retainedUpdate();
+        if (pSVs != NULL) {
+            *pSVs = ubxNavPvtSVs(pFrame);
+        }
+        if (pLongitudeX10e7 != NULL) {
+            *pLongitudeX10e7 = gRetained.longitudeX10e7;
+        }
+        if (pLatitudeX10e7 != NULL) {
+            *pLatitudeX10e7 = gRetained.latitudeX10e7;
+        }
+        if (pAltitudeMetres != NULL) {
+            *pAltitudeMetres = gRetained.altitudeMetres;
+        }
+        if (pRadiusMetres != NULL) {
+            *pRadiusMetres = gRetained.radiusMetres;
+        }
+        if (pSpeedMPS != NULL) {
+            *pSpeedMPS = ubxNavPvtSpeedMMPS(pFrame) / 1000;
+        }
+    }
+
+    return result;
+}
+
+// Wait for the UBX-UPD-SOS response carrying the given command
+// (2 for a backup being created, 3 for a restore), returning the
+// response byte or negative if there was none.  If the GNSS chip
+// doesn't support save-on-shutdown it will NACK the message instead,
+// in which case *pNacked (if not NULL) is set to true.
+static int getSosResponse(unsigned char cmd, bool *pNacked)
 {
-    unsigned int retValue;
+    int response = -1;
+    UbxFrame frame;
+
+    while ((response < 0) &&
+           gpGnssParser->waitUbx(UBX_ANY, UBX_ANY, &frame, ZOEM8_SOS_WAIT_TIME_MS)) {
+        if ((frame.cls == 0x09) && (frame.id == 0x14) &&
+            (frame.length == 8) && (ubxU1(&frame, 0) == cmd)) {
+            response = ubxU1(&frame, 4);
+        } else if (ubxAck(&frame, 0x09, 0x14) == 0) {
+            response = 0;
+            if (pNacked != NULL) {
+                *pNacked = true;
+            }
+        }
+    }
+
+    return response;
+}
+
+// Find out how the GNSS chip got on restoring any backup we asked
+// it to make, then give it whatever hints we have as to time and
+// position so that it can get a fix more quickly.
+static void assistStart()
+{
+    char payload[ZOEM8_MGA_INI_TIME_UTC_LENGTH];
+    time_t timeUTC;
+    unsigned int accuracyMetres;
+    int timeAccuracySeconds;
+
+    retainedCheck();
+
+    if (gRetained.backupSaved) {
+        // See ublox8-M8_ReceiverDescrProtSpec, section 32.20.1 (UPD-SOS):
+        // poll the restore status, 2 meaning that the backup was restored
+        if (gpGnssParser->sendUbx(0x09, 0x14, NULL, 0) > 0) {
+            getSosResponse(3, NULL);
+        }
+        // The backup is only good for a single restore
+        gRetained.backupSaved = false;
+        retainedUpdate();
+    }
+
+    // Time first, then position, see section 13.5.1 of the u-blox
+    // M8 receiver manual (MGA-INI)
+    timeUTC = time(NULL);
+    if (timeUTC > ZOEM8_ASSIST_MIN_TIME_UTC) {
+        // Claim the error the clock's drift predicts, if it
+        // can be predicted, limited to what the field holds
+        timeAccuracySeconds = clockPredictedErrorSeconds();
+        if (timeAccuracySeconds < 0) {
+            timeAccuracySeconds = ZOEM8_ASSIST_TIME_ACCURACY_SECONDS;
+        }
+        if (timeAccuracySeconds > 0xffff) {
+            timeAccuracySeconds = 0xffff;
+        }
+        gpGnssParser->sendUbx(0x13, 0x40, payload,
+                              zoem8MgaIniTimeUtc(payload, timeUTC,
+                                                 timeAccuracySeconds));
+    }
 
-    retValue = *pByte;
-    retValue += ((unsigned int) *(pByte + 1)) << 8;
-    retValue += ((unsigned int) *(pByte + 2)) << 16;
-    retValue += ((unsigned int) *(pByte + 3)) << 24;
+    if (gRetained.positionValid) {
+        accuracyMetres = gRetained.radiusMetres + ZOEM8_ASSIST_POSITION_MARGIN_METRES;
+        if (gRetained.moved) {
+            accuracyMetres += ZOEM8_ASSIST_POSITION_MOVED_METRES;
+        }
+        gpGnssParser->sendUbx(0x13, 0x40, payload,
+                              zoem8MgaIniPosLlh(payload, gRetained.latitudeX10e7,
+                                                gRetained.longitudeX10e7,
+                                                gRetained.altitudeMetres,
+                                                accuracyMetres));
+    }
+}
 
-    return  retValue;
+// Ask the GNSS chip to save its state (ephemeris, almanac, last
+// position, etc.) before it is switched off so that the next start
+// can be a hot one.  If the chip NACKs the request it has nowhere
+// to save its state (e.g. it has no flash) so remember that and
+// don't ask again; if there is simply no answer, ask again next time.
+static void assistStop()
+{
+    char payload[4];
+    int response;
+    bool nacked = false;
+
+    retainedCheck();
+
+    if (!gRetained.sosNotSupported) {
+        // See ublox8-M8_ReceiverDescrProtSpec, section 32.20.1 (UPD-SOS):
+        // command 0 is create backup, the response is command 2
+        // carrying 1 if the backup was created
+        memset(payload, 0, sizeof(payload));
+        response = -1;
+        if (gpGnssParser->sendUbx(0x09, 0x14, payload, sizeof(payload)) > 0) {
+            response = getSosResponse(2, &nacked);
+        }
+        gRetained.backupSaved = (response == 1);
+        gRetained.sosNotSupported = nacked;
+        retainedUpdate();
+    }
 }
 
 /**************************************************************************
@@ -364,7 +681,12 @@ ActionDriver zoem8Init(char i2cAddress)
     if (gpGnssParser == NULL) {
         gpGnssParser = new XGnssParser(i2cAddress);
         if (gpGnssParser != NULL) {
-            if (!gpGnssParser->init()) {
+            if (gpGnssParser->init()) {
+#ifdef PIN_GNSS_TX_READY
+                gTxReady.rise(&txReadyInterrupt);
+#endif
+                assistStart();
+            } else {
                 result = ACTION_DRIVER_ERROR_DEVICE_NOT_PRESENT;
                 delete gpGnssParser;
                 gpGnssParser = NULL;
@@ -385,6 +707,10 @@ void zoem8Deinit()
     MTX_LOCK(gMtx);
 
     if (gpGnssParser != NULL) {
+        assistStop();
+#ifdef PIN_GNSS_TX_READY
+        gTxReady.rise(NULL);
+#endif
         delete gpGnssParser;
         gpGnssParser = NULL;
     }
@@ -392,53 +718,118 @@ void zoem8Deinit()
     MTX_UNLOCK(gMtx);
 }
 
+// Note that the device has moved since the last fix.
+void zoem8PositionMoved()
+{
+    MTX_LOCK(gMtx);
+
+    retainedCheck();
+    gRetained.moved = true;
+    retainedUpdate();
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Write the payload of a UBX-MGA-INI-TIME_UTC message.
+int zoem8MgaIniTimeUtc(char *pBuf, time_t timeUTC,
+                       unsigned int accuracySeconds)
+{
+    struct tm *pTm;
+
+    // See ublox8-M8_ReceiverDescrProtSpec, section 32.14.10.6
+    memset(pBuf, 0, ZOEM8_MGA_INI_TIME_UTC_LENGTH);
+    pTm = gmtime(&timeUTC);
+    *pBuf = 0x10; // Type
+    *(pBuf + 2) = 0; // Reference: none
+    *(pBuf + 3) = (char) -128; // Leap seconds unknown
+    if (pTm != NULL) {
+        *(pBuf + 4) = (char) (pTm->tm_year + 1900);
+        *(pBuf + 5) = (char) ((pTm->tm_year + 1900) >> 8);
+        *(pBuf + 6) = (char) (pTm->tm_mon + 1);
+        *(pBuf + 7) = (char) pTm->tm_mday;
+        *(pBuf + 8) = (char) pTm->tm_hour;
+        *(pBuf + 9) = (char) pTm->tm_min;
+        *(pBuf + 10) = (char) pTm->tm_sec;
+    }
+    *(pBuf + 16) = (char) accuracySeconds;
+    *(pBuf + 17) = (char) (accuracySeconds >> 8);
+
+    return ZOEM8_MGA_INI_TIME_UTC_LENGTH;
+}
+
+// Write the payload of a UBX-MGA-INI-POS_LLH message.
+int zoem8MgaIniPosLlh(char *pBuf, int latitudeX10e7, int longitudeX10e7,
+                      int altitudeMetres, unsigned int accuracyMetres)
+{
+    // See ublox8-M8_ReceiverDescrProtSpec, section 32.14.10.2
+    memset(pBuf, 0, ZOEM8_MGA_INI_POS_LLH_LENGTH);
+    *pBuf = 0x01; // Type
+    littleEndianUintWrite(pBuf + 4, (unsigned int) latitudeX10e7);
+    littleEndianUintWrite(pBuf + 8, (unsigned int) longitudeX10e7);
+    littleEndianUintWrite(pBuf + 12, (unsigned int) (altitudeMetres * 100));
+    littleEndianUintWrite(pBuf + 16, accuracyMetres * 100);
+
+    return ZOEM8_MGA_INI_POS_LLH_LENGTH;
+}
+
 // Read the position
 ActionDriver getPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
                          int *pRadiusMetres, int *pAltitudeMetres,
                          unsigned char *pSpeedMPS, unsigned char *pSVs)
 {
     ActionDriver result;
-    int returnCode;
+    UbxFrame frame;
 
     MTX_LOCK(gMtx);
 
     result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
 
     if (gpGnssParser != NULL) {
-        // See ublox8-M8_ReceiverDescrProtSpec, section 32.18.14 (NAV-PVT)
-        result = ACTION_DRIVER_ERROR_I2C_WRITE;
-        if (gpGnssParser->sendUbx(0x01, 0x07, NULL, 0) > 0) {
-            result = ACTION_DRIVER_ERROR_NO_DATA;
-            returnCode = gpGnssParser->getMessage(gMsgBuffer, sizeof(gMsgBuffer));
-            if (PROTOCOL(returnCode) == GnssParser::UBX) {
-                returnCode = LENGTH(returnCode);
-                if (returnCode > 0) {
-                    result = ACTION_DRIVER_ERROR_NO_VALID_DATA;
-                    // Have we got a fix?
-                    if ((gMsgBuffer[21 + UBX_PROTOCOL_HEADER_SIZE] & 0x01) != 0) {
-                        result = ACTION_DRIVER_OK;
-                        if (pSVs != NULL) {
-                            *pSVs = (unsigned char) gMsgBuffer[23 + UBX_PROTOCOL_HEADER_SIZE];
-                        }
-                        if (pLongitudeX10e7 != NULL) {
-                            *pLongitudeX10e7 = (int) littleEndianUint(&(gMsgBuffer[24 + UBX_PROTOCOL_HEADER_SIZE]));
-                        }
-                        if (pLatitudeX10e7 != NULL) {
-                            *pLatitudeX10e7 = (int) littleEndianUint(&(gMsgBuffer[28 + UBX_PROTOCOL_HEADER_SIZE]));
-                        }
-                        if (pAltitudeMetres != NULL) {
-                            *pAltitudeMetres = ((int) littleEndianUint(&(gMsgBuffer[36 + UBX_PROTOCOL_HEADER_SIZE]))) / 1000;
-                        }
-                        if (pRadiusMetres != NULL) {
-                            *pRadiusMetres = ((int) littleEndianUint(&(gMsgBuffer[40 + UBX_PROTOCOL_HEADER_SIZE]))) / 1000;
-                        }
-                        if (pSpeedMPS != NULL) {
-                            *pSpeedMPS = ((int) littleEndianUint(&(gMsgBuffer[60 + UBX_PROTOCOL_HEADER_SIZE]))) / 1000;
-                        }
-                    }
-                }
-            }
+        // NAV-PVT is sent by the GNSS chip with every navigation
+        // solution, no need to ask for it
+        result = ACTION_DRIVER_ERROR_NO_DATA;
+        if (gpGnssParser->waitUbx(0x01, 0x07, &frame, ZOEM8_GET_WAIT_TIME_MS)) {
+            result = navPvtDecode(&frame, pLatitudeX10e7, pLongitudeX10e7,
+                                  pRadiusMetres, pAltitudeMetres,
+                                  pSpeedMPS, pSVs);
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return result;
+}
+
+// Wait for a position fix.
+ActionDriver waitPosition(int *pLatitudeX10e7, int *pLongitudeX10e7,
+                          int *pRadiusMetres, int *pAltitudeMetres,
+                          unsigned char *pSpeedMPS, unsigned char *pSVs,
+                          int timeoutMs,
+                          bool (*pKeepGoingCallback)(void *),
+                          void *pCallbackParam)
+{
+    ActionDriver result;
+    UbxFrame frame;
+    Timer timer;
+
+    MTX_LOCK(gMtx);
+
+    result = ACTION_DRIVER_ERROR_NOT_INITIALISED;
+
+    if (gpGnssParser != NULL) {
+        result = ACTION_DRIVER_ERROR_NO_DATA;
+        timer.reset();
+        timer.start();
+        // Sleep between the NAV-PVT messages that the GNSS chip sends
+        // of its own accord until one of them carries a fix
+        while ((result != ACTION_DRIVER_OK) && (timer.read_ms() < timeoutMs) &&
+               gpGnssParser->waitUbx(0x01, 0x07, &frame, timeoutMs - timer.read_ms(),
+                                     pKeepGoingCallback, pCallbackParam)) {
+            result = navPvtDecode(&frame, pLatitudeX10e7, pLongitudeX10e7,
+                                  pRadiusMetres, pAltitudeMetres,
+                                  pSpeedMPS, pSVs);
         }
+        timer.stop();
     }
 
     MTX_UNLOCK(gMtx);
@@ -452,8 +843,8 @@ ActionDriver getTime(time_t *pTimeUTC)
     ActionDriver result;
     time_t timeUTC = 0;
     unsigned int months;
-    unsigned int year;
-    int returnCode;
+    struct tm tmUTC;
+    UbxFrame frame;
 
     MTX_LOCK(gMtx);
 
@@ -464,41 +855,35 @@ ActionDriver getTime(time_t *pTimeUTC)
         result = ACTION_DRIVER_ERROR_I2C_WRITE;
         if (gpGnssParser->sendUbx(0x01, 0x21, NULL, 0) > 0) {
             result = ACTION_DRIVER_ERROR_NO_DATA;
-            returnCode = gpGnssParser->getMessage(gMsgBuffer, sizeof(gMsgBuffer));
-            if (PROTOCOL(returnCode) == GnssParser::UBX) {
-                returnCode = LENGTH(returnCode);
-                if (returnCode > 0) {
-                    result = ACTION_DRIVER_ERROR_NO_VALID_DATA;
-                    // Have we got valid UTC time?
-                    if ((gMsgBuffer[19 + UBX_PROTOCOL_HEADER_SIZE] & 0x04) != 0) {
-                        result = ACTION_DRIVER_OK;
-                        // Year 1999-2099, so need to adjust to get year since 1970
-                        year = ((unsigned int) (gMsgBuffer[12 + UBX_PROTOCOL_HEADER_SIZE])) +
-                                ((unsigned int) (gMsgBuffer[13 + UBX_PROTOCOL_HEADER_SIZE]) << 8) - 1999 + 29;
-                        // Month (1 to 12), so take away 1 to make it zero-based
-                        months = gMsgBuffer[14 + UBX_PROTOCOL_HEADER_SIZE] - 1;
-                        months += year * 12;
-                        // Work out the number of seconds due to the year/month count
-                        for (unsigned int x = 0; x < months; x++) {
-                            if (isLeapYear((x / 12) + 1970)) {
-                                timeUTC += gDaysInMonthLeapYear[x % 12] * 3600 * 24;
-                            } else {
-                                timeUTC += gDaysInMonth[x % 12] * 3600 * 24;
-                            }
-                        }
-                        // Day (1 to 31)
-                        timeUTC += ((unsigned int) gMsgBuffer[15 + UBX_PROTOCOL_HEADER_SIZE] - 1) * 3600 * 24;
-                        // Hour (0 to 23)
-                        timeUTC += ((unsigned int) gMsgBuffer[16 + UBX_PROTOCOL_HEADER_SIZE]) * 3600;
-                        // Minute (0 to 59)
-                        timeUTC += ((unsigned int) gMsgBuffer[17 + UBX_PROTOCOL_HEADER_SIZE]) * 60;
-                        // Second (0 to 60)
-                        timeUTC += gMsgBuffer[18 + UBX_PROTOCOL_HEADER_SIZE];
-
-                        if (pTimeUTC != NULL) {
-                            *pTimeUTC = timeUTC;
+            // The answer will be mixed in with NAV-PVT messages
+            if (gpGnssParser->waitUbx(0x01, 0x21, &frame, ZOEM8_GET_WAIT_TIME_MS) &&
+                ubxIsNavTimeUtc(&frame)) {
+                result = ACTION_DRIVER_ERROR_NO_VALID_DATA;
+                // Have we got valid UTC time?
+                if (ubxNavTimeUtc(&frame, &tmUTC)) {
+                    result = ACTION_DRIVER_OK;
+                    // Month (0 to 11) plus years since 1970
+                    months = tmUTC.tm_mon + ((tmUTC.tm_year - 70) * 12);
+                    // Work out the number of seconds due to the year/month count
+                    for (unsigned int x = 0; x < months; x++) {
+                        if (isLeapYear((x / 12) + 1970)) {
+                            timeUTC += gDaysInMonthLeapYear[x % 12] * 3600 * 24;
+                        } else {
+                            timeUTC += gDaysInMonth[x % 12] * 3600 * 24;
                         }
                     }
+                    // Day (1 to 31)
+                    timeUTC += (tmUTC.tm_mday - 1) * 3600 * 24;
+                    // Hour (0 to 23)
+                    timeUTC += tmUTC.tm_hour * 3600;
+                    // Minute (0 to 59)
+                    timeUTC += tmUTC.tm_min * 60;
+                    // Second (0 to 60)
+                    timeUTC += tmUTC.tm_sec;
+
+                    if (pTimeUTC != NULL) {
+                        *pTimeUTC = timeUTC;
+                    }
                 }
             }
         }
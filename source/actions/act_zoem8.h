@@ -12,6 +12,7 @@
 #ifndef _ACT_ZOEM8_H_
 #define _ACT_ZOEM8_H_
 
+#include <time.h>
 #include <act_common.h>
 
 /**************************************************************************
@@ -44,6 +45,14 @@
  */
 #define ZOEM8_POWER_ACTIVE_NW 45000000UL
 
+/** The length of the payload of a UBX-MGA-INI-TIME_UTC message.
+ */
+#define ZOEM8_MGA_INI_TIME_UTC_LENGTH 24
+
+/** The length of the payload of a UBX-MGA-INI-POS_LLH message.
+ */
+#define ZOEM8_MGA_INI_POS_LLH_LENGTH 20
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -65,6 +74,39 @@ ActionDriver zoem8Init(char i2cAddress);
  */
 void zoem8Deinit();
 
+/** Tell the Zoe M8 driver that the device has moved since the last
+ * position fix, so that the stored position it offers as assistance
+ * to the GNSS chip on the next initialisation is given a suitably
+ * large uncertainty.
+ */
+void zoem8PositionMoved();
+
+/** Write the payload of a UBX-MGA-INI-TIME_UTC message, used to
+ * give the Zoe M8 a hint as to the time.
+ *
+ * @param pBuf             a buffer of at least
+ *                         ZOEM8_MGA_INI_TIME_UTC_LENGTH bytes.
+ * @param timeUTC          the (Unix) UTC time.
+ * @param accuracySeconds  the accuracy of timeUTC in seconds.
+ * @return                 the length of the payload written.
+ */
+int zoem8MgaIniTimeUtc(char *pBuf, time_t timeUTC,
+                       unsigned int accuracySeconds);
+
+/** Write the payload of a UBX-MGA-INI-POS_LLH message, used to
+ * give the Zoe M8 a hint as to its position.
+ *
+ * @param pBuf            a buffer of at least
+ *                        ZOEM8_MGA_INI_POS_LLH_LENGTH bytes.
+ * @param latitudeX10e7   latitude in 10 millionths of a degree.
+ * @param longitudeX10e7  longitude in 10 millionths of a degree.
+ * @param altitudeMetres  altitude in metres.
+ * @param accuracyMetres  the accuracy of the position in metres.
+ * @return                the length of the payload written.
+ */
+int zoem8MgaIniPosLlh(char *pBuf, int latitudeX10e7, int longitudeX10e7,
+                      int altitudeMetres, unsigned int accuracyMetres);
+
 #endif // _ACT_ZOEM8_H_
 
 // End Of File
@@ -18,6 +18,7 @@
 
 #include <ble_data_gather.h>
 #include <eh_utilities.h>
+#include <eh_heap.h>
 
 /**************************************************************************
  * MACROS
@@ -568,13 +569,13 @@ static int freeBleDevice(const char *pAddress, int addressType)
         pBleDevice->connectionState = BLE_CONNECTION_STATE_DISCONNECTED;
         pBleDevice->discoveryAttempts = 0;
         if (pBleDevice->pDeviceNameCharacteristic != NULL) {
-            free (pBleDevice->pDeviceNameCharacteristic);
+            heapFree(HEAP_SITE_BLE, pBleDevice->pDeviceNameCharacteristic, sizeof(DiscoveredCharacteristic));
         }
         if (pBleDevice->pWantedCharacteristic != NULL) {
-            free (pBleDevice->pWantedCharacteristic);
+            heapFree(HEAP_SITE_BLE, pBleDevice->pWantedCharacteristic, sizeof(DiscoveredCharacteristic));
         }
         if (pBleDevice->pDeviceName != NULL) {
-            free (pBleDevice->pDeviceName);
+            heapFree(HEAP_SITE_BLE, pBleDevice->pDeviceName, strlen(pBleDevice->pDeviceName) + 1);
         }
         clearBleDeviceData(pBleDevice->pDataContainer);
         pBleDevice->pDataContainer = NULL;
@@ -663,7 +664,7 @@ static int addBleData(const char *pAddress, int addressType, const char *pData,
 
         //BLE_DEBUG_PRINTF("  %d data item(s) already in the list.\n", numItems);
         // Add the new container
-        *ppThis = (BleDataContainer *) malloc(sizeof(BleDataContainer));
+        *ppThis = (BleDataContainer *) pHeapMalloc(HEAP_SITE_BLE, sizeof(BleDataContainer));
         if (*ppThis != NULL) {
             //BLE_DEBUG_PRINTF("  allocated %d byte(s) for the data container at time %d.\n", sizeof(BleDataContainer), (int) time(NULL));
             (*ppThis)->dataStruct.timestamp = time(NULL);
@@ -671,7 +672,7 @@ static int addBleData(const char *pAddress, int addressType, const char *pData,
             (*ppThis)->pNext = NULL;
             //BLE_DEBUG_PRINTF("New pThis 0x%08x, pThis->pPrevious 0x%08x, pThis->pNext 0x%08x.\n", (int) *ppThis, (int) (*ppThis)->pPrevious, (int) (*ppThis)->pNext);
             // Add the data to the container
-            (*ppThis)->dataStruct.pData = (char *) malloc(dataLen);
+            (*ppThis)->dataStruct.pData = (char *) pHeapMalloc(HEAP_SITE_BLE, dataLen);
             if ((*ppThis)->dataStruct.pData != NULL) {
                 //BLE_DEBUG_PRINTF("  allocated %d byte(s) for the data.\n", dataLen);
                 memcpy ((*ppThis)->dataStruct.pData, pData, dataLen);
@@ -691,7 +692,7 @@ static int addBleData(const char *pAddress, int addressType, const char *pData,
                 //BLE_DEBUG_PRINTF("  unable to allocate %d byte(s) for the data.\n", dataLen);
                 // If we can't allocate space for the data, go back
                 // and delete the container
-                free (*ppThis);
+                heapFree(HEAP_SITE_BLE, *ppThis, sizeof(BleDataContainer));
                 *ppThis = NULL;
             }
         } else {
@@ -713,7 +714,7 @@ static BleData *pGetNextDataItemCopy(BleDevice *pBleDevice)
     BleDataContainer *pThis = pBleDevice->pNextDataItemToRead;
 
     if (pThis != NULL) {
-        pDataStruct = (BleData *) malloc(sizeof(BleData));
+        pDataStruct = (BleData *) pHeapMalloc(HEAP_SITE_BLE, sizeof(BleData));
         if (pDataStruct != NULL) {
             memcpy(pDataStruct, &(pThis->dataStruct), sizeof (*pDataStruct));
             // Also make a copy of the malloc()ed pData
@@ -721,12 +722,12 @@ static BleData *pGetNextDataItemCopy(BleDevice *pBleDevice)
             // safety
             if (pDataStruct->dataLen > 0) {
                 pTmp = pDataStruct->pData;
-                pDataStruct->pData = (char *) malloc(pDataStruct->dataLen);
+                pDataStruct->pData = (char *) pHeapMalloc(HEAP_SITE_BLE, pDataStruct->dataLen);
                 if (pDataStruct->pData != NULL) {
                     memcpy (pDataStruct->pData, pTmp, pDataStruct->dataLen);
                 } else {
                     // If that malloc() failed, reverse the first one
-                    free(pDataStruct);
+                    heapFree(HEAP_SITE_BLE, pDataStruct, sizeof(BleData));
                     pDataStruct = NULL;
                 }
             }
@@ -743,7 +744,7 @@ static void freeBleDataItem(BleDataContainer *pDataContainer)
 {
     // Free the data for this entry
     if (pDataContainer->dataStruct.pData != NULL) {
-        free (pDataContainer->dataStruct.pData);
+        heapFree(HEAP_SITE_BLE, pDataContainer->dataStruct.pData, pDataContainer->dataStruct.dataLen);
     }
     // Seal up the list
     if (pDataContainer->pPrevious != NULL) {
@@ -753,7 +754,7 @@ static void freeBleDataItem(BleDataContainer *pDataContainer)
         pDataContainer->pNext->pPrevious = pDataContainer->pPrevious;
     }
     // Free this container
-    free (pDataContainer);
+    heapFree(HEAP_SITE_BLE, pDataContainer, sizeof(BleDataContainer));
 }
 
 // Clear the data for a BLE device from the given entry onwards.
@@ -885,9 +886,9 @@ static void characteristicDiscoveryCallback(const DiscoveredCharacteristic *pCha
             // Take a copy of the characteristic so that we can read it once service discovery has ended
             BLE_DEBUG_PRINTF("  BLE device %s has a characteristic we want to read (0x%04x).\n", pPrintBleAddress(pBleDevice->address, addressString), uuid);
             if (*ppStoredCharacteristic != NULL) {
-                free(*ppStoredCharacteristic);
+                heapFree(HEAP_SITE_BLE, *ppStoredCharacteristic, sizeof(DiscoveredCharacteristic));
             }
-            *ppStoredCharacteristic = (DiscoveredCharacteristic *) malloc(sizeof (*pCharacteristic));
+            *ppStoredCharacteristic = (DiscoveredCharacteristic *) pHeapMalloc(HEAP_SITE_BLE, sizeof (*pCharacteristic));
             if (*ppStoredCharacteristic != NULL) {
                 memcpy(*ppStoredCharacteristic, pCharacteristic, sizeof (*pCharacteristic));
             }
@@ -928,7 +929,7 @@ static void discoveryTerminationCallback(Gap::Handle_t connectionHandle)
                                      gWantedCharacteristicUuid);
                     pBleDevice->deviceState = BLE_DEVICE_STATE_NOT_WANTED;
                     // Free up the Device Name characteristic to save RAM
-                    free(pBleDevice->pDeviceNameCharacteristic);
+                    heapFree(HEAP_SITE_BLE, pBleDevice->pDeviceNameCharacteristic, sizeof(DiscoveredCharacteristic));
                     pBleDevice->pDeviceNameCharacteristic = NULL;
                 }
             } else {
@@ -936,7 +937,7 @@ static void discoveryTerminationCallback(Gap::Handle_t connectionHandle)
                 pBleDevice->deviceState = BLE_DEVICE_STATE_NOT_WANTED;
                 // Free up the wanted characteristic if it was there to save RAM
                 if (pBleDevice->pWantedCharacteristic != NULL) {
-                    free(pBleDevice->pWantedCharacteristic);
+                    heapFree(HEAP_SITE_BLE, pBleDevice->pWantedCharacteristic, sizeof(DiscoveredCharacteristic));
                     pBleDevice->pWantedCharacteristic = NULL;
                 }
             }
@@ -1099,14 +1100,14 @@ static void checkDeviceNameCallback(const GattReadCallbackParams *pResponse)
                              pPrintBleAddress(pBleDevice->address, addressString),
                              pResponse->len, pResponse->data);
             // Save the device name
-            pBleDevice->pDeviceName = (char *) malloc(pResponse->len + 1);
+            pBleDevice->pDeviceName = (char *) pHeapMalloc(HEAP_SITE_BLE, pResponse->len + 1);
             if (pBleDevice->pDeviceName != NULL) {
                 memcpy (pBleDevice->pDeviceName, pResponse->data, pResponse->len);
                 *(pBleDevice->pDeviceName + pResponse->len) = 0;  // Add terminator
             }
             // Free up the Device Name characteristic to save RAM
             if (pBleDevice->pDeviceNameCharacteristic != NULL) {
-                free(pBleDevice->pDeviceNameCharacteristic);
+                heapFree(HEAP_SITE_BLE, pBleDevice->pDeviceNameCharacteristic, sizeof(DiscoveredCharacteristic));
                 pBleDevice->pDeviceNameCharacteristic = NULL;
             }
             pBleDevice->deviceState = BLE_DEVICE_STATE_IS_WANTED;
@@ -43,7 +43,7 @@
  */
 typedef struct {
     int timestamp; /// Unix timestamp.
-    char *pData; /// This will be malloc()ed; it is up to the caller to free()
+    char *pData; /// This will be malloc()ed; it is up to the caller to heapFree() (HEAP_SITE_BLE)
     int dataLen;
 } BleData;
 
@@ -146,13 +146,14 @@ int bleGetNumDataItems(const char *pDeviceName);
  *                     This is a COPY of the data
  *                     item, malloc()ed for the purpose
  *                     by this function, and it is up
- *                     to the caller to free() it when
- *                     done.  Note also that the pData
- *                     item inside the BleData structure
- *                     is ALSO malloc()ed by this
- *                     function and should be free()ed
- *                     before the BleData structure is
- *                     free()ed to avoid memory leaks.
+ *                     to the caller to heapFree() it,
+ *                     with HEAP_SITE_BLE, when done.
+ *                     Note also that the pData item
+ *                     inside the BleData structure is
+ *                     ALSO malloc()ed by this function
+ *                     and should be heapFree()ed before
+ *                     the BleData structure is
+ *                     heapFree()ed to avoid memory leaks.
  */
 BleData *pBleGetFirstDataItem(const char *pDeviceName,
                               bool andDelete);
@@ -171,13 +172,14 @@ BleData *pBleGetFirstDataItem(const char *pDeviceName,
  *                     This is a COPY of the data
  *                     item, malloc()ed for the purpose
  *                     by this function, and it is up
- *                     to the caller to free() it when
- *                     done.  Note also that the pData
- *                     item inside the BleData structure
- *                     is ALSO malloc()ed by this
- *                     function and should be free()ed
- *                     before the BleData structure is
- *                     free()ed to avoid memory leaks.
+ *                     to the caller to heapFree() it,
+ *                     with HEAP_SITE_BLE, when done.
+ *                     Note also that the pData item
+ *                     inside the BleData structure is
+ *                     ALSO malloc()ed by this function
+ *                     and should be heapFree()ed before
+ *                     the BleData structure is
+ *                     heapFree()ed to avoid memory leaks.
  */
 BleData *pBleGetNextDataItem(const char *pDeviceName);
 
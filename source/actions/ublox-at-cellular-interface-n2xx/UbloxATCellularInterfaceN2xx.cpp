@@ -27,9 +27,17 @@
 #define tr_error(format, ...) debug_if(_debug_trace_on, format "\n", ## __VA_ARGS__)
 #endif
 
-// When calling the SendTo function, the large hex string for the bytes to send is chopped into chunks 
+// When calling the SendTo function, the large hex string for the bytes to send is chopped into chunks
+// (must be even, as each byte becomes two hex characters)
 #define SENDTO_CHUNK_SIZE 50
 
+// Room for the AT+NSOSTF command preamble, which precedes the hex string
+#define SENDTO_CMD_MAX_SIZE 64
+
+// When calling the ReceiveFrom function, the hex string is read back and decoded in chunks of this size
+// (must be even, as each byte becomes two hex characters)
+#define RECVFROM_CHUNK_SIZE 64
+
 /**********************************************************************
  * PRIVATE METHODS
  **********************************************************************/
@@ -299,33 +307,25 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::socket_sendto(nsapi_socket_t
 nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::sendto(SockCtrl *socket, const SocketAddress &address, const char *buf, int size) {
     nsapi_size_or_error_t sent = NSAPI_ERROR_DEVICE_ERROR;
     int id;
-        
-    char *dataStr = (char *) malloc((size * 2) + 1);
-    if (dataStr == NULL) {
-        tr_error("Couldn't allocate memory for hex string conversion.");
-        return NSAPI_ERROR_NO_MEMORY;
-    }
-    
-    tr_debug("Converting byte array to hex string");
-    bin_to_hex(buf, size, dataStr);
-    tr_debug("Got hex string");
-    
+    char cmdStr[SENDTO_CMD_MAX_SIZE];
+
     // AT+NSOSTF= socket, remote_addr, remote_port, length, data
-    tr_debug("Writing AT+NSOSTF=<sktid>,<ipaddr>,<port>,<flags>,<size>,<hex string> command...");    
-    char *cmdStr = (char *) malloc(50);
-    if (cmdStr == NULL) {
-        tr_error("Couldn't allocate memory for AT cmd string.");
-        return NSAPI_ERROR_NO_MEMORY;
-    }
-            
-    int cmdsize = sprintf(cmdStr, "AT+NSOSTF=%d,\"%s\",%d,%s,%d,\"", socket->modem_handle, address.get_ip_address(), address.get_port(), _sendFlags, size);    
+    // Note: the hex string is generated on the fly, chunk by chunk,
+    // as it is written to the modem, so there is no need to hold
+    // a (size * 2) copy of the data on the heap
+    tr_debug("Writing AT+NSOSTF=<sktid>,<ipaddr>,<port>,<flags>,<size>,<hex string> command...");
+    int cmdsize = snprintf(cmdStr, sizeof(cmdStr), "AT+NSOSTF=%d,\"%s\",%d,%s,%d,\"", socket->modem_handle, address.get_ip_address(), address.get_port(), _sendFlags, size);
+    if ((cmdsize <= 0) || (cmdsize >= (int) sizeof(cmdStr))) {
+        tr_error("AT cmd string too long.");
+        return NSAPI_ERROR_PARAMETER;
+    }
     tr_debug("%s", cmdStr);
-    
+
     LOCK();
-    if (_at->write(cmdStr, cmdsize) && sendATChopped(dataStr)) 
+    if (_at->write(cmdStr, cmdsize) && sendATChopped(buf, size))
     {
         tr_debug("Finished sending AT+NSOST comamnd, reading back the 'sent' size...");
-        if (_at->recv("%d,%d\n", &id, &sent) && _at->recv("OK")) {            
+        if (_at->recv("%d,%d\n", &id, &sent) && _at->recv("OK")) {
             tr_debug("Sent %d bytes on socket %d", sent, id);
         } else {
             tr_error("Didn't get the Sent size or OK");
@@ -333,60 +333,44 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::sendto(SockCtrl *socket, con
     } else {
         tr_error("Didn't send the AT command!");
     }
-    UNLOCK();  
+    UNLOCK();
 
-    free(cmdStr);    
-    free(dataStr);
-       
     return sent;
 }
 
-bool UbloxATCellularInterfaceN2xx::sendATChopped(const char *cmd)
+// Write a binary buffer to the modem as a hex string, SENDTO_CHUNK_SIZE
+// characters at a time, followed by the enclosing quote that completes
+// the AT command.
+bool UbloxATCellularInterfaceN2xx::sendATChopped(const char *buf, int size)
 {
     char buff[SENDTO_CHUNK_SIZE];
-    tr_debug("Chopping up large AT text of %d characters.", strlen(cmd));
-    
-    while (*cmd != '\0')
-    {
-        int i=0;
-        
-        for (i=0; i<SENDTO_CHUNK_SIZE; i++) {
-            buff[i] = *cmd;
-            
-            // if we have copied the NULL terminator, we can exit 
-            if (*cmd == '\0')  
-                break;
-            
-            // still more characters to copy, so move along
-            cmd++;
+    int blk;
+
+    tr_debug("Chopping up %d byte(s) into %d character hex chunks.", size, SENDTO_CHUNK_SIZE);
+
+    while (size > 0) {
+        blk = SENDTO_CHUNK_SIZE / 2;
+        if (blk > size) {
+            blk = size;
         }
-       
-       // if we are at the end of the line, use the send command to 
-       // provide the \r\n terminator for the AT command
-        if (*cmd == '\0') {
-            tr_debug("send(%d): %s", i, buff);            
-            // write the last buffer...
-            if (!_at->write(buff,i))
-                return false;
-            
-            // ...send the enclosing quote to complete the AT command
-            if (!_at->send("\""))
-                return false;
-        } else {
-            tr_debug("write(50): %s", buff);
-            if (!_at->write(buff, 50))
-                return false;
+        bin_to_hex(buf, blk, buff);
+        if (!_at->write(buff, blk * 2)) {
+            return false;
         }
-     }
-     
-     return true;
+        buf += blk;
+        size -= blk;
+    }
+
+    // Use the send command to provide the enclosing
+    // quote and the \r\n terminator for the AT command
+    return _at->send("\"");
 }
 
+// Convert length bytes of binary into (length * 2) hex
+// characters; output is NOT null terminated.
 void UbloxATCellularInterfaceN2xx::bin_to_hex(const char *buff, unsigned int length, char *output)
 {
-    char binHex[] = "0123456789ABCDEF";
-    
-    *output = '\0';
+    static const char binHex[] = "0123456789ABCDEF";
 
     for (; length > 0; --length)
     {
@@ -395,8 +379,6 @@ void UbloxATCellularInterfaceN2xx::bin_to_hex(const char *buff, unsigned int len
         *output++ = binHex[(byte >> 4) & 0x0F];
         *output++ = binHex[byte & 0x0F];
     }
-    
-    *output++ = '\0';
 }
 
 // Receive from a socket, TCP style.
@@ -419,9 +401,6 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::socket_recvfrom(nsapi_socket
     nsapi_size_t read_blk;
     nsapi_size_t count = 0;
     int at_timeout = _at_timeout;
-        
-    char * tmpBuf = NULL;
-
     Timer timer;
     SockCtrl *socket = (SockCtrl *) handle;
 
@@ -444,17 +423,11 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::socket_recvfrom(nsapi_socket
             tr_debug("Socket 0x%08x: modem handle %d has %d byte(s) pending",
                      (unsigned int) socket, socket->modem_handle, socket->pending);
     
-            tmpBuf = (char *) malloc(read_blk);
-            if (tmpBuf == NULL) {
-                return NSAPI_ERROR_NO_MEMORY;
-            }
-            
-            // call the AT helper function to get the bytes
-            nsapi_error_size = receivefrom(socket->modem_handle, address, read_blk, tmpBuf);
-                    
-            if (nsapi_error_size >= 0) {
-                memcpy(buf, tmpBuf, nsapi_error_size);
+            // call the AT helper function to get the bytes,
+            // decoded directly into the caller's buffer
+            nsapi_error_size = receivefrom(socket->modem_handle, address, read_blk, buf);
 
+            if (nsapi_error_size >= 0) {
                 if (read_blk != (uint32_t) nsapi_error_size)
                     tr_debug("Requested size is not the same as the returned size.");
                 
@@ -471,9 +444,6 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::socket_recvfrom(nsapi_socket
                 // Should never fail to read when there is pending data
                 success = false;
             }
-            
-            free(tmpBuf);
-            
         } else if (timer.read_ms() < SOCKET_TIMEOUT) {
             // Wait for URCs
             tr_debug("Waiting for URC...");
@@ -506,65 +476,76 @@ nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::socket_recvfrom(nsapi_socket
 
 nsapi_size_or_error_t UbloxATCellularInterfaceN2xx::receivefrom(int modem_handle, SocketAddress *address, int length, char *buf) {
     char ipAddress[NSAPI_IP_SIZE];
-    nsapi_size_or_error_t size;
+    char hexBuf[RECVFROM_CHUNK_SIZE];
+    nsapi_size_or_error_t size = NSAPI_ERROR_DEVICE_ERROR;
+    int remaining = 0;
+    int blk;
+    int decoded;
 
     memset (ipAddress, 0, sizeof (ipAddress)); // Ensure terminator
-    
+
     if (length > MAX_READ_SIZE_N2XX) {
         return NSAPI_ERROR_UNSUPPORTED;
     }
-    
-    char * tmpBuf = (char *) malloc(length*2);
-    if (tmpBuf == NULL)
-        return NSAPI_ERROR_NO_MEMORY;
-    
-    int remaining;
-    
+
     _at->debug_on(false); // ABSOLUTELY no time for debug here if you want to
                       // be able to read packets of any size without
                       // losing characters in UARTSerial
-    
-    // Ask for x bytes from Socket 
+
+    // Ask for x bytes from Socket
     tr_debug("Requesting to read back %d bytes from socket %d", length, modem_handle);
     if (_at->send("AT+NSORF=%d,%d", modem_handle, length)) {
         unsigned int id, port;
-        
+
         // ReadFrom header, to get length - if no data then this will time out
         if (_at->recv("%d,\"%15[^\"]\",%d,%d,", &id, ipAddress, &port, &size)) {
             tr_debug("Socket RecvFrom: #%d: %d", id, size);
-                
-            address->set_ip_address(ipAddress);
-            address->set_port(port);
-            
-            // read the beginning quote for this data
-            _at->read(tmpBuf, 1);
-            
-            // now read hex data
-            if (_at->read(tmpBuf, size*2) == size*2) {
-                
-                // convert to bytes
-                hex_to_bin(tmpBuf, buf, size);
-             
+
+            if ((size < 0) || (size > length)) {
+                size = NSAPI_ERROR_DEVICE_ERROR;
+            } else {
+                address->set_ip_address(ipAddress);
+                address->set_port(port);
+
+                // read the beginning quote for this data
+                _at->read(hexBuf, 1);
+
+                // now read the hex data, a chunk at a time, converting
+                // it straight into the caller's buffer
+                decoded = 0;
+                while (decoded < size) {
+                    blk = (size - decoded) * 2;
+                    if (blk > (int) sizeof(hexBuf)) {
+                        blk = sizeof(hexBuf);
+                    }
+                    if ((_at->read(hexBuf, blk) != blk) ||
+                        (hex_to_bin(hexBuf, blk, buf + decoded, size - decoded) != blk / 2)) {
+                        tr_error("Failed reading the hex data.");
+                        size = NSAPI_ERROR_DEVICE_ERROR;
+                        break;
+                    }
+                    decoded += blk / 2;
+                }
+
                 // read the "remaining" value - remembing there is an enclosing quote at the beginning of this read
-                if (!_at->recv("\",%d\n", &remaining)) {
+                if ((size >= 0) && !_at->recv("\",%d\n", &remaining)) {
                     tr_error("Failed reading the 'remaining' value after the received data.");
                     size = NSAPI_ERROR_DEVICE_ERROR;
                 }
             }
         }
-        
+
         // we should get the OK (even if there is no data to read)
-        if (_at->recv("OK")) {          
+        if (_at->recv("OK")) {
             tr_debug("Socket RecvFrom: Read %d bytes, %d bytes remaining.", size, remaining);
         } else {
             tr_error("Socket RecvFrom: Didn't receive OK from AT+NSORF command.");
             size = NSAPI_ERROR_DEVICE_ERROR;
         }
     }
-    
+
     _at->debug_on(_debug_trace_on);
-    free(tmpBuf);
-    
+
     return size;
 }
 
@@ -576,12 +557,15 @@ char UbloxATCellularInterfaceN2xx::hex_char(char c)
     return 0xFF;
 }
 
-int UbloxATCellularInterfaceN2xx::hex_to_bin(const char* s, char * buff, int length)
+// Convert numChars hex characters (which need not be null
+// terminated) into at most length bytes of binary, returning
+// the number of bytes written or -1 on error.
+int UbloxATCellularInterfaceN2xx::hex_to_bin(const char* s, int numChars, char * buff, int length)
 {
     int result;
-    if (!s || !buff || length <= 0) return -1;
+    if (!s || !buff || length <= 0 || (numChars & 1)) return -1;
 
-    for (result = 0; *s; ++result)
+    for (result = 0; numChars > 0; ++result, numChars -= 2)
     {
         unsigned char msn = hex_char(*s++);
         if (msn == 0xFF) return -1;
@@ -626,10 +626,10 @@ private:
     
     nsapi_size_or_error_t receivefrom(int socketId, SocketAddress *address, int length, char *buf);
     nsapi_size_or_error_t sendto(SockCtrl *socket, const SocketAddress &address, const char *buf, int size);
-    bool sendATChopped(const char *);
+    bool sendATChopped(const char *buf, int size);
     
     char hex_char(char c);
-    int hex_to_bin(const char* s, char * buff, int length);
+    int hex_to_bin(const char* s, int numChars, char * buff, int length);
     void bin_to_hex(const char *buff, unsigned int length, char *output);
     
     Callback<void(nsapi_error_t)> _connection_status_cb;
@@ -91,8 +91,9 @@ static const char *gActionStateString[] = {"ACTION_STATE_NULL",
                                            "ACTION_STATE_REQUESTED",
                                            "ACTION_STATE_IN_PROGRESS",
                                            "ACTION_STATE_COMPLETED",
-                                           "ACTION_STATE_TRIED_AND_FAILED"
-                                           "ACTION_STATE_ABORTED"};
+                                           "ACTION_STATE_TRIED_AND_FAILED",
+                                           "ACTION_STATE_ABORTED",
+                                           "ACTION_STATE_DEFERRED"};
 
 /** The action types as strings for debug purposes.
  */
@@ -210,13 +211,16 @@ static bool condition(Action *pAction, Action *pNextAction)
 }
 
 // Rank the gpRankedList using the given condition function.
+// The list is populated from the start, so the first NULL
+// entry marks the end of it.
 // NOTE: this does not lock the list.
 static void ranker(bool condition(Action *, Action *)) {
     Action **ppRanked;
     Action *pRankedTmp;
 
     ppRanked = &(gpRankedList[0]);
-    while (ppRanked < (Action **) (gpRankedList  + ARRAY_SIZE(gpRankedList)) - 1) {
+    while ((ppRanked < (Action **) (gpRankedList  + ARRAY_SIZE(gpRankedList)) - 1) &&
+           (*(ppRanked + 1) != NULL)) {
         CHECK_ACTION_PP(ppRanked);
         CHECK_ACTION_PP(ppRanked + 1);
         // If condition is true, swap them and restart the sort
@@ -349,6 +353,19 @@ void actionAborted(Action *pAction)
     MTX_UNLOCK(gMtx);
 }
 
+// Mark an action as deferred.
+void actionDeferred(Action *pAction)
+{
+    MTX_LOCK(gMtx);
+
+    if (pAction != NULL) {
+        CHECK_ACTION_PP(&pAction);
+        pAction->state = ACTION_STATE_DEFERRED;
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
 // Remove an action from the list.
 void actionRemove(Action *pAction)
 {
@@ -390,11 +407,12 @@ Action *pActionAdd(ActionType type)
     MTX_LOCK(gMtx);
 
     pAction = NULL;
-    // See if there are any NULL, ABORTED or TIMED-OUT entries
-    // that can be re-used
+    // See if there are any NULL, ABORTED, DEFERRED or TIMED-OUT
+    // entries that can be re-used
     for (unsigned int x = 0; (x < ARRAY_SIZE(gActionList)) && (pAction == NULL); x++) {
         if ((gActionList[x].state == ACTION_STATE_NULL) ||
             (gActionList[x].state == ACTION_STATE_ABORTED) ||
+            (gActionList[x].state == ACTION_STATE_DEFERRED) ||
             (gActionList[x].state == ACTION_STATE_TRIED_AND_FAILED)) {
             pAction = &(gActionList[x]);
         }
@@ -487,6 +505,7 @@ ActionType actionRankTypes()
     for (unsigned int x = 0; x < ARRAY_SIZE(gActionList); x++) {
         if ((gActionList[x].state != ACTION_STATE_NULL) &&
             (gActionList[x].state != ACTION_STATE_ABORTED) &&
+            (gActionList[x].state != ACTION_STATE_DEFERRED) &&
             (gActionList[x].state != ACTION_STATE_TRIED_AND_FAILED)) {
             MBED_ASSERT(gActionList[x].type != ACTION_TYPE_NULL);
             (gOccurrence[gActionList[x].type])++;
@@ -724,7 +743,8 @@ void actionPrintList()
     PRINTF("Action list:\n");
     for (unsigned int x = 0; (x < ARRAY_SIZE(gpRankedList)) && (gpRankedList[x] != NULL); x++) {
         if ((gActionList[x].state != ACTION_STATE_NULL) &&
-            (gActionList[x].state != ACTION_STATE_ABORTED)&&
+            (gActionList[x].state != ACTION_STATE_ABORTED) &&
+            (gActionList[x].state != ACTION_STATE_DEFERRED) &&
             (gActionList[x].state != ACTION_STATE_TRIED_AND_FAILED)) {
             printAction(&(gActionList[x]));
             numActions++;
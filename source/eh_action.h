@@ -68,6 +68,7 @@ typedef enum {
     ACTION_STATE_COMPLETED,
     ACTION_STATE_TRIED_AND_FAILED,
     ACTION_STATE_ABORTED,
+    ACTION_STATE_DEFERRED,
     MAX_NUM_ACTION_STATES
 } ActionState;
 
@@ -175,6 +176,16 @@ void actionTriedAndFailed(Action *pAction);
  */
 void actionAborted(Action *pAction);
 
+/** Mark an action as deferred: it was not run, on purpose,
+ * because it is better done later (e.g. a report when radio
+ * conditions are poor).
+ * Note: this has no effect on any data that might
+ * be associated with the action.
+ *
+ * @param pAction pointer to the action to mark as deferred.
+ */
+void actionDeferred(Action *pAction);
+
 /** Remove an action from the list.
  * Note: this has no effect on any data that might
  * be associated with the action.
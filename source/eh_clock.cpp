@@ -0,0 +1,275 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mbed.h> // For PinName, needed by eh_config.h
+#include <string.h> // For memset()
+#include <stddef.h> // For offsetof()
+#include <eh_utilities.h> // For NOINIT and utilitiesChecksum()
+#include <eh_config.h>
+#include <eh_clock.h>
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The state of the clock.
+ */
+typedef struct {
+    time_t lastSetTime;         //!< The time at which the time was last set, 0 if never.
+    time_t sampleStartTime;     //!< The time at which the drift sample began, 0 if none.
+    int sampleErrorSeconds;     //!< How far out the clock was found to be during the sample.
+    time_t lastCorrectedTime;   //!< The time up to which drift has been accounted for.
+    long long int correctionUs; //!< Drift accounted for but not yet corrected.
+} ClockState;
+
+/** The clock, retained across a reset.
+ */
+typedef struct {
+    unsigned int magic;
+    time_t timeUTC;        //!< The time when it was retained.
+    ClockState state;
+    unsigned int checksum;
+} ClockRetained;
+
+/** The drift that has been learnt.
+ */
+typedef struct {
+    unsigned int magic;
+    int driftPpm;          //!< The rate at which the clock loses time.
+    int deviationPpm;      //!< The average deviation of the samples from driftPpm.
+    unsigned int numSamples;
+    unsigned int checksum;
+} ClockDrift;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The retained clock and the drift, in an uninitialised RAM area
+ * so that they survive a reset.
+ */
+static ClockRetained gRetained NOINIT;
+static ClockDrift gDrift NOINIT;
+
+/** The state of the clock.
+ */
+static ClockState gState;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Average a drift sample into the learnt drift.
+static void learn(int samplePpm)
+{
+    int residualPpm = samplePpm - gDrift.driftPpm;
+    int divisor = 1 << CLOCK_DRIFT_LEARNING_SHIFT;
+
+    if (gDrift.numSamples < (unsigned int) divisor) {
+        gDrift.numSamples++;
+        divisor = (int) gDrift.numSamples;
+    }
+    gDrift.driftPpm += residualPpm / divisor;
+    if (residualPpm < 0) {
+        residualPpm = -residualPpm;
+    }
+    gDrift.deviationPpm += (residualPpm - gDrift.deviationPpm) / divisor;
+    gDrift.checksum = utilitiesChecksum(&gDrift, offsetof(ClockDrift, checksum));
+}
+
+// Return the drift, in microseconds, that is due at the
+// given time but has not yet been corrected.
+static long long int correctionDueUs(time_t timeUTC)
+{
+    long long int correctionUs = 0;
+
+    if (gState.lastSetTime != 0) {
+        correctionUs = gState.correctionUs +
+                       ((long long int) (timeUTC - gState.lastCorrectedTime)) *
+                       gDrift.driftPpm;
+    }
+
+    return correctionUs;
+}
+
+// Return the uncertainty in the learnt drift.
+static int uncertaintyPpm()
+{
+    int uncertaintyPpm = gDrift.deviationPpm * 2;
+
+    if (uncertaintyPpm < CLOCK_DRIFT_MIN_UNCERTAINTY_PPM) {
+        uncertaintyPpm = CLOCK_DRIFT_MIN_UNCERTAINTY_PPM;
+    }
+
+    return uncertaintyPpm;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Initialise the clock, restoring the time if it was retained.
+bool clockInit()
+{
+    bool restored = false;
+
+    if ((gDrift.magic != CLOCK_DRIFT_MAGIC) ||
+        (gDrift.checksum != utilitiesChecksum(&gDrift, offsetof(ClockDrift, checksum)))) {
+        memset(&gDrift, 0, sizeof(gDrift));
+        gDrift.magic = CLOCK_DRIFT_MAGIC;
+        gDrift.checksum = utilitiesChecksum(&gDrift, offsetof(ClockDrift, checksum));
+    }
+
+    memset(&gState, 0, sizeof(gState));
+    if ((gRetained.magic == CLOCK_RETAINED_MAGIC) &&
+        (gRetained.checksum == utilitiesChecksum(&gRetained, offsetof(ClockRetained, checksum)))) {
+        // clockRetain() is called immediately before each
+        // reset (in the case of a fatal error, by mbed_die()
+        // once it has finished flashing) and the reset itself
+        // takes a lot less than a second, so the retained time
+        // is as good as it was
+        set_time(gRetained.timeUTC);
+        gState = gRetained.state;
+        // Even so the clock is a little behind and that lag is
+        // not drift, so start a fresh drift sample at the next
+        // clockSet()
+        gState.sampleStartTime = 0;
+        gState.sampleErrorSeconds = 0;
+        restored = true;
+    } else {
+        set_time(0);
+    }
+    gRetained.magic = 0;
+
+    return restored;
+}
+
+// Set the time from an external source, learning the drift.
+void clockSet(time_t timeUTC)
+{
+    time_t elapsedSeconds;
+    long long int samplePpm;
+
+    if ((gState.lastSetTime != 0) && (gState.sampleStartTime != 0)) {
+        // Add how far out the clock is to the sample and, if the
+        // sample is long enough, learn from it
+        gState.sampleErrorSeconds += (int) (timeUTC - time(NULL));
+        elapsedSeconds = timeUTC - gState.sampleStartTime;
+        if (elapsedSeconds >= CLOCK_DRIFT_MIN_SAMPLE_SECONDS) {
+            samplePpm = ((long long int) gState.sampleErrorSeconds) * 1000000 / elapsedSeconds;
+            if ((samplePpm <= CLOCK_DRIFT_MAX_PPM) && (samplePpm >= -CLOCK_DRIFT_MAX_PPM)) {
+                learn((int) samplePpm);
+            }
+            gState.sampleStartTime = 0;
+        }
+    } else {
+        gState.sampleStartTime = 0;
+    }
+    if (gState.sampleStartTime == 0) {
+        gState.sampleStartTime = timeUTC;
+        gState.sampleErrorSeconds = 0;
+    }
+
+    gState.lastSetTime = timeUTC;
+    gState.lastCorrectedTime = timeUTC;
+    gState.correctionUs = 0;
+    set_time(timeUTC);
+}
+
+// Get the correction for drift that is due.
+int clockDriftSeconds()
+{
+    return (int) (correctionDueUs(time(NULL)) / 1000000);
+}
+
+// Correct the clock for drift.
+void clockCorrect(time_t timeUTC)
+{
+    time_t nowUTC = time(NULL);
+    int correctionSeconds = (int) (timeUTC - nowUTC);
+
+    if (gState.lastSetTime != 0) {
+        // Keep what is left over, so that the correction is
+        // not lost a second at a time, and count what has been
+        // corrected in the drift sample
+        gState.correctionUs = correctionDueUs(nowUTC) -
+                              ((long long int) correctionSeconds) * 1000000;
+        gState.lastCorrectedTime = timeUTC;
+        gState.sampleErrorSeconds += correctionSeconds;
+    }
+    set_time(timeUTC);
+}
+
+// Determine whether the time should be updated.
+bool clockUpdateNeeded()
+{
+    bool updateNeeded = true;
+    time_t elapsedSeconds;
+
+    if (gState.lastSetTime != 0) {
+        elapsedSeconds = time(NULL) - gState.lastSetTime;
+        if (gDrift.numSamples < CLOCK_DRIFT_MIN_NUM_SAMPLES) {
+            updateNeeded = (elapsedSeconds >= TIME_UPDATE_INTERVAL_SECONDS);
+        } else {
+            updateNeeded = (clockPredictedErrorSeconds() >= CLOCK_MAX_ERROR_SECONDS) ||
+                           (elapsedSeconds >= CLOCK_UPDATE_MAX_INTERVAL_SECONDS);
+        }
+    }
+
+    return updateNeeded;
+}
+
+// Get the time at which the time was last set.
+time_t clockLastSetTime()
+{
+    return gState.lastSetTime;
+}
+
+// Get the drift that has been learnt.
+int clockDriftPpm(int *pUncertaintyPpm)
+{
+    if (pUncertaintyPpm != NULL) {
+        *pUncertaintyPpm = uncertaintyPpm();
+    }
+
+    return gDrift.driftPpm;
+}
+
+// Get the predicted error in the clock.
+int clockPredictedErrorSeconds()
+{
+    int errorSeconds = -1;
+
+    if ((gState.lastSetTime != 0) &&
+        (gDrift.numSamples >= CLOCK_DRIFT_MIN_NUM_SAMPLES)) {
+        // Plus one for the resolution of the time
+        errorSeconds = (int) (((long long int) (time(NULL) - gState.lastSetTime)) *
+                              uncertaintyPpm() / 1000000) + 1;
+    }
+
+    return errorSeconds;
+}
+
+// Retain the time across the reset that is about to happen.
+void clockRetain()
+{
+    gRetained.magic = CLOCK_RETAINED_MAGIC;
+    gRetained.timeUTC = time(NULL);
+    gRetained.state = gState;
+    gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(ClockRetained, checksum));
+}
+
+// End of file
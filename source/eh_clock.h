@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_CLOCK_H_
+#define _EH_CLOCK_H_
+
+#include <time.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The value at the start of the retained clock when it is valid.
+ */
+#define CLOCK_RETAINED_MAGIC 0x434c4b31
+
+/** The value at the start of the learnt drift when it is valid.
+ */
+#define CLOCK_DRIFT_MAGIC 0x44524631
+
+/** The shortest interval over which a drift sample is taken: the
+ * time is only known to a second so, over six hours, a sample is
+ * good to around 50 ppm; times set more often than this are put
+ * together into one sample.
+ */
+#define CLOCK_DRIFT_MIN_SAMPLE_SECONDS (6 * 3600)
+
+/** A drift sample larger than this is taken to be a bad time
+ * source rather than drift and is ignored.
+ */
+#define CLOCK_DRIFT_MAX_PPM 1000
+
+/** The number of drift samples needed before the drift is taken to
+ * have been learnt; until then the time is updated every
+ * TIME_UPDATE_INTERVAL_SECONDS.
+ */
+#define CLOCK_DRIFT_MIN_NUM_SAMPLES 3
+
+/** The weight given to a new drift sample, as a power of two, as for
+ * FORECAST_LEARNING_SHIFT: until there are this many samples they are
+ * simply averaged.
+ */
+#define CLOCK_DRIFT_LEARNING_SHIFT 2
+
+/** However steady the drift, it is never taken to be known better
+ * than this.
+ */
+#define CLOCK_DRIFT_MIN_UNCERTAINTY_PPM 2
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Initialise the clock; there is no real-time clock on this chip
+ * that survives a reset so, if the time was retained by
+ * clockRetain() just before the reset (in RAM which is not
+ * initialised at start-up), it is restored, along with when the
+ * time was last set, otherwise the clock is started at zero.  The
+ * retained time is only ever used once.  The drift that has been
+ * learnt is kept in the same way but survives any reset that leaves
+ * the RAM intact.  Should be called at start-up before anything
+ * else uses the time.
+ *
+ * @return true if the time was restored, else false.
+ */
+bool clockInit();
+
+/** Set the time from an external source (the network or GNSS),
+ * learning the drift of the clock from how far out it was;
+ * anything that holds times should be adjusted beforehand, since
+ * time(NULL) changes here.
+ *
+ * @param timeUTC the time (UTC Unix).
+ */
+void clockSet(time_t timeUTC);
+
+/** Get the correction for the drift that is due, i.e. the number
+ * of whole seconds the clock has drifted, by the drift learnt so
+ * far, since it was last set or corrected.
+ *
+ * @return the correction in seconds, to be added to time(NULL).
+ */
+int clockDriftSeconds();
+
+/** Correct the clock for drift; as for clockSet() anything that
+ * holds times should be adjusted beforehand.
+ *
+ * @param timeUTC the corrected time, usually time(NULL) plus
+ *                clockDriftSeconds().
+ */
+void clockCorrect(time_t timeUTC);
+
+/** Determine whether the time should be updated from an external
+ * source: always if it has never been set; if the drift has not
+ * yet been learnt, once TIME_UPDATE_INTERVAL_SECONDS have passed;
+ * otherwise once the error predicted from the uncertainty in the
+ * drift reaches CLOCK_MAX_ERROR_SECONDS or once
+ * CLOCK_UPDATE_MAX_INTERVAL_SECONDS have passed.
+ *
+ * @return true if the time should be updated.
+ */
+bool clockUpdateNeeded();
+
+/** Get the time at which the time was last set by clockSet(),
+ * which may have been before a reset.
+ *
+ * @return the time at which the time was last set, zero if it
+ *         has not been set.
+ */
+time_t clockLastSetTime();
+
+/** Get the drift that has been learnt.
+ *
+ * @param pUncertaintyPpm a place to put the uncertainty in the
+ *                        drift in parts per million, may be NULL.
+ * @return                the rate at which the clock loses time
+ *                        (negative if it gains) in parts per
+ *                        million, zero if nothing has been learnt.
+ */
+int clockDriftPpm(int *pUncertaintyPpm);
+
+/** Get the error in the clock that is predicted from the uncertainty
+ * in the drift.
+ *
+ * @return the predicted error in seconds, -1 if the time has not
+ *         been set or the drift has not been learnt.
+ */
+int clockPredictedErrorSeconds();
+
+/** Retain the time so that clockInit() can restore it after the
+ * reset that is about to happen; quick enough to be called from
+ * the watchdog callback.
+ */
+void clockRetain();
+
+#endif // _EH_CLOCK_H_
+
+// End Of File
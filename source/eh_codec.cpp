@@ -76,7 +76,16 @@ static const char *gpDataName[] = {"",    /* DATA_TYPE_NULL */
                                    "nrg", /* DATA_TYPE_ENERGY_SOURCE */
                                    "stt", /* DATA_TYPE_STATISTICS */
                                    "log",  /* DATA_TYPE_LOG */
-                                   "vlt"  /* DATA_TYPE_VOLTAGES */};
+                                   "vlt", /* DATA_TYPE_VOLTAGES */
+                                   "mot", /* DATA_TYPE_MOTION */
+                                   "i2c", /* DATA_TYPE_I2C_STATISTICS */
+                                   "act", /* DATA_TYPE_ACTION_STATISTICS */
+                                   "lpk", /* DATA_TYPE_LOG_PACKED */
+                                   "hep"  /* DATA_TYPE_HEAP_STATISTICS */};
+
+/** The base64 alphabet, for packed log entries.
+ */
+static const char gBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
 /**************************************************************************
  * STATIC FUNCTIONS
@@ -309,15 +318,22 @@ static int encodeDataBle(char *pBuf, int len, DataBle *pData)
     return bytesEncoded;
 }
 
-/** Encode a wake-up reason data item: |,"d":{"rsn":"rtc"}|
+/** Encode a wake-up reason data item: |,"d":{"rsn":"rtc"}| or,
+ * for a magnetic wake-up, |,"d":{"rsn":"MAG","tslx1000":1500}|
  */
 static int encodeDataWakeUpReason(char *pBuf, int len, DataWakeUpReason *pData)
 {
     int bytesEncoded = -1;
     int x;
 
-    // Attempt to snprintf() the string
-    x = snprintf(pBuf, len, ",\"d\":{\"rsn\":\"%s\"}", gpWakeUpReason[pData->reason]);
+    // Attempt to snprintf() the string, adding the field
+    // strength that caused a magnetic wake-up
+    if (pData->reason == WAKE_UP_MAGNETIC) {
+        x = snprintf(pBuf, len, ",\"d\":{\"rsn\":\"%s\",\"tslx1000\":%u}",
+                     gpWakeUpReason[pData->reason], pData->teslaX1000);
+    } else {
+        x = snprintf(pBuf, len, ",\"d\":{\"rsn\":\"%s\"}", gpWakeUpReason[pData->reason]);
+    }
     if ((x > 0) && (x < len)) {// x < len since snprintf() adds a terminator
         bytesEncoded = x;      // but doesn't count it
     }
@@ -460,6 +476,270 @@ static int encodeDataVoltages(char *pBuf, int len, DataVoltages *pData)
     return bytesEncoded;
 }
 
+/** Encode a motion data item: |,"d":{"rmsgx1000":120,"pkgx1000":850,"n":32,"ax":2,"act":1}|
+ */
+static int encodeDataMotion(char *pBuf, int len, DataMotion *pData)
+{
+    int bytesEncoded = -1;
+    int x;
+
+    // Attempt to snprintf() the string
+    x = snprintf(pBuf, len, ",\"d\":{\"rmsgx1000\":%u,\"pkgx1000\":%u,\"n\":%u,\"ax\":%u,\"act\":%u}",
+                 pData->rmsGX1000, pData->peakGX1000, pData->numSamples,
+                 pData->dominantAxis, pData->activity);
+    if ((x > 0) && (x < len)) {// x < len since snprintf() adds a terminator
+        bytesEncoded = x;      // but doesn't count it
+    }
+
+    return bytesEncoded;
+}
+
+/** Encode an I2C statistics data item: |,"d":{"dev":[[118,120,720,0,0,95,3],[82,60,600,1,1,40,0]]}|
+ * where each device is [address,transactions,bytes,errors,retries,bus ms,wait ms].
+ */
+static int encodeDataI2cStatistics(char *pBuf, int len, DataI2cStatistics *pData)
+{
+    int bytesEncoded = -1;
+    bool keepGoing = true;
+    int x;
+    unsigned int y;
+    int total = 0;
+
+    // Attempt to snprintf() the prefix
+    x = snprintf(pBuf, len, ",\"d\":{\"dev\":[");
+    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+        for (y = 0; keepGoing && (y < pData->numDevices) && (y < ARRAY_SIZE(pData->device)); y++) {
+            x = snprintf(pBuf, len, "[%u,%u,%u,%u,%u,%u,%u],", pData->device[y].i2cAddress,
+                         pData->device[y].transactions, pData->device[y].bytes,
+                         pData->device[y].errors, pData->device[y].retries,
+                         pData->device[y].busTimeMs, pData->device[y].waitTimeMs);
+            if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+            } else {
+                keepGoing = false;
+            }
+        }
+        if (keepGoing) {
+            if (y > 0) {
+                // Replace the last comma with a closing square bracket
+                // and add the closing brace
+                *(pBuf - 1) = ']';
+                x = snprintf(pBuf, len, "}");
+            } else {
+                // Didn't go around the loop so add both
+                x = snprintf(pBuf, len, "]}");
+            }
+            if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+                bytesEncoded = total;
+            }
+        }
+    }
+
+    return bytesEncoded;
+}
+
+/** Encode an action statistics data item: |,"d":{"typ":8,"res":[3,1,0,2],"mwt":250,"tms":[0,0,1,2,1,0,0,0],"nwh":[0,0,0,0,3,1,0,0]}|
+ * where "typ" is the action type, "res" is [completed,failed,aborted,deferred], "mwt" the mutex wait in ms and
+ * "tms"/"nwh" the time and energy histograms.
+ */
+static int encodeDataActionStatistics(char *pBuf, int len, DataActionStatistics *pData)
+{
+    int bytesEncoded = -1;
+    bool keepGoing = true;
+    const unsigned short *pHistogram[] = {pData->timeHistogram, pData->energyHistogram};
+    const char *pHistogramName[] = {"tms", "nwh"};
+    int x;
+    int total = 0;
+
+    // Attempt to snprintf() the first portion of the string
+    x = snprintf(pBuf, len, ",\"d\":{\"typ\":%u,\"res\":[%u,%u,%u,%u],\"mwt\":%u",
+                 pData->actionType, pData->numCompleted, pData->numFailed,
+                 pData->numAborted, pData->numDeferred, pData->mutexWaitMs);
+    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+        // Add the histograms
+        for (unsigned int y = 0; keepGoing && (y < ARRAY_SIZE(pHistogram)); y++) {
+            x = snprintf(pBuf, len, ",\"%s\":[", pHistogramName[y]);
+            if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+                for (unsigned int z = 0; keepGoing && (z < DATA_NUM_ACTION_HISTOGRAM_BUCKETS); z++) {
+                    x = snprintf(pBuf, len, "%u,", *(pHistogram[y] + z));
+                    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+                    } else {
+                        keepGoing = false;
+                    }
+                }
+                // Replace the last comma with a closing square bracket
+                *(pBuf - 1) = ']';
+            } else {
+                keepGoing = false;
+            }
+        }
+        if (keepGoing) {
+            x = snprintf(pBuf, len, "}");
+            if ((x > 0) && (x < len)) {   // x < len since snprintf() adds a terminator
+                bytesEncoded = x + total; // but doesn't count it
+            }
+        }
+    }
+
+    return bytesEncoded;
+}
+
+/** Encode bytes as base64 (with padding) without a terminator,
+ * returning the number of characters encoded or -1 if they will not
+ * fit with room to spare for a terminator.
+ */
+static int encodeBase64(char *pBuf, int len, const unsigned char *pData, int size)
+{
+    int bytesEncoded = -1;
+    unsigned int triplet;
+    int x = 0;
+
+    if (((size + 2) / 3) * 4 < len) {
+        for (int y = 0; y < size; y += 3) {
+            triplet = ((unsigned int) *(pData + y)) << 16;
+            if (y + 1 < size) {
+                triplet |= ((unsigned int) *(pData + y + 1)) << 8;
+            }
+            if (y + 2 < size) {
+                triplet |= *(pData + y + 2);
+            }
+            *(pBuf + x) = gBase64[(triplet >> 18) & 0x3F];
+            *(pBuf + x + 1) = gBase64[(triplet >> 12) & 0x3F];
+            *(pBuf + x + 2) = (y + 1 < size) ? gBase64[(triplet >> 6) & 0x3F] : '=';
+            *(pBuf + x + 3) = (y + 2 < size) ? gBase64[triplet & 0x3F] : '=';
+            x += 4;
+        }
+        bytesEncoded = x;
+    }
+
+    return bytesEncoded;
+}
+
+/** Encode a packed log data item: |,"d":{"v":"1.1","i":4,"ts":4294966996,"n":3,"pk":"AwAAyAGsAgEFIP7///8P"}|
+ * where "ts" is the timestamp of the first entry, "n" the number of
+ * entries and "pk" the packed entries as base64.
+ */
+static int encodeDataLogPacked(char *pBuf, int len, DataLogPacked *pData)
+{
+    int bytesEncoded = -1;
+    int numBytes = pData->numBytes;
+    int x;
+    int total = 0;
+
+    if (numBytes > (int) sizeof(pData->packed)) {
+        numBytes = sizeof(pData->packed);
+    }
+    // Attempt to snprintf() the prefix
+    x = snprintf(pBuf, len, ",\"d\":{\"v\":\"%u.%u\",\"i\":%u,\"ts\":%u,\"n\":%u,\"pk\":\"",
+                 pData->logApplicationVersion, pData->logClientVersion,
+                 pData->index, pData->timestamp, pData->numItems);
+    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+        x = encodeBase64(pBuf, len, pData->packed, numBytes);
+        if (x >= 0) {
+            ADVANCE_BUFFER(pBuf, len, x, total);
+            // Add the closing quote and brace
+            x = snprintf(pBuf, len, "\"}");
+            if ((x > 0) && (x < len)) {   // x < len since snprintf() adds a terminator
+                bytesEncoded = x + total; // but doesn't count it
+            }
+        }
+    }
+
+    return bytesEncoded;
+}
+
+/** Encode a heap statistics data item: |,"d":{"fbk":[4096,512,96],"sit":[[2,48,48,48],[12,640,320,480],[0,0,1024,1024],[4,4864,9728,9728]]}|
+ * where "fbk" is the fragmentation map, the sizes of the largest free blocks, and each entry
+ * of "sit" is, for a HeapSite, [allocations,bytes allocated,bytes in use,peak bytes in use].
+ */
+static int encodeDataHeapStatistics(char *pBuf, int len, DataHeapStatistics *pData)
+{
+    int bytesEncoded = -1;
+    bool keepGoing = true;
+    int x;
+    unsigned int y;
+    int total = 0;
+
+    // Attempt to snprintf() the prefix
+    x = snprintf(pBuf, len, ",\"d\":{\"fbk\":[");
+    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+        for (y = 0; keepGoing && (y < pData->numFreeBlocks) && (y < ARRAY_SIZE(pData->freeBlock)); y++) {
+            x = snprintf(pBuf, len, "%u,", pData->freeBlock[y]);
+            if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+            } else {
+                keepGoing = false;
+            }
+        }
+        if (keepGoing) {
+            if (y > 0) {
+                // Replace the last comma with a closing square bracket
+                *(pBuf - 1) = ']';
+                x = snprintf(pBuf, len, ",\"sit\":[");
+            } else {
+                // Didn't go around the loop so add both
+                x = snprintf(pBuf, len, "],\"sit\":[");
+            }
+            if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+                for (y = 0; keepGoing && (y < ARRAY_SIZE(pData->site)); y++) {
+                    x = snprintf(pBuf, len, "[%u,%u,%u,%u],", pData->site[y].numAllocs,
+                                 pData->site[y].bytesAllocated, pData->site[y].bytesInUse,
+                                 pData->site[y].peakBytesInUse);
+                    if ((x > 0) && (x < len)) {               // x < len since snprintf() adds a terminator
+                        ADVANCE_BUFFER(pBuf, len, x, total);  // but doesn't count it
+                    } else {
+                        keepGoing = false;
+                    }
+                }
+                if (keepGoing) {
+                    // Replace the last comma with a closing square bracket
+                    // and add the closing brace
+                    *(pBuf - 1) = ']';
+                    x = snprintf(pBuf, len, "}");
+                    if ((x > 0) && (x < len)) {   // x < len since snprintf() adds a terminator
+                        bytesEncoded = x + total; // but doesn't count it
+                    }
+                }
+            }
+        }
+    }
+
+    return bytesEncoded;
+}
+
+/** Pack an unsigned value as a variable-length integer, returning
+ * the number of bytes used or -1 if it will not fit.
+ */
+static int packVarint(unsigned char *pBuf, int len, unsigned int value)
+{
+    bool done = false;
+    int x = 0;
+
+    while (!done && (x < len)) {
+        *(pBuf + x) = (unsigned char) (value & 0x7F);
+        value >>= 7;
+        done = (value == 0);
+        if (!done) {
+            *(pBuf + x) |= 0x80;
+        }
+        x++;
+    }
+
+    if (!done) {
+        x = -1;
+    }
+
+    return x;
+}
+
 /** Encode a single character, incrementing or decrementing the
  * bracket count.
  */
@@ -558,6 +838,21 @@ static int encodeDataItem(char *pBuf, int len, DataType dataType)
                 case DATA_TYPE_VOLTAGES:
                     x = encodeDataVoltages(pBuf, len, &gpData->contents.voltages);
                 break;
+                case DATA_TYPE_MOTION:
+                    x = encodeDataMotion(pBuf, len, &gpData->contents.motion);
+                break;
+                case DATA_TYPE_I2C_STATISTICS:
+                    x = encodeDataI2cStatistics(pBuf, len, &gpData->contents.i2cStatistics);
+                break;
+                case DATA_TYPE_ACTION_STATISTICS:
+                    x = encodeDataActionStatistics(pBuf, len, &gpData->contents.actionStatistics);
+                break;
+                case DATA_TYPE_LOG_PACKED:
+                    x = encodeDataLogPacked(pBuf, len, &gpData->contents.logPacked);
+                break;
+                case DATA_TYPE_HEAP_STATISTICS:
+                    x = encodeDataHeapStatistics(pBuf, len, &gpData->contents.heapStatistics);
+                break;
                 default:
                     MBED_ASSERT(false);
                 break;
@@ -866,4 +1161,45 @@ CodecErrorOrIndex codecDecodeAck(char *pBuf, int len, const char *pNameString)
     return (CodecErrorOrIndex) returnValue;
 }
 
+// Pack a log entry onto the end of a packed log data item.
+int codecPackLogEntry(DataLogPacked *pData, const LogEntry *pEntry)
+{
+    unsigned char *pBuf = pData->packed + pData->numBytes;
+    int len = sizeof(pData->packed) - pData->numBytes;
+    int total = 0;
+    int x;
+
+    if (pData->numItems == 0) {
+        pData->timestamp = pEntry->timestamp;
+        pData->lastTimestamp = pEntry->timestamp;
+    }
+
+    // The delta is unsigned so that it survives the
+    // timestamp wrapping
+    x = packVarint(pBuf, len, (unsigned int) pEntry->event);
+    if (x > 0) {
+        total += x;
+        x = packVarint(pBuf + total, len - total,
+                       pEntry->timestamp - pData->lastTimestamp);
+        if (x > 0) {
+            total += x;
+            x = packVarint(pBuf + total, len - total,
+                           (((unsigned int) pEntry->parameter) << 1) ^
+                           (unsigned int) (pEntry->parameter >> 31));
+            if (x > 0) {
+                total += x;
+                pData->numBytes += total;
+                pData->lastTimestamp = pEntry->timestamp;
+                pData->numItems++;
+            }
+        }
+    }
+
+    if (x <= 0) {
+        total = -1;
+    }
+
+    return total;
+}
+
 // End of file
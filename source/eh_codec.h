@@ -12,6 +12,8 @@
 #ifndef _EH_CODEC_H_
 #define _EH_CODEC_H_
 
+#include <eh_data.h> // For DataLogPacked and LogEntry
+
 /** The encoded data will look something like this:
  *
  * {
@@ -97,6 +99,12 @@
  */
 #define CODEC_SIZE(codecFlagsAndSize) ((codecFlagsAndSize) & 0xFFFF)
 
+/** The most bytes that codecPackLogEntry() can add for a log entry:
+ * three 32-bit values as variable-length integers of up to five
+ * bytes each.
+ */
+#define CODEC_LOG_PACKED_ENTRY_MAX_BYTES 15
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -228,6 +236,25 @@ int codecGetLastIndex();
  */
 CodecErrorOrIndex codecDecodeAck(char *pBuf, int len, const char *pNameString);
 
+/** Pack a log entry onto the end of a packed log data item.  The
+ * entry is packed as three variable-length integers, seven bits to
+ * a byte, least significant first, the top bit set on all but the
+ * last byte: the event, the time since the previous entry in the
+ * data item (pData->lastTimestamp, or pData->timestamp for the first,
+ * which this sets) and the parameter, zig-zag coded so that small
+ * negative values stay small.  The data item is sent as base64 and
+ * log-decode.py unpacks it.
+ *
+ * @param pData  the packed log data item, which should be zeroed
+ *               before the first entry is packed.
+ * @param pEntry the log entry.
+ * @return       the number of bytes added, negative if there is
+ *               not room for the entry, in which case nothing is
+ *               added; there is always room if there are at least
+ *               CODEC_LOG_PACKED_ENTRY_MAX_BYTES left.
+ */
+int codecPackLogEntry(DataLogPacked *pData, const LogEntry *pEntry);
+
 #endif // _EH_CODEC_H_
 
 // End Of File
@@ -22,10 +22,26 @@
  * MANIFEST CONSTANTS: MISC
  *************************************************************************/
 
-/** How frequently to update time (as a maximum).
+/** How frequently to update time (as a maximum) until the drift
+ * of the clock has been learnt (see eh_clock).
  */
 #define TIME_UPDATE_INTERVAL_SECONDS (24 * 3600)
 
+/** Once the drift of the clock has been learnt, the time is updated
+ * when the error in it, predicted from the uncertainty in the
+ * drift, reaches this.
+ */
+#ifdef MBED_CONF_APP_CLOCK_MAX_ERROR_SECONDS
+# define CLOCK_MAX_ERROR_SECONDS MBED_CONF_APP_CLOCK_MAX_ERROR_SECONDS
+#else
+# define CLOCK_MAX_ERROR_SECONDS 10
+#endif
+
+/** However well the drift of the clock is known, the time is
+ * updated at least this often so that the drift can be checked.
+ */
+#define CLOCK_UPDATE_MAX_INTERVAL_SECONDS (7 * 24 * 3600)
+
 /** The default energy source (1, 2 or 3, can't be 0).
  */
 #ifdef MBED_CONF_APP_ENERGY_SOURCE_DEFAULT
@@ -43,15 +59,34 @@
 # define MAX_DATA_QUEUE_LENGTH_PERCENT 90
 #endif
 
-/** If logging is enabled and it's not only printed-out
- * logging, it's being reporting over the air, then we
- * have to report every wake-up so as to avoid a
- * logging buffer overrun.
+/** Pack log entries into DATA_TYPE_LOG_PACKED data items, which
+ * take around a third of the space per entry, rather than sending them
+ * as DATA_TYPE_LOG arrays of JSON numbers.
+ */
+#ifdef MBED_CONF_APP_LOG_PACKED
+# define LOG_PACKED MBED_CONF_APP_LOG_PACKED
+#else
+# define LOG_PACKED 1
+#endif
+
+/** Logging is enabled and it's not only printed-out
+ * logging, it's being reported over the air.
  */
 #if defined(MBED_CONF_APP_ENABLE_LOGGING) && \
      MBED_CONF_APP_ENABLE_LOGGING && \
      !(defined (MBED_CONF_APP_LOG_PRINT_ONLY) && \
        MBED_CONF_APP_LOG_PRINT_ONLY)
+# define LOGGING_REPORTED 1
+#else
+# define LOGGING_REPORTED 0
+#endif
+
+/** If logging is being reported over the air then, unless
+ * it is packed, we have to report every wake-up so as to avoid
+ * a logging buffer overrun; packed, the log store is instead
+ * emptied into the data queue at the end of every wake-up.
+ */
+#if LOGGING_REPORTED && !LOG_PACKED
 # define LOGGING_NEEDS_REPORTING_EACH_WAKEUP 1
 #else
 # define LOGGING_NEEDS_REPORTING_EACH_WAKEUP 0
@@ -72,6 +107,57 @@
 # define AVOID_FRAGMENTATION 1
 #endif
 
+/** Set this to 1 to use the asynchronous I2C API of mbed, where
+ * the target supports it (DEVICE_I2C_ASYNCH), so that the hardware
+ * (e.g. TWIM with EasyDMA on NRF52) moves the data while the thread
+ * performing the transaction sleeps.
+ */
+#if defined(MBED_CONF_APP_I2C_ASYNCH) && DEVICE_I2C_ASYNCH
+# define I2C_ASYNCH MBED_CONF_APP_I2C_ASYNCH
+#else
+# define I2C_ASYNCH 0
+#endif
+
+/** Set this to 1 to count the traffic on the I2C bus for each device
+ * (see i2cGetStatistics()) and report it with the statistics.
+ */
+#ifdef MBED_CONF_APP_I2C_STATISTICS
+# define I2C_STATISTICS MBED_CONF_APP_I2C_STATISTICS
+#else
+# define I2C_STATISTICS 1
+#endif
+
+/** Set this to 1 to take the fragmentation map of the heap at the end
+ * of each wake-up where the modem is off (see heapMap()) and report
+ * it, with the use of the heap from each HeapSite, with the statistics.
+ */
+#ifdef MBED_CONF_APP_HEAP_STATISTICS
+# define HEAP_STATISTICS MBED_CONF_APP_HEAP_STATISTICS
+#else
+# define HEAP_STATISTICS 1
+#endif
+
+/** Set this to 1 to record the beginning and end of the processor's
+ * activities, the action threads and modem operations in the timeline
+ * store (see eh_timeline.h), which takes TIMELINE_STORE_SIZE bytes of
+ * RAM.
+ */
+#ifdef MBED_CONF_APP_TIMELINE_TRACE
+# define TIMELINE_TRACE MBED_CONF_APP_TIMELINE_TRACE
+#else
+# define TIMELINE_TRACE 0
+#endif
+
+/** Set this to 1, as well as TIMELINE_TRACE, to also record each I2C
+ * transfer and each wait for the I2C bus; there are enough of these
+ * to push everything else out of the timeline store.
+ */
+#ifdef MBED_CONF_APP_TIMELINE_TRACE_I2C
+# define TIMELINE_TRACE_I2C MBED_CONF_APP_TIMELINE_TRACE_I2C
+#else
+# define TIMELINE_TRACE_I2C 0
+#endif
+
 /**************************************************************************
  * MANIFEST CONSTANTS: DEBUG
  *************************************************************************/
@@ -109,6 +195,29 @@
 # define WAKEUP_INTERVAL_SECONDS (60 * 2)
 #endif
 
+/** The shortest interval between wake-ups that the harvest
+ * forecaster (see eh_forecast.h) may choose when energy is
+ * plentiful.  The next wake-up is scheduled when the current one
+ * has finished so wake-ups cannot overlap, however short this is.
+ */
+#ifdef MBED_CONF_APP_WAKEUP_INTERVAL_MIN_SECONDS
+# define WAKEUP_INTERVAL_MIN_SECONDS MBED_CONF_APP_WAKEUP_INTERVAL_MIN_SECONDS
+#else
+# define WAKEUP_INTERVAL_MIN_SECONDS (WAKEUP_INTERVAL_SECONDS / 2)
+#endif
+
+/** The longest interval between wake-ups that the harvest
+ * forecaster may choose, hibernating, when energy is short; the
+ * note on logging for WAKEUP_INTERVAL_SECONDS applies.  Set this
+ * and WAKEUP_INTERVAL_MIN_SECONDS to WAKEUP_INTERVAL_SECONDS
+ * for a fixed wake-up interval.
+ */
+#ifdef MBED_CONF_APP_WAKEUP_INTERVAL_MAX_SECONDS
+# define WAKEUP_INTERVAL_MAX_SECONDS MBED_CONF_APP_WAKEUP_INTERVAL_MAX_SECONDS
+#else
+# define WAKEUP_INTERVAL_MAX_SECONDS (WAKEUP_INTERVAL_SECONDS * 15)
+#endif
+
 /** The maximum run-time of the processor; should be less than the wake-up
  * interval otherwise we will skip wake-up intervals (we won't run a new
  * one when the previous one is still running).
@@ -130,19 +239,31 @@
 # define MAX_RUN_FIRST_TIME_SECONDS  (60 * 6)
 #endif
 
-/** Watchdog timer duration.  The watchdog is fed only at the start of
- * a wake-up and so the watchdog timer duration must be at least the
- * maximum duration of a wake-up plus the maximum value of the
- * wake-up interval.
+/** The interval at which the watchdog is fed.  It is fed from the
+ * wake-up event queue, independently of the wake-up interval, so
+ * that the watchdog still catches a hang when the forecaster has
+ * chosen a long wake-up interval.
+ */
+#ifdef MBED_CONF_APP_WATCHDOG_FEED_INTERVAL_SECONDS
+# define WATCHDOG_FEED_INTERVAL_SECONDS MBED_CONF_APP_WATCHDOG_FEED_INTERVAL_SECONDS
+#else
+# define WATCHDOG_FEED_INTERVAL_SECONDS WAKEUP_INTERVAL_SECONDS
+#endif
+
+/** Watchdog timer duration.  The watchdog is fed every
+ * WATCHDOG_FEED_INTERVAL_SECONDS from the wake-up event queue, which
+ * is blocked while a wake-up is running, and so the watchdog timer
+ * duration must be at least the maximum duration of a wake-up plus
+ * the feed interval.
  */
 #ifdef MBED_CONF_APP_WATCHDOG_INTERVAL_SECONDS
 # define WATCHDOG_INTERVAL_SECONDS MBED_CONF_APP_WATCHDOG_INTERVAL_SECONDS
 #else
-# define WATCHDOG_INTERVAL_SECONDS (MAX_RUN_TIME_SECONDS + WAKEUP_INTERVAL_SECONDS + 30)
+# define WATCHDOG_INTERVAL_SECONDS (MAX_RUN_TIME_SECONDS + WATCHDOG_FEED_INTERVAL_SECONDS + 30)
 #endif
 
 /** The number of seconds for which to keep a history of the energy
- * choices made; must be at least one WAKEUP_INTERVAL_SECONDS.
+ * choices made; must be at least one WAKEUP_INTERVAL_MIN_SECONDS.
  */
 #ifdef MBED_CONF_APP_ENERGY_HISTORY_SECONDS
 # define ENERGY_HISTORY_SECONDS MBED_CONF_APP_ENERGY_HISTORY_SECONDS
@@ -189,6 +310,17 @@
 # define ENABLE_LOCATION 1
 #endif
 
+/** Set this to 1 to only measure the magnetic field when
+ * the magnetometer interrupt goes off, the field strength
+ * that caused it then being carried with WAKE_UP_MAGNETIC,
+ * rather than also measuring it on timed wake-ups.
+ */
+#ifdef MBED_CONF_APP_MAGNETIC_EVENTS_ONLY
+# define MAGNETIC_EVENTS_ONLY MBED_CONF_APP_MAGNETIC_EVENTS_ONLY
+#else
+# define MAGNETIC_EVENTS_ONLY 0
+#endif
+
 /** The maximum time between reports (energy permitting,
  * of course), set to 0 for no maximum time.
  */
@@ -457,6 +589,41 @@
 # define MAX_NUM_REPORT_FAILURES 1
 #endif
 
+/** The maximum time for which reports may be put off
+ * because radio conditions make transmission expensive
+ * (e.g. coverage class 2), measured from the last successful
+ * report; set to 0 to always send reports regardless of
+ * radio conditions.  Data flagged DATA_FLAG_SEND_NOW is
+ * never put off.
+ */
+#ifdef MBED_CONF_APP_REPORT_DEFER_MAX_SECONDS
+# define REPORT_DEFER_MAX_SECONDS MBED_CONF_APP_REPORT_DEFER_MAX_SECONDS
+#else
+# define REPORT_DEFER_MAX_SECONDS (3600 * 6)
+#endif
+
+/** Reports may be put off if the estimated energy cost of
+ * transmitting a byte under the current radio conditions
+ * exceeds the running average by this percentage.
+ */
+#ifdef MBED_CONF_APP_REPORT_DEFER_COST_PERCENT
+# define REPORT_DEFER_COST_PERCENT MBED_CONF_APP_REPORT_DEFER_COST_PERCENT
+#else
+# define REPORT_DEFER_COST_PERCENT 200
+#endif
+
+/** How long the estimated energy cost of transmitting a byte,
+ * measured the last time the modem was registered, is taken to
+ * hold.  While the modem is off a report may be put off on that
+ * estimate without powering the modem up; once it is older than
+ * this the modem is powered up to measure radio conditions again.
+ */
+#ifdef MBED_CONF_APP_REPORT_DEFER_COST_VALID_SECONDS
+# define REPORT_DEFER_COST_VALID_SECONDS MBED_CONF_APP_REPORT_DEFER_COST_VALID_SECONDS
+#else
+# define REPORT_DEFER_COST_VALID_SECONDS 3600
+#endif
+
 /**************************************************************************
  * MANIFEST CONSTANTS: PINS
  *************************************************************************/
@@ -552,6 +719,31 @@
 # define PIN_INT_ACCELERATION        NINA_B1_GPIO_22
 #endif
 
+/** Input pin connected to the (active low) interrupt output of the
+ * light sensor, only defined if it is wired up; if it is not then
+ * the end of a light measurement is timed from the light sensor's
+ * configuration instead.
+ */
+#ifdef MBED_CONF_APP_PIN_INT_LIGHT
+# define PIN_INT_LIGHT              MBED_CONF_APP_PIN_INT_LIGHT
+#endif
+
+/** Input pin connected to the TX-ready output of the GNSS chip,
+ * only defined if it is wired up; if it is not then the GNSS
+ * chip is checked periodically for data instead.
+ */
+#ifdef MBED_CONF_APP_PIN_GNSS_TX_READY
+# define PIN_GNSS_TX_READY          MBED_CONF_APP_PIN_GNSS_TX_READY
+#endif
+
+/** The PIO of the GNSS chip that is wired to PIN_GNSS_TX_READY.
+ */
+#ifdef MBED_CONF_APP_GNSS_TX_READY_PIO
+# define GNSS_TX_READY_PIO          MBED_CONF_APP_GNSS_TX_READY_PIO
+#else
+# define GNSS_TX_READY_PIO          6
+#endif
+
 /** Analogue input pin for measuring VIN.
  */
 #ifdef MBED_CONF_APP_PIN_ANALOGUE_VIN
@@ -702,6 +894,40 @@
 # define SI7210_ACTIVE_HIGH true
 #endif
 
+/** The digital filter for the SI7210 (see act_si7210.h for definition).
+ */
+#ifdef MBED_CONF_APP_SI7210_FILTER
+# define SI7210_FILTER MBED_CONF_APP_SI7210_FILTER
+#else
+# define SI7210_FILTER 1
+#endif
+
+/** The bandwidth of the SI7210 digital filter (see act_si7210.h for
+ * definition).
+ */
+#ifdef MBED_CONF_APP_SI7210_FILTER_BANDWIDTH
+# define SI7210_FILTER_BANDWIDTH MBED_CONF_APP_SI7210_FILTER_BANDWIDTH
+#else
+# define SI7210_FILTER_BANDWIDTH 2
+#endif
+
+/** The SI7210 burst size (see act_si7210.h for definition).
+ */
+#ifdef MBED_CONF_APP_SI7210_BURST_SIZE
+# define SI7210_BURST_SIZE MBED_CONF_APP_SI7210_BURST_SIZE
+#else
+# define SI7210_BURST_SIZE 0
+#endif
+
+/** The tamper threshold for the SI7210, 0 for none (see act_si7210.h
+ * for definition).
+ */
+#ifdef MBED_CONF_APP_SI7210_TAMPER_THRESHOLD_TESLAX1000
+# define SI7210_TAMPER_THRESHOLD_TESLAX1000 MBED_CONF_APP_SI7210_TAMPER_THRESHOLD_TESLAX1000
+#else
+# define SI7210_TAMPER_THRESHOLD_TESLAX1000 0
+#endif
+
 /**************************************************************************
  * MANIFEST CONSTANTS: BLE
  * Note: most of these taken from
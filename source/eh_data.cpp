@@ -18,6 +18,7 @@
 #include <stddef.h> // for offsetof()
 #include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK(()
 #include <eh_data.h>
+#include <eh_timeline.h>
 
 /**************************************************************************
  * MANIFEST CONSTANTS
@@ -27,6 +28,14 @@
  */
 #define TO_WORDS(bytes) (((bytes) / 4) + (((bytes) % 4) == 0 ? 0 : 1))
 
+/** Convert a pointer into gpBuffer to the int stored at the end of a
+ * block to link it to the next, and back again: the link is the word
+ * index plus one, zero meaning NULL, so that it fits in an int whatever
+ * the size of a pointer.
+ */
+#define TO_LINK(pWord) ((int) ((pWord) - gpBuffer) + 1)
+#define FROM_LINK(link) ((link) == 0 ? NULL : gpBuffer + (link) - 1)
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
@@ -88,7 +97,12 @@ const size_t gDataSizeOfContents[] = {0, /* DATA_TYPE_NULL */
                                       sizeof(DataEnergySource), /* DATA_TYPE_ENERGY_SOURCE */
                                       sizeof(DataStatistics), /* DATA_TYPE_STATISTICS */
                                       sizeof(DataLog), /* DATA_TYPE_LOG */
-                                      sizeof(DataVoltages) /* DATA_TYPE_VOLTAGES */};
+                                      sizeof(DataVoltages), /* DATA_TYPE_VOLTAGES */
+                                      sizeof(DataMotion), /* DATA_TYPE_MOTION */
+                                      sizeof(DataI2cStatistics), /* DATA_TYPE_I2C_STATISTICS */
+                                      sizeof(DataActionStatistics), /* DATA_TYPE_ACTION_STATISTICS */
+                                      sizeof(DataLogPacked), /* DATA_TYPE_LOG_PACKED */
+                                      sizeof(DataHeapStatistics) /* DATA_TYPE_HEAP_STATISTICS */};
 
 
 /**************************************************************************
@@ -111,12 +125,12 @@ static void advanceMemoryPointers(int mallocSizeWords)
     if (gpBufferPreviousNext != NULL) {
         // Set the pointer at the end of the previous
         // entry to point to this one
-        *gpBufferPreviousNext = (int) gpBufferNextEmpty;
+        *gpBufferPreviousNext = TO_LINK(gpBufferNextEmpty);
     }
     gpBufferNextEmpty += mallocSizeWords;
     // Set pointer to next entry on this one to NULL
     gpBufferPreviousNext = gpBufferNextEmpty - 1;
-    *gpBufferPreviousNext = (int) NULL;
+    *gpBufferPreviousNext = 0;
     // Check if gpBufferNextEmpty was right on the edge and
     // so needs to be wrapped
     if (gpBufferNextEmpty >= gpBuffer + DATA_MAX_SIZE_WORDS) {
@@ -143,7 +157,11 @@ static Data *pMemoryAlloc(DataType type, bool allocNotCheck, unsigned int *pByte
         // allocate from it
         if (gpBufferFirstFull == NULL) {
             gpBufferPreviousNext = NULL;
-            // Empty case
+            // Empty case: start again from the beginning of the
+            // buffer, else a block that doesn't fit between
+            // wherever the last one ended and the end of the
+            // buffer can't be allocated from an empty buffer
+            gpBufferNextEmpty = gpBuffer;
             if (gpBufferNextEmpty - gpBuffer + mallocSizeWords <= DATA_MAX_SIZE_WORDS) {
                 pData = (Data *) gpBufferNextEmpty;
                 if (allocNotCheck) {
@@ -243,9 +261,9 @@ static unsigned int memoryFree(Data *pData)
                 // Move the "first full" pointer on to the
                 // one stored at the end of the current
                 // data block
-                gpBufferFirstFull = (int *) *(gpBufferFirstFull +
-                                              (TO_WORDS(offsetof(Data, contents) +
-                                                        gDataSizeOfContents[pData->type])));
+                gpBufferFirstFull = FROM_LINK(*(gpBufferFirstFull +
+                                                (TO_WORDS(offsetof(Data, contents) +
+                                                          gDataSizeOfContents[pData->type]))));
                 bytesFreed += (TO_WORDS(offsetof(Data, contents) + gDataSizeOfContents[pData->type]) + 1) * 4;
                 // Set pData to the next block (may be NULL)
                 pData = (Data *) gpBufferFirstFull;
@@ -393,6 +411,14 @@ int dataDifference(const Data *pData1, const Data *pData2)
             // Deliberate fall-through
         case DATA_TYPE_STATISTICS:
             // Deliberate fall-through
+        case DATA_TYPE_I2C_STATISTICS:
+            // Deliberate fall-through
+        case DATA_TYPE_ACTION_STATISTICS:
+            // Deliberate fall-through
+        case DATA_TYPE_LOG_PACKED:
+            // Deliberate fall-through
+        case DATA_TYPE_HEAP_STATISTICS:
+            // Deliberate fall-through
         case DATA_TYPE_LOG:
             difference = 1;
             // For all of these return 1 as they are not measurements,
@@ -409,6 +435,14 @@ int dataDifference(const Data *pData1, const Data *pData2)
                 difference = x;
             }
         break;
+        case DATA_TYPE_MOTION:
+            // For motion use the larger of the RMS and peak values
+            difference = pData1->contents.motion.rmsGX1000 - pData2->contents.motion.rmsGX1000;
+            x = pData1->contents.motion.peakGX1000 - pData2->contents.motion.peakGX1000;
+            if (abs(x) > abs(difference)) {
+                difference = x;
+            }
+        break;
         default:
             MBED_ASSERT(false);
         break;
@@ -474,15 +508,20 @@ Data *pDataAlloc(Action *pAction, DataType type, unsigned char flags,
 void dataFree(Data **ppData)
 {
     Data **ppThis;
+    Data *pData;
     Data *pNext;
     unsigned int x;
 
     MTX_LOCK(gMtx);
 
     if ((ppData != NULL) && ((*ppData) != NULL)) {
+        // Work on a copy of the pointer since ppData may well
+        // be the address of the pData of the action it is
+        // attached to, which is set to NULL below
+        pData = *ppData;
         // Check that we have a valid pointer by finding it in the list
         ppThis = &(gpDataList);
-        while ((*ppThis != NULL) && (*ppThis != *ppData)) {
+        while ((*ppThis != NULL) && (*ppThis != pData)) {
             ppThis = &((*ppThis)->pNext);
         }
 
@@ -490,23 +529,23 @@ void dataFree(Data **ppData)
             actionLockList();
             // Find the action that is pointing at this
             // data item and set its data pointer to NULL
-            if ((*ppData)->pAction != NULL) {
-                (*ppData)->pAction->pData = NULL;
+            if (pData->pAction != NULL) {
+                pData->pAction->pData = NULL;
             }
             actionUnlockList();
 
             // Seal up the list
-            if ((*ppData)->pPrevious != NULL) {
-                ((*ppData)->pPrevious)->pNext = (*ppData)->pNext;
+            if (pData->pPrevious != NULL) {
+                (pData->pPrevious)->pNext = pData->pNext;
             }
             // In case we're at the root or gpNextData, remember
             // where the next item is
-            pNext = (*ppData)->pNext;
-            if ((*ppData)->pNext != NULL) {
-                (*ppData)->pNext->pPrevious = (*ppData)->pPrevious;
+            pNext = pData->pNext;
+            if (pData->pNext != NULL) {
+                pData->pNext->pPrevious = pData->pPrevious;
             }
             // Free this item
-            x = memoryFree(*ppData);
+            x = memoryFree(pData);
             if (gDataSizeUsed >= x) {
                 gDataSizeUsed -= x;
             }
@@ -579,12 +618,36 @@ int dataCountType(DataType type)
     return x;
 }
 
+// Count the number of data items with any of the given flags set.
+int dataCountFlags(unsigned char flags)
+{
+    Data **ppThis;
+    int x;
+
+    MTX_LOCK(gMtx);
+
+    x = 0;
+    ppThis = &(gpDataList);
+    while (*ppThis != NULL) {
+        if (((*ppThis)->flags & flags) != 0) {
+            x++;
+        }
+        ppThis = &((*ppThis)->pNext);
+    }
+
+    MTX_UNLOCK(gMtx);
+
+    return x;
+}
+
 // Sort the data list.
 Data *pDataSort()
 {
     MTX_LOCK(gMtx);
 
+    TIMELINE_BEGIN(TIMELINE_ID_DATA_SORT, 0);
     sort(conditionFlags);
+    TIMELINE_END(TIMELINE_ID_DATA_SORT, 0);
     gpNextData = gpDataList;
 
     MTX_UNLOCK(gMtx);
@@ -24,6 +24,30 @@
  */
 #define DATA_MAX_LEN_BLE_DEVICE_NAME 12
 
+/** The maximum number of devices in an I2C statistics data item:
+ * there are five on the board; any more would make the encoded
+ * item bigger than a log item.
+ */
+#define DATA_MAX_NUM_I2C_DEVICES 6
+
+/** The number of buckets in each of the histograms of an action
+ * statistics data item.
+ */
+#define DATA_NUM_ACTION_HISTOGRAM_BUCKETS 8
+
+/** The number of bytes of packed log entries in a packed log data
+ * item: at a typical five or six bytes per entry this holds around
+ * twice as many entries as a DataLog in less space and, since it is
+ * sent base64-encoded, its encoding is still smaller than that of
+ * a DataLog.
+ */
+#define DATA_LOG_PACKED_MAX_BYTES 100
+
+/** The maximum number of free blocks in the fragmentation map of a
+ * heap statistics data item.
+ */
+#define DATA_MAX_NUM_HEAP_FREE_BLOCKS 8
+
 /** A guard timer on the sorting algorithm.  This is set to a large
  * number in order to allow unit tests, in which all of RAM is filled-up
  * with data items, to complete.
@@ -83,6 +107,11 @@ typedef enum {
     DATA_TYPE_STATISTICS,
     DATA_TYPE_LOG,
     DATA_TYPE_VOLTAGES,
+    DATA_TYPE_MOTION,
+    DATA_TYPE_I2C_STATISTICS,
+    DATA_TYPE_ACTION_STATISTICS,
+    DATA_TYPE_LOG_PACKED,
+    DATA_TYPE_HEAP_STATISTICS,
     MAX_NUM_DATA_TYPES
 } DataType;
 
@@ -174,6 +203,7 @@ typedef enum {
  */
 typedef struct {
     WakeUpReason reason; /**< The wake-up reason.*/
+    unsigned int teslaX1000; /**< For WAKE_UP_MAGNETIC, the field strength that caused it in thousandths of a Tesla.*/
 } DataWakeUpReason;
 
 /** Data struct for energy source.
@@ -224,6 +254,109 @@ typedef struct {
     int vPrimaryMV;
 } DataVoltages;
 
+/** The activity classes for motion.
+ */
+typedef enum {
+    MOTION_ACTIVITY_STILL,
+    MOTION_ACTIVITY_MOVING,
+    MOTION_ACTIVITY_VIGOROUS,
+    MAX_NUM_MOTION_ACTIVITIES
+} MotionActivity;
+
+/** Data struct for motion, features extracted from a stream of
+ * acceleration samples.
+ */
+typedef struct {
+    unsigned short rmsGX1000; /**< RMS of the dynamic (gravity removed) acceleration in thousandths of a gravity.*/
+    unsigned short peakGX1000; /**< Peak dynamic acceleration in thousandths of a gravity.*/
+    unsigned char numSamples; /**< The number of samples the features were extracted from.*/
+    unsigned char dominantAxis; /**< The axis with the most dynamic acceleration: 0 for x, 1 for y, 2 for z.*/
+    unsigned char activity; /**< The activity class, a MotionActivity.*/
+} DataMotion;
+
+/** The I2C traffic statistics for one device.
+ */
+typedef struct {
+    unsigned char i2cAddress; /**< The 7-bit I2C address of the device.*/
+    unsigned int transactions; /**< The number of transactions since initial power-on.*/
+    unsigned int bytes; /**< The number of bytes sent and received since initial power-on.*/
+    unsigned short errors; /**< The number of failed transactions since initial power-on.*/
+    unsigned short retries; /**< The number of transactions that followed a failure since initial power-on.*/
+    unsigned int busTimeMs; /**< The time spent performing transactions since initial power-on.*/
+    unsigned int waitTimeMs; /**< The time spent waiting for the bus since initial power-on.*/
+} DataI2cDevice;
+
+/** Data struct for I2C statistics.
+ */
+typedef struct {
+    unsigned int numDevices; /**< The number of entries in the following array.*/
+    DataI2cDevice device[DATA_MAX_NUM_I2C_DEVICES];
+} DataI2cStatistics;
+
+/** Data struct for the statistics of one action type, accumulated
+ * since the last one was reported; the histogram buckets are
+ * log-scale, see statisticsActionEnd() and the
+ * STATISTICS_*_HISTOGRAM_* constants in eh_statistics.h for the
+ * boundaries.
+ */
+typedef struct {
+    unsigned char actionType; /**< The ActionType these statistics are for.*/
+    unsigned short numCompleted; /**< The number of actions that completed.*/
+    unsigned short numFailed; /**< The number of actions that were tried and failed.*/
+    unsigned short numAborted; /**< The number of actions that ended without completing, failing or being deferred, e.g. for lack of energy or time.*/
+    unsigned short numDeferred; /**< The number of actions that were deferred, e.g. a report put off for poor radio conditions.*/
+    unsigned int mutexWaitMs; /**< The time the actions spent waiting for a shared resource (modem or I2C).*/
+    unsigned short timeHistogram[DATA_NUM_ACTION_HISTOGRAM_BUCKETS]; /**< The number of actions in each bucket of execution time.*/
+    unsigned short energyHistogram[DATA_NUM_ACTION_HISTOGRAM_BUCKETS]; /**< The number of actions in each bucket of estimated energy.*/
+} DataActionStatistics;
+
+/** Data struct for a portion of logging, packed (see
+ * codecPackLogEntry()): for each entry the event, the
+ * time since the previous entry (or since timestamp for
+ * the first) and the parameter, as variable-length integers.
+ */
+typedef struct {
+    unsigned int logClientVersion; /**< The version of the log client compiled into the target.*/
+    unsigned int logApplicationVersion; /**< The version of the application logging compiled into the target.*/
+    unsigned int index; /**< The index of this log entry (starts at zero and increments for each entry) */
+    unsigned int numItems; /**< The number of log entries packed into the following array.*/
+    unsigned int timestamp; /**< The timestamp of the first log entry.*/
+    unsigned int lastTimestamp; /**< The timestamp of the last log entry, which the next one is relative to.*/
+    unsigned char numBytes; /**< The number of bytes used in the following array.*/
+    unsigned char packed[DATA_LOG_PACKED_MAX_BYTES];
+} DataLogPacked;
+
+/** The places from which the heap is used, as counted by
+ * heapCountAlloc(); order is important, it is the order in which
+ * they are reported.
+ */
+typedef enum {
+    HEAP_SITE_OTHER, /**< Anything else that is counted, e.g. timers.*/
+    HEAP_SITE_BLE, /**< The BLE device list and its data containers.*/
+    HEAP_SITE_MODEM, /**< The cellular interface.*/
+    HEAP_SITE_THREAD, /**< Threads, including their stacks.*/
+    MAX_NUM_HEAP_SITES
+} HeapSite;
+
+/** The use of the heap from one HeapSite.
+ */
+typedef struct {
+    unsigned short numAllocs; /**< The number of allocations since the last report.*/
+    unsigned int bytesAllocated; /**< The number of bytes allocated since the last report.*/
+    unsigned int bytesInUse; /**< The number of bytes allocated and not yet freed.*/
+    unsigned int peakBytesInUse; /**< The peak of bytesInUse since the last report.*/
+} DataHeapSite;
+
+/** Data struct for heap statistics: the fragmentation map, as it was
+ * when last taken (see heapMap()), and the use of the heap from each
+ * HeapSite.
+ */
+typedef struct {
+    unsigned char numFreeBlocks; /**< The number of entries in the following array.*/
+    unsigned short freeBlock[DATA_MAX_NUM_HEAP_FREE_BLOCKS]; /**< The sizes of the largest free blocks, largest first.*/
+    DataHeapSite site[MAX_NUM_HEAP_SITES];
+} DataHeapStatistics;
+
 /** A union of all the possible data structs.
  */
 typedef union {
@@ -241,6 +374,11 @@ typedef union {
     DataStatistics statistics;
     DataLog log;
     DataVoltages voltages;
+    DataMotion motion;
+    DataI2cStatistics i2cStatistics;
+    DataActionStatistics actionStatistics;
+    DataLogPacked logPacked;
+    DataHeapStatistics heapStatistics;
 } DataContents;
 
 /** The possible types of flag in a data
@@ -351,6 +489,15 @@ int dataCount();
  */
 int dataCountType(DataType type);
 
+/** Count the number of data items which have any of
+ * the given flags set.
+ *
+ * @param flags the flags (see DataFlag) to look for.
+ * @return      the number of data items with any of those
+ *              flags set.
+ */
+int dataCountFlags(unsigned char flags);
+
 /** Sort the data list.  The list is sorted in the following order:
  *
  * 1. Items with the flag DATA_FLAG_SEND_NOW in time order, newest first.
@@ -19,6 +19,7 @@
 #include <log.h>
 #include <eh_morse.h>
 #include <eh_config.h>
+#include <eh_clock.h>
 #include <eh_debug.h>
 
 /**************************************************************************
@@ -90,6 +91,9 @@ void mbed_die(void)
         }
     }
 
+    // Retain the time only now, after the flashing, so that
+    // it is not behind when restored
+    clockRetain();
     NVIC_SystemReset();
 }
 
@@ -0,0 +1,213 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <string.h> // for memset()
+#include <stddef.h> // For offsetof()
+#include <mbed.h> // For PinName, needed by eh_config.h
+#include <eh_utilities.h> // For NOINIT and utilitiesChecksum()
+#include <eh_config.h>
+#include <act_energy_source.h> // For ENERGY_SOURCES_MAX_NUM
+#include <eh_forecast.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+// A bounds check for the time: before this the time has not been set
+#define EARLIEST_TIME 1529687605
+
+// The number of seconds in a time-of-day slot
+#define SLOT_SECONDS (3600 * 24 / FORECAST_NUM_SLOTS)
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A learnt harvest rate.
+ */
+typedef struct {
+    int harvestNW;
+    unsigned int count;
+} ForecastSlot;
+
+/** What has been learnt, retained across a reset.
+ */
+typedef struct {
+    unsigned int magic;
+    ForecastSlot slot[ENERGY_SOURCES_MAX_NUM][FORECAST_NUM_SLOTS]; //!< Each time-of-day slot.
+    ForecastSlot anyTime[ENERGY_SOURCES_MAX_NUM];                  //!< Any time of day.
+    unsigned int checksum;
+} ForecastRetained;
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The harvest rate of each energy source, in an uninitialised
+ * RAM area so that what has been learnt survives a reset.
+ */
+static ForecastRetained gRetained NOINIT;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Average a harvest estimate into a slot.
+static void learn(ForecastSlot *pSlot, int harvestNW)
+{
+    if (pSlot->count < (1 << FORECAST_LEARNING_SHIFT)) {
+        pSlot->count++;
+        pSlot->harvestNW += (harvestNW - pSlot->harvestNW) / (int) pSlot->count;
+    } else {
+        pSlot->harvestNW += (harvestNW - pSlot->harvestNW) / (1 << FORECAST_LEARNING_SHIFT);
+    }
+}
+
+// Return the time-of-day slot a time falls in.
+static int slotIndex(time_t timeUTC)
+{
+    return (int) ((timeUTC % (3600 * 24)) / SLOT_SECONDS);
+}
+
+// Clamp a wake-up interval to the allowed range.
+static int clampInterval(long long int intervalSeconds)
+{
+    if (intervalSeconds < WAKEUP_INTERVAL_MIN_SECONDS) {
+        intervalSeconds = WAKEUP_INTERVAL_MIN_SECONDS;
+    }
+    if (intervalSeconds > WAKEUP_INTERVAL_MAX_SECONDS) {
+        intervalSeconds = WAKEUP_INTERVAL_MAX_SECONDS;
+    }
+
+    return (int) intervalSeconds;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Initialise the forecaster, restoring what was learnt if it was retained.
+bool forecastInit()
+{
+    bool restored = true;
+
+    if ((gRetained.magic != FORECAST_RETAINED_MAGIC) ||
+        (gRetained.checksum != utilitiesChecksum(&gRetained, offsetof(ForecastRetained, checksum)))) {
+        forecastReset();
+        restored = false;
+    }
+
+    return restored;
+}
+
+// Forget everything that has been learnt.
+void forecastReset()
+{
+    memset(&gRetained, 0, sizeof(gRetained));
+    gRetained.magic = FORECAST_RETAINED_MAGIC;
+    gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(ForecastRetained, checksum));
+}
+
+// Learn from a harvest estimate.
+void forecastUpdate(unsigned char energySource, time_t timeUTC, int harvestNW)
+{
+    if ((energySource > 0) && (energySource <= ENERGY_SOURCES_MAX_NUM)) {
+        if (harvestNW < 0) {
+            harvestNW = 0;
+        }
+        learn(&(gRetained.anyTime[energySource - 1]), harvestNW);
+        if (timeUTC >= EARLIEST_TIME) {
+            learn(&(gRetained.slot[energySource - 1][slotIndex(timeUTC)]), harvestNW);
+        }
+        gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(ForecastRetained, checksum));
+    }
+}
+
+// Get the forecast harvest rate.
+bool forecastHarvestNW(unsigned char energySource, time_t timeUTC, int *pHarvestNW)
+{
+    ForecastSlot *pSlot = NULL;
+
+    *pHarvestNW = 0;
+    if ((energySource > 0) && (energySource <= ENERGY_SOURCES_MAX_NUM)) {
+        if (timeUTC >= EARLIEST_TIME) {
+            pSlot = &(gRetained.slot[energySource - 1][slotIndex(timeUTC)]);
+        }
+        if ((pSlot == NULL) || (pSlot->count == 0)) {
+            pSlot = &(gRetained.anyTime[energySource - 1]);
+        }
+        if (pSlot->count > 0) {
+            *pHarvestNW = pSlot->harvestNW;
+        } else {
+            pSlot = NULL;
+        }
+    }
+
+    return (pSlot != NULL);
+}
+
+// Get the energy that can be spent on actions now.
+unsigned long long int forecastEnergyBudgetNWH(unsigned char energySource,
+                                               time_t timeUTC,
+                                               unsigned long long int energyAvailableNWH,
+                                               unsigned int idleNW)
+{
+    unsigned long long int reserveNWH = 0;
+    time_t seconds = 0;
+    int harvestNW;
+
+    if ((timeUTC >= EARLIEST_TIME) &&
+        forecastHarvestNW(energySource, timeUTC, &harvestNW)) {
+        // Walk forward through the slots until one is forecast
+        // to harvest more than is used sleeping
+        for (int x = 0; (x < FORECAST_NUM_SLOTS) && (harvestNW <= (int) idleNW); x++) {
+            seconds += SLOT_SECONDS - ((timeUTC + seconds) % SLOT_SECONDS);
+            forecastHarvestNW(energySource, timeUTC + seconds, &harvestNW);
+        }
+        reserveNWH = ((unsigned long long int) seconds) * idleNW / 3600;
+    }
+
+    return (energyAvailableNWH > reserveNWH) ? energyAvailableNWH - reserveNWH : 0;
+}
+
+// Get the interval until the next wake-up.
+int forecastWakeUpIntervalSeconds(unsigned char energySource, time_t timeUTC,
+                                  unsigned long long int energyAvailableNWH,
+                                  unsigned long long int wakeUpEnergyNWH,
+                                  unsigned int idleNW)
+{
+    int intervalSeconds = WAKEUP_INTERVAL_SECONDS;
+    long long int surplusNW;
+    int harvestNW;
+
+    if (forecastHarvestNW(energySource, timeUTC, &harvestNW)) {
+        surplusNW = ((long long int) harvestNW) - idleNW +
+                    (long long int) (forecastEnergyBudgetNWH(energySource, timeUTC,
+                                                             energyAvailableNWH,
+                                                             idleNW) *
+                                     3600 / FORECAST_SPEND_SECONDS);
+        if (surplusNW <= 0) {
+            intervalSeconds = WAKEUP_INTERVAL_MAX_SECONDS;
+        } else {
+            intervalSeconds = clampInterval(((long long int) wakeUpEnergyNWH) * 3600 / surplusNW);
+        }
+    }
+
+    return intervalSeconds;
+}
+
+// End of file
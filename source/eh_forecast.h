@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_FORECAST_H_
+#define _EH_FORECAST_H_
+
+#include <time.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The value at the start of the retained forecast when it is valid.
+ */
+#define FORECAST_RETAINED_MAGIC 0x46434331
+
+/** The number of time-of-day slots over which the harvest rate of
+ * each energy source is learnt, i.e. one per hour.
+ */
+#define FORECAST_NUM_SLOTS 24
+
+/** The weight given to a new harvest estimate when it is averaged
+ * into its slot, as a power of two: a shift of 2 means that each new
+ * estimate counts for a quarter, so a slot forgets a cloudy day in
+ * a few days.  Until a slot has this many estimates they are simply
+ * averaged.
+ */
+#define FORECAST_LEARNING_SHIFT 2
+
+/** The period over which energy stored beyond the reserve is
+ * spent when working out the wake-up interval.
+ */
+#define FORECAST_SPEND_SECONDS 3600
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Initialise the forecaster.  What has been learnt is kept in RAM
+ * which is not initialised at start-up, with a checksum, so that
+ * it survives a reset; if it is valid it is restored, otherwise
+ * the forecaster starts from nothing.
+ *
+ * @return true if what was learnt was restored, else false.
+ */
+bool forecastInit();
+
+/** Forget everything the forecaster has learnt.
+ */
+void forecastReset();
+
+/** Learn from a harvest estimate.  Until the time is known (i.e.
+ * has been set from the network or GNSS) only an any-time average
+ * is learnt for the energy source; after that the estimate is also
+ * averaged into the time-of-day slot it falls in.
+ *
+ * @param energySource the energy source, 1 to ENERGY_SOURCES_MAX_NUM.
+ * @param timeUTC      the time at which the estimate was made.
+ * @param harvestNW    the rate at which the energy source was harvesting,
+ *                     in nanoWatts; negative values are taken as zero.
+ */
+void forecastUpdate(unsigned char energySource, time_t timeUTC, int harvestNW);
+
+/** Get the forecast harvest rate for an energy source at a given
+ * time: the time-of-day slot if it has been learnt, otherwise the
+ * any-time average.
+ *
+ * @param energySource the energy source, 1 to ENERGY_SOURCES_MAX_NUM.
+ * @param timeUTC      the time to forecast for.
+ * @param pHarvestNW   a place to put the forecast in nanoWatts, may
+ *                     not be NULL.
+ * @return             true if there was a forecast, false if nothing
+ *                     has been learnt for the energy source (in which
+ *                     case *pHarvestNW is set to zero).
+ */
+bool forecastHarvestNW(unsigned char energySource, time_t timeUTC, int *pHarvestNW);
+
+/** Get the energy that can be spent on actions now.  This is the
+ * energy available less a reserve that keeps the device sleeping
+ * until the energy source is next forecast to harvest more than the
+ * idle power of the device (e.g. through the night for solar).  If
+ * nothing has been learnt for the energy source, or the time is not
+ * known, there is no reserve.
+ *
+ * @param energySource       the energy source, 1 to ENERGY_SOURCES_MAX_NUM.
+ * @param timeUTC            the time now.
+ * @param energyAvailableNWH the energy available, as returned by
+ *                           getEnergyAvailableNWH().
+ * @param idleNW             the power consumed while sleeping.
+ * @return                   the energy budget in nanoWatt hours.
+ */
+unsigned long long int forecastEnergyBudgetNWH(unsigned char energySource,
+                                               time_t timeUTC,
+                                               unsigned long long int energyAvailableNWH,
+                                               unsigned int idleNW);
+
+/** Get the interval until the next wake-up: the interval at which
+ * the forecast harvest less the idle power, plus the energy budget
+ * spent over FORECAST_SPEND_SECONDS, pays for a wake-up.  The result
+ * is limited to WAKEUP_INTERVAL_MIN_SECONDS to
+ * WAKEUP_INTERVAL_MAX_SECONDS, the maximum being used when there is
+ * nothing to spare; if nothing has been learnt for the energy source
+ * WAKEUP_INTERVAL_SECONDS is returned.
+ *
+ * @param energySource       the energy source, 1 to ENERGY_SOURCES_MAX_NUM.
+ * @param timeUTC            the time now.
+ * @param energyAvailableNWH the energy available, as returned by
+ *                           getEnergyAvailableNWH().
+ * @param wakeUpEnergyNWH    the energy a wake-up typically costs.
+ * @param idleNW             the power consumed while sleeping.
+ * @return                   the wake-up interval in seconds.
+ */
+int forecastWakeUpIntervalSeconds(unsigned char energySource, time_t timeUTC,
+                                  unsigned long long int energyAvailableNWH,
+                                  unsigned long long int wakeUpEnergyNWH,
+                                  unsigned int idleNW);
+
+#endif // _EH_FORECAST_H_
+
+// End Of File
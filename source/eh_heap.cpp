@@ -0,0 +1,266 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mbed.h> // For Mutex
+#include <mbed_stats.h> // For mbed_stats_heap_get()
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset() and memcpy()
+#include <eh_utilities.h> // For MTX_LOCK()/MTX_UNLOCK() and ARRAY_SIZE()
+#include <eh_heap.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+// The largest count of allocations
+#define MAX_NUM_ALLOCS 0xFFFF
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** Mutex to protect the counts, which are updated from any thread.
+ */
+static Mutex gMtx;
+
+/** The use of the heap from each site.
+ */
+static DataHeapSite gSite[MAX_NUM_HEAP_SITES];
+
+/** The number of free blocks in the last fragmentation map.
+ */
+static int gNumFreeBlocks = 0;
+
+/** The sizes of the free blocks in the last fragmentation map.
+ */
+static unsigned short gFreeBlock[DATA_MAX_NUM_HEAP_FREE_BLOCKS];
+
+/** Incremented on every counted use of the heap, so that a
+ * measurement can tell if anything else used the heap meanwhile.
+ */
+static unsigned int gActivity = 0;
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Note a use of the heap that is about to happen.
+static void noteActivity()
+{
+    MTX_LOCK(gMtx);
+    gActivity++;
+    MTX_UNLOCK(gMtx);
+}
+
+// Return the number of bytes of heap in use, zero if the
+// heap statistics are not enabled.
+static unsigned int heapInUse()
+{
+    mbed_stats_heap_t stats;
+
+    mbed_stats_heap_get(&stats);
+
+    return stats.current_size;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Count an allocation.
+void heapCountAlloc(HeapSite site, unsigned int size)
+{
+    DataHeapSite *pSite;
+
+    if (site < MAX_NUM_HEAP_SITES) {
+        MTX_LOCK(gMtx);
+        gActivity++;
+        pSite = &(gSite[site]);
+        if (pSite->numAllocs < MAX_NUM_ALLOCS) {
+            pSite->numAllocs++;
+        }
+        pSite->bytesAllocated += size;
+        pSite->bytesInUse += size;
+        if (pSite->bytesInUse > pSite->peakBytesInUse) {
+            pSite->peakBytesInUse = pSite->bytesInUse;
+        }
+        MTX_UNLOCK(gMtx);
+    }
+}
+
+// Count a free.
+void heapCountFree(HeapSite site, unsigned int size)
+{
+    DataHeapSite *pSite;
+
+    if (site < MAX_NUM_HEAP_SITES) {
+        MTX_LOCK(gMtx);
+        gActivity++;
+        pSite = &(gSite[site]);
+        if (size < pSite->bytesInUse) {
+            pSite->bytesInUse -= size;
+        } else {
+            pSite->bytesInUse = 0;
+        }
+        MTX_UNLOCK(gMtx);
+    }
+}
+
+// malloc(), counting the allocation.
+void *pHeapMalloc(HeapSite site, unsigned int size)
+{
+    void *pMemory;
+
+    // Noted beforehand as well as when counted so that a
+    // measurement can't end in between
+    noteActivity();
+    pMemory = malloc(size);
+    if (pMemory != NULL) {
+        heapCountAlloc(site, size);
+    }
+
+    return pMemory;
+}
+
+// free(), counting it.
+void heapFree(HeapSite site, void *pMemory, unsigned int size)
+{
+    if (pMemory != NULL) {
+        noteActivity();
+        free(pMemory);
+        heapCountFree(site, size);
+    }
+}
+
+// Start measuring the heap taken by something.
+void heapMeasureStart(HeapMeasure *pMeasure)
+{
+    MTX_LOCK(gMtx);
+    pMeasure->activityBefore = gActivity;
+    MTX_UNLOCK(gMtx);
+    pMeasure->heapBefore = heapInUse();
+}
+
+// End a heap measurement and count the result.
+unsigned int heapMeasureEnd(HeapMeasure *pMeasure, HeapSite site,
+                            unsigned int minSize)
+{
+    unsigned int heapAfter = heapInUse();
+    unsigned int bytes;
+
+    MTX_LOCK(gMtx);
+    if ((gActivity == pMeasure->activityBefore) &&
+        (heapAfter > pMeasure->heapBefore)) {
+        pMeasure->bytes = heapAfter - pMeasure->heapBefore;
+    }
+    MTX_UNLOCK(gMtx);
+
+    bytes = pMeasure->bytes;
+    if (bytes < minSize) {
+        bytes = minSize;
+    }
+    heapCountAlloc(site, bytes);
+
+    return bytes;
+}
+
+// Find the largest free block by binary search.
+unsigned int heapLargestFreeBlock(unsigned int maxSize)
+{
+    unsigned int lower = 0;
+    unsigned int upper;
+    unsigned int size;
+    void *pMemory;
+
+    if (maxSize > HEAP_PROBE_MAX_BYTES) {
+        maxSize = HEAP_PROBE_MAX_BYTES;
+    }
+
+    // lower is always a size that fits, upper one that doesn't
+    upper = maxSize;
+    pMemory = malloc(maxSize);
+    if (pMemory != NULL) {
+        free(pMemory);
+        lower = maxSize;
+    }
+    while (upper - lower > HEAP_PROBE_RESOLUTION_BYTES) {
+        size = (lower + upper) / 2;
+        pMemory = malloc(size);
+        if (pMemory != NULL) {
+            free(pMemory);
+            lower = size;
+        } else {
+            upper = size;
+        }
+    }
+
+    return lower;
+}
+
+// Take the fragmentation map.
+unsigned int heapMap()
+{
+    void *pBlock[DATA_MAX_NUM_HEAP_FREE_BLOCKS];
+    unsigned short freeBlock[DATA_MAX_NUM_HEAP_FREE_BLOCKS];
+    unsigned int size;
+    int numFreeBlocks = 0;
+
+    // Hold each free block while looking for the next largest
+    do {
+        size = heapLargestFreeBlock(HEAP_PROBE_MAX_BYTES);
+        if (size >= HEAP_MAP_MIN_BLOCK_BYTES) {
+            pBlock[numFreeBlocks] = malloc(size);
+            if (pBlock[numFreeBlocks] != NULL) {
+                freeBlock[numFreeBlocks] = (unsigned short) size;
+                numFreeBlocks++;
+            } else {
+                size = 0;
+            }
+        }
+    } while ((size >= HEAP_MAP_MIN_BLOCK_BYTES) &&
+             (numFreeBlocks < (int) ARRAY_SIZE(pBlock)));
+
+    for (int x = numFreeBlocks - 1; x >= 0; x--) {
+        free(pBlock[x]);
+    }
+
+    MTX_LOCK(gMtx);
+    memcpy(gFreeBlock, freeBlock, numFreeBlocks * sizeof(freeBlock[0]));
+    gNumFreeBlocks = numFreeBlocks;
+    MTX_UNLOCK(gMtx);
+
+    return (numFreeBlocks > 0) ? freeBlock[0] : 0;
+}
+
+// Get the heap statistics and reset them.
+void heapGetStatistics(DataHeapStatistics *pStatistics)
+{
+    if (pStatistics != NULL) {
+        MTX_LOCK(gMtx);
+        memset(pStatistics, 0, sizeof(*pStatistics));
+        pStatistics->numFreeBlocks = (unsigned char) gNumFreeBlocks;
+        memcpy(pStatistics->freeBlock, gFreeBlock, gNumFreeBlocks * sizeof(gFreeBlock[0]));
+        memcpy(pStatistics->site, gSite, sizeof(pStatistics->site));
+        for (unsigned int x = 0; x < ARRAY_SIZE(gSite); x++) {
+            gSite[x].numAllocs = 0;
+            gSite[x].bytesAllocated = 0;
+            gSite[x].peakBytesInUse = gSite[x].bytesInUse;
+        }
+        MTX_UNLOCK(gMtx);
+    }
+}
+
+// End of file
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_HEAP_H_
+#define _EH_HEAP_H_
+
+#include <eh_data.h> // For HeapSite and DataHeapStatistics
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The largest free block that is looked for: more than there is RAM
+ * on the chip and still fits in the unsigned short of a heap
+ * statistics data item.
+ */
+#define HEAP_PROBE_MAX_BYTES 0xFFF0
+
+/** The resolution to which the size of a free block is found.
+ */
+#define HEAP_PROBE_RESOLUTION_BYTES 16
+
+/** Free blocks smaller than this are not included in the
+ * fragmentation map.
+ */
+#define HEAP_MAP_MIN_BLOCK_BYTES 64
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** A measurement of the heap taken by something that allocates
+ * internally, see heapMeasureStart(); keep one for each thing
+ * measured, zeroed to begin with, as it remembers the last
+ * measurement that could be believed.
+ */
+typedef struct {
+    unsigned int heapBefore; /**< The heap in use at the start.*/
+    unsigned int activityBefore; /**< The counted heap activity at the start.*/
+    unsigned int bytes; /**< The last measurement that could be believed, zero if none.*/
+} HeapMeasure;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Count an allocation from the heap against a site; to be called
+ * next to malloc() or new, once it has succeeded.
+ *
+ * @param site the place the allocation is made from.
+ * @param size the number of bytes allocated.
+ */
+void heapCountAlloc(HeapSite site, unsigned int size);
+
+/** Count the freeing of an allocation that was counted by
+ * heapCountAlloc(); to be called next to free() or delete.
+ *
+ * @param site the place the allocation was made from.
+ * @param size the number of bytes that were allocated.
+ */
+void heapCountFree(HeapSite site, unsigned int size);
+
+/** malloc(), counting the allocation against a site.
+ *
+ * @param site the place the allocation is made from.
+ * @param size the number of bytes to allocate.
+ * @return     a pointer to the memory, NULL on failure.
+ */
+void *pHeapMalloc(HeapSite site, unsigned int size);
+
+/** free() memory that was allocated with pHeapMalloc().
+ *
+ * @param site    the place the allocation was made from.
+ * @param pMemory the memory, may be NULL.
+ * @param size    the number of bytes that were allocated.
+ */
+void heapFree(HeapSite site, void *pMemory, unsigned int size);
+
+/** Start measuring the heap taken by something that allocates
+ * internally (e.g. a driver that creates its own serial port,
+ * buffers and threads) from the change in the heap in use; see
+ * heapMeasureEnd().
+ *
+ * @param pMeasure the measurement.
+ */
+void heapMeasureStart(HeapMeasure *pMeasure);
+
+/** End a measurement started with heapMeasureStart(), counting the
+ * heap taken against a site.  The change in the heap in use is only
+ * believed if no other heap activity was counted meanwhile (all of
+ * the application's own use of the heap is counted, see
+ * heapCountAlloc()), since another thread allocating or freeing at
+ * the same time would pollute it; otherwise the last measurement that
+ * was believed is counted, or minSize if there has been none.
+ *
+ * @param pMeasure the measurement.
+ * @param site     the site to count the heap taken against.
+ * @param minSize  the least that can have been taken (e.g. the size
+ *                 of the driver object).
+ * @return         the number of bytes counted against the site, to
+ *                 be given to heapCountFree() when the thing that
+ *                 was measured is deleted.
+ */
+unsigned int heapMeasureEnd(HeapMeasure *pMeasure, HeapSite site,
+                            unsigned int minSize);
+
+/** Find the largest block that could be allocated from the heap
+ * right now, by trying to allocate it, to within
+ * HEAP_PROBE_RESOLUTION_BYTES.  Never holds more than maxSize bytes
+ * at any one time.
+ *
+ * @param maxSize the largest size of interest, at most
+ *                HEAP_PROBE_MAX_BYTES.
+ * @return        the size of the largest free block, maxSize if
+ *                a block of that size is free.
+ */
+unsigned int heapLargestFreeBlock(unsigned int maxSize);
+
+/** Take the fragmentation map of the heap: the sizes of the largest
+ * free blocks, up to DATA_MAX_NUM_HEAP_FREE_BLOCKS of them, found by
+ * allocating the largest free block, then the next largest, etc.,
+ * and then freeing them all again.  While this is done the heap is
+ * all but empty so this must only be called when no other thread
+ * might allocate memory, e.g. when the action threads have been
+ * terminated.  The map is kept for heapGetStatistics().
+ *
+ * @return the size of the largest free block, zero if there
+ *         are no free blocks of HEAP_MAP_MIN_BLOCK_BYTES or more.
+ */
+unsigned int heapMap();
+
+/** Get the heap statistics: the fragmentation map, as last taken by
+ * heapMap(), and the use of the heap from each site since this was
+ * last called, which is then reset.
+ *
+ * @param pStatistics a place to put the statistics.
+ */
+void heapGetStatistics(DataHeapStatistics *pStatistics);
+
+#endif // _EH_HEAP_H_
+
+// End Of File
@@ -15,14 +15,25 @@
  */
 
 #include <mbed.h> // for I2C
-#include <eh_config.h> // For PIN_ENABLE_1V8
-#include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK()
+#include <eh_config.h> // For PIN_ENABLE_1V8, I2C_ASYNCH, I2C_STATISTICS and TIMELINE_TRACE_I2C
+#include <eh_utilities.h> // for MTX_LOCK()/MTX_UNLOCK() and ARRAY_SIZE()
 #include <eh_i2c.h>
+#include <eh_statistics.h> // For statisticsAddMutexWait()
+#include <eh_timeline.h>
 
 /**************************************************************************
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+// The I2C spans only go into the timeline if TIMELINE_TRACE_I2C is set.
+#if TIMELINE_TRACE_I2C
+# define I2C_TIMELINE_BEGIN(id, param) TIMELINE_BEGIN(id, param)
+# define I2C_TIMELINE_END(id, param) TIMELINE_END(id, param)
+#else
+# define I2C_TIMELINE_BEGIN(id, param)
+# define I2C_TIMELINE_END(id, param)
+#endif
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
@@ -35,6 +46,51 @@ static I2C *gpI2c = NULL;
  */
 static Mutex gMtx;
 
+/** Mutex to protect the transaction queue.
+ */
+static Mutex gQueueMtx;
+
+/** The transaction queue.
+ */
+static I2CTransaction *gpQueueHead = NULL;
+static I2CTransaction *gpQueueTail = NULL;
+
+/** Set while a thread is working through the queue.
+ */
+static bool gQueueBusy = false;
+
+/** Buffer for merged reads.
+ */
+static char gMergeBuffer[I2C_MAX_MERGED_READ_SIZE];
+
+#if I2C_ASYNCH
+/** Semaphore released when an asynchronous transfer has completed.
+ */
+static Semaphore gTransferSemaphore(0);
+
+/** The event that completed an asynchronous transfer.
+ */
+static volatile int gTransferEvent;
+#endif
+
+#if I2C_STATISTICS
+/** Timer for the statistics.
+ */
+static Timer gTimer;
+
+/** The statistics for each device.
+ */
+static I2CStatistics gStatistics[I2C_STATISTICS_MAX_NUM_DEVICES];
+
+/** Whether the last transaction with each device failed.
+ */
+static bool gLastFailed[I2C_STATISTICS_MAX_NUM_DEVICES];
+
+/** The number of entries in gStatistics.
+ */
+static int gNumStatistics = 0;
+#endif
+
 /** Remember SDA pin so that we can tidy it up on deinit().
  */
 static PinName gSda;
@@ -47,6 +103,313 @@ static PinName gScl;
  * STATIC FUNCTIONS
  *************************************************************************/
 
+#if I2C_ASYNCH
+// Callback for the end of an asynchronous transfer.
+static void transferCallback(int event)
+{
+    gTransferEvent = event;
+    gTransferSemaphore.release();
+}
+#endif
+
+#if I2C_STATISTICS
+// Find the statistics entry for a device, adding one if
+// there is room, returning -1 if there is not; gMtx must
+// be locked.
+static int statisticsIndex(char i2cAddress)
+{
+    int index = -1;
+
+    for (int x = 0; (index < 0) && (x < gNumStatistics); x++) {
+        if (gStatistics[x].i2cAddress == i2cAddress) {
+            index = x;
+        }
+    }
+    if ((index < 0) && (gNumStatistics < (int) ARRAY_SIZE(gStatistics))) {
+        index = gNumStatistics;
+        memset(&(gStatistics[index]), 0, sizeof(gStatistics[index]));
+        gStatistics[index].i2cAddress = i2cAddress;
+        gLastFailed[index] = false;
+        gNumStatistics++;
+    }
+
+    return index;
+}
+
+// Account for a transaction with a device which started at
+// startUs; gMtx must be locked.
+static void statisticsTransaction(char i2cAddress, int bytesSent,
+                                  I2CReceivedOrError receivedOrError,
+                                  int startUs)
+{
+    int index = statisticsIndex(i2cAddress);
+
+    if (index >= 0) {
+        gStatistics[index].transactions++;
+        if (gLastFailed[index]) {
+            gStatistics[index].retries++;
+        }
+        gLastFailed[index] = (receivedOrError < 0);
+        if (receivedOrError < 0) {
+            gStatistics[index].errors++;
+        } else {
+            gStatistics[index].bytesSent += bytesSent;
+            gStatistics[index].bytesReceived += receivedOrError;
+        }
+        gStatistics[index].busTimeUs += gTimer.read_us() - startUs;
+    }
+}
+
+// Account for the time a device has waited for the bus since
+// startUs; gMtx must be locked.
+static void statisticsWait(char i2cAddress, int startUs)
+{
+    int index = statisticsIndex(i2cAddress);
+
+    if (index >= 0) {
+        gStatistics[index].waitTimeUs += gTimer.read_us() - startUs;
+    }
+}
+#endif
+
+// Perform a send and/or receive with the hardware;
+// gMtx must be locked.
+static I2CReceivedOrError transfer(char i2cAddress, const char *pSend,
+                                   int bytesToSend, char *pReceive,
+                                   int bytesToReceive)
+{
+    I2CReceivedOrError receivedOrError = I2C_RESULT_ERROR_NOT_INITIALISED;
+#if I2C_STATISTICS
+    char address = i2cAddress;
+    int startUs = gTimer.read_us();
+#endif
+
+    I2C_TIMELINE_BEGIN(TIMELINE_ID_I2C_TRANSFER, i2cAddress);
+
+    if (gpI2c != NULL) {
+        // Mbed uses an 8-bit address, shifted up from 7
+        i2cAddress <<= 1;
+#if I2C_ASYNCH
+        // Let the hardware (e.g. TWIM with EasyDMA on NRF52) do the
+        // work while this thread sleeps
+        receivedOrError = I2C_RESULT_ERROR_SEND_FAILED;
+        if (pSend == NULL) {
+            receivedOrError = I2C_RESULT_ERROR_RECEIVE_FAILED;
+        }
+        gTransferEvent = 0;
+        if (gpI2c->transfer(i2cAddress, pSend, bytesToSend, pReceive, bytesToReceive,
+                            callback(transferCallback), I2C_EVENT_ALL, false) == 0) {
+            if (gTransferSemaphore.wait(I2C_ASYNCH_TIMEOUT_MS) > 0) {
+                if ((gTransferEvent & I2C_EVENT_TRANSFER_COMPLETE) != 0) {
+                    receivedOrError = I2C_RESULT_OK;
+                    if (pReceive != NULL) {
+                        receivedOrError = bytesToReceive;
+                    }
+                }
+            } else {
+                // Stop the hardware so that a late callback can't
+                // release the semaphore into the next transfer, then
+                // mop up any callback that got in before the abort
+                gpI2c->abort_transfer();
+                while (gTransferSemaphore.wait(0) > 0) {}
+            }
+        }
+#else
+        receivedOrError = I2C_RESULT_OK;
+        if (pSend != NULL) {
+            // Set repeated start if there is something to receive
+            if (gpI2c->write(i2cAddress, pSend, bytesToSend, (pReceive != NULL)) != 0) {
+                receivedOrError = I2C_RESULT_ERROR_SEND_FAILED;
+            }
+        }
+        if (receivedOrError != I2C_RESULT_ERROR_SEND_FAILED) {
+            if (pReceive != NULL) {
+                if (gpI2c->read(i2cAddress, pReceive, bytesToReceive) == 0) {
+                    receivedOrError = bytesToReceive;
+                } else {
+                    receivedOrError = I2C_RESULT_ERROR_RECEIVE_FAILED;
+                }
+            }
+        }
+#endif
+#if I2C_STATISTICS
+        statisticsTransaction(address, bytesToSend, receivedOrError, startUs);
+#endif
+    }
+
+    I2C_TIMELINE_END(TIMELINE_ID_I2C_TRANSFER, receivedOrError);
+
+    return receivedOrError;
+}
+
+// Determine whether pNext reads the registers of the same device
+// that follow on from those read by the chain of merged transactions
+// ending at pLast, mergedSize bytes having been read so far.
+static bool canMerge(const I2CTransaction *pLast, const I2CTransaction *pNext,
+                     int mergedSize)
+{
+    return (pNext != NULL) &&
+           ((pLast->flags & I2C_FLAG_REGISTER_AUTO_INCREMENT) != 0) &&
+           ((pNext->flags & I2C_FLAG_REGISTER_AUTO_INCREMENT) != 0) &&
+           (pNext->i2cAddress == pLast->i2cAddress) &&
+           (pLast->bytesToSend == 1) && (pNext->bytesToSend == 1) &&
+           (pLast->pReceive != NULL) && (pNext->pReceive != NULL) &&
+           (pNext->pSend[0] == (char) (pLast->pSend[0] + pLast->bytesToReceive)) &&
+           (mergedSize + pNext->bytesToReceive <= I2C_MAX_MERGED_READ_SIZE);
+}
+
+// Take the next transaction, and any that can be merged with
+// it, off the queue, returning NULL (and marking the queue as
+// no longer busy) if there is nothing left.
+static I2CTransaction *pQueueTake(int *pMergedSize)
+{
+    I2CTransaction *pFirst;
+    I2CTransaction *pLast;
+
+    MTX_LOCK(gQueueMtx);
+
+    pFirst = gpQueueHead;
+    if (pFirst != NULL) {
+        pLast = pFirst;
+        *pMergedSize = pFirst->bytesToReceive;
+        while (canMerge(pLast, pLast->pNext, *pMergedSize)) {
+            pLast = pLast->pNext;
+            *pMergedSize += pLast->bytesToReceive;
+        }
+        gpQueueHead = pLast->pNext;
+        if (gpQueueHead == NULL) {
+            gpQueueTail = NULL;
+        }
+        pLast->pNext = NULL;
+    } else {
+        gQueueBusy = false;
+    }
+
+    MTX_UNLOCK(gQueueMtx);
+
+    return pFirst;
+}
+
+// Work through the queue.
+static void queueRun()
+{
+    I2CTransaction *pTransaction;
+    I2CTransaction *pNext;
+    I2CReceivedOrError receivedOrError;
+    int mergedSize = 0;
+    int offset;
+    unsigned int waitStartUs;
+
+    while ((pTransaction = pQueueTake(&mergedSize)) != NULL) {
+        waitStartUs = us_ticker_read();
+        I2C_TIMELINE_BEGIN(TIMELINE_ID_I2C_MUTEX_WAIT, pTransaction->i2cAddress);
+        MTX_LOCK(gMtx);
+        I2C_TIMELINE_END(TIMELINE_ID_I2C_MUTEX_WAIT, pTransaction->i2cAddress);
+        statisticsAddMutexWait(us_ticker_read() - waitStartUs);
+
+#if I2C_STATISTICS
+        for (I2CTransaction *pWaited = pTransaction; pWaited != NULL; pWaited = pWaited->pNext) {
+            statisticsWait(pWaited->i2cAddress, pWaited->submitTimeUs);
+        }
+#endif
+        if (pTransaction->pNext == NULL) {
+            pTransaction->result = transfer(pTransaction->i2cAddress,
+                                            pTransaction->pSend,
+                                            pTransaction->bytesToSend,
+                                            pTransaction->pReceive,
+                                            pTransaction->bytesToReceive);
+        } else {
+            // Read the lot in one go, starting from the
+            // register address of the first, and share it out
+            receivedOrError = transfer(pTransaction->i2cAddress,
+                                       pTransaction->pSend, 1,
+                                       gMergeBuffer, mergedSize);
+            offset = 0;
+            for (I2CTransaction *pMerged = pTransaction; pMerged != NULL; pMerged = pMerged->pNext) {
+                pMerged->result = receivedOrError;
+                if (receivedOrError == mergedSize) {
+                    memcpy(pMerged->pReceive, gMergeBuffer + offset, pMerged->bytesToReceive);
+                    pMerged->result = pMerged->bytesToReceive;
+                }
+                offset += pMerged->bytesToReceive;
+            }
+        }
+
+        MTX_UNLOCK(gMtx);
+
+        // Call the callbacks outside the lock, noting that
+        // the transaction may cease to exist once its callback
+        // has been called
+        while (pTransaction != NULL) {
+            pNext = pTransaction->pNext;
+            if (pTransaction->pCallback != NULL) {
+                pTransaction->pCallback(pTransaction, pTransaction->pCallbackParam);
+            }
+            pTransaction = pNext;
+        }
+    }
+}
+
+// Callback used by i2cSendReceive() and i2cSendReceiveMany().
+static void sendReceiveCallback(I2CTransaction *pTransaction, void *pParam)
+{
+    (void) pTransaction;
+    ((Semaphore *) pParam)->release();
+}
+
+// Queue a number of transactions, all together so that they may
+// be merged, and work through the queue if no-one else is.
+static I2CResult submit(I2CTransaction *pTransactions, int numTransactions)
+{
+    I2CResult result = I2C_RESULT_ERROR_INVALID_PARAMETER;
+    I2CTransaction *pTransaction;
+    bool runQueue = false;
+
+    if ((pTransactions != NULL) && (numTransactions > 0)) {
+        result = I2C_RESULT_OK;
+        for (int x = 0; (result == I2C_RESULT_OK) && (x < numTransactions); x++) {
+            pTransaction = pTransactions + x;
+            if (((pTransaction->i2cAddress & 0x80) != 0) ||
+                ((pTransaction->pSend == NULL) && (pTransaction->bytesToSend != 0)) ||
+                ((pTransaction->pReceive == NULL) && (pTransaction->bytesToReceive != 0))) {
+                result = I2C_RESULT_ERROR_INVALID_PARAMETER;
+            }
+        }
+    }
+
+    if (result == I2C_RESULT_OK) {
+        MTX_LOCK(gQueueMtx);
+
+        for (int x = 0; x < numTransactions; x++) {
+            pTransaction = pTransactions + x;
+            pTransaction->result = I2C_RESULT_ERROR_NOT_INITIALISED;
+            pTransaction->pNext = NULL;
+#if I2C_STATISTICS
+            pTransaction->submitTimeUs = gTimer.read_us();
+#endif
+            if (gpQueueTail != NULL) {
+                gpQueueTail->pNext = pTransaction;
+            } else {
+                gpQueueHead = pTransaction;
+            }
+            gpQueueTail = pTransaction;
+        }
+        // If no-one is working through the queue, it's us
+        if (!gQueueBusy) {
+            gQueueBusy = true;
+            runQueue = true;
+        }
+
+        MTX_UNLOCK(gQueueMtx);
+
+        if (runQueue) {
+            queueRun();
+        }
+    }
+
+    return result;
+}
+
 /**************************************************************************
  * PUBLIC FUNCTIONS
  *************************************************************************/
@@ -60,6 +423,10 @@ void i2cInit(PinName sda, PinName scl)
         gpI2c = new I2C(sda, scl);
         gSda = sda;
         gScl = scl;
+#if I2C_STATISTICS
+        gTimer.reset();
+        gTimer.start();
+#endif
     }
 
     MTX_UNLOCK(gMtx);
@@ -107,6 +474,9 @@ void i2cDeinit()
 #endif
 
         gpI2c = NULL;
+#if I2C_STATISTICS
+        gTimer.stop();
+#endif
     }
 
     MTX_UNLOCK(gMtx);
@@ -124,50 +494,56 @@ void i2cSetFrequency(int frequencyHz)
     MTX_UNLOCK(gMtx);
 }
 
-// Send and/or receive over the I2C interface.
-I2CReceivedOrError i2cSendReceive(char i2cAddress, const char *pSend,
-                                  int bytesToSend, char *pReceive,
-                                  int bytesReceived)
+// Queue a transaction.
+I2CResult i2cSubmit(I2CTransaction *pTransaction)
 {
-    I2CReceivedOrError receivedOrError;
-    bool repeatedStart;
+    return submit(pTransaction, 1);
+}
 
-    MTX_LOCK(gMtx);
+// Perform a set of transactions, merging where possible.
+I2CResult i2cSendReceiveMany(I2CTransaction *pTransactions, int numTransactions)
+{
+    I2CResult result;
+    Semaphore done(0);
 
-    receivedOrError = I2C_RESULT_ERROR_NOT_INITIALISED;
-    // Set repeated start if there is something to receive
-    repeatedStart = (pReceive != NULL);
+    for (int x = 0; x < numTransactions; x++) {
+        (pTransactions + x)->pCallback = sendReceiveCallback;
+        (pTransactions + x)->pCallbackParam = &done;
+    }
 
-    if (gpI2c != NULL) {
-        if ((i2cAddress & 0x80) != 0) {
-            receivedOrError = I2C_RESULT_ERROR_INVALID_PARAMETER;
-        } else if ((pSend == NULL) && (bytesToSend != 0)) {
-            receivedOrError = I2C_RESULT_ERROR_INVALID_PARAMETER;
-        } else if ((pReceive == NULL) && (bytesReceived != 0)) {
-            receivedOrError = I2C_RESULT_ERROR_INVALID_PARAMETER;
-        } else {
-            // Mbed uses an 8-bit address, shifted up from 7
-            i2cAddress <<= 1;
-            if (pSend != NULL) {
-                if (gpI2c->write(i2cAddress, pSend, bytesToSend, repeatedStart) != 0) {
-                    receivedOrError = I2C_RESULT_ERROR_SEND_FAILED;
-                }
-            }
-            if (receivedOrError != I2C_RESULT_ERROR_SEND_FAILED) {
-                if (pReceive != NULL) {
-                    if (gpI2c->read(i2cAddress, pReceive, bytesReceived) == 0) {
-                        receivedOrError = bytesReceived;
-                    } else {
-                        receivedOrError = I2C_RESULT_ERROR_RECEIVE_FAILED;
-                    }
-                } else {
-                    receivedOrError = I2C_RESULT_OK;
-                }
-            }
+    result = submit(pTransactions, numTransactions);
+    if (result == I2C_RESULT_OK) {
+        for (int x = 0; x < numTransactions; x++) {
+            done.wait();
         }
     }
 
-    MTX_UNLOCK(gMtx);
+    return result;
+}
+
+// Send and/or receive over the I2C interface.
+I2CReceivedOrError i2cSendReceive(char i2cAddress, const char *pSend,
+                                  int bytesToSend, char *pReceive,
+                                  int bytesReceived)
+{
+    I2CReceivedOrError receivedOrError;
+    I2CTransaction transaction;
+    Semaphore done(0);
+
+    transaction.i2cAddress = i2cAddress;
+    transaction.pSend = pSend;
+    transaction.bytesToSend = bytesToSend;
+    transaction.pReceive = pReceive;
+    transaction.bytesToReceive = bytesReceived;
+    transaction.flags = 0;
+    transaction.pCallback = sendReceiveCallback;
+    transaction.pCallbackParam = &done;
+
+    receivedOrError = i2cSubmit(&transaction);
+    if (receivedOrError == I2C_RESULT_OK) {
+        done.wait();
+        receivedOrError = transaction.result;
+    }
 
     return receivedOrError;
 }
@@ -178,8 +554,15 @@ I2CReceivedOrError i2cSend(char i2cAddress, const char *pSend,
                            int bytesToSend, bool repeatedStart)
 {
     I2CReceivedOrError error;
+    unsigned int waitStartUs = us_ticker_read();
+#if I2C_STATISTICS
+    int startUs = gTimer.read_us();
+#endif
 
+    I2C_TIMELINE_BEGIN(TIMELINE_ID_I2C_MUTEX_WAIT, i2cAddress);
     MTX_LOCK(gMtx);
+    I2C_TIMELINE_END(TIMELINE_ID_I2C_MUTEX_WAIT, i2cAddress);
+    statisticsAddMutexWait(us_ticker_read() - waitStartUs);
 
     error = I2C_RESULT_ERROR_NOT_INITIALISED;
 
@@ -189,15 +572,21 @@ I2CReceivedOrError i2cSend(char i2cAddress, const char *pSend,
         } else if ((pSend == NULL) && (bytesToSend != 0)) {
             error = I2C_RESULT_ERROR_INVALID_PARAMETER;
         } else {
-            // Mbed uses an 8-bit address, shifted up from 7
-            i2cAddress <<= 1;
+#if I2C_STATISTICS
+            statisticsWait(i2cAddress, startUs);
+            startUs = gTimer.read_us();
+#endif
             if (pSend != NULL) {
-                if (gpI2c->write(i2cAddress, pSend, bytesToSend, repeatedStart) == 0) {
+                // Mbed uses an 8-bit address, shifted up from 7
+                if (gpI2c->write(i2cAddress << 1, pSend, bytesToSend, repeatedStart) == 0) {
                     error = I2C_RESULT_OK;
                 } else {
                     error = I2C_RESULT_ERROR_SEND_FAILED;
                 }
             }
+#if I2C_STATISTICS
+            statisticsTransaction(i2cAddress, bytesToSend, error, startUs);
+#endif
         }
     }
 
@@ -225,4 +614,39 @@ I2CReceivedOrError i2cStop()
     return error;
 }
 
+// Get the I2C traffic statistics.
+int i2cGetStatistics(I2CStatistics *pStatistics, int maxNum)
+{
+    int num = 0;
+
+    MTX_LOCK(gMtx);
+
+#if I2C_STATISTICS
+    if (pStatistics != NULL) {
+        for (num = 0; (num < maxNum) && (num < gNumStatistics); num++) {
+            *(pStatistics + num) = gStatistics[num];
+        }
+    }
+#else
+    (void) pStatistics;
+    (void) maxNum;
+#endif
+
+    MTX_UNLOCK(gMtx);
+
+    return num;
+}
+
+// Clear the I2C traffic statistics.
+void i2cClearStatistics()
+{
+    MTX_LOCK(gMtx);
+
+#if I2C_STATISTICS
+    gNumStatistics = 0;
+#endif
+
+    MTX_UNLOCK(gMtx);
+}
+
 // End of file
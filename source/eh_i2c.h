@@ -16,6 +16,28 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+/** Transaction flag: pSend is a single register address and the device
+ * increments that address as it is read from, so the transaction may be
+ * merged with a queued transaction reading the registers which follow
+ * on the same device.
+ */
+#define I2C_FLAG_REGISTER_AUTO_INCREMENT 0x01
+
+/** The largest number of bytes that may be read in one go when
+ * transactions are merged.
+ */
+#define I2C_MAX_MERGED_READ_SIZE 32
+
+/** How long to wait for the hardware to complete an asynchronous
+ * transfer (when I2C_ASYNCH is set) before giving up.
+ */
+#define I2C_ASYNCH_TIMEOUT_MS 100
+
+/** The number of devices for which traffic statistics are kept
+ * (see i2cGetStatistics()).
+ */
+#define I2C_STATISTICS_MAX_NUM_DEVICES 8
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -35,6 +57,39 @@ typedef enum {
     I2C_RESULT_ERROR_RECEIVE_FAILED = -4
 } I2CResult;
 
+/** An I2C transaction.  This is owned by the caller and must remain
+ * valid until its callback has been called.
+ */
+typedef struct I2CTransactionTag {
+    char i2cAddress;                //!< The 7-bit I2C address; the top bit must be 0.
+    const char *pSend;              //!< The bytes to send, may be NULL.
+    int bytesToSend;                //!< The number of bytes at pSend.
+    char *pReceive;                 //!< Where to put received bytes, may be NULL.
+    int bytesToReceive;             //!< The size of the buffer at pReceive.
+    unsigned char flags;            //!< A bit-map of I2C_FLAG_xxx values.
+    void (*pCallback) (struct I2CTransactionTag *, void *); //!< Called on completion, may be NULL.
+    void *pCallbackParam;           //!< Passed to pCallback.
+    I2CReceivedOrError result;      //!< The outcome, as i2cSendReceive() would return it.
+    int submitTimeUs;               //!< Used by the statistics.
+    struct I2CTransactionTag *pNext; //!< Used by the queue.
+} I2CTransaction;
+
+/** Traffic statistics for a device on the I2C bus.  A merged read
+ * counts as a single transaction, since that is what appears on the
+ * bus, and a transaction which follows a failed transaction with
+ * the same device is counted as a retry.
+ */
+typedef struct {
+    char i2cAddress;                 //!< The 7-bit I2C address of the device.
+    unsigned int transactions;       //!< The number of transactions on the bus.
+    unsigned int bytesSent;          //!< The number of bytes sent successfully.
+    unsigned int bytesReceived;      //!< The number of bytes received successfully.
+    unsigned int errors;             //!< The number of transactions that failed.
+    unsigned int retries;            //!< The number of transactions that followed a failure.
+    unsigned long long int busTimeUs;  //!< The time spent performing transactions.
+    unsigned long long int waitTimeUs; //!< The time spent waiting for the bus.
+} I2CStatistics;
+
 /**************************************************************************
  * FUNCTIONS
  *************************************************************************/
@@ -56,7 +111,8 @@ void i2cDeinit();
  */
 void i2cSetFrequency(int frequencyHz);
 
-/** Send and/or receive over the I2C interface.
+/** Send and/or receive over the I2C interface, waiting for the
+ * transaction to be performed (see i2cSubmit()).
  *
  * @param i2cAddress     the 7-bit I2C address to exchange data with; the top
  *                       bit must be 0.
@@ -73,6 +129,57 @@ I2CReceivedOrError i2cSendReceive(char i2cAddress, const char *pSend,
                                   int bytesToSend, char *pReceive,
                                   int bytesReceived);
 
+/** Queue a transaction for the I2C interface.  Transactions are
+ * performed in the order they are queued.  If no transaction is in
+ * progress then the queue is worked through, and callbacks called,
+ * in the context of the calling thread before this function returns,
+ * otherwise this function returns at once and the transaction is
+ * performed in the context of the thread that is working through the
+ * queue; either way the calling thread does not wait on the bus.
+ * Consecutive transactions with I2C_FLAG_REGISTER_AUTO_INCREMENT set
+ * that read adjacent registers of the same device are performed as a
+ * single read of up to I2C_MAX_MERGED_READ_SIZE bytes.  Callbacks
+ * may call i2cSubmit() but must not call i2cSendReceive(); this
+ * function must not be called from interrupt context.
+ *
+ * @param pTransaction the transaction, which must remain valid until
+ *                     its callback has been called.
+ * @return             zero if the transaction was queued (in which case
+ *                     its callback will be called exactly once), else
+ *                     negative error code.
+ */
+I2CResult i2cSubmit(I2CTransaction *pTransaction);
+
+/** Perform a number of transactions, waiting for them all to be
+ * performed.  The transactions are queued together (see i2cSubmit())
+ * so those with I2C_FLAG_REGISTER_AUTO_INCREMENT set that read
+ * adjacent registers of the same device are performed as a single
+ * read.  The callbacks of the transactions are set by this function.
+ *
+ * @param pTransactions   an array of transactions; the outcome of each
+ *                        is in its result field on return.
+ * @param numTransactions the number of transactions at pTransactions.
+ * @return                zero if the transactions were performed (the
+ *                        outcome of each may still be an error), else
+ *                        negative error code.
+ */
+I2CResult i2cSendReceiveMany(I2CTransaction *pTransactions, int numTransactions);
+
+/** Get the traffic statistics for the devices on the I2C bus, collected
+ * since start of day or since i2cClearStatistics() was last called,
+ * in the order the devices were first addressed.  Statistics are only
+ * collected if I2C_STATISTICS is set.
+ *
+ * @param pStatistics a place to put the statistics.
+ * @param maxNum      the number of entries at pStatistics.
+ * @return            the number of entries populated.
+ */
+int i2cGetStatistics(I2CStatistics *pStatistics, int maxNum);
+
+/** Clear the traffic statistics for the I2C bus.
+ */
+void i2cClearStatistics();
+
 /** Perform just a send over the I2C interface with the option of a repeated
  * start.
  *
@@ -0,0 +1,124 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h> // for memset()
+#include <eh_data.h>
+#include <eh_motion.h>
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Integer square root, rounded down.
+static unsigned int squareRoot(unsigned long long int x)
+{
+    unsigned long long int root = 0;
+    unsigned long long int bit = 1ULL << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (unsigned int) root;
+}
+
+// Limit a value to fit in an unsigned short.
+static unsigned short limitShort(unsigned int x)
+{
+    if (x > 0xFFFF) {
+        x = 0xFFFF;
+    }
+
+    return (unsigned short) x;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Extract motion features from a stream of acceleration samples.
+void motionExtractFeatures(const short *pXGX1000, const short *pYGX1000,
+                           const short *pZGX1000, unsigned int numSamples,
+                           DataMotion *pMotion)
+{
+    const short *pAxis[3] = {pXGX1000, pYGX1000, pZGX1000};
+    int mean[3];
+    unsigned long long int sumSquares[3];
+    unsigned long long int total = 0;
+    unsigned long long int peakSquared = 0;
+    unsigned long long int squared;
+    long long int sum;
+    int x;
+
+    memset(pMotion, 0, sizeof(*pMotion));
+
+    if (numSamples > 0) {
+        // The mean of each axis is gravity
+        for (unsigned int a = 0; a < 3; a++) {
+            sum = 0;
+            for (unsigned int y = 0; y < numSamples; y++) {
+                sum += *(pAxis[a] + y);
+            }
+            mean[a] = (int) (sum / (int) numSamples);
+            sumSquares[a] = 0;
+        }
+
+        // Work out the dynamic acceleration, keeping
+        // track of the energy on each axis and the peak
+        for (unsigned int y = 0; y < numSamples; y++) {
+            squared = 0;
+            for (unsigned int a = 0; a < 3; a++) {
+                x = *(pAxis[a] + y) - mean[a];
+                sumSquares[a] += ((long long int) x) * x;
+                squared += ((long long int) x) * x;
+            }
+            if (squared > peakSquared) {
+                peakSquared = squared;
+            }
+        }
+
+        for (unsigned int a = 0; a < 3; a++) {
+            total += sumSquares[a];
+            if (sumSquares[a] > sumSquares[pMotion->dominantAxis]) {
+                pMotion->dominantAxis = a;
+            }
+        }
+
+        pMotion->rmsGX1000 = limitShort(squareRoot(total / numSamples));
+        pMotion->peakGX1000 = limitShort(squareRoot(peakSquared));
+        pMotion->numSamples = (numSamples > 0xFF) ? 0xFF : (unsigned char) numSamples;
+
+        pMotion->activity = MOTION_ACTIVITY_STILL;
+        if ((pMotion->rmsGX1000 >= MOTION_VIGOROUS_RMS_GX1000) ||
+            (pMotion->peakGX1000 >= MOTION_VIGOROUS_PEAK_GX1000)) {
+            pMotion->activity = MOTION_ACTIVITY_VIGOROUS;
+        } else if (pMotion->rmsGX1000 >= MOTION_STILL_RMS_GX1000) {
+            pMotion->activity = MOTION_ACTIVITY_MOVING;
+        }
+    }
+}
+
+// End of file
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_MOTION_H_
+#define _EH_MOTION_H_
+
+#include <eh_data.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Below this RMS dynamic acceleration, in thousandths of a gravity,
+ * the device is considered to be still.
+ */
+#define MOTION_STILL_RMS_GX1000 50
+
+/** At or above this RMS dynamic acceleration, in thousandths of a
+ * gravity, or at or above MOTION_VIGOROUS_PEAK_GX1000, the device is
+ * considered to be moving vigorously (e.g. being shaken or dropped).
+ */
+#define MOTION_VIGOROUS_RMS_GX1000 400
+
+/** At or above this peak dynamic acceleration, in thousandths of a
+ * gravity, the device is considered to be moving vigorously.
+ */
+#define MOTION_VIGOROUS_PEAK_GX1000 1500
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Extract motion features from a stream of acceleration samples.
+ * The mean of each axis over the stream is taken to be gravity
+ * and is removed; the RMS and peak of what remains, the axis
+ * with the most dynamic acceleration and an activity class are
+ * then worked out.  Only integer arithmetic is used.
+ *
+ * @param pXGX1000   the x-axis samples in thousandths of a gravity.
+ * @param pYGX1000   the y-axis samples in thousandths of a gravity.
+ * @param pZGX1000   the z-axis samples in thousandths of a gravity.
+ * @param numSamples the number of samples in each of the above,
+ *                   if this is zero pMotion will be zeroed.
+ * @param pMotion    a place to put the features, may not be NULL.
+ */
+void motionExtractFeatures(const short *pXGX1000, const short *pYGX1000,
+                           const short *pZGX1000, unsigned int numSamples,
+                           DataMotion *pMotion);
+
+#endif // _EH_MOTION_H_
+
+// End Of File
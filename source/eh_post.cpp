@@ -16,6 +16,8 @@
 
 #include <mbed.h> // For the pin names
 #include <mbed_events.h>
+#include <stddef.h> // For offsetof()
+#include <eh_utilities.h> // For NOINIT and utilitiesChecksum()
 #include <log.h>
 #include <eh_debug.h>
 #include <eh_action.h>
@@ -33,18 +35,120 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+/** The value at the start of the retained POST outcome when it is valid.
+ */
+#define POST_RETAINED_MAGIC 0x504f5331
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The outcome of POST, retained across resets.
+ */
+typedef struct {
+    unsigned int magic;
+    PostResult result;
+    unsigned int notDesirable;  //!< Bit-map of the action types POST found to be absent.
+    time_t restartTimeNV;       //!< The restart time in NV when POST was run.
+    unsigned int checksum;
+} PostRetained;
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
 
+/** The outcome of POST, in an uninitialised RAM area so that it
+ * survives a reset.
+ */
+static PostRetained gRetained NOINIT;
+
+/** Whether this start-up is a warm one, set by postInit().
+ */
+static bool gWarmStart = false;
+
 /**************************************************************************
  * STATIC FUNCTIONS
  *************************************************************************/
 
+// Return true if the retained POST outcome is valid.
+static bool retainedIsValid()
+{
+    return (gRetained.magic == POST_RETAINED_MAGIC) &&
+           (gRetained.checksum == utilitiesChecksum(&gRetained, offsetof(PostRetained, checksum)));
+}
+
+// Retain the outcome of POST, including which action types
+// have been found not to be desirable.
+static void retain(PostResult result)
+{
+    time_t restartTimeNV = 0;
+
+    debugReadErrorNV(&restartTimeNV, NULL, NULL);
+    memset(&gRetained, 0, sizeof(gRetained));
+    gRetained.magic = POST_RETAINED_MAGIC;
+    gRetained.result = result;
+    for (unsigned int x = ACTION_TYPE_NULL + 1; x < MAX_NUM_ACTION_TYPES; x++) {
+        if (actionGetDesirability((ActionType) x) == 0) {
+            gRetained.notDesirable |= 1 << x;
+        }
+    }
+    gRetained.restartTimeNV = restartTimeNV;
+    gRetained.checksum = utilitiesChecksum(&gRetained, offsetof(PostRetained, checksum));
+}
+
+// Return true if the retained POST outcome says that
+// an action type was found not to be desirable.
+static bool retainedNotDesirable(ActionType type)
+{
+    return (gRetained.notDesirable & (1 << type)) != 0;
+}
+
 /**************************************************************************
  * PUBLIC FUNCTIONS
  *************************************************************************/
 
+// Initialise POST, deciding whether this start-up is a warm one.
+void postInit()
+{
+    RestartReason restartReason;
+    time_t restartTimeNV = 0;
+
+    gWarmStart = retainedIsValid() && (gRetained.result == POST_RESULT_OK);
+
+#if TARGET_UBLOX_EVK_NINA_B1
+    // From section 18.8.3 of the NRF52832 product spec: a watchdog,
+    // pin or lock-up reset means that something, or someone, wants
+    // things started from scratch.  The register is only read
+    // here, processorWakeUpReason() clears it.
+    if (NRF_POWER->RESETREAS & 0x0B) {
+        gWarmStart = false;
+    }
+#endif
+
+    // A fatal error or watchdog recorded in NV since POST
+    // was last run also calls for a cold start
+    restartReason = debugReadErrorNV(&restartTimeNV, NULL, NULL);
+    if (((restartReason == RESTART_REASON_FATAL_ERROR) ||
+         (restartReason == RESTART_REASON_WATCHDOG)) &&
+        (restartTimeNV != gRetained.restartTimeNV)) {
+        gWarmStart = false;
+    }
+
+    AQ_NRG_LOGX(EVENT_WARM_START, gWarmStart);
+}
+
+// Determine whether this start-up is a warm one.
+bool postIsWarmStart()
+{
+    return gWarmStart;
+}
+
+// Forget the retained outcome of POST.
+void postInvalidate()
+{
+    gRetained.magic = 0;
+}
+
 // Perform a power-on self test.
 PostResult post(bool bestEffort,
                 EventQueue *pEventQueue,
@@ -65,6 +169,12 @@ PostResult post(bool bestEffort,
          x++) {
         switch (x) {
             case ACTION_TYPE_REPORT:
+                if (gWarmStart) {
+                    // The modem was there last time, no need to
+                    // spend the energy powering it up to find out
+                    modemIsOk = true;
+                    break;
+                }
                 enable1V8 = 1;
                 // Attempt to initialise the cellular modem
                 if (modemInit(SIM_PIN, APN, USERNAME, PASSWORD) != ACTION_DRIVER_OK) {
@@ -82,6 +192,14 @@ PostResult post(bool bestEffort,
             case ACTION_TYPE_MEASURE_HUMIDITY:
                 // Do all of the BME280 humidity/temperature/pressure
                 // device in one go here
+                if (gWarmStart) {
+                    if (retainedNotDesirable(ACTION_TYPE_MEASURE_HUMIDITY)) {
+                        actionSetDesirability(ACTION_TYPE_MEASURE_HUMIDITY, 0);
+                        actionSetDesirability(ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE, 0);
+                        actionSetDesirability(ACTION_TYPE_MEASURE_TEMPERATURE, 0);
+                    }
+                    break;
+                }
                 if (bme280Init(BME280_DEFAULT_ADDRESS) != ACTION_DRIVER_OK) {
                     result = POST_RESULT_ERROR_BME280;
                     AQ_NRG_LOGX(EVENT_POST_ERROR, result);
@@ -100,6 +218,12 @@ PostResult post(bool bestEffort,
                 // Nothing to do, all done in ACTION_TYPE_MEASURE_HUMIDITY
             break;
             case ACTION_TYPE_MEASURE_LIGHT:
+                if (gWarmStart) {
+                    if (retainedNotDesirable(ACTION_TYPE_MEASURE_LIGHT)) {
+                        actionSetDesirability(ACTION_TYPE_MEASURE_LIGHT, 0);
+                    }
+                    break;
+                }
                 // Attempt initialisation of the light sensor
                 if (si1133Init(SI1133_DEFAULT_ADDRESS) != ACTION_DRIVER_OK) {
                     result = POST_RESULT_ERROR_SI1133;
@@ -111,12 +235,19 @@ PostResult post(bool bestEffort,
                 si1133Deinit();
             break;
             case ACTION_TYPE_MEASURE_ACCELERATION:
+                // The accelerometer has to be configured even on a
+                // warm start-up, unless it was found to be absent
+                if (gWarmStart && retainedNotDesirable(ACTION_TYPE_MEASURE_ACCELERATION)) {
+                    actionSetDesirability(ACTION_TYPE_MEASURE_ACCELERATION, 0);
+                    break;
+                }
                 // Initialise the accelerometer
                 if ((lis3dhInit(LIS3DH_DEFAULT_ADDRESS) != ACTION_DRIVER_OK) ||
                     (lis3dhSetSensitivity(LIS3DH_SENSITIVITY) != ACTION_DRIVER_OK) ||
                     (lis3dhSetInterruptThreshold(LIS3DH_INTERRUPT, LIS3DH_INTERRUPT_THRESHOLD_MG,
                                                  LIS3DH_INTERRUPT_DURATION_SECONDS) != ACTION_DRIVER_OK) ||
-                    (lis3dhSetInterruptEnable(LIS3DH_INTERRUPT, true, pEventQueue, pEventCallback) != ACTION_DRIVER_OK)) {
+                    (lis3dhSetInterruptEnable(LIS3DH_INTERRUPT, true, pEventQueue, pEventCallback) != ACTION_DRIVER_OK) ||
+                    (lis3dhSetFifoEnable(true) != ACTION_DRIVER_OK)) {
                     result = POST_RESULT_ERROR_LIS3DH;
                     AQ_NRG_LOGX(EVENT_POST_ERROR, result);
                     if (bestEffort) {
@@ -126,6 +257,12 @@ PostResult post(bool bestEffort,
                 // Don't de-initialise this, it should be left on in lowest power state
             break;
             case ACTION_TYPE_MEASURE_POSITION:
+                if (gWarmStart) {
+                    if (retainedNotDesirable(ACTION_TYPE_MEASURE_POSITION)) {
+                        actionSetDesirability(ACTION_TYPE_MEASURE_POSITION, 0);
+                    }
+                    break;
+                }
                 enable1V8 = 1;
                 // Attempt instantiation of the GNSS driver
                 if (zoem8Init(ZOEM8_DEFAULT_ADDRESS) != ACTION_DRIVER_OK) {
@@ -138,9 +275,19 @@ PostResult post(bool bestEffort,
                 zoem8Deinit();
             break;
             case ACTION_TYPE_MEASURE_MAGNETIC:
+                // As for the accelerometer, the hall effect sensor
+                // has to be configured even on a warm start-up
+                if (gWarmStart && retainedNotDesirable(ACTION_TYPE_MEASURE_MAGNETIC)) {
+                    actionSetDesirability(ACTION_TYPE_MEASURE_MAGNETIC, 0);
+                    break;
+                }
                 // Initialise the hall effect sensor
                 if ((si7210Init(SI7210_DEFAULT_ADDRESS) != ACTION_DRIVER_OK) ||
                     (si7210SetRange((Si7210FieldStrengthRange) SI7210_RANGE) != ACTION_DRIVER_OK) ||
+                    (si7210SetFilter((Si7210Filter) SI7210_FILTER,
+                                     SI7210_FILTER_BANDWIDTH,
+                                     SI7210_BURST_SIZE) != ACTION_DRIVER_OK) ||
+                    (si7210SetTamper(SI7210_TAMPER_THRESHOLD_TESLAX1000) != ACTION_DRIVER_OK) ||
                     (si7210SetInterrupt(SI7210_INTERRUPT_THRESHOLD_TESLAX1000,
                                         SI7210_INTERRUPT_HYSTERESIS_TESLAX1000,
                                         SI7210_ACTIVE_HIGH,
@@ -180,6 +327,9 @@ PostResult post(bool bestEffort,
         AQ_NRG_LOGX(EVENT_POST_ERROR, result);
     }
 
+    // Keep the outcome so that the next start-up can be a warm one
+    retain(result);
+
     return result;
 }
 
@@ -40,7 +40,34 @@ typedef enum {
  * FUNCTIONS
  *************************************************************************/
 
-/** Perform a power-on self test.
+/** Initialise POST, deciding whether this start-up is a warm one.
+ * It is warm if the outcome of a successful POST has been retained
+ * (in RAM which is not initialised at start-up) and the reset was
+ * a power-on (e.g. a brown-out) or a soft reset; a reset by the
+ * watchdog, the reset pin or CPU lock-up, or a new fatal error or
+ * watchdog entry from debugReadErrorNV(), makes it cold.  Should be
+ * called once at start-up, before post().
+ */
+void postInit();
+
+/** Determine whether this start-up is a warm one, in which case
+ * the hardware has already been checked and the delays which let
+ * it settle from an unknown state may be skipped.
+ *
+ * @return true if this start-up is a warm one.
+ */
+bool postIsWarmStart();
+
+/** Forget the retained outcome of POST so that the next start-up
+ * is a cold one; quick enough to call from the watchdog callback.
+ */
+void postInvalidate();
+
+/** Perform a power-on self test.  On a warm start-up the devices
+ * which are only probed (the cellular modem, BME280, SI1133 and
+ * ZOEM8) are not powered up again, the retained outcome being used
+ * instead; the devices which have to be left configured (LIS3DH
+ * and SI7210) are always initialised.
  *
  * @param bestEffort         if true then, should a device fail, POST
  *                           will mark the device as "not desirable" so
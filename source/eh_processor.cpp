@@ -16,7 +16,7 @@
 
 #include <mbed.h> // For Threading and I2C pins
 #include <log.h>
-#include <act_voltages.h> // For voltageIsGood() and voltageIsNotBad()
+#include <act_voltages.h> // For voltageIsGood(), voltageIsNotBad() and getVoltages()
 #include <act_energy_source.h>
 #include <eh_debug.h>
 #include <eh_utilities.h> // For ARRAY_SIZE and MTX_LOCK/MTX_UNLOCK
@@ -24,6 +24,8 @@
 #include <eh_i2c.h>
 #include <eh_config.h>
 #include <eh_statistics.h>
+#include <eh_clock.h>
+#include <eh_heap.h>
 #include <act_cellular.h>
 #include <act_modem.h>
 #include <act_temperature_humidity_pressure.h>
@@ -42,6 +44,10 @@
 #include <ble_data_gather.h>
 #endif
 #include <eh_data.h>
+#include <eh_codec.h> // For codecPackLogEntry()
+#include <eh_motion.h>
+#include <eh_forecast.h>
+#include <eh_timeline.h>
 #include <eh_processor.h>
 
 /**************************************************************************
@@ -73,6 +79,12 @@
  */
 #define SET_CURRENT_ENERGY_SOURCE_GOOD (gEnergyChoice[0] |= 0x01)
 
+/** The number of bytes transmitted over which the running
+ * average of the energy cost of transmitting a byte is
+ * (roughly) taken.
+ */
+#define REPORT_COST_HISTORY_BYTES 4096
+
 #if defined (MBED_CONF_APP_DISABLE_ENERGY_CHOOSER) && \
     MBED_CONF_APP_DISABLE_ENERGY_CHOOSER
 #define DISABLE_ENERGY_CHOOSER
@@ -100,6 +112,14 @@ static DigitalOut gEnable1V8(PIN_ENABLE_1V8, 0);
  */
 static Thread *gpActionThreadList[MAX_NUM_SIMULTANEOUS_ACTIONS];
 
+/** The number of action threads running doAction() and the
+ * number that have ever started, so that an action can tell
+ * whether it had the device to itself, only touched in a
+ * critical section.
+ */
+static int gNumActionsRunning;
+static unsigned int gNumActionsStarted;
+
 /** Diagnostic hook.
  */
 static Callback<bool(Action *)> gThreadDiagnosticsCallback;
@@ -122,15 +142,20 @@ static time_t gLogSuspendTime;
  */
 static unsigned int gLogIndex;
 
-/** The time at which time was last updated.
+/** The log events that are filtered out of the uplink, a bitmap.
  */
-static time_t gTimeUpdate;
+static unsigned int gLogFilter[PROCESSOR_LOG_FILTER_MAX_NUM_EVENTS / 32];
 
 /** Timer to keep track of how long we've been
  * actively processing.
  */
 static Timer *gpProcessTimer = NULL;
 
+/** A timer running since start-up, until the first measurement
+ * has been made.
+ */
+static Timer *gpBootTimer = NULL;
+
 /** A timer to keep track of when BLE is active.
  */
 static Timer *gpBleTimer = NULL;
@@ -167,6 +192,17 @@ static const DataType gDataType[] = {DATA_TYPE_NULL,                 // ACTION_T
                                      DATA_TYPE_MAGNETIC,             // ACTION_TYPE_MEASURE_MAGNETIC
                                      DATA_TYPE_BLE};                 // ACTION_TYPE_MEASURE_BLE
 
+/** The action types served by the BME280: these are performed
+ * as a group, from a single measurement.
+ */
+static const ActionType gBme280ActionTypes[] = {ACTION_TYPE_MEASURE_HUMIDITY,
+                                                ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE,
+                                                ACTION_TYPE_MEASURE_TEMPERATURE};
+
+/** Which of gBme280ActionTypes[] are wanted in this wake-up.
+ */
+static bool gBme280ActionWanted[ARRAY_SIZE(gBme280ActionTypes)];
+
 /** Keep track of the energy cost of measurements for
  * the always-on BME280.
  */
@@ -177,6 +213,14 @@ static time_t gLastMeasurementTimeBme280Seconds;
  */
 static time_t gLastMeasurementTimeLis3dhSeconds;
 
+/** Somewhere to put the samples drained from the LIS3DH FIFO,
+ * kept off the stack of the action thread; there is only ever
+ * one acceleration action running.
+ */
+static short gAccelerationXGX1000[LIS3DH_FIFO_SIZE];
+static short gAccelerationYGX1000[LIS3DH_FIFO_SIZE];
+static short gAccelerationZGX1000[LIS3DH_FIFO_SIZE];
+
 /** Keep track of the energy cost of measurements for
  * the always-on SI7210.
  */
@@ -224,8 +268,11 @@ static unsigned int gAwakeCount;
  * energy to wake-up again afterwards.  Coding is that
  * the upper-nibble is the energy source enum and the
  * lower nibble is 0 for failure or 1 for success.
+ * Sized for the shortest wake-up interval, of which
+ * only those covering ENERGY_HISTORY_SECONDS at the
+ * current wake-up interval are used.
  */
-static unsigned char gEnergyChoice[ENERGY_HISTORY_SECONDS / WAKEUP_INTERVAL_SECONDS];
+static unsigned char gEnergyChoice[ENERGY_HISTORY_SECONDS / WAKEUP_INTERVAL_MIN_SECONDS];
 
 /** Array to keep track of VIN measurements.
  */
@@ -236,6 +283,27 @@ static int gVIn[ENERGY_SOURCES_MAX_NUM];
  */
 static unsigned int gVInCount;
 
+/** Array to keep track of the rate at which each energy
+ * source was last seen to harvest energy, in nW.
+ */
+static int gHarvestNW[ENERGY_SOURCES_MAX_NUM];
+
+/** Semaphore released each time an action thread ends.
+ */
+static Semaphore gActionEndedSemaphore(0);
+
+/** The energy required by the actions chosen at the last wake-up.
+ */
+static unsigned long long int gActionsEnergyNWH;
+
+/** The energy a wake-up typically costs, averaged.
+ */
+static unsigned long long int gWakeUpEnergyNWH;
+
+/** The interval to the next wake-up, chosen by the harvest forecaster.
+ */
+static int gWakeUpIntervalSeconds;
+
 /** Track the number of wake-ups.
  */
 static unsigned int gNumWakeups;
@@ -256,18 +324,20 @@ static time_t gLastPositionTime;
  */
 static bool gWeveMoved;
 
-/** The number of wake-ups to skip attempting a GNSS fix.
+/** How long to back off from attempting a GNSS fix, in
+ * seconds of wake-up interval.
  */
-static unsigned int gPositionFixSkipsRequired;
+static unsigned int gPositionBackOffSeconds;
 
-/** Keep a track of the current number of GNSS skips.
+/** Keep a track of the wake-up intervals for which GNSS
+ * fixes have been skipped, in seconds.
  */
-static unsigned int gPositionNumFixesSkipped;
+static unsigned int gPositionSkippedSeconds;
 
-/** Keep a track of the number of GNSS tried and failed
- * without backing off.
+/** Keep a track of the wake-up intervals for which GNSS
+ * has tried and failed without backing off, in seconds.
  */
-static unsigned int gPositionNumFixesFailedNoBackOff;
+static unsigned int gPositionFailedNoBackOffSeconds;
 
 /** Keep track of whether the modem was idle between
  * wake-ups or was off and needed to register.
@@ -283,6 +353,37 @@ static unsigned int gReportNumFailures;
  */
 static time_t gMaxRunTime;
 
+/** Running average, weighted by bytes transmitted, of the
+ * estimated energy cost of transmitting a byte in nWh, zero
+ * if not yet known.
+ */
+static unsigned int gReportCostPerByteNWH;
+
+/** The time at which reports were last sent successfully,
+ * zero if they never have been.
+ */
+static time_t gLastReportTimeSeconds;
+
+/** Flag to indicate that sending of reports has been put
+ * off because radio conditions were poor.
+ */
+static bool gReportDeferred;
+
+/** The estimated energy cost of transmitting a byte when
+ * radio conditions were last measured, zero if they never
+ * have been.
+ */
+static unsigned int gReportLastCostPerByteNWH;
+
+/** The time at which gReportLastCostPerByteNWH was measured.
+ */
+static time_t gReportLastCostTimeSeconds;
+
+/** Flag to indicate that the next report must not be put
+ * off, e.g. because someone waved a magnet at us.
+ */
+static bool gReportUrgent;
+
 /**************************************************************************
  * STATIC FUNCTIONS
  *************************************************************************/
@@ -298,10 +399,12 @@ static void awake()
     //AQ_NRG_LOG(EVENT_AWAKE, gAwakeCount);
 }
 
-// Update the current time.
-static void updateTime(time_t timeUTC)
+// Update the current time, either from an external source or
+// to correct for the drift of the clock.
+static void updateTime(time_t timeUTC, bool external)
 {
     time_t diff;
+    int driftUncertaintyPpm;
 
     MTX_LOCK(gMtx);
 
@@ -314,7 +417,11 @@ static void updateTime(time_t timeUTC)
     gLastMeasurementTimeLis3dhSeconds += diff;
     gLastMeasurementTimeSi7210Seconds += diff;
     gLastMeasurementTimeSi1133Seconds += diff;
+    gLastMeasurementTimeBleSeconds += diff;
     gLastSleepTimeModemSeconds += diff;
+    if (gLastReportTimeSeconds != 0) {
+        gLastReportTimeSeconds += diff;
+    }
 
     // Adjust the last position fix time
     if (gLastPositionTime >= 0) {
@@ -324,9 +431,15 @@ static void updateTime(time_t timeUTC)
     // Update the times of the items in the data queueu
     dataAdjustTime(diff);
 
-    set_time(timeUTC);
-    gTimeUpdate = timeUTC;
-    AQ_NRG_LOGX(EVENT_TIME_SET, timeUTC);
+    if (external) {
+        clockSet(timeUTC);
+        AQ_NRG_LOGX(EVENT_TIME_SET, timeUTC);
+        AQ_NRG_LOGX(EVENT_CLOCK_DRIFT_PPM, clockDriftPpm(&driftUncertaintyPpm));
+        AQ_NRG_LOGX(EVENT_CLOCK_DRIFT_UNCERTAINTY_PPM, driftUncertaintyPpm);
+    } else {
+        clockCorrect(timeUTC);
+        AQ_NRG_LOGX(EVENT_CLOCK_CORRECTED_SECONDS, diff);
+    }
 
     MTX_UNLOCK(gMtx);
 }
@@ -341,6 +454,9 @@ static bool heapIsAboveMargin(unsigned int margin)
     if (pMalloc != NULL) {
         success = true;
         free(pMalloc);
+    } else {
+        // Log how far short the largest free block is
+        AQ_NRG_LOGX(EVENT_HEAP_LARGEST_FREE_BLOCK, heapLargestFreeBlock(margin));
     }
 
     return success;
@@ -361,6 +477,29 @@ static unsigned long long int activeEnergyUsedNWH()
     return energyNWH;
 }
 
+// Return true if an action type powers up a radio, drawing
+// enough to swamp the rate at which the supercap charges.
+static bool actionIsLoad(ActionType actionType)
+{
+    return (actionType == ACTION_TYPE_REPORT) ||
+           (actionType == ACTION_TYPE_GET_TIME_AND_REPORT) ||
+           (actionType == ACTION_TYPE_MEASURE_POSITION) ||
+           (actionType == ACTION_TYPE_MEASURE_BLE);
+}
+
+// Get the latest VBAT_OK: the last reading of the background
+// voltage sampler if it has one, else measured afresh.
+static int vBatOkLatestMV()
+{
+    int vBatOkMV = voltageSamplerVBatOkMV();
+
+    if (vBatOkMV < 0) {
+        vBatOkMV = getVBatOkMV();
+    }
+
+    return vBatOkMV;
+}
+
 // Check whether this thread has been terminated.
 // Note: the signal is automagically reset after it has been received,
 // hence it is necessary to pass in a pointer to the same "keepGoing" flag
@@ -375,8 +514,149 @@ static bool modemKeepGoing(void *pKeepGoing) {
     return threadContinue((bool *) pKeepGoing);
 }
 
-// Do both sorts of reporting (get time as an option).
-static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
+// Callback function to tell GNSS to keep going (or not).
+static bool positionKeepGoing(void *pKeepGoing) {
+    return threadContinue((bool *) pKeepGoing);
+}
+
+// Update the running average of the energy cost of transmitting
+// a byte with the cost under the conditions of a successful report.
+static void reportCostUpdate(unsigned int costPerByteNWH,
+                             unsigned int bytesTransmitted)
+{
+    if (bytesTransmitted > REPORT_COST_HISTORY_BYTES) {
+        bytesTransmitted = REPORT_COST_HISTORY_BYTES;
+    }
+
+    if (gReportCostPerByteNWH == 0) {
+        gReportCostPerByteNWH = costPerByteNWH;
+    } else {
+        gReportCostPerByteNWH = (unsigned int) ((((unsigned long long int) gReportCostPerByteNWH) *
+                                                 (REPORT_COST_HISTORY_BYTES - bytesTransmitted) +
+                                                 ((unsigned long long int) costPerByteNWH) * bytesTransmitted) /
+                                                REPORT_COST_HISTORY_BYTES);
+    }
+}
+
+// Return true if a log event is filtered out of the uplink.
+static bool logFilteredOut(LogEvent event)
+{
+    return ((unsigned int) event < PROCESSOR_LOG_FILTER_MAX_NUM_EVENTS) &&
+           ((gLogFilter[event / 32] & (1U << (event % 32))) != 0);
+}
+
+// Empty the log store into data items, leaving out any
+// events that are filtered out of the uplink.
+// Note: since we have to commit to removing the log items from the store
+// on calling getLog() this is the one case where we preallocate a data
+// item, to make sure one is available, and then fill it in place.
+static void logCollect()
+{
+    Data *pData;
+    LogEntry entry;
+#if LOG_PACKED
+    DataLogPacked *pLog;
+#else
+    DataLog *pLog;
+#endif
+
+    dataLockList();
+#if LOG_PACKED
+    while ((getNumLogEntries() > 0) &&
+           ((pData = pDataAlloc(NULL, DATA_TYPE_LOG_PACKED, 0, NULL)) != NULL)) {
+        pLog = &(pData->contents.logPacked);
+        memset(pLog, 0, sizeof(*pLog));
+        // Pack entries while there is sure to be room
+        while ((getNumLogEntries() > 0) &&
+               (sizeof(pLog->packed) - pLog->numBytes >= CODEC_LOG_PACKED_ENTRY_MAX_BYTES) &&
+               (getLog(&entry, 1) == 1)) {
+            if (!logFilteredOut(entry.event)) {
+                codecPackLogEntry(pLog, &entry);
+            }
+        }
+#else
+    while ((getNumLogEntries() > 0) &&
+           ((pData = pDataAlloc(NULL, DATA_TYPE_LOG, 0, NULL)) != NULL)) {
+        pLog = &(pData->contents.log);
+        pLog->numItems = 0;
+        while ((getNumLogEntries() > 0) &&
+               (pLog->numItems < ARRAY_SIZE(pLog->log)) &&
+               (getLog(&entry, 1) == 1)) {
+            if (!logFilteredOut(entry.event)) {
+                pLog->log[pLog->numItems] = entry;
+                pLog->numItems++;
+            }
+        }
+#endif
+        if (pLog->numItems > 0) {
+            pLog->index = gLogIndex;
+            gLogIndex++;
+            pLog->logClientVersion = LOG_VERSION;
+            pLog->logApplicationVersion = APPLICATION_LOG_VERSION;
+        } else {
+            // Everything was filtered out
+            dataFree(&pData);
+        }
+    }
+    dataUnlockList();
+}
+
+// Decide whether sending reports can be put off until radio
+// conditions improve, given the estimated energy cost of
+// transmitting a byte under the current conditions.
+static bool reportDefer(unsigned int costPerByteNWH)
+{
+    bool defer = false;
+
+    // Don't put things off if nothing is known, if nothing has
+    // yet been sent, if the latency bound has been reached,
+    // if the queue is getting full or if anything is urgent
+#if !LOGGING_NEEDS_REPORTING_EACH_WAKEUP
+    if ((REPORT_DEFER_MAX_SECONDS > 0) && !gReportUrgent &&
+        (costPerByteNWH > 0) && (gReportCostPerByteNWH > 0) &&
+        (gLastReportTimeSeconds != 0) &&
+        (time(NULL) - gLastReportTimeSeconds < REPORT_DEFER_MAX_SECONDS) &&
+        (((unsigned long long int) costPerByteNWH) * 100 >
+         ((unsigned long long int) gReportCostPerByteNWH) * REPORT_DEFER_COST_PERCENT) &&
+        (dataGetPercentageBytesUsed() < MAX_DATA_QUEUE_LENGTH_PERCENT) &&
+        (dataCountFlags(DATA_FLAG_SEND_NOW) == 0)) {
+        defer = true;
+    }
+#endif
+
+    return defer;
+}
+
+// Return the estimated energy cost of transmitting a byte when
+// radio conditions were last measured, zero if that was too long
+// ago for it to still hold.
+static unsigned int reportLastCostPerByteNWH()
+{
+    unsigned int costPerByteNWH = 0;
+
+    if (time(NULL) - gReportLastCostTimeSeconds < REPORT_DEFER_COST_VALID_SECONDS) {
+        costPerByteNWH = gReportLastCostPerByteNWH;
+    }
+
+    return costPerByteNWH;
+}
+
+#if !LOGGING_NEEDS_REPORTING_EACH_WAKEUP
+// Check whether a report that was put off should be retried
+// this wake-up: if the modem has been left registered then it
+// costs little to check the radio conditions again, otherwise
+// wait for the radio conditions last measured to go stale or
+// for the latency bound to be reached.
+static bool reportRetryDue()
+{
+    return gReportDeferred &&
+           (!gModemOff || (reportLastCostPerByteNWH() == 0) ||
+            (time(NULL) - gLastReportTimeSeconds >= REPORT_DEFER_MAX_SECONDS));
+}
+#endif
+
+// Do both sorts of reporting with the modem (get time as an option).
+static void reportingModem(Action *pAction, bool *pKeepGoing, bool getTime)
 {
     DataContents contents;
     Data *pData;
@@ -384,12 +664,34 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
     time_t timeUTC;
     char imeiString[MODEM_IMEI_LENGTH];
     unsigned int bytesTransmitted = 0;
+    unsigned int costPerByteNWH = 0;
+    bool reportsSent = false;
+    bool modemWasOff = gModemOff;
+    bool modemRan = false;
+    int vBatOkStartMV;
+    int startTimeMs = 0;
+    bool alone;
+    unsigned int numActionsStarted;
+    long long int energyNWH;
     int x;
     void (*pWatchdogCallback) (void) = NULL;
 
+    // Note VBAT_OK at the start so that the energy
+    // used by the modem can be measured, and whether
+    // any other action is running to muddy the waters
+    core_util_critical_section_enter();
+    alone = (gNumActionsRunning == 1);
+    numActionsStarted = gNumActionsStarted;
+    core_util_critical_section_exit();
+    vBatOkStartMV = getVBatOkMV();
+    if (gpProcessTimer != NULL) {
+        startTimeMs = gpProcessTimer->read_ms();
+    }
+
     // Initialise the cellular modem
     gEnable1V8 = 1;
     if (modemInit(SIM_PIN, APN, USERNAME, PASSWORD) == ACTION_DRIVER_OK) {
+        modemRan = true;
         // Obtain the IMEI
         if (threadContinue(pKeepGoing)) {
             // Fill with something unique so that we can see
@@ -417,21 +719,37 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
             AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
         }
 
-        // Collect the stored log entries
-        // Note: since we have to commit to removing the log items from the store
-        // on calling getLog() this is the one case where we preallocate a data
-        // item, to make sure when is available, and then copy the contents in later
-        dataLockList();
-        while ((getNumLogEntries() > 0) &&
-               ((pData = pDataAlloc(NULL, DATA_TYPE_LOG, 0, NULL)) != NULL)) {
-            contents.log.numItems = getLog(contents.log.log, ARRAY_SIZE(contents.log.log));
-            contents.log.index = gLogIndex;
-            gLogIndex++;
-            contents.log.logClientVersion = LOG_VERSION;
-            contents.log.logApplicationVersion = APPLICATION_LOG_VERSION;
-            memcpy(&(pData->contents), &contents, gDataSizeOfContents[DATA_TYPE_LOG]);
+        // Add the statistics of each action type that has run
+        // since the last report
+        for (unsigned int x = ACTION_TYPE_NULL + 1; x < MAX_NUM_ACTION_TYPES; x++) {
+            if (statisticsGetAction((ActionType) x, &contents.actionStatistics) &&
+                (pDataAlloc(NULL, DATA_TYPE_ACTION_STATISTICS, 0, &contents) == NULL)) {
+                AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_ACTION_STATISTICS);
+                AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+            }
         }
-        dataUnlockList();
+
+#if I2C_STATISTICS
+        // Add the I2C traffic statistics
+        statisticsGetI2c(&contents.i2cStatistics);
+        if ((contents.i2cStatistics.numDevices > 0) &&
+            (pDataAlloc(NULL, DATA_TYPE_I2C_STATISTICS, 0, &contents) == NULL)) {
+            AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_I2C_STATISTICS);
+            AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+        }
+#endif
+
+#if HEAP_STATISTICS
+        // Add the heap statistics
+        heapGetStatistics(&contents.heapStatistics);
+        if (pDataAlloc(NULL, DATA_TYPE_HEAP_STATISTICS, 0, &contents) == NULL) {
+            AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_HEAP_STATISTICS);
+            AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+        }
+#endif
+
+        // Collect the stored log entries
+        logCollect();
 
         // If the run time we're given is greater than the
         // watchdog interval (which might be the case
@@ -448,7 +766,7 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
                 // Get the time if required
                 if (threadContinue(pKeepGoing) && getTime) {
                     if (modemGetTime(&timeUTC) == ACTION_DRIVER_OK) {
-                        updateTime(timeUTC);
+                        updateTime(timeUTC, true);
                     } else {
                         AQ_NRG_LOGX(EVENT_GET_TIME_FAILURE, 0);
                     }
@@ -465,6 +783,12 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
                                                                     &contents.cellular.earfcn,
                                                                     &contents.cellular.ecl) == ACTION_DRIVER_OK);
                     if (cellularMeasurementTaken) {
+                        costPerByteNWH = modemEnergyPerByteNWH(contents.cellular.rsrpDbm,
+                                                               contents.cellular.transmitPowerDbm,
+                                                               contents.cellular.ecl);
+                        gReportLastCostPerByteNWH = costPerByteNWH;
+                        gReportLastCostTimeSeconds = time(NULL);
+                        AQ_NRG_LOGX(EVENT_REPORT_COST_PER_BYTE_NWH, costPerByteNWH);
                         // The cost of the last modem activity is used here
                         // since we won't know the total until after the
                         // transmission has completed
@@ -475,15 +799,26 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
                         }
                     }
                 }
-                // Send reports
+                // Send reports, unless radio conditions are such
+                // that they are better put off for a while
                 if (threadContinue(pKeepGoing)) {
-                    x = modemSendReports(IOT_SERVER_IP_ADDRESS, IOT_SERVER_PORT,
-                                         imeiString, modemKeepGoing, pKeepGoing);
-                    if (x == ACTION_DRIVER_OK) {
+                    if (reportDefer(costPerByteNWH)) {
+                        gReportDeferred = true;
                         actionCompleted(pAction);
+                        AQ_NRG_LOGX(EVENT_REPORT_DEFERRED, gReportCostPerByteNWH);
                     } else {
-                        actionTriedAndFailed(pAction);
-                        AQ_NRG_LOGX(EVENT_SEND_FAILURE, x);
+                        x = modemSendReports(IOT_SERVER_IP_ADDRESS, IOT_SERVER_PORT,
+                                             imeiString, modemKeepGoing, pKeepGoing);
+                        if (x == ACTION_DRIVER_OK) {
+                            actionCompleted(pAction);
+                            reportsSent = true;
+                            gReportDeferred = false;
+                            gReportUrgent = false;
+                            gLastReportTimeSeconds = time(NULL);
+                        } else {
+                            actionTriedAndFailed(pAction);
+                            AQ_NRG_LOGX(EVENT_SEND_FAILURE, x);
+                        }
                     }
                 }
             } else {
@@ -504,6 +839,34 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
     // can report it next time
     statisticsGet(&contents.statistics);
     bytesTransmitted = contents.statistics.cellularBytesTransmittedSinceReset - bytesTransmitted;
+    if (reportsSent && (costPerByteNWH > 0)) {
+        reportCostUpdate(costPerByteNWH, bytesTransmitted);
+    }
+
+    // Feed what VBAT_OK says was actually used, less what
+    // the processor itself used, into the modem energy model.
+    // Every session goes in, however small the droop (or even
+    // a rise), since leaving out the small ones would bias the
+    // fit upwards, but only if no other action ran alongside
+    // and the supercap alone was powering things (with the
+    // secondary cell charged VBAT_OK hardly moves)
+    x = getVBatOkMV();
+    core_util_critical_section_enter();
+    alone = alone && (gNumActionsRunning == 1) && (gNumActionsStarted == numActionsStarted);
+    core_util_critical_section_exit();
+    if (modemRan && alone && !voltageIsGoodMV(vBatOkStartMV) && (gpProcessTimer != NULL)) {
+        if (x <= vBatOkStartMV) {
+            energyNWH = (long long int) getEnergyDrawnNWH(vBatOkStartMV, x);
+        } else {
+            energyNWH = -((long long int) getEnergyDrawnNWH(x, vBatOkStartMV));
+        }
+        x = gpProcessTimer->read_ms() - startTimeMs;
+        energyNWH -= (long long int) (((unsigned long long int) x) * PROCESSOR_POWER_ACTIVE_NW / 3600000);
+        modemEnergyCalibrate(modemWasOff, bytesTransmitted, energyNWH);
+        if ((energyNWH >= 0) && (energyNWH < 0xFFFFFFFF)) {
+            AQ_NRG_LOGX(EVENT_MODEM_ENERGY_MEASURED_NWH, (unsigned int) energyNWH);
+        }
+    }
     MTX_LOCK(gMtx);
     timeUTC = 0;  // Just re-using this variable since it happens to be lying around
     if (!gModemOff) {
@@ -539,133 +902,136 @@ static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
     *pKeepGoing = false;
 }
 
-// Measure humidity.
-static void doMeasureHumidity(Action *pAction, bool *pKeepGoing)
+// Do both sorts of reporting (get time as an option).
+static void reporting(Action *pAction, bool *pKeepGoing, bool getTime)
 {
-    DataContents contents;
-
-    MBED_ASSERT(pAction->type == ACTION_TYPE_MEASURE_HUMIDITY);
-    if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
-        // Make sure the device is up and take a measurement
-        if (bme280Init(BME280_DEFAULT_ADDRESS) == ACTION_DRIVER_OK) {
-            if (threadContinue(pKeepGoing)) {
-                if (getHumidity(&contents.humidity.percentage) == ACTION_DRIVER_OK) {
-                    actionCompleted(pAction);
-                    // The environment sensor is on all the time so the energy
-                    // consumed is the power consumed since the last measurement
-                    // times the time, plus any individual cost associated with
-                    // taking this reading.
-                    MTX_LOCK(gMtx);
-                    pAction->energyCostNWH = (((unsigned long long int) (time(NULL) - gLastMeasurementTimeBme280Seconds)) *
-                                              BME280_POWER_IDLE_NW / 3600) + BME280_ENERGY_READING_NWH +
-                                             gSystemIdleEnergyPropNWH + activeEnergyUsedNWH();
-                    gLastMeasurementTimeBme280Seconds = time(NULL);
-                    MTX_UNLOCK(gMtx);
-                    if (pDataAlloc(pAction, DATA_TYPE_HUMIDITY, 0, &contents) == NULL) {
-                        AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_HUMIDITY);
-                        AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
-                    }
-                } else {
-                    actionTriedAndFailed(pAction);
-                }
-            }
-        } else {
-            AQ_NRG_LOGX(EVENT_ACTION_DRIVER_INIT_FAILURE, ACTION_TYPE_MEASURE_HUMIDITY);
-        }
+    // If the modem is off then powering it up and registering
+    // is most of the cost of finding out that radio conditions
+    // are still poor, so decide on the conditions last measured,
+    // if they are recent enough, whether to put the report off
+    // before doing that; the action is marked as deferred rather
+    // than completed so that it doesn't count towards the energy
+    // cost of a report
+    if (!getTime && gModemOff && reportDefer(reportLastCostPerByteNWH())) {
+        gReportDeferred = true;
+        actionDeferred(pAction);
+        AQ_NRG_LOGX(EVENT_REPORT_DEFERRED, gReportLastCostPerByteNWH);
+        *pKeepGoing = false;
     } else {
-        AQ_NRG_LOGX(EVENT_ACTION_DRIVER_HEAP_TOO_LOW, pAction->type);
+        reportingModem(pAction, pKeepGoing, getTime);
     }
-
-    // Don't deinitialise afterwards in case we are taking a
-    // temperature or atmospheric pressure reading also
-    // Done with this task now
-    *pKeepGoing = false;
 }
 
-// Measure atmospheric pressure.
-static void doMeasureAtmosphericPressure(Action *pAction, bool *pKeepGoing)
+// Return the index of an action type in gBme280ActionTypes[],
+// or -1 if it is not a BME280 action type.
+static int bme280ActionIndex(ActionType actionType)
 {
-    DataContents contents;
-
-    MBED_ASSERT(pAction->type == ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE);
+    int index = -1;
 
-    if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
-        // Make sure the device is up and take a measurement
-        if (bme280Init(BME280_DEFAULT_ADDRESS) == ACTION_DRIVER_OK) {
-            if (threadContinue(pKeepGoing)) {
-                if (getPressure(&contents.atmosphericPressure.pascalX100) == ACTION_DRIVER_OK) {
-                    actionCompleted(pAction);
-                    // The environment sensor is on all the time so the energy
-                    // consumed is the power consumed since the last measurement
-                    // times the time, plus any individual cost associated with
-                    // taking this reading.
-                    MTX_LOCK(gMtx);
-                    pAction->energyCostNWH = (((unsigned long long int) (time(NULL) - gLastMeasurementTimeBme280Seconds)) *
-                                              BME280_POWER_IDLE_NW / 3600) + BME280_ENERGY_READING_NWH +
-                                             gSystemIdleEnergyPropNWH + activeEnergyUsedNWH();
-                    gLastMeasurementTimeBme280Seconds = time(NULL);
-                    MTX_UNLOCK(gMtx);
-                    if (pDataAlloc(pAction, DATA_TYPE_ATMOSPHERIC_PRESSURE, 0, &contents) == NULL) {
-                        AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_ATMOSPHERIC_PRESSURE);
-                        AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
-                    }
-                } else {
-                    actionTriedAndFailed(pAction);
-                }
-            }
-        } else {
-            AQ_NRG_LOGX(EVENT_ACTION_DRIVER_INIT_FAILURE, ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE);
+    for (unsigned int x = 0; (x < ARRAY_SIZE(gBme280ActionTypes)) && (index < 0); x++) {
+        if (gBme280ActionTypes[x] == actionType) {
+            index = x;
         }
-    } else {
-        AQ_NRG_LOGX(EVENT_ACTION_DRIVER_HEAP_TOO_LOW, pAction->type);
     }
 
-    // Don't deinitialise afterwards in case we are taking a
-    // humidity or atmospheric pressure reading also
-    // Done with this task now
-    *pKeepGoing = false;
+    return index;
 }
 
-// Measure temperature.
-static void doMeasureTemperature(Action *pAction, bool *pKeepGoing)
+// Measure humidity, atmospheric pressure and temperature: whichever
+// of these action types starts first performs all of those that
+// are wanted, from a single BME280 measurement.
+static void doMeasureBme280(Action *pAction, bool *pKeepGoing)
 {
     DataContents contents;
+    Action *pGroupAction;
+    unsigned int numWanted = 0;
+    signed int cX100;
+    unsigned char percentage;
+    unsigned int pascalX100;
+    unsigned long long int energyNWH;
+    ActionDriver result;
+    Timer timer;
 
-    MBED_ASSERT(pAction->type == ACTION_TYPE_MEASURE_TEMPERATURE);
+    MBED_ASSERT(bme280ActionIndex(pAction->type) >= 0);
+    gBme280ActionWanted[bme280ActionIndex(pAction->type)] = true;
 
     if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
         // Make sure the device is up and take a measurement
         if (bme280Init(BME280_DEFAULT_ADDRESS) == ACTION_DRIVER_OK) {
             if (threadContinue(pKeepGoing)) {
-                if (getTemperature(&contents.temperature.cX100) == ACTION_DRIVER_OK) {
-                    actionCompleted(pAction);
-                    // The environment sensor is on all the time so the energy
-                    // consumed is the power consumed since the last measurement
-                    // times the time, plus any individual cost associated with
-                    // taking this reading.
-                    MTX_LOCK(gMtx);
-                    pAction->energyCostNWH = (((unsigned long long int) (time(NULL) - gLastMeasurementTimeBme280Seconds)) *
-                                              BME280_POWER_IDLE_NW / 3600) + BME280_ENERGY_READING_NWH +
-                                             gSystemIdleEnergyPropNWH + activeEnergyUsedNWH();
-                    gLastMeasurementTimeBme280Seconds = time(NULL);
-                    MTX_UNLOCK(gMtx);
-                    if (pDataAlloc(pAction, DATA_TYPE_TEMPERATURE, 0, &contents) == NULL) {
-                        AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_TEMPERATURE);
-                        AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+                timer.start();
+                result = getTemperatureHumidityPressure(&cX100, &percentage, &pascalX100);
+                // The environment sensor is on all the time so the energy
+                // consumed is the power consumed since the last measurement
+                // times the time, plus any individual cost associated with
+                // taking this reading, shared between the actions in the group.
+                for (unsigned int x = 0; x < ARRAY_SIZE(gBme280ActionWanted); x++) {
+                    if (gBme280ActionWanted[x]) {
+                        numWanted++;
+                    }
+                }
+                MTX_LOCK(gMtx);
+                energyNWH = ((((unsigned long long int) (time(NULL) - gLastMeasurementTimeBme280Seconds)) *
+                              BME280_POWER_IDLE_NW / 3600) + BME280_ENERGY_READING_NWH +
+                             gSystemIdleEnergyPropNWH + activeEnergyUsedNWH()) / numWanted;
+                gLastMeasurementTimeBme280Seconds = time(NULL);
+                MTX_UNLOCK(gMtx);
+                for (unsigned int x = 0; x < ARRAY_SIZE(gBme280ActionTypes); x++) {
+                    if (gBme280ActionWanted[x]) {
+                        pGroupAction = pAction;
+                        if (gBme280ActionTypes[x] != pAction->type) {
+                            // The other actions in the group were never
+                            // started so add them here, running in this thread
+                            pGroupAction = pActionAdd(gBme280ActionTypes[x]);
+                            if (pGroupAction != NULL) {
+                                statisticsAddAction(pGroupAction->type);
+                                statisticsActionStart(pGroupAction->type);
+                                statisticsAddEnergy(energyNWH);
+                            } else {
+                                AQ_NRG_LOGX(EVENT_ACTION_ALLOC_FAILURE, 0);
+                            }
+                        }
+                        if (pGroupAction != NULL) {
+                            pGroupAction->energyCostNWH = energyNWH;
+                            if (result == ACTION_DRIVER_OK) {
+                                actionCompleted(pGroupAction);
+                                switch (pGroupAction->type) {
+                                    case ACTION_TYPE_MEASURE_HUMIDITY:
+                                        contents.humidity.percentage = percentage;
+                                    break;
+                                    case ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE:
+                                        contents.atmosphericPressure.pascalX100 = pascalX100;
+                                    break;
+                                    default:
+                                        contents.temperature.cX100 = cX100;
+                                    break;
+                                }
+                                if (pDataAlloc(pGroupAction, gDataType[pGroupAction->type], 0, &contents) == NULL) {
+                                    AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, gDataType[pGroupAction->type]);
+                                    AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+                                }
+                            } else {
+                                actionTriedAndFailed(pGroupAction);
+                            }
+                            // This action ends in doAction(), the others here,
+                            // having taken the time of the shared measurement
+                            if (pGroupAction != pAction) {
+                                statisticsActionEnd(pGroupAction->type, pGroupAction->state,
+                                                    timer.read_ms(), energyNWH);
+                            }
+                        }
                     }
-                } else {
-                    actionTriedAndFailed(pAction);
                 }
             }
         } else {
-            AQ_NRG_LOGX(EVENT_ACTION_DRIVER_INIT_FAILURE, ACTION_TYPE_MEASURE_TEMPERATURE);
+            AQ_NRG_LOGX(EVENT_ACTION_DRIVER_INIT_FAILURE, pAction->type);
         }
     } else {
         AQ_NRG_LOGX(EVENT_ACTION_DRIVER_HEAP_TOO_LOW, pAction->type);
     }
 
-    // Don't deinitialise afterwards in case we are taking a
-    // humidity or atmospheric pressure reading also
+    // Don't deinitialise afterwards as the BME280
+    // is always on
     // Done with this task now
     *pKeepGoing = false;
 }
@@ -720,13 +1086,27 @@ static void doMeasureLight(Action *pAction, bool *pKeepGoing)
 static void doMeasureAcceleration(Action *pAction, bool *pKeepGoing)
 {
     DataContents contents;
+    unsigned int numSamples = 0;
 
     MBED_ASSERT(pAction->type == ACTION_TYPE_MEASURE_ACCELERATION);
 
     if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
         if (lis3dhInit(LIS3DH_DEFAULT_ADDRESS) == ACTION_DRIVER_OK) {
-            if (getAcceleration(&contents.acceleration.xGX1000, &contents.acceleration.yGX1000,
-                                &contents.acceleration.zGX1000) == ACTION_DRIVER_OK) {
+            // Drain the samples the accelerometer has buffered while
+            // we were asleep; the newest of them is the acceleration
+            // reading, all of them together give the motion reading
+            if ((getAccelerationStream(gAccelerationXGX1000, gAccelerationYGX1000,
+                                       gAccelerationZGX1000, ARRAY_SIZE(gAccelerationXGX1000),
+                                       &numSamples) == ACTION_DRIVER_OK) && (numSamples > 0)) {
+                contents.acceleration.xGX1000 = gAccelerationXGX1000[numSamples - 1];
+                contents.acceleration.yGX1000 = gAccelerationYGX1000[numSamples - 1];
+                contents.acceleration.zGX1000 = gAccelerationZGX1000[numSamples - 1];
+            } else {
+                numSamples = 0;
+            }
+            if ((numSamples > 0) ||
+                (getAcceleration(&contents.acceleration.xGX1000, &contents.acceleration.yGX1000,
+                                 &contents.acceleration.zGX1000) == ACTION_DRIVER_OK)) {
                 actionCompleted(pAction);
                 // The accelerometer is on all the time so the energy
                 // consumed is the power consumed since the last measurement
@@ -742,6 +1122,18 @@ static void doMeasureAcceleration(Action *pAction, bool *pKeepGoing)
                     AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_ACCELERATION);
                     AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
                 }
+                // A single sample has no motion in it.  Note that the
+                // motion data item is not attached to the action since
+                // an action can only track one data item and the energy
+                // cost is already carried by the acceleration data item
+                if (numSamples > 1) {
+                    motionExtractFeatures(gAccelerationXGX1000, gAccelerationYGX1000,
+                                          gAccelerationZGX1000, numSamples, &contents.motion);
+                    if (pDataAlloc(NULL, DATA_TYPE_MOTION, 0, &contents) == NULL) {
+                        AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_MOTION);
+                        AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
+                    }
+                }
             } else {
                 actionTriedAndFailed(pAction);
             }
@@ -768,8 +1160,8 @@ static void doMeasurePosition(Action *pAction, bool *pKeepGoing)
 
     MBED_ASSERT(pAction->type == ACTION_TYPE_MEASURE_POSITION);
 
-    AQ_NRG_LOGX(EVENT_POSITION_BACK_OFF_SECONDS, gPositionFixSkipsRequired * WAKEUP_INTERVAL_SECONDS);
-    if (gPositionNumFixesSkipped >= gPositionFixSkipsRequired) {
+    AQ_NRG_LOGX(EVENT_POSITION_BACK_OFF_SECONDS, gPositionBackOffSeconds);
+    if (gPositionSkippedSeconds >= gPositionBackOffSeconds) {
         if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
             // Initialise the GNSS device and wait for a measurement
             // to pop-out.
@@ -778,19 +1170,14 @@ static void doMeasurePosition(Action *pAction, bool *pKeepGoing)
                 timer.reset();
                 timer.start();
                 statisticsIncPositionAttempts();
-#if defined(__CC_ARM) || (defined(__ARMCC_VERSION) && (__ARMCC_VERSION >= 6010050))
-#pragma diag_suppress 1293  //  suppressing warning "assignment in condition" on ARMCC
-#endif
-                while (threadContinue(pKeepGoing) &&
-                       !(gotFix = (getPosition(&contents.position.latitudeX10e7,
-                                               &contents.position.longitudeX10e7,
-                                               &contents.position.radiusMetres,
-                                               &contents.position.altitudeMetres,
-                                               &contents.position.speedMPS,
-                                               &SVs) == ACTION_DRIVER_OK)) &&
-                        (timer.read_ms() < POSITION_TIMEOUT_MS)) {
-                    Thread::wait(POSITION_CHECK_INTERVAL_MS);
-                }
+                // Sleep while GNSS works on a fix
+                gotFix = (waitPosition(&contents.position.latitudeX10e7,
+                                       &contents.position.longitudeX10e7,
+                                       &contents.position.radiusMetres,
+                                       &contents.position.altitudeMetres,
+                                       &contents.position.speedMPS,
+                                       &SVs, POSITION_TIMEOUT_MS,
+                                       positionKeepGoing, pKeepGoing) == ACTION_DRIVER_OK);
                 timer.stop();
 
                 // GNSS is only switched on when required and so
@@ -805,16 +1192,16 @@ static void doMeasurePosition(Action *pAction, bool *pKeepGoing)
                     gLastPositionTime = time(NULL);
                     // Reset the number of skips required and
                     // the skip count as we can get position now
-                    gPositionFixSkipsRequired = 0;
-                    gPositionNumFixesSkipped = 0;
-                    gPositionNumFixesFailedNoBackOff = 0;
+                    gPositionBackOffSeconds = 0;
+                    gPositionSkippedSeconds = 0;
+                    gPositionFailedNoBackOffSeconds = 0;
                     // Update stats and complete the action
                     statisticsIncPositionSuccess();
                     statisticsLastSVs(SVs);
                     actionCompleted(pAction);
                     // Since GNSS is able to get a fix, get the time also
                     if (getTime(&timeUTC) == ACTION_DRIVER_OK) {
-                        updateTime(timeUTC);
+                        updateTime(timeUTC, true);
                     }
                     if (pDataAlloc(pAction, DATA_TYPE_POSITION, 0, &contents) == NULL) {
                         AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_POSITION);
@@ -822,46 +1209,48 @@ static void doMeasurePosition(Action *pAction, bool *pKeepGoing)
                     }
                     // Since GNSS is able to get a fix, get the time also
                     if (getTime(&timeUTC) == ACTION_DRIVER_OK) {
-                        updateTime(timeUTC);
+                        updateTime(timeUTC, true);
                     }
                 } else {
-                    // Didn't achieve a fix, decide what to do
-                    if (gPositionFixSkipsRequired == 0) {
-                        gPositionNumFixesFailedNoBackOff++;
+                    // Didn't achieve a fix, decide what to do, counting
+                    // in the wake-up interval the forecaster chose since
+                    // it varies from one wake-up to the next
+                    if (gPositionBackOffSeconds == 0) {
+                        gPositionFailedNoBackOffSeconds += gWakeUpIntervalSeconds;
                         // If we've tried without success for the no back-off
                         // period, start skipping
-                        if (gPositionNumFixesFailedNoBackOff * WAKEUP_INTERVAL_SECONDS > LOCATION_FIX_NO_BACK_OFF_SECONDS) {
-                            gPositionFixSkipsRequired = 1;
-                            gPositionNumFixesSkipped = 0;
+                        if (gPositionFailedNoBackOffSeconds > LOCATION_FIX_NO_BACK_OFF_SECONDS) {
+                            gPositionBackOffSeconds = gWakeUpIntervalSeconds;
+                            gPositionSkippedSeconds = 0;
                         }
                     } else {
-                        // We've been skipping already, double the number
-                        // of skips up to the limit
-                        if (gPositionFixSkipsRequired * WAKEUP_INTERVAL_SECONDS * 2 < LOCATION_FIX_MAX_PERIOD_SECONDS) {
-                            gPositionFixSkipsRequired *= 2;
+                        // We've been skipping already, double the back-off
+                        // up to the limit
+                        if (gPositionBackOffSeconds * 2 < LOCATION_FIX_MAX_PERIOD_SECONDS) {
+                            gPositionBackOffSeconds *= 2;
                         } else {
-                            gPositionFixSkipsRequired = LOCATION_FIX_MAX_PERIOD_SECONDS / WAKEUP_INTERVAL_SECONDS;
+                            gPositionBackOffSeconds = LOCATION_FIX_MAX_PERIOD_SECONDS;
                         }
-                        gPositionNumFixesSkipped = 0;
+                        gPositionSkippedSeconds = 0;
                     }
 
                     actionTriedAndFailed(pAction);
                 }
             } else {
                 // Keep track of the number of position fix attempts skipped
-                gPositionNumFixesSkipped++;
+                gPositionSkippedSeconds += gWakeUpIntervalSeconds;
                 AQ_NRG_LOGX(EVENT_ACTION_DRIVER_INIT_FAILURE, ACTION_TYPE_MEASURE_POSITION);
             }
             // Shut the device down again
             zoem8Deinit();
         } else {
             // Keep track of the number of position fix attempts skipped
-            gPositionNumFixesSkipped++;
+            gPositionSkippedSeconds += gWakeUpIntervalSeconds;
             AQ_NRG_LOGX(EVENT_ACTION_DRIVER_HEAP_TOO_LOW, pAction->type);
         }
     } else {
         // Keep track of the number of position fix attempts skipped
-        gPositionNumFixesSkipped++;
+        gPositionSkippedSeconds += gWakeUpIntervalSeconds;
     }
 
     // Done with this task now
@@ -952,8 +1341,8 @@ static void checkBleProgress(Action *pAction)
                     AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_BLE);
                     AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
                 }
-                free(pBleData->pData);
-                free(pBleData);
+                heapFree(HEAP_SITE_BLE, pBleData->pData, pBleData->dataLen);
+                heapFree(HEAP_SITE_BLE, pBleData, sizeof(*pBleData));
             }
         }
     }
@@ -970,6 +1359,7 @@ static void doMeasureBle(Action *pAction, bool *pKeepGoing)
 
 #if !MBED_CONF_APP_DISABLE_PERIPHERAL_HW && !defined (TARGET_UBLOX_C030_U201)
     gpBleTimer = new Timer();
+    heapCountAlloc(HEAP_SITE_OTHER, sizeof(Timer));
     gBleActiveEnergyAllocatedNWH = 0;
     if (heapIsAboveMargin(MODEM_HEAP_REQUIRED_BYTES)) {
         bleInit(BLE_PEER_DEVICE_NAME_PREFIX, GattCharacteristic::UUID_BATTERY_LEVEL_STATE_CHAR, BLE_PEER_NUM_DATA_ITEMS, gpEventQueue, false);
@@ -988,6 +1378,7 @@ static void doMeasureBle(Action *pAction, bool *pKeepGoing)
     } else {
         AQ_NRG_LOGX(EVENT_ACTION_DRIVER_HEAP_TOO_LOW, pAction->type);
     }
+    heapCountFree(HEAP_SITE_OTHER, sizeof(Timer));
     delete gpBleTimer;
     gpBleTimer = NULL;
 #endif
@@ -999,9 +1390,21 @@ static void doMeasureBle(Action *pAction, bool *pKeepGoing)
 static void doAction(Action *pAction)
 {
     bool keepGoing = true;
+    Timer timer;
+    Timer *pBootTimer;
 
+    TIMELINE_BEGIN(TIMELINE_ID_ACTION, pAction->type);
     AQ_NRG_LOGX(EVENT_ACTION_THREAD_STARTED, pAction->type);
+    core_util_critical_section_enter();
+    gNumActionsRunning++;
+    gNumActionsStarted++;
+    core_util_critical_section_exit();
     statisticsAddAction(pAction->type);
+    statisticsActionStart(pAction->type);
+    if (actionIsLoad(pAction->type)) {
+        voltageSamplerLoad(true);
+    }
+    timer.start();
 
     while (threadContinue(&keepGoing)) {
 
@@ -1015,13 +1418,9 @@ static void doAction(Action *pAction)
                 reporting(pAction, &keepGoing, true);
             break;
             case ACTION_TYPE_MEASURE_HUMIDITY:
-                doMeasureHumidity(pAction, &keepGoing);
-            break;
             case ACTION_TYPE_MEASURE_ATMOSPHERIC_PRESSURE:
-                doMeasureAtmosphericPressure(pAction, &keepGoing);
-            break;
             case ACTION_TYPE_MEASURE_TEMPERATURE:
-                doMeasureTemperature(pAction, &keepGoing);
+                doMeasureBme280(pAction, &keepGoing);
             break;
             case ACTION_TYPE_MEASURE_LIGHT:
                 doMeasureLight(pAction, &keepGoing);
@@ -1049,14 +1448,38 @@ static void doAction(Action *pAction)
         }
     }
 
-    // If the action has not run, mark it as aborted
-    if (!hasActionRun(pAction)) {
+    if (actionIsLoad(pAction->type)) {
+        voltageSamplerLoad(false);
+    }
+    core_util_critical_section_enter();
+    gNumActionsRunning--;
+    core_util_critical_section_exit();
+
+    // If the action has not run, and was not deferred,
+    // mark it as aborted
+    if (!hasActionRun(pAction) && (pAction->state != ACTION_STATE_DEFERRED)) {
         actionAborted(pAction);
     }
 
     // Whether successful or not, add any energy used to
-    // the statistics
+    // the statistics, along with how the action went
     statisticsAddEnergy(pAction->energyCostNWH);
+    statisticsActionEnd(pAction->type, pAction->state, timer.read_ms(),
+                        pAction->energyCostNWH);
+
+    // Note how long it took to make a measurement after start-up
+    if ((pAction->state == ACTION_STATE_COMPLETED) &&
+        (gDataType[pAction->type] != DATA_TYPE_NULL)) {
+        core_util_critical_section_enter();
+        pBootTimer = gpBootTimer;
+        gpBootTimer = NULL;
+        core_util_critical_section_exit();
+        if (pBootTimer != NULL) {
+            pBootTimer->stop();
+            TIMELINE_INSTANT(TIMELINE_ID_FIRST_MEASUREMENT, pAction->type);
+            AQ_NRG_LOGX(EVENT_BOOT_TO_FIRST_MEASUREMENT_MS, pBootTimer->read_ms());
+        }
+    }
 
     AQ_NRG_LOGX(EVENT_ACTION_THREAD_TERMINATED, pAction->type);
     AQ_NRG_LOGX(EVENT_THIS_STACK_MIN_LEFT, osThreadGetStackSize(Thread::gettid()) - osThreadGetStackSpace(Thread::gettid()));
@@ -1065,6 +1488,11 @@ static void doAction(Action *pAction)
     } else {
         AQ_NRG_LOGX(EVENT_ENERGY_USED_UWH, (unsigned int) (pAction->energyCostNWH / 1000));
     }
+
+    TIMELINE_END(TIMELINE_ID_ACTION, pAction->type);
+
+    // Let the processor know that there's a free slot
+    gActionEndedSemaphore.release();
 }
 
 // Tidy up any threads that have terminated, returning
@@ -1076,6 +1504,7 @@ static int checkThreadsRunning()
     for (unsigned int x = 0; x < ARRAY_SIZE(gpActionThreadList); x++) {
         if (gpActionThreadList[x] != NULL) {
             if (gpActionThreadList[x]->get_state() ==  rtos::Thread::Deleted) {
+                heapCountFree(HEAP_SITE_THREAD, sizeof(Thread) + gpActionThreadList[x]->stack_size());
                 delete gpActionThreadList[x];
                 gpActionThreadList[x] = NULL;
             } else {
@@ -1092,6 +1521,8 @@ static void terminateAllThreads()
 {
     unsigned int x;
 
+    TIMELINE_BEGIN(TIMELINE_ID_THREADS_TERMINATE, 0);
+
     // Set the terminate signal on all threads
     for (x = 0; x < ARRAY_SIZE(gpActionThreadList); x++) {
         if (gpActionThreadList[x] != NULL) {
@@ -1107,8 +1538,36 @@ static void terminateAllThreads()
     }
 
     AQ_NRG_LOGX(EVENT_ALL_THREADS_TERMINATED, 0);
+
+    TIMELINE_END(TIMELINE_ID_THREADS_TERMINATE, 0);
 }
 
+#if !MBED_CONF_APP_DISABLE_PERIPHERAL_HW
+// Leave only the first of the BME280 action types in the ranked
+// list, since it will perform the others, noting which are wanted.
+static void groupBme280Actions()
+{
+    ActionType actionType;
+    bool first = true;
+    int x;
+
+    memset(gBme280ActionWanted, 0, sizeof(gBme280ActionWanted));
+    actionType = actionRankFirstType();
+    while (actionType != ACTION_TYPE_NULL) {
+        x = bme280ActionIndex(actionType);
+        if (x >= 0) {
+            gBme280ActionWanted[x] = true;
+        }
+        if ((x >= 0) && !first) {
+            actionType = actionRankDelType(actionType);
+        } else {
+            first = first && (x < 0);
+            actionType = actionRankNextType();
+        }
+    }
+}
+#endif
+
 // Determine the actions to perform
 static ActionType processorActionList(WakeUpReason wakeUpReason)
 {
@@ -1124,6 +1583,15 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
         AQ_NRG_LOGX(EVENT_ENERGY_AVAILABLE_UWH, (unsigned int) (energyAvailableNWH / 1000));
     }
 
+    // Hold back what is needed to sleep until the
+    // energy source is next forecast to harvest
+    energyAvailableNWH = forecastEnergyBudgetNWH(getEnergySource(), time(NULL),
+                                                 energyAvailableNWH,
+                                                 PROCESSOR_POWER_IDLE_NW);
+    if (energyAvailableNWH < 0xFFFFFFFF) {
+        AQ_NRG_LOGX(EVENT_ENERGY_BUDGET_NWH, (unsigned int) energyAvailableNWH);
+    }
+
     // Rank the action list
     actionType = actionRankTypes();
 
@@ -1131,8 +1599,9 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
     // from the list and move ACTION_TYPE_REPORT to the end so that we report things from
     // this wake-up straight away rather than leaving them sitting around until next
     // time, otherwise move ACTION_TYPE_GET_TIME_AND_REPORT to the end and delete
-    // ACTION_TYPE_REPORT
-    if ((gTimeUpdate != 0) && (time(NULL) - gTimeUpdate < TIME_UPDATE_INTERVAL_SECONDS)) {
+    // ACTION_TYPE_REPORT; how often the time needs updating depends on how
+    // well the drift of the clock is known, see eh_clock
+    if (!clockUpdateNeeded()) {
         actionType = actionRankDelType(ACTION_TYPE_GET_TIME_AND_REPORT);
         actionType = actionRankMoveType(ACTION_TYPE_REPORT, MAX_NUM_ACTION_TYPES);
     } else {
@@ -1140,14 +1609,28 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
         actionType = actionRankDelType(ACTION_TYPE_REPORT);
     }
 
+    // A passing magnet means someone wants a report
+    // now, whatever the radio conditions
+    if (wakeUpReason == WAKE_UP_MAGNETIC) {
+        gReportUrgent = true;
+    }
+
+#if MAGNETIC_EVENTS_ONLY
+    // The field strength that matters is carried with
+    // WAKE_UP_MAGNETIC, there's no need to measure it otherwise
+    actionType = actionRankDelType(ACTION_TYPE_MEASURE_MAGNETIC);
+#endif
+
     // If the data queue is not sufficiently full, we're
     // not reporting logging over the air interface
     // (which is quite a heavy load and so requires reporting
-    // every wakeup), we've not be woken up by a passing magnet
+    // every wakeup), we've not be woken up by a passing magnet,
+    // we're not due to retry a report that was put off
     // and we're less than the maximum report interval
     // (or there isn't one) then don't report.
 #if !LOGGING_NEEDS_REPORTING_EACH_WAKEUP
     if ((wakeUpReason != WAKE_UP_MAGNETIC) &&
+        !reportRetryDue() &&
         (dataGetPercentageBytesUsed() < MAX_DATA_QUEUE_LENGTH_PERCENT) &&
         ((MAX_REPORT_INTERVAL_SECONDS == 0) ||
          (time(NULL) - gLastSleepTimeModemSeconds < MAX_REPORT_INTERVAL_SECONDS))) {
@@ -1173,9 +1656,10 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
     // waking up prodigiously often)
     if (wakeUpReason == WAKE_UP_ACCELERATION) {
         gWeveMoved = true;
-        gPositionFixSkipsRequired = 0;
-        gPositionNumFixesSkipped = 0;
-        gPositionNumFixesFailedNoBackOff = 0;
+        zoem8PositionMoved();
+        gPositionBackOffSeconds = 0;
+        gPositionSkippedSeconds = 0;
+        gPositionFailedNoBackOffSeconds = 0;
         while (actionType != ACTION_TYPE_NULL) {
             actionType = actionRankDelType(actionType);
         }
@@ -1216,7 +1700,7 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
             }
             // Increment the skip count if this was GNSS
             if (actionOverTheBrink == ACTION_TYPE_MEASURE_POSITION) {
-                gPositionNumFixesSkipped++;
+                gPositionSkippedSeconds += gWakeUpIntervalSeconds;
             }
             actionType = actionRankDelType(actionOverTheBrink);
         }
@@ -1226,15 +1710,23 @@ static ActionType processorActionList(WakeUpReason wakeUpReason)
     } else {
         AQ_NRG_LOGX(EVENT_ENERGY_REQUIRED_TOTAL_UWH, (unsigned int) (energyRequiredTotalNWH / 1000));
     }
+    gActionsEnergyNWH = energyRequiredTotalNWH;
+
+    // The BME280 measurements are made as a group (but
+    // only by the real driver, hence not when the peripheral
+    // HW is disabled for testing)
+#if !MBED_CONF_APP_DISABLE_PERIPHERAL_HW
+    groupBme280Actions();
+#endif
 
     return actionRankFirstType();
 }
 
-// Determine the wake-up reason.
+// Determine the wake-up reason; this only looks at flags,
+// it doesn't talk to any of the sensors.
 static WakeUpReason processorWakeUpReason()
 {
     WakeUpReason wakeUpReason = WAKE_UP_RTC;
-    DataContents contents;
 
     if (gJustBooted) {
         wakeUpReason = WAKE_UP_POWER_ON;
@@ -1272,13 +1764,32 @@ static WakeUpReason processorWakeUpReason()
        }
     }
 
+    return wakeUpReason;
+}
+
+// Add a wake-up reason data structure to the queue, reading
+// the field strength that caused a magnetic wake-up only if
+// there is the power to do so.
+static void processorDataWakeUpReason(WakeUpReason wakeUpReason, bool powerIsGood)
+{
+    DataContents contents;
+
     contents.wakeUpReason.reason = wakeUpReason;
+    contents.wakeUpReason.teslaX1000 = 0;
+    if ((wakeUpReason == WAKE_UP_MAGNETIC) && powerIsGood) {
+        // Capture the field strength that caused the wake-up while
+        // it is still there: the SI7210 has carried on sampling and
+        // filtering while we were asleep so this is one quick read
+        i2cInit(PIN_I2C_SDA, PIN_I2C_SCL);
+        if (getFieldStrength(&contents.wakeUpReason.teslaX1000) != ACTION_DRIVER_OK) {
+            contents.wakeUpReason.teslaX1000 = 0;
+        }
+        i2cDeinit();
+    }
     if (pDataAlloc(NULL, DATA_TYPE_WAKE_UP_REASON, 0, &contents) == NULL) {
         AQ_NRG_LOGX(EVENT_DATA_ITEM_ALLOC_FAILURE, DATA_TYPE_WAKE_UP_REASON);
         AQ_NRG_LOGX(EVENT_DATA_CURRENT_SIZE_BYTES, dataGetBytesUsed());
     }
-
-    return wakeUpReason;
 }
 
 // Add a voltages data structure to the queue.
@@ -1324,6 +1835,15 @@ static unsigned char processorBestRecentEnergySource()
 
     memset(count, 0, sizeof(count));
 
+    // Look back over ENERGY_HISTORY_SECONDS at the
+    // wake-up interval the forecaster has chosen
+    if ((gWakeUpIntervalSeconds > 0) &&
+        (y > ENERGY_HISTORY_SECONDS / (unsigned int) gWakeUpIntervalSeconds)) {
+        y = ENERGY_HISTORY_SECONDS / gWakeUpIntervalSeconds;
+        if (y == 0) {
+            y = 1;
+        }
+    }
     if (y > gNumWakeups) {
         y = gNumWakeups;
     }
@@ -1338,9 +1858,13 @@ static unsigned char processorBestRecentEnergySource()
         }
     }
 
-    // Chose the highest scoring one
+    // Chose the highest scoring one, using the rate at which
+    // the energy sources were last seen to harvest to decide
+    // between equals
     for (unsigned int x = 0; x < ARRAY_SIZE(count); x++) {
-        if (count[x] > count[energySource - 1]) {
+        if ((count[x] > count[energySource - 1]) ||
+            ((count[x] == count[energySource - 1]) &&
+             (gHarvestNW[x] > gHarvestNW[energySource - 1]))) {
             energySource = x + 1;
         }
     }
@@ -1352,9 +1876,10 @@ static unsigned char processorBestRecentEnergySource()
 // Age the energy source.
 static void processorAgeEnergySource()
 {
-    // Shuffle the energy sources down in the list
-    for (unsigned int x = 0; x < ARRAY_SIZE(gEnergyChoice) - 1; x++) {
-        gEnergyChoice[x + 1] = gEnergyChoice[x];
+    // Shuffle the energy sources down in the list, from
+    // the end so that each entry moves only one place
+    for (unsigned int x = ARRAY_SIZE(gEnergyChoice) - 1; x > 0; x--) {
+        gEnergyChoice[x] = gEnergyChoice[x - 1];
     }
 }
 
@@ -1370,28 +1895,42 @@ void processorInit()
         for (unsigned int x = 0; x < ARRAY_SIZE(gpActionThreadList); x++) {
             gpActionThreadList[x] = NULL;
         }
+        gNumActionsRunning = 0;
+        gNumActionsStarted = 0;
 
         gLogSuspendTime = 0;
         gLogIndex = 0;
-        gTimeUpdate = 0;
-        gLastMeasurementTimeBme280Seconds = 0;
-        gLastMeasurementTimeLis3dhSeconds = 0;
-        gLastMeasurementTimeSi7210Seconds = 0;
-        gLastMeasurementTimeSi1133Seconds = 0;
-        gLastSleepTimeModemSeconds = 0;
-        gLastMeasurementTimeBleSeconds = 0;
+        // The time may have been restored across a reset (see
+        // eh_clock) so these start from now rather than zero
+        gLastMeasurementTimeBme280Seconds = time(NULL);
+        gLastMeasurementTimeLis3dhSeconds = gLastMeasurementTimeBme280Seconds;
+        gLastMeasurementTimeSi7210Seconds = gLastMeasurementTimeBme280Seconds;
+        gLastMeasurementTimeSi1133Seconds = gLastMeasurementTimeBme280Seconds;
+        gLastSleepTimeModemSeconds = gLastMeasurementTimeBme280Seconds;
+        gLastMeasurementTimeBleSeconds = gLastMeasurementTimeBme280Seconds;
         gLastModemEnergyNWH = 0;
         memset(gVIn, 0, sizeof(gVIn));
         gVInCount = 0;
+        memset(gHarvestNW, 0, sizeof(gHarvestNW));
+        gActionsEnergyNWH = 0;
+        gWakeUpEnergyNWH = 0;
+        gWakeUpIntervalSeconds = WAKEUP_INTERVAL_SECONDS;
+        forecastInit();
         gNumWakeups = 0;
         gNumEnergeticWakeups= 0;
         gLastPositionTime = -1;
         gWeveMoved = false;
-        gPositionFixSkipsRequired = 0;
-        gPositionNumFixesSkipped = 0;
-        gPositionNumFixesFailedNoBackOff = 0;
+        gPositionBackOffSeconds = 0;
+        gPositionSkippedSeconds = 0;
+        gPositionFailedNoBackOffSeconds = 0;
         gReportNumFailures = 0;
         gModemOff = true;
+        gReportCostPerByteNWH = 0;
+        gLastReportTimeSeconds = 0;
+        gReportDeferred = false;
+        gReportLastCostPerByteNWH = 0;
+        gReportLastCostTimeSeconds = 0;
+        gReportUrgent = false;
 
         CHOOSE_ENERGY_SOURCE(ENERGY_SOURCE_DEFAULT);
     }
@@ -1417,7 +1956,13 @@ void processorHandleWakeup(EventQueue *pEventQueue)
     int vBatOk = 0;
     int vPrimary = 0;
     unsigned int vInCount = 0;
+    Voltages voltages;
+    VoltageSamplerStatistics samplerStatistics;
+    long long int harvestNW;
+    int harvestForecastNW;
+    unsigned long long int wakeUpEnergyNWH;
     WakeUpReason wakeUpReason;
+    int driftSeconds;
 #ifndef DISABLE_ENERGY_CHOOSER
     unsigned char energySource = ENERGY_SOURCE_DEFAULT;
 #endif
@@ -1442,6 +1987,7 @@ void processorHandleWakeup(EventQueue *pEventQueue)
         gAwakeCount = 0;
         ticker.attach(&awake, 1);
         gpProcessTimer = new Timer();
+        heapCountAlloc(HEAP_SITE_OTHER, sizeof(Timer));
         gpProcessTimer->start();
         gSystemActiveEnergyAllocatedNWH = 0;
 
@@ -1452,36 +1998,55 @@ void processorHandleWakeup(EventQueue *pEventQueue)
         feedWatchdog();
         resumeLog(((unsigned int) (time(NULL) - gLogSuspendTime)) * 1000000);
 
+        // Correct the clock for the drift learnt so far
+        driftSeconds = clockDriftSeconds();
+        if (driftSeconds != 0) {
+            updateTime(time(NULL) + driftSeconds, false);
+        }
+
         wakeUpReason = processorWakeUpReason();
+        TIMELINE_BEGIN(TIMELINE_ID_WAKE_UP, wakeUpReason);
         AQ_NRG_LOGX(EVENT_WAKE_UP, wakeUpReason);
         AQ_NRG_LOGX(EVENT_CURRENT_TIME_UTC, time(NULL));
 
-        vBatOk = getVBatOkMV();
+        // Take all the voltages in one go
+        getVoltages(&voltages);
+        vBatOk = voltages.vBatOkMV;
         AQ_NRG_LOGX(EVENT_V_BAT_OK_READING_MV, vBatOk);
-        vPrimary = getVPrimaryMV();
+        vPrimary = voltages.vPrimaryMV;
         AQ_NRG_LOGX(EVENT_V_PRIMARY_READING_MV, vPrimary);
-        vIn = getVInMV();
+        vIn = voltages.vInMV;
         vInCount++;
         AQ_NRG_LOGX(EVENT_V_IN_READING_MV, vIn);
         AQ_NRG_LOGX(EVENT_ENERGY_SOURCE, getEnergySource());
 
+        // Record why we woke up, only going to the sensors
+        // for it if there is the power to do so
+        processorDataWakeUpReason(wakeUpReason, voltageIsBearableMV(vBatOk));
+
         // If there is enough power to operate, perform some actions
-        if (voltageIsBearable()) {
+        if (voltageIsBearableMV(vBatOk)) {
             gNumEnergeticWakeups++;
             debugPulseLed(20);
-            AQ_NRG_LOGX(EVENT_PROCESSOR_RUNNING, voltageIsGood() + voltageIsNotBad() + voltageIsBearable());
-
-            // Take a measurement of VIn
-            vIn += getVInMV();
-            vInCount++;
+            AQ_NRG_LOGX(EVENT_PROCESSOR_RUNNING, voltageIsGoodMV(vBatOk) + voltageIsNotBadMV(vBatOk) +
+                                                 voltageIsBearableMV(vBatOk));
 
             // Add a voltages data structure to the queue
             processorDataVoltages(vBatOk, vIn / vInCount, vPrimary);
 
+            // Sample VIN and VBAT_OK in the background while the
+            // actions run, rather than in the loops below
+            while (gActionEndedSemaphore.wait(0) > 0) {}
+            if (!voltageSamplerStart()) {
+                AQ_NRG_LOGX(EVENT_VOLTAGE_SAMPLER_START_FAILURE, 0);
+            }
+
             statisticsWakeUp();
 
             // Derive the action to be performed
+            TIMELINE_BEGIN(TIMELINE_ID_ACTION_LIST, 0);
             actionType = processorActionList(wakeUpReason);
+            TIMELINE_END(TIMELINE_ID_ACTION_LIST, actionType);
             AQ_NRG_LOGX(EVENT_ACTION, actionType);
 
             if (actionCount() > 0) {
@@ -1492,7 +2057,7 @@ void processorHandleWakeup(EventQueue *pEventQueue)
             }
 
             // Kick off actions while there's power and something to start
-            while ((actionType != ACTION_TYPE_NULL) && voltageIsNotBad()) {
+            while ((actionType != ACTION_TYPE_NULL) && voltageIsNotBadMV(vBatOkLatestMV())) {
                 // Get I2C going for the sensors
                 i2cInit(PIN_I2C_SDA, PIN_I2C_SCL);
                 // If there's an empty slot, start an action thread
@@ -1501,9 +2066,12 @@ void processorHandleWakeup(EventQueue *pEventQueue)
                     if (pAction != NULL) {
                         gpActionThreadList[taskIndex] = new Thread(osPriorityNormal, gStackSizes[actionType]);
                         if (gpActionThreadList[taskIndex] != NULL) {
+                            heapCountAlloc(HEAP_SITE_THREAD, sizeof(Thread) + gStackSizes[actionType]);
+                            TIMELINE_INSTANT(TIMELINE_ID_ACTION_THREAD_START, actionType);
                             taskStatus = gpActionThreadList[taskIndex]->start(callback(doAction, pAction));
                             if (taskStatus != osOK) {
                                 AQ_NRG_LOGX(EVENT_ACTION_THREAD_START_FAILURE, taskStatus);
+                                heapCountFree(HEAP_SITE_THREAD, sizeof(Thread) + gStackSizes[actionType]);
                                 delete gpActionThreadList[taskIndex];
                                 gpActionThreadList[taskIndex] = NULL;
                             }
@@ -1525,27 +2093,29 @@ void processorHandleWakeup(EventQueue *pEventQueue)
                 if (taskIndex >= ARRAY_SIZE(gpActionThreadList)) {
                     taskIndex = 0;
                     AQ_NRG_LOGX(EVENT_ACTION_THREADS_RUNNING, checkThreadsRunning());
-                    Thread::wait(PROCESSOR_IDLE_MS); // Relax a little once we've set a batch off
+                    // Relax a little once we've set a batch off, or
+                    // until an action ends and frees up a slot
+                    gActionEndedSemaphore.wait(PROCESSOR_IDLE_MS);
                 }
 
                 // Check if any threads have ended
                 checkThreadsRunning();
             }
 
-            AQ_NRG_LOGX(EVENT_POWER, voltageIsNotBad() + voltageIsBearable());
+            vBatOk = vBatOkLatestMV();
+            AQ_NRG_LOGX(EVENT_POWER, voltageIsNotBadMV(vBatOk) + voltageIsBearableMV(vBatOk));
 
             // If we've got here then either we've kicked off all the required actions or
             // power is no longer good.  While power is good and we've not run out of time
-            // take measurements of each VIN and do a background check on the progress of
-            // the remaining actions.  Also make sure we keep running until we've measured
-            // the VIN of all energy sources
+            // do a background check on the progress of the remaining actions, waking up
+            // when one ends or every PROCESSOR_IDLE_MS otherwise; VIN is measured by the
+            // background voltage sampler meanwhile
+            TIMELINE_BEGIN(TIMELINE_ID_ACTIONS_WAIT, 0);
             while ((checkThreadsRunning() > 0) && keepGoing) {
-                // Take another measurement of VIn
-                vIn += getVInMV();
-                vInCount++;
                 // Check for VBAT_OK going bad
-                if (!voltageIsNotBad()) {
-                    AQ_NRG_LOGX(EVENT_POWER, voltageIsNotBad() + voltageIsBearable());
+                vBatOk = vBatOkLatestMV();
+                if (!voltageIsNotBadMV(vBatOk)) {
+                    AQ_NRG_LOGX(EVENT_POWER, voltageIsNotBadMV(vBatOk) + voltageIsBearableMV(vBatOk));
                     keepGoing = false;
                 // Check run-time
                 } else if (gpProcessTimer->read_ms() / 1000 > gMaxRunTime) {
@@ -1553,14 +2123,35 @@ void processorHandleWakeup(EventQueue *pEventQueue)
                     keepGoing = false;
                 // Or just wait
                 } else {
-                    Thread::wait(PROCESSOR_IDLE_MS);
+                    gActionEndedSemaphore.wait(PROCESSOR_IDLE_MS);
                 }
             }
+            TIMELINE_END(TIMELINE_ID_ACTIONS_WAIT, 0);
 
             // We've now either done everything or power has gone.  If there are threads
             // still running, terminate them.
             terminateAllThreads();
 
+            // Collect what the background voltage sampler has seen
+            voltageSamplerStop();
+            voltageSamplerGet(&samplerStatistics);
+
+#if HEAP_STATISTICS
+            // With the action threads and the sampler gone, and
+            // provided the modem driver (which has a thread of its
+            // own) is not left up, nothing else is allocating, so
+            // take the fragmentation map of the heap for the next
+            // report
+            if (gModemOff) {
+                AQ_NRG_LOGX(EVENT_HEAP_LARGEST_FREE_BLOCK, heapMap());
+            }
+#endif
+            if (samplerStatistics.numSamples > 0) {
+                vIn += samplerStatistics.vIn.meanMV * samplerStatistics.numSamples;
+                vInCount += samplerStatistics.numSamples;
+                AQ_NRG_LOGX(EVENT_V_BAT_OK_MIN_MV, samplerStatistics.vBatOk.minMV);
+            }
+
             // Don't need 1V8 any more
             gEnable1V8 = 0;
 
@@ -1574,13 +2165,16 @@ void processorHandleWakeup(EventQueue *pEventQueue)
 
             // If we've got here without the voltage going
             // bad then mark the current energy source as good
-            if (voltageIsNotBad()) {
+            if (voltageIsNotBadMV((samplerStatistics.numSamples > 0) ?
+                                  samplerStatistics.vBatOk.latestMV : getVBatOkMV())) {
                 SET_CURRENT_ENERGY_SOURCE_GOOD;
             }
 
             // Work out what VIn has been on average
-            // and add it to the stored list
-            if (vInCount > 0) {
+            // and add it to the stored list (if an energy
+            // source has been chosen, which it may not have
+            // been when under test)
+            if ((vInCount > 0) && (getEnergySource() > 0)) {
                 vIn /= vInCount;
                 gVIn[getEnergySource() - 1] = vIn;
                 if (gVInCount < ARRAY_SIZE(gVIn)) {
@@ -1590,6 +2184,34 @@ void processorHandleWakeup(EventQueue *pEventQueue)
                 AQ_NRG_LOGX(EVENT_V_IN_READING_AVERAGED_MV, vIn);
             }
 
+            // Work out the rate at which the current energy source
+            // is harvesting: the rate at which the supercap charged
+            // (0.5CV^2 differentiated is CV dV/dt), which is net of
+            // what was being used, plus what the processor was using.
+            // The slope is only taken while no radio was on (see
+            // actionIsLoad()) since the processor is all that is
+            // added back; if there was no such time there is no
+            // estimate this wake-up rather than a wrong one
+            if ((samplerStatistics.numSlopeSamples > 1) && (getEnergySource() > 0)) {
+                harvestNW = ((long long int) SUPERCAP_MICROFARADS) *
+                            samplerStatistics.vBatOk.meanMV *
+                            samplerStatistics.vBatOk.slopeUVPerSecond / 1000000 +
+                            (long long int) PROCESSOR_POWER_ACTIVE_NW;
+                gHarvestNW[getEnergySource() - 1] = (int) harvestNW;
+                AQ_NRG_LOGX(EVENT_HARVEST_ESTIMATE_NW, (int) harvestNW);
+                forecastUpdate(getEnergySource(), time(NULL), (int) harvestNW);
+            }
+
+            // Keep a running average of what a wake-up costs: the
+            // actions that were chosen plus the processor being active
+            wakeUpEnergyNWH = gActionsEnergyNWH + ((unsigned long long int) gpProcessTimer->read_ms()) *
+                                                  PROCESSOR_POWER_ACTIVE_NW / 3600000;
+            if (gWakeUpEnergyNWH == 0) {
+                gWakeUpEnergyNWH = wakeUpEnergyNWH;
+            } else {
+                gWakeUpEnergyNWH = (gWakeUpEnergyNWH * 3 + wakeUpEnergyNWH) / 4;
+            }
+
 #ifndef DISABLE_ENERGY_CHOOSER
             if (vInCount > 0) {
                 // Work out which energy source to use next
@@ -1638,6 +2260,11 @@ void processorHandleWakeup(EventQueue *pEventQueue)
             AQ_NRG_LOGX(EVENT_DATA_CURRENT_QUEUE_BYTES, dataGetBytesQueued());
             AQ_NRG_LOGX(EVENT_PROCESSOR_FINISHED, gpProcessTimer->read_ms() / 1000);
             statisticsSleep();
+#if LOGGING_REPORTED && LOG_PACKED
+            // Empty the log store into the data queue, where it
+            // waits for the next report
+            logCollect();
+#endif
         } else {
 #ifndef DISABLE_ENERGY_CHOOSER
             // Not enough energy to run, select the most successful
@@ -1652,7 +2279,19 @@ void processorHandleWakeup(EventQueue *pEventQueue)
             AQ_NRG_LOGX(EVENT_NOT_ENOUGH_POWER_TO_RUN_PROCESSOR, 0);
         }
 
+        // Ask the harvest forecaster when to wake up next,
+        // given the energy source that is now in use
+        if (forecastHarvestNW(getEnergySource(), time(NULL), &harvestForecastNW)) {
+            AQ_NRG_LOGX(EVENT_HARVEST_FORECAST_NW, harvestForecastNW);
+        }
+        gWakeUpIntervalSeconds = forecastWakeUpIntervalSeconds(getEnergySource(), time(NULL),
+                                                               getEnergyAvailableNWH(),
+                                                               gWakeUpEnergyNWH,
+                                                               PROCESSOR_POWER_IDLE_NW);
+        AQ_NRG_LOGX(EVENT_WAKE_UP_INTERVAL_SECONDS, gWakeUpIntervalSeconds);
+
         gpProcessTimer->stop();
+        heapCountFree(HEAP_SITE_OTHER, sizeof(Timer));
         delete gpProcessTimer;
         gpProcessTimer = NULL;
 
@@ -1664,6 +2303,7 @@ void processorHandleWakeup(EventQueue *pEventQueue)
         ticker.detach();
 
         AQ_NRG_LOGX(EVENT_RETURN_TO_SLEEP, time(NULL));
+        TIMELINE_END(TIMELINE_ID_WAKE_UP, 0);
         suspendLog();
         gLogSuspendTime = time(NULL);
 
@@ -1675,10 +2315,44 @@ void processorHandleWakeup(EventQueue *pEventQueue)
     }
 }
 
+// Set the timer that has been running since start-up.
+void processorSetBootTimer(Timer *pBootTimer)
+{
+    core_util_critical_section_enter();
+    gpBootTimer = pBootTimer;
+    core_util_critical_section_exit();
+}
+
+// Get the interval to the next wake-up.
+int processorWakeUpIntervalSeconds()
+{
+    return gWakeUpIntervalSeconds;
+}
+
 // Set the thread diagnostics callback.
 void processorSetThreadDiagnosticsCallback(Callback<bool(Action *)> threadDiagnosticsCallback)
 {
     gThreadDiagnosticsCallback = threadDiagnosticsCallback;
 }
 
+// Filter a log event out of, or back into, the uplink.
+bool processorSetLogFilter(LogEvent event, bool filterOut)
+{
+    bool success = false;
+
+    if (((unsigned int) event < PROCESSOR_LOG_FILTER_MAX_NUM_EVENTS) &&
+        (!filterOut || ((event != EVENT_LOG_START) &&
+                        (event != EVENT_CURRENT_TIME_UTC) &&
+                        (event != EVENT_TIME_SET)))) {
+        if (filterOut) {
+            gLogFilter[event / 32] |= 1U << (event % 32);
+        } else {
+            gLogFilter[event / 32] &= ~(1U << (event % 32));
+        }
+        success = true;
+    }
+
+    return success;
+}
+
 // End of file
@@ -13,6 +13,7 @@
 #define _EH_PROCESSOR_H_
 
 #include <mbed_events.h>
+#include <log.h> // For LogEvent
 #include <eh_action.h>
 
 /**************************************************************************
@@ -39,6 +40,11 @@
  */
 #define PROCESSOR_POWER_ACTIVE_NW 7200000UL
 
+/** The number of log events, from zero, that can be filtered
+ * out of the uplink with processorSetLogFilter().
+ */
+#define PROCESSOR_LOG_FILTER_MAX_NUM_EVENTS 256
+
 /**************************************************************************
  * FUNCTIONS
  *************************************************************************/
@@ -57,6 +63,23 @@ void processorInit();
  */
 void processorHandleWakeup(EventQueue *pEventQueue);
 
+/** Set a timer that has been running since start-up: when the first
+ * measurement since start-up has been made the time on it is logged
+ * (as EVENT_BOOT_TO_FIRST_MEASUREMENT_MS) and it is stopped.
+ *
+ * @param pBootTimer a pointer to the timer, which must remain valid
+ *                   until the first measurement has been made.
+ */
+void processorSetBootTimer(Timer *pBootTimer);
+
+/** Get the interval from the end of the last wake-up to the
+ * next, as chosen by the harvest forecaster (see eh_forecast.h).
+ * Before processorInit() has been called this is zero.
+ *
+ * @return the wake-up interval in seconds.
+ */
+int processorWakeUpIntervalSeconds();
+
 /** Set the thread diagnostics callback, required during unit testing.  The
  * callback is called in the doAction() loop.
  *
@@ -67,6 +90,22 @@ void processorHandleWakeup(EventQueue *pEventQueue);
  */
 void processorSetThreadDiagnosticsCallback(Callback<bool(Action *)> threadDiagnosticsCallback);
 
+/** Filter a log event out of, or back into, the log that is sent
+ * to the server; the event is still logged, and printed if log
+ * printing is on, but is dropped when the log store is emptied
+ * into data items.  By default nothing is filtered out.  The events
+ * that log-decode.py needs to rebuild the timeline (EVENT_LOG_START,
+ * EVENT_CURRENT_TIME_UTC and EVENT_TIME_SET) cannot be filtered out.
+ *
+ * @param event     the log event.
+ * @param filterOut true to leave the event out of the uplink, false
+ *                  to put it back.
+ * @return          true if successful, false if the event cannot
+ *                  be filtered out or is not less than
+ *                  PROCESSOR_LOG_FILTER_MAX_NUM_EVENTS.
+ */
+bool processorSetLogFilter(LogEvent event, bool filterOut);
+
 #endif // _EH_PROCESSOR_H_
 
 // End Of File
@@ -16,8 +16,11 @@
 
 #include <time.h>
 #include <string.h> // for memset() and memcpy()
+#include <mbed.h> // For PinName, needed by eh_i2c.h
 #include <eh_data.h>
-#include <eh_utilities.h> // For LOCK()/UNLOCK()
+#include <eh_utilities.h> // For LOCK()/UNLOCK() and ARRAY_SIZE()
+#include <eh_i2c.h>
+#include <eh_processor.h> // For MAX_NUM_SIMULTANEOUS_ACTIONS
 #include <eh_statistics.h>
 
 /**************************************************************************
@@ -27,6 +30,20 @@
 // A bounds check for the time
 #define EARLIEST_TIME 1529687605
 
+// The largest count in an action statistics histogram bucket
+#define MAX_HISTOGRAM_COUNT 0xFFFF
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** An action thread, so that waits can be put down to its action.
+ */
+typedef struct {
+    osThreadId threadId;
+    ActionType action;
+} StatisticsActionThread;
+
 /**************************************************************************
  * LOCAL VARIABLES
  *************************************************************************/
@@ -43,6 +60,29 @@ time_t gLastWakeUpTime;
  */
 time_t gLastSleepTime;
 
+/** Somewhere to put the I2C statistics, kept off the stack.
+ */
+static I2CStatistics gI2cStatistics[I2C_STATISTICS_MAX_NUM_DEVICES];
+
+/** Mutex to protect the action statistics, which are updated
+ * from the action threads.
+ */
+static Mutex gMtx;
+
+/** The statistics for each action type since they were last got.
+ */
+static DataActionStatistics gActionStatistics[MAX_NUM_ACTION_TYPES];
+
+/** The time each action type has waited for a shared resource
+ * since the statistics were last got, kept in microseconds so
+ * that many short waits add up.
+ */
+static unsigned long long int gMutexWaitUs[MAX_NUM_ACTION_TYPES];
+
+/** The running action threads.
+ */
+static StatisticsActionThread gActionThread[MAX_NUM_SIMULTANEOUS_ACTIONS];
+
 /**************************************************************************
  * STATIC FUNCTIONS
  *************************************************************************/
@@ -63,6 +103,28 @@ static void zeroDailys()
 
 }
 
+// Return the log-scale histogram bucket for a value.
+static unsigned int histogramBucket(unsigned long long int value,
+                                    unsigned long long int firstBound)
+{
+    unsigned int bucket = 0;
+
+    while ((value >= firstBound) && (bucket < DATA_NUM_ACTION_HISTOGRAM_BUCKETS - 1)) {
+        firstBound <<= STATISTICS_HISTOGRAM_BUCKET_SHIFT;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+// Increment a count, stopping at the maximum.
+static void incSaturating(unsigned short *pCount)
+{
+    if (*pCount < MAX_HISTOGRAM_COUNT) {
+        (*pCount)++;
+    }
+}
+
 /**************************************************************************
  * PUBLIC FUNCTIONS
  *************************************************************************/
@@ -71,6 +133,9 @@ static void zeroDailys()
 void statisticsInit()
 {
     memset(&gStatistics, 0, sizeof (gStatistics));
+    memset(gActionStatistics, 0, sizeof (gActionStatistics));
+    memset(gMutexWaitUs, 0, sizeof (gMutexWaitUs));
+    memset(gActionThread, 0, sizeof (gActionThread));
     gLastWakeUpTime = 0;
     gLastSleepTime = 0;
 }
@@ -204,4 +269,128 @@ void statisticsLastSVs(unsigned char svs)
     gStatistics.positionLastNumSvVisible = svs;
 }
 
+// Note the start of an action thread.
+void statisticsActionStart(ActionType action)
+{
+    osThreadId threadId = Thread::gettid();
+
+    MTX_LOCK(gMtx);
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(gActionThread); x++) {
+        if (gActionThread[x].threadId == NULL) {
+            gActionThread[x].threadId = threadId;
+            gActionThread[x].action = action;
+            break;
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Note the end of an action thread and update the action statistics.
+void statisticsActionEnd(ActionType action, ActionState state,
+                         unsigned int timeMs,
+                         unsigned long long int energyNWH)
+{
+    osThreadId threadId = Thread::gettid();
+    DataActionStatistics *pStatistics;
+
+    MTX_LOCK(gMtx);
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(gActionThread); x++) {
+        if ((gActionThread[x].threadId == threadId) &&
+            (gActionThread[x].action == action)) {
+            gActionThread[x].threadId = NULL;
+        }
+    }
+
+    if (action < MAX_NUM_ACTION_TYPES) {
+        pStatistics = &(gActionStatistics[action]);
+        switch (state) {
+            case ACTION_STATE_COMPLETED:
+                incSaturating(&pStatistics->numCompleted);
+            break;
+            case ACTION_STATE_TRIED_AND_FAILED:
+                incSaturating(&pStatistics->numFailed);
+            break;
+            case ACTION_STATE_DEFERRED:
+                incSaturating(&pStatistics->numDeferred);
+            break;
+            default:
+                incSaturating(&pStatistics->numAborted);
+            break;
+        }
+        incSaturating(&pStatistics->timeHistogram[histogramBucket(timeMs,
+                                                  STATISTICS_TIME_HISTOGRAM_FIRST_BUCKET_MS)]);
+        incSaturating(&pStatistics->energyHistogram[histogramBucket(energyNWH,
+                                                    STATISTICS_ENERGY_HISTOGRAM_FIRST_BUCKET_NWH)]);
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Put a wait for a shared resource down to the calling
+// thread's action, if it is an action thread.
+void statisticsAddMutexWait(unsigned int waitUs)
+{
+    osThreadId threadId = Thread::gettid();
+
+    MTX_LOCK(gMtx);
+
+    for (unsigned int x = 0; x < ARRAY_SIZE(gActionThread); x++) {
+        if ((gActionThread[x].threadId == threadId) &&
+            (gActionThread[x].action < MAX_NUM_ACTION_TYPES)) {
+            gMutexWaitUs[gActionThread[x].action] += waitUs;
+        }
+    }
+
+    MTX_UNLOCK(gMtx);
+}
+
+// Get and reset the statistics for an action type.
+bool statisticsGetAction(ActionType action, DataActionStatistics *pStatistics)
+{
+    bool anythingToReport = false;
+
+    if ((pStatistics != NULL) && (action < MAX_NUM_ACTION_TYPES)) {
+        MTX_LOCK(gMtx);
+
+        memcpy(pStatistics, &(gActionStatistics[action]), sizeof(*pStatistics));
+        pStatistics->actionType = action;
+        pStatistics->mutexWaitMs = (unsigned int) (gMutexWaitUs[action] / 1000);
+        anythingToReport = (pStatistics->numCompleted > 0) ||
+                           (pStatistics->numFailed > 0) ||
+                           (pStatistics->numAborted > 0) ||
+                           (pStatistics->numDeferred > 0);
+        memset(&(gActionStatistics[action]), 0, sizeof(gActionStatistics[action]));
+        gMutexWaitUs[action] = 0;
+
+        MTX_UNLOCK(gMtx);
+    }
+
+    return anythingToReport;
+}
+
+// Get the I2C traffic statistics.
+void statisticsGetI2c(DataI2cStatistics *pStatistics)
+{
+    int num;
+
+    if (pStatistics != NULL) {
+        memset(pStatistics, 0, sizeof(*pStatistics));
+        num = i2cGetStatistics(gI2cStatistics, ARRAY_SIZE(gI2cStatistics));
+        for (int x = 0; (x < num) && (x < (int) ARRAY_SIZE(pStatistics->device)); x++) {
+            pStatistics->device[x].i2cAddress = gI2cStatistics[x].i2cAddress;
+            pStatistics->device[x].transactions = gI2cStatistics[x].transactions;
+            pStatistics->device[x].bytes = gI2cStatistics[x].bytesSent +
+                                           gI2cStatistics[x].bytesReceived;
+            pStatistics->device[x].errors = gI2cStatistics[x].errors;
+            pStatistics->device[x].retries = gI2cStatistics[x].retries;
+            pStatistics->device[x].busTimeMs = (unsigned int) (gI2cStatistics[x].busTimeUs / 1000);
+            pStatistics->device[x].waitTimeMs = (unsigned int) (gI2cStatistics[x].waitTimeUs / 1000);
+            pStatistics->numDevices++;
+        }
+    }
+}
+
 // End of file
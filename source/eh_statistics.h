@@ -18,6 +18,25 @@
  * MANIFEST CONSTANTS
  *************************************************************************/
 
+/** The upper bound of the first bucket of the action execution time
+ * histogram; each bucket after that is STATISTICS_HISTOGRAM_BUCKET_SHIFT
+ * wider, the last one catching everything above.
+ */
+#define STATISTICS_TIME_HISTOGRAM_FIRST_BUCKET_MS 100
+
+/** The upper bound of the first bucket of the action energy
+ * histogram; each bucket after that is STATISTICS_HISTOGRAM_BUCKET_SHIFT
+ * wider, the last one catching everything above.
+ */
+#define STATISTICS_ENERGY_HISTOGRAM_FIRST_BUCKET_NWH 1000
+
+/** The shift from the upper bound of one histogram bucket to the
+ * next: 2 means that each bucket is four times as wide as the
+ * last, so that for time, with 8 buckets, the bounds are 100 ms,
+ * 400 ms, 1.6 s, 6.4 s, 25.6 s, 102.4 s and 409.6 s.
+ */
+#define STATISTICS_HISTOGRAM_BUCKET_SHIFT 2
+
 /**************************************************************************
  * TYPES
  *************************************************************************/
@@ -110,6 +129,56 @@ void statisticsIncPositionSuccess();
  */
 void statisticsLastSVs(unsigned char svs);
 
+/** Let statistics know that an action thread has started, so
+ * that time it spends waiting for a shared resource can be put
+ * down to the action; must be called from the action's thread.
+ *
+ * @param action the type of action.
+ */
+void statisticsActionStart(ActionType action);
+
+/** Let statistics know that an action thread has ended, updating
+ * the action statistics; must be called from the action's thread.
+ * A thread that performs more than one action (e.g. a group of
+ * measurements from one sensor) calls statisticsActionStart() and
+ * statisticsActionEnd() for each of them.
+ *
+ * @param action    the type of action.
+ * @param state     the state the action ended in: ACTION_STATE_COMPLETED,
+ *                  ACTION_STATE_TRIED_AND_FAILED or ACTION_STATE_DEFERRED,
+ *                  anything else being counted as aborted.
+ * @param timeMs    the time the action took.
+ * @param energyNWH the energy the action is estimated to have used.
+ */
+void statisticsActionEnd(ActionType action, ActionState state,
+                         unsigned int timeMs,
+                         unsigned long long int energyNWH);
+
+/** Let statistics know that the calling thread has waited for a
+ * shared resource (the modem or the I2C bus); ignored if the
+ * calling thread is not an action thread.
+ *
+ * @param waitUs the time spent waiting in microseconds.
+ */
+void statisticsAddMutexWait(unsigned int waitUs);
+
+/** Get the statistics for an action type accumulated since this
+ * was last called for that action type, and then reset them.
+ *
+ * @param action      the type of action.
+ * @param pStatistics a place to put the statistics.
+ * @return            true if there is anything to report, i.e. an
+ *                    action of this type has ended, else false.
+ */
+bool statisticsGetAction(ActionType action, DataActionStatistics *pStatistics);
+
+/** Get the I2C traffic statistics for each device on the bus
+ * (see i2cGetStatistics()).
+ *
+ * @param pStatistics a place to put the statistics.
+ */
+void statisticsGetI2c(DataI2cStatistics *pStatistics);
+
 #endif // _EH_STATISTICS_H_
 
 // End Of File
@@ -0,0 +1,194 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mbed.h>
+#include <eh_debug.h> // For PRINTF()
+#include <eh_timeline.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The number of records in the timeline store.
+ */
+#define TIMELINE_NUM_RECORDS ((TIMELINE_STORE_SIZE - sizeof(TimelineHeader)) / \
+                              sizeof(TimelineRecord))
+
+/**************************************************************************
+ * LOCAL VARIABLES
+ *************************************************************************/
+
+/** The header of the timeline store, NULL until timelineInit()
+ * is called.
+ */
+static TimelineHeader *gpHeader = NULL;
+
+/** The records in the timeline store.
+ */
+static TimelineRecord *gpRecords = NULL;
+
+/** The threads, indexed as they are in the records; this is
+ * not kept across a reset, the index being enough to tell
+ * threads apart.
+ */
+static osThreadId gThreadId[TIMELINE_MAX_NUM_THREADS];
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Return the index of a thread, handing one out if the thread is
+// new (reusing them in turn once they have all been handed out);
+// must be called in a critical section.
+static unsigned char threadIndex(osThreadId threadId)
+{
+    unsigned int numThreads = gpHeader->numThreads;
+    unsigned int x;
+
+    if (numThreads > TIMELINE_MAX_NUM_THREADS) {
+        numThreads = TIMELINE_MAX_NUM_THREADS;
+    }
+    for (x = 0; (x < numThreads) && (gThreadId[x] != threadId); x++) {
+    }
+    if (x >= numThreads) {
+        x = gpHeader->numThreads % TIMELINE_MAX_NUM_THREADS;
+        gThreadId[x] = threadId;
+        gpHeader->numThreads++;
+    }
+
+    return (unsigned char) x;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Initialise the timeline.
+void timelineInit(char *pStore)
+{
+    gpHeader = (TimelineHeader *) pStore;
+    gpRecords = (TimelineRecord *) (pStore + sizeof(TimelineHeader));
+
+    if ((gpHeader->magic != TIMELINE_MAGIC) ||
+        (gpHeader->nextIndex >= TIMELINE_NUM_RECORDS) ||
+        (gpHeader->numRecords > TIMELINE_NUM_RECORDS)) {
+        gpHeader->magic = TIMELINE_MAGIC;
+        gpHeader->nextIndex = 0;
+        gpHeader->numRecords = 0;
+    }
+    // Thread indexes start again since the threads have gone
+    gpHeader->numThreads = 0;
+
+    timelineRecord(TIMELINE_ID_BOOT, TIMELINE_PHASE_INSTANT, 0);
+}
+
+// Record the beginning or end of a span, or an instant.
+void timelineRecord(TimelineId id, TimelinePhase phase, int param)
+{
+    TimelineRecord *pRecord;
+    osThreadId threadId;
+    unsigned int timeUs;
+
+    if (gpHeader != NULL) {
+        threadId = Thread::gettid();
+        timeUs = us_ticker_read();
+        core_util_critical_section_enter();
+        pRecord = gpRecords + gpHeader->nextIndex;
+        pRecord->timeUs = timeUs;
+        pRecord->id = (unsigned char) id;
+        pRecord->phaseThread = (unsigned char) ((phase << TIMELINE_PHASE_SHIFT) |
+                                                threadIndex(threadId));
+        pRecord->param = (unsigned short) param;
+        gpHeader->nextIndex++;
+        if (gpHeader->nextIndex >= TIMELINE_NUM_RECORDS) {
+            gpHeader->nextIndex = 0;
+        }
+        if (gpHeader->numRecords < TIMELINE_NUM_RECORDS) {
+            gpHeader->numRecords++;
+        }
+        core_util_critical_section_exit();
+    }
+}
+
+// Copy the records out, oldest first.
+int timelineGet(TimelineRecord *pRecords, int maxNum)
+{
+    unsigned int index;
+    int numRecords = 0;
+
+    if (gpHeader != NULL) {
+        core_util_critical_section_enter();
+        numRecords = gpHeader->numRecords;
+        if (numRecords > maxNum) {
+            numRecords = maxNum;
+        }
+        index = (gpHeader->nextIndex + TIMELINE_NUM_RECORDS - gpHeader->numRecords) %
+                TIMELINE_NUM_RECORDS;
+        for (int x = 0; x < numRecords; x++) {
+            *(pRecords + x) = *(gpRecords + index);
+            index++;
+            if (index >= TIMELINE_NUM_RECORDS) {
+                index = 0;
+            }
+        }
+        core_util_critical_section_exit();
+    }
+
+    return numRecords;
+}
+
+// Discard the records.
+void timelineClear()
+{
+    if (gpHeader != NULL) {
+        core_util_critical_section_enter();
+        gpHeader->nextIndex = 0;
+        gpHeader->numRecords = 0;
+        core_util_critical_section_exit();
+    }
+}
+
+// Print the records.
+void timelinePrint()
+{
+    TimelineRecord record;
+    unsigned int index;
+    unsigned int numRecords;
+
+    if (gpHeader != NULL) {
+        // Print a record at a time rather than taking a copy of
+        // the lot, printing being slow and RAM being short; records
+        // added meanwhile may overwrite the oldest ones, which is
+        // no great loss
+        numRecords = gpHeader->numRecords;
+        index = (gpHeader->nextIndex + TIMELINE_NUM_RECORDS - numRecords) %
+                TIMELINE_NUM_RECORDS;
+        for (unsigned int x = 0; x < numRecords; x++) {
+            core_util_critical_section_enter();
+            record = *(gpRecords + index);
+            core_util_critical_section_exit();
+            PRINTF("TIMELINE,%u,%d,%d,%d,%d\n", record.timeUs, record.id,
+                   record.phaseThread >> TIMELINE_PHASE_SHIFT,
+                   record.phaseThread & TIMELINE_THREAD_MASK, record.param);
+            index++;
+            if (index >= TIMELINE_NUM_RECORDS) {
+                index = 0;
+            }
+        }
+    }
+}
+
+// End of file
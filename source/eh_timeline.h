@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_TIMELINE_H_
+#define _EH_TIMELINE_H_
+
+#include <eh_config.h> // For TIMELINE_TRACE
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The size of the timeline store in bytes, header included: 2048
+ * bytes holds 254 records, about a wake-up's worth.
+ */
+#define TIMELINE_STORE_SIZE 2048
+
+/** The value at the start of the timeline store when it is valid,
+ * which is how a timeline survives a reset.
+ */
+#define TIMELINE_MAGIC 0x54494d31
+
+/** The most threads that are told apart in the timeline, a limit set
+ * by the number of bits for the thread index in a record.
+ */
+#define TIMELINE_MAX_NUM_THREADS 64
+
+/** The shift of the phase in TimelineRecord.phaseThread.
+ */
+#define TIMELINE_PHASE_SHIFT 6
+
+/** The mask of the thread index in TimelineRecord.phaseThread.
+ */
+#define TIMELINE_THREAD_MASK ((1 << TIMELINE_PHASE_SHIFT) - 1)
+
+/** Mark the beginning of a span of time.
+ */
+#if TIMELINE_TRACE
+# define TIMELINE_BEGIN(id, param) timelineRecord(id, TIMELINE_PHASE_BEGIN, param)
+#else
+# define TIMELINE_BEGIN(id, param)
+#endif
+
+/** Mark the end of a span of time.
+ */
+#if TIMELINE_TRACE
+# define TIMELINE_END(id, param) timelineRecord(id, TIMELINE_PHASE_END, param)
+#else
+# define TIMELINE_END(id, param)
+#endif
+
+/** Mark an instant in time.
+ */
+#if TIMELINE_TRACE
+# define TIMELINE_INSTANT(id, param) timelineRecord(id, TIMELINE_PHASE_INSTANT, param)
+#else
+# define TIMELINE_INSTANT(id, param)
+#endif
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The things that are timed.  Add new ones at the end: the numbers
+ * are what is stored and timeline-decode.py takes the names from this
+ * header.
+ */
+typedef enum {
+    TIMELINE_ID_NULL,
+    TIMELINE_ID_BOOT,                  //!< Instant: start-up.
+    TIMELINE_ID_WAKE_UP,               //!< Span: processorHandleWakeup(), param the wake-up reason.
+    TIMELINE_ID_ACTION_LIST,           //!< Span: making and ranking the action list.
+    TIMELINE_ID_ACTION_THREAD_START,   //!< Instant: an action thread is started, param the action type.
+    TIMELINE_ID_ACTION,                //!< Span: an action thread, param the action type.
+    TIMELINE_ID_ACTIONS_WAIT,          //!< Span: the processor waiting for the actions to end.
+    TIMELINE_ID_THREADS_TERMINATE,     //!< Span: terminating the action threads.
+    TIMELINE_ID_DATA_SORT,             //!< Span: pDataSort().
+    TIMELINE_ID_I2C_MUTEX_WAIT,        //!< Span: waiting for the I2C bus, param the I2C address.
+    TIMELINE_ID_I2C_TRANSFER,          //!< Span: an I2C transfer, param the I2C address then the result.
+    TIMELINE_ID_MODEM_MUTEX_WAIT,      //!< Span: waiting for the modem.
+    TIMELINE_ID_MODEM_INIT,            //!< Span: modemInit().
+    TIMELINE_ID_MODEM_CONNECT,         //!< Span: modemConnect(), param the result at the end.
+    TIMELINE_ID_MODEM_GET_TIME,        //!< Span: modemGetTime(), param the result at the end.
+    TIMELINE_ID_MODEM_SEND_REPORTS,    //!< Span: modemSendReports(), param the result at the end.
+    TIMELINE_ID_MODEM_DNS,             //!< Span: a DNS look-up.
+    TIMELINE_ID_MODEM_SEND,            //!< Span: sending a datagram, param its size.
+    TIMELINE_ID_MODEM_RECEIVE,         //!< Span: a receive attempt, param the size received at the end.
+    TIMELINE_ID_FIRST_MEASUREMENT,     //!< Instant: the first measurement since start-up, param the action type.
+    MAX_NUM_TIMELINE_IDS
+} TimelineId;
+
+/** The kinds of record.
+ */
+typedef enum {
+    TIMELINE_PHASE_BEGIN,
+    TIMELINE_PHASE_END,
+    TIMELINE_PHASE_INSTANT
+} TimelinePhase;
+
+/** A record in the timeline store, eight bytes; on target the
+ * layout is little-endian, which is what timeline-decode.py expects.
+ */
+typedef struct {
+    unsigned int timeUs;       //!< From us_ticker_read(), which wraps and does not count sleep.
+    unsigned char id;          //!< A TimelineId.
+    unsigned char phaseThread; //!< The TimelinePhase in the top two bits, the thread index below.
+    unsigned short param;      //!< Depends on the id.
+} TimelineRecord;
+
+/** The header of the timeline store, followed by the records.
+ */
+typedef struct {
+    unsigned int magic;        //!< TIMELINE_MAGIC when valid.
+    unsigned int nextIndex;    //!< The record that will be written next.
+    unsigned int numRecords;   //!< The number of valid records.
+    unsigned int numThreads;   //!< The number of thread indexes handed out.
+} TimelineHeader;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Initialise the timeline, which is kept in a store that should be in
+ * RAM which is not initialised at start-up so that, if the store is
+ * found to be valid, what was recorded before a reset is kept.  A
+ * TIMELINE_ID_BOOT instant is recorded.
+ *
+ * @param pStore a pointer to TIMELINE_STORE_SIZE bytes, word aligned.
+ */
+void timelineInit(char *pStore);
+
+/** Record the beginning or end of a span, or an instant, for the
+ * calling thread; use the TIMELINE_BEGIN(), TIMELINE_END() and
+ * TIMELINE_INSTANT() macros rather than calling this directly so that
+ * the calls are compiled out when TIMELINE_TRACE is 0.  May be called
+ * from any thread but not from interrupt context.
+ *
+ * @param id    the thing being timed.
+ * @param phase the kind of record.
+ * @param param a parameter, truncated to 16 bits.
+ */
+void timelineRecord(TimelineId id, TimelinePhase phase, int param);
+
+/** Copy the records out, oldest first.
+ *
+ * @param pRecords a place to put the records.
+ * @param maxNum   the number of records that will fit at pRecords.
+ * @return         the number of records copied.
+ */
+int timelineGet(TimelineRecord *pRecords, int maxNum);
+
+/** Discard the records.
+ */
+void timelineClear();
+
+/** Print the records, oldest first, one per line as
+ * "TIMELINE,<timeUs>,<id>,<phase>,<thread>,<param>", the format that
+ * timeline-decode.py reads from a captured console log (only if
+ * printf() is enabled).
+ */
+void timelinePrint();
+
+#endif // _EH_TIMELINE_H_
+
+// End Of File
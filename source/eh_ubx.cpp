@@ -0,0 +1,308 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2018 u-blox Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h> // for memset()/memcpy()
+#include <eh_ubx.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** Mask to turn a free-running index into an index into the ring.
+ */
+#define UBX_RING_MASK (UBX_RING_SIZE - 1)
+
+/** The largest payload that will fit in the ring.
+ */
+#define UBX_MAX_PAYLOAD_LENGTH (UBX_RING_SIZE - UBX_OVERHEAD_SIZE)
+
+/**************************************************************************
+ * STATIC FUNCTIONS
+ *************************************************************************/
+
+// Give up on the frame being parsed and start looking for a new
+// one from the byte after its first sync character.
+static void restart(UbxParser *pParser)
+{
+    pParser->parseIndex = pParser->frameIndex + 1;
+    pParser->releaseIndex = pParser->parseIndex;
+    pParser->numDiscards++;
+    pParser->state = UBX_STATE_SYNC_1;
+}
+
+/**************************************************************************
+ * PUBLIC FUNCTIONS
+ *************************************************************************/
+
+// Initialise a UBX parser.
+void ubxParserInit(UbxParser *pParser)
+{
+    memset(pParser, 0, sizeof(*pParser));
+    pParser->state = UBX_STATE_SYNC_1;
+}
+
+// Get the contiguous space that may be written to.
+char *ubxParserSpace(UbxParser *pParser, unsigned int *pLength)
+{
+    unsigned int toEnd = UBX_RING_SIZE - (pParser->writeIndex & UBX_RING_MASK);
+
+    *pLength = UBX_RING_SIZE - (pParser->writeIndex - pParser->releaseIndex);
+    if (*pLength > toEnd) {
+        *pLength = toEnd;
+    }
+
+    return pParser->ring + (pParser->writeIndex & UBX_RING_MASK);
+}
+
+// Note that bytes have been written.
+void ubxParserCommit(UbxParser *pParser, unsigned int length)
+{
+    pParser->writeIndex += length;
+}
+
+// Copy bytes into the ring.
+unsigned int ubxParserWrite(UbxParser *pParser, const char *pBuf,
+                            unsigned int len)
+{
+    unsigned int written = 0;
+    unsigned int length;
+    char *pSpace;
+
+    // At most two goes, one either side of the end of the ring
+    for (unsigned int x = 0; (x < 2) && (written < len); x++) {
+        pSpace = ubxParserSpace(pParser, &length);
+        if (length > len - written) {
+            length = len - written;
+        }
+        memcpy(pSpace, pBuf + written, length);
+        ubxParserCommit(pParser, length);
+        written += length;
+    }
+
+    return written;
+}
+
+// Parse up to the end of the next good frame.
+bool ubxParserNext(UbxParser *pParser, UbxFrame *pFrame)
+{
+    bool found = false;
+    unsigned char byte;
+
+    // Release the previous frame, if there was one
+    if (pParser->state == UBX_STATE_SYNC_1) {
+        pParser->releaseIndex = pParser->parseIndex;
+    }
+
+    while (!found && (pParser->parseIndex != pParser->writeIndex)) {
+        byte = (unsigned char) pParser->ring[pParser->parseIndex & UBX_RING_MASK];
+        pParser->parseIndex++;
+        // The Fletcher checksum covers class, id, length and payload,
+        // see section 32.4 of the u-blox M8 receiver manual
+        if ((pParser->state >= UBX_STATE_CLASS) &&
+            (pParser->state <= UBX_STATE_PAYLOAD)) {
+            pParser->checksumA += byte;
+            pParser->checksumB += pParser->checksumA;
+        }
+        switch (pParser->state) {
+            case UBX_STATE_SYNC_1:
+                if (byte == 0xb5) {
+                    pParser->frameIndex = pParser->parseIndex - 1;
+                    pParser->state = UBX_STATE_SYNC_2;
+                } else {
+                    pParser->releaseIndex = pParser->parseIndex;
+                    pParser->numDiscards++;
+                }
+            break;
+            case UBX_STATE_SYNC_2:
+                if (byte == 0x62) {
+                    pParser->checksumA = 0;
+                    pParser->checksumB = 0;
+                    pParser->state = UBX_STATE_CLASS;
+                } else {
+                    restart(pParser);
+                }
+            break;
+            case UBX_STATE_CLASS:
+                pParser->cls = byte;
+                pParser->state = UBX_STATE_ID;
+            break;
+            case UBX_STATE_ID:
+                pParser->id = byte;
+                pParser->state = UBX_STATE_LENGTH_1;
+            break;
+            case UBX_STATE_LENGTH_1:
+                pParser->length = byte;
+                pParser->state = UBX_STATE_LENGTH_2;
+            break;
+            case UBX_STATE_LENGTH_2:
+                pParser->length += ((unsigned int) byte) << 8;
+                pParser->count = 0;
+                pParser->state = UBX_STATE_PAYLOAD;
+                if (pParser->length == 0) {
+                    pParser->state = UBX_STATE_CHECKSUM_A;
+                } else if (pParser->length > UBX_MAX_PAYLOAD_LENGTH) {
+                    // Either not really a frame or one we couldn't
+                    // hold anyway
+                    pParser->numBadFrames++;
+                    restart(pParser);
+                }
+            break;
+            case UBX_STATE_PAYLOAD:
+                pParser->count++;
+                if (pParser->count >= pParser->length) {
+                    pParser->state = UBX_STATE_CHECKSUM_A;
+                }
+            break;
+            case UBX_STATE_CHECKSUM_A:
+                if (byte == pParser->checksumA) {
+                    pParser->state = UBX_STATE_CHECKSUM_B;
+                } else {
+                    pParser->numBadFrames++;
+                    restart(pParser);
+                }
+            break;
+            case UBX_STATE_CHECKSUM_B:
+                if (byte == pParser->checksumB) {
+                    // The frame stays in the ring until the next call
+                    pFrame->pRing = pParser->ring;
+                    pFrame->payloadIndex = pParser->frameIndex + UBX_HEADER_SIZE;
+                    pFrame->cls = pParser->cls;
+                    pFrame->id = pParser->id;
+                    pFrame->length = pParser->length;
+                    pParser->numFrames++;
+                    pParser->state = UBX_STATE_SYNC_1;
+                    found = true;
+                } else {
+                    pParser->numBadFrames++;
+                    restart(pParser);
+                }
+            break;
+            default:
+                restart(pParser);
+            break;
+        }
+    }
+
+    return found;
+}
+
+// Read an unsigned byte from a payload.
+unsigned char ubxU1(const UbxFrame *pFrame, unsigned int offset)
+{
+    return (unsigned char) pFrame->pRing[(pFrame->payloadIndex + offset) & UBX_RING_MASK];
+}
+
+// Read a little-endian unsigned 16 bit value from a payload.
+unsigned short ubxU2(const UbxFrame *pFrame, unsigned int offset)
+{
+    return (unsigned short) (ubxU1(pFrame, offset) +
+                             (((unsigned int) ubxU1(pFrame, offset + 1)) << 8));
+}
+
+// Read a little-endian unsigned 32 bit value from a payload.
+unsigned int ubxU4(const UbxFrame *pFrame, unsigned int offset)
+{
+    return ubxU2(pFrame, offset) + (((unsigned int) ubxU2(pFrame, offset + 2)) << 16);
+}
+
+// Check for an ACK-ACK or ACK-NAK of a message.
+int ubxAck(const UbxFrame *pFrame, unsigned char cls, unsigned char id)
+{
+    int ack = -1;
+
+    // See section 32.9 of the u-blox M8 receiver manual
+    if ((pFrame->cls == 0x05) && (pFrame->id <= 0x01) && (pFrame->length == 2) &&
+        (ubxU1(pFrame, 0) == cls) && (ubxU1(pFrame, 1) == id)) {
+        ack = pFrame->id;
+    }
+
+    return ack;
+}
+
+// Check for a NAV-PVT message.
+bool ubxIsNavPvt(const UbxFrame *pFrame)
+{
+    // See section 32.18.14 of the u-blox M8 receiver manual
+    return (pFrame->cls == 0x01) && (pFrame->id == 0x07) &&
+           (pFrame->length >= UBX_NAV_PVT_LENGTH);
+}
+
+// Check for a valid fix in a NAV-PVT message.
+bool ubxNavPvtFixOk(const UbxFrame *pFrame)
+{
+    return (ubxU1(pFrame, 21) & 0x01) != 0;
+}
+
+// Get the number of space vehicles from a NAV-PVT message.
+unsigned char ubxNavPvtSVs(const UbxFrame *pFrame)
+{
+    return ubxU1(pFrame, 23);
+}
+
+// Get the latitude from a NAV-PVT message.
+int ubxNavPvtLatitudeX10e7(const UbxFrame *pFrame)
+{
+    return (int) ubxU4(pFrame, 28);
+}
+
+// Get the longitude from a NAV-PVT message.
+int ubxNavPvtLongitudeX10e7(const UbxFrame *pFrame)
+{
+    return (int) ubxU4(pFrame, 24);
+}
+
+// Get the height above mean sea level from a NAV-PVT message.
+int ubxNavPvtAltitudeMM(const UbxFrame *pFrame)
+{
+    return (int) ubxU4(pFrame, 36);
+}
+
+// Get the horizontal accuracy estimate from a NAV-PVT message.
+int ubxNavPvtRadiusMM(const UbxFrame *pFrame)
+{
+    return (int) ubxU4(pFrame, 40);
+}
+
+// Get the ground speed from a NAV-PVT message.
+int ubxNavPvtSpeedMMPS(const UbxFrame *pFrame)
+{
+    return (int) ubxU4(pFrame, 60);
+}
+
+// Check for a NAV-TIMEUTC message.
+bool ubxIsNavTimeUtc(const UbxFrame *pFrame)
+{
+    // See section 32.18.28 of the u-blox M8 receiver manual
+    return (pFrame->cls == 0x01) && (pFrame->id == 0x21) &&
+           (pFrame->length >= UBX_NAV_TIMEUTC_LENGTH);
+}
+
+// Get the UTC time from a NAV-TIMEUTC message.
+bool ubxNavTimeUtc(const UbxFrame *pFrame, struct tm *pTm)
+{
+    if (pTm != NULL) {
+        pTm->tm_year = ((int) ubxU2(pFrame, 12)) - 1900;
+        pTm->tm_mon = ((int) ubxU1(pFrame, 14)) - 1;
+        pTm->tm_mday = ubxU1(pFrame, 15);
+        pTm->tm_hour = ubxU1(pFrame, 16);
+        pTm->tm_min = ubxU1(pFrame, 17);
+        pTm->tm_sec = ubxU1(pFrame, 18);
+    }
+
+    return (ubxU1(pFrame, 19) & 0x04) != 0;
+}
+
+// End of file
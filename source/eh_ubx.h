@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) u-blox Melbourn Ltd
+ * u-blox Melbourn Ltd, Melbourn, UK
+ *
+ * All rights reserved.
+ *
+ * This source file is the sole property of u-blox Melbourn Ltd.
+ * Reproduction or utilisation of this source in whole or part is
+ * forbidden without the written consent of u-blox Melbourn Ltd.
+ */
+
+#ifndef _EH_UBX_H_
+#define _EH_UBX_H_
+
+#include <time.h>
+
+/**************************************************************************
+ * MANIFEST CONSTANTS
+ *************************************************************************/
+
+/** The size of the ring buffer that UBX frames are parsed in; must
+ * be a power of two and big enough for the largest frame that is
+ * wanted (NAV-PVT, 100 bytes including overhead).
+ */
+#define UBX_RING_SIZE 256
+
+/** The number of bytes at the start of a UBX frame before the payload:
+ * two sync characters, class, id and a two byte length.
+ */
+#define UBX_HEADER_SIZE 6
+
+/** The number of bytes of UBX overhead in a frame: the header plus
+ * the two checksum bytes.
+ */
+#define UBX_OVERHEAD_SIZE (UBX_HEADER_SIZE + 2)
+
+/** The length of the payload of a NAV-PVT message.
+ */
+#define UBX_NAV_PVT_LENGTH 92
+
+/** The length of the payload of a NAV-TIMEUTC message.
+ */
+#define UBX_NAV_TIMEUTC_LENGTH 20
+
+/**************************************************************************
+ * TYPES
+ *************************************************************************/
+
+/** The states of the UBX parser.
+ */
+typedef enum {
+    UBX_STATE_SYNC_1,
+    UBX_STATE_SYNC_2,
+    UBX_STATE_CLASS,
+    UBX_STATE_ID,
+    UBX_STATE_LENGTH_1,
+    UBX_STATE_LENGTH_2,
+    UBX_STATE_PAYLOAD,
+    UBX_STATE_CHECKSUM_A,
+    UBX_STATE_CHECKSUM_B
+} UbxState;
+
+/** An incremental UBX parser: bytes are written into its ring buffer
+ * (directly, with ubxParserSpace()/ubxParserCommit(), or by copying,
+ * with ubxParserWrite()) and frames are pulled out with ubxParserNext().
+ * The checksum is worked out as each byte is parsed, so no byte is
+ * looked at twice unless a frame turns out to be bad.  Anything that
+ * isn't a UBX frame (e.g. NMEA sentences or the 0xFF bytes a GNSS chip
+ * returns over I2C when it has nothing to send) is discarded.
+ * All indexes are free-running and are masked to index the ring.
+ */
+typedef struct {
+    char ring[UBX_RING_SIZE];
+    unsigned int writeIndex;   //!< Where the next byte will be written.
+    unsigned int parseIndex;   //!< The next byte to parse.
+    unsigned int releaseIndex; //!< Bytes before this may be overwritten.
+    unsigned int frameIndex;   //!< The start of the frame being parsed.
+    UbxState state;
+    unsigned char cls;
+    unsigned char id;
+    unsigned int length;
+    unsigned int count;
+    unsigned char checksumA;
+    unsigned char checksumB;
+    unsigned int numFrames;    //!< The number of good frames found.
+    unsigned int numBadFrames; //!< The number of frames with a bad checksum or length.
+    unsigned int numDiscards;  //!< The number of non-UBX bytes discarded.
+} UbxParser;
+
+/** A view of a UBX frame in the ring buffer of a UbxParser, valid
+ * until ubxParserNext() is next called on that parser; the payload
+ * may wrap around the end of the ring, hence the accessor functions.
+ */
+typedef struct {
+    const char *pRing;
+    unsigned int payloadIndex;
+    unsigned char cls;
+    unsigned char id;
+    unsigned int length;
+} UbxFrame;
+
+/**************************************************************************
+ * FUNCTIONS
+ *************************************************************************/
+
+/** Initialise a UBX parser, discarding anything in it.
+ *
+ * @param pParser the parser.
+ */
+void ubxParserInit(UbxParser *pParser);
+
+/** Get the contiguous space in the ring buffer of a UBX parser that
+ * may be written to, e.g. directly by an I2C read; once written,
+ * call ubxParserCommit().
+ *
+ * @param pParser  the parser.
+ * @param pLength  a place to put the number of bytes that may be
+ *                 written, may not be NULL.
+ * @return         a pointer to the space.
+ */
+char *ubxParserSpace(UbxParser *pParser, unsigned int *pLength);
+
+/** Tell a UBX parser that bytes have been written to the space
+ * returned by ubxParserSpace().
+ *
+ * @param pParser the parser.
+ * @param length  the number of bytes written.
+ */
+void ubxParserCommit(UbxParser *pParser, unsigned int length);
+
+/** Copy bytes into the ring buffer of a UBX parser.
+ *
+ * @param pParser the parser.
+ * @param pBuf    the bytes.
+ * @param len     the number of bytes at pBuf.
+ * @return        the number of bytes copied, which will be less
+ *                than len if the ring buffer is full.
+ */
+unsigned int ubxParserWrite(UbxParser *pParser, const char *pBuf,
+                            unsigned int len);
+
+/** Parse what has been written to a UBX parser up to the end of the
+ * next good frame.  Calling this releases the frame returned by the
+ * previous call.
+ *
+ * @param pParser the parser.
+ * @param pFrame  a place to put a view of the frame, may not be NULL.
+ * @return        true if a frame was found, else more bytes are needed.
+ */
+bool ubxParserNext(UbxParser *pParser, UbxFrame *pFrame);
+
+/** Read an unsigned byte from the payload of a UBX frame.
+ *
+ * @param pFrame the frame.
+ * @param offset the offset into the payload.
+ * @return       the value.
+ */
+unsigned char ubxU1(const UbxFrame *pFrame, unsigned int offset);
+
+/** Read a little-endian unsigned 16 bit value from the payload of
+ * a UBX frame.
+ *
+ * @param pFrame the frame.
+ * @param offset the offset into the payload.
+ * @return       the value.
+ */
+unsigned short ubxU2(const UbxFrame *pFrame, unsigned int offset);
+
+/** Read a little-endian unsigned 32 bit value from the payload of
+ * a UBX frame.
+ *
+ * @param pFrame the frame.
+ * @param offset the offset into the payload.
+ * @return       the value.
+ */
+unsigned int ubxU4(const UbxFrame *pFrame, unsigned int offset);
+
+/** Determine whether a UBX frame is an ACK-ACK or ACK-NAK of a message.
+ *
+ * @param pFrame the frame.
+ * @param cls    the class of the message.
+ * @param id     the id of the message.
+ * @return       1 if the frame is an ACK-ACK of the message, 0 if it
+ *               is an ACK-NAK of the message, else -1.
+ */
+int ubxAck(const UbxFrame *pFrame, unsigned char cls, unsigned char id);
+
+/** Determine whether a UBX frame is a NAV-PVT message.
+ *
+ * @param pFrame the frame.
+ * @return       true if it is.
+ */
+bool ubxIsNavPvt(const UbxFrame *pFrame);
+
+/** Determine whether a NAV-PVT message carries a valid fix.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       true if it does.
+ */
+bool ubxNavPvtFixOk(const UbxFrame *pFrame);
+
+/** Get the number of space vehicles used in the solution
+ * from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the number of space vehicles.
+ */
+unsigned char ubxNavPvtSVs(const UbxFrame *pFrame);
+
+/** Get the latitude from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the latitude in 10 millionths of a degree.
+ */
+int ubxNavPvtLatitudeX10e7(const UbxFrame *pFrame);
+
+/** Get the longitude from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the longitude in 10 millionths of a degree.
+ */
+int ubxNavPvtLongitudeX10e7(const UbxFrame *pFrame);
+
+/** Get the height above mean sea level from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the height in millimetres.
+ */
+int ubxNavPvtAltitudeMM(const UbxFrame *pFrame);
+
+/** Get the horizontal accuracy estimate from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the horizontal accuracy estimate in millimetres.
+ */
+int ubxNavPvtRadiusMM(const UbxFrame *pFrame);
+
+/** Get the ground speed from a NAV-PVT message.
+ *
+ * @param pFrame a NAV-PVT frame.
+ * @return       the ground speed in millimetres per second.
+ */
+int ubxNavPvtSpeedMMPS(const UbxFrame *pFrame);
+
+/** Determine whether a UBX frame is a NAV-TIMEUTC message.
+ *
+ * @param pFrame the frame.
+ * @return       true if it is.
+ */
+bool ubxIsNavTimeUtc(const UbxFrame *pFrame);
+
+/** Get the UTC time from a NAV-TIMEUTC message.
+ *
+ * @param pFrame a NAV-TIMEUTC frame.
+ * @param pTm    a place to put the time (only tm_year, tm_mon,
+ *               tm_mday, tm_hour, tm_min and tm_sec are filled in),
+ *               may be NULL.
+ * @return       true if the UTC time is valid.
+ */
+bool ubxNavTimeUtc(const UbxFrame *pFrame, struct tm *pTm);
+
+#endif // _EH_UBX_H_
+
+// End Of File
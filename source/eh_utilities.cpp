@@ -113,6 +113,20 @@ int utilitiesBytesToHexString(const char *pInBuf, int lenInBuf, char *pOutBuf, i
     return y;
 }
 
+// Calculate the checksum of the first size bytes of a structure.
+unsigned int utilitiesChecksum(const void *pStruct, unsigned int size)
+{
+    unsigned int checksum = 0;
+    const unsigned char *pByte = (const unsigned char *) pStruct;
+
+    for (unsigned int x = 0; x < size; x++) {
+        checksum = (checksum << 1) + (checksum >> 31) + *pByte;
+        pByte++;
+    }
+
+    return checksum;
+}
+
 // A simple implementation of atoi() for positive numbers only.
 int asciiToInt(const char *pBuf)
 {
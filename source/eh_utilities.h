@@ -47,6 +47,21 @@
  */
 #define AQ_NRG_UNUSED(x) (void)(x)
 
+/** Place a variable in the uninitialised RAM area so that it survives
+ * a reset; goes after the declarator, e.g.:
+ *
+ * static Thingy gThingy NOINIT;
+ */
+#if defined(__CC_ARM) || (defined(__ARMCC_VERSION) && (__ARMCC_VERSION >= 6010050))
+# define NOINIT __attribute__ ((section(".bss.noinit"), zero_init))
+#elif defined(__GNUC__)
+# define NOINIT __attribute__ ((section(".noinit")))
+#elif defined(__ICCARM__)
+# define NOINIT @ ".noinit"
+#else
+# define NOINIT
+#endif
+
 // ----------------------------------------------------------------
 // VARIABLES
 // ----------------------------------------------------------------
@@ -92,6 +107,16 @@ int utilitiesHexStringToBytes(const char *pInBuf, int lenInBuf, char *pOutBuf, i
  */
 int utilitiesBytesToHexString(const char *pInBuf, int lenInBuf, char *pOutBuf, int lenOutBuf);
 
+/** Calculate a simple rotate-and-add checksum over the first
+ * size bytes of a structure, e.g. one kept in NOINIT RAM, where
+ * size would usually be the offsetof() its checksum field.
+ *
+ * @param pStruct pointer to the structure.
+ * @param size    the number of bytes to include.
+ * @return        the checksum.
+ */
+unsigned int utilitiesChecksum(const void *pStruct, unsigned int size);
+
 /** A simple implementation of atoi() for positive, perfectly
  * formed numbers.  Needed in order to avoid using atoi() as
  * that requires some obscure RTX configuration to do with
@@ -2,6 +2,7 @@
 """Extract Infinite-IoT device log records from a Mongo database and decode them"""
 import argparse
 import signal
+from base64 import b64decode
 from datetime import date, datetime, timedelta, tzinfo
 from collections import namedtuple
 from tempfile import NamedTemporaryFile
@@ -124,9 +125,14 @@ class LogDecode():
                             r_list = record["r"]
                             # Go through the list
                             for r_item in r_list:
-                                # See if there's a log segment in it
+                                # See if there's a log segment in it,
+                                # packed or otherwise
+                                log_segment = None
                                 if "log" in r_item:
                                     log_segment = r_item["log"]
+                                elif "lpk" in r_item:
+                                    log_segment = r_item["lpk"]
+                                if log_segment is not None:
                                     if log_record_in_range:
                                         log_segment_count += 1
                                     log_segment_struct = self.get_log_segment(log_segment)
@@ -214,12 +220,44 @@ class LogDecode():
             # Extract the log records
             if "rec" in log_data:
                 log_records = log_data["rec"]
+            elif ("pk" in log_data) and ("ts" in log_data):
+                log_records = self.unpack_log_records(log_data["ts"], log_data["pk"])
 
         return LogSegment(log_application_version,
                           log_client_version,
                           log_index,
                           log_records)
 
+    @staticmethod
+    def unpack_log_records(timestamp, packed):
+        """Unpack base64 log records, as packed by codecPackLogEntry(),
+           into [timestamp, event, parameter] lists"""
+        log_records = []
+        values = []
+        value = 0
+        shift = 0
+        try:
+            packed_bytes = bytearray(b64decode(packed))
+        except (TypeError, ValueError):
+            packed_bytes = bytearray()
+        # Each record is three variable-length integers, seven
+        # bits to a byte, least significant first, the top bit
+        # set on all but the last byte of each
+        for byte in packed_bytes:
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte & 0x80 == 0:
+                values.append(value & 0xFFFFFFFF)
+                value = 0
+                shift = 0
+        for index in range(0, len(values) - 2, 3):
+            # The time is relative to the previous record and the
+            # parameter is zig-zag coded
+            timestamp = (timestamp + values[index + 1]) & 0xFFFFFFFF
+            parameter = (values[index + 2] >> 1) ^ -(values[index + 2] & 1)
+            log_records.append([timestamp, values[index], parameter & 0xFFFFFFFF])
+        return log_records
+
     def log_has_reset(self, log_segment_struct):
         """Determine if the log stream has reset"""
         reset = False;
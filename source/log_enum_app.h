@@ -79,5 +79,21 @@
     EVENT_CELLULAR_OFF_NOW,
     EVENT_CME_ERROR,
     EVENT_MODEM_ENTERED_PSM,
-    EVENT_MODEM_CSCON_STATE
+    EVENT_MODEM_CSCON_STATE,
+    EVENT_REPORT_COST_PER_BYTE_NWH,
+    EVENT_REPORT_DEFERRED,
+    EVENT_MODEM_ENERGY_MEASURED_NWH,
+    EVENT_VOLTAGE_SAMPLER_START_FAILURE,
+    EVENT_V_BAT_OK_MIN_MV,
+    EVENT_HARVEST_ESTIMATE_NW,
+    EVENT_HARVEST_FORECAST_NW,
+    EVENT_ENERGY_BUDGET_NWH,
+    EVENT_WAKE_UP_INTERVAL_SECONDS,
+    EVENT_WARM_START,
+    EVENT_BOOT_TO_FIRST_MEASUREMENT_MS,
+    EVENT_TIME_RESTORED,
+    EVENT_CLOCK_DRIFT_PPM,
+    EVENT_CLOCK_DRIFT_UNCERTAINTY_PPM,
+    EVENT_CLOCK_CORRECTED_SECONDS,
+    EVENT_HEAP_LARGEST_FREE_BLOCK
 
@@ -79,4 +79,20 @@
     "  CELLULAR_OFF_NOW",
     "* CME_ERROR",
     "  MODEM_ENTERED_PSM",
-    "  MODEM_CSCON_STATE"
+    "  MODEM_CSCON_STATE",
+    "  REPORT_COST_PER_BYTE_NWH",
+    "  REPORT_DEFERRED",
+    "  MODEM_ENERGY_MEASURED_NWH",
+    "* VOLTAGE_SAMPLER_START_FAILURE",
+    "  V_BAT_OK_MIN_MV",
+    "  HARVEST_ESTIMATE_NW",
+    "  HARVEST_FORECAST_NW",
+    "  ENERGY_BUDGET_NWH",
+    "  WAKE_UP_INTERVAL_SECONDS",
+    "  WARM_START",
+    "  BOOT_TO_FIRST_MEASUREMENT_MS",
+    "  TIME_RESTORED",
+    "  CLOCK_DRIFT_PPM",
+    "  CLOCK_DRIFT_UNCERTAINTY_PPM",
+    "  CLOCK_CORRECTED_SECONDS",
+    "  HEAP_LARGEST_FREE_BLOCK"
@@ -23,7 +23,7 @@
 #include <compile_time.h>
 #include <eh_utilities.h>
 #include <eh_watchdog.h>
-#include <act_voltages.h> // For voltageIsGood()
+#include <act_voltages.h> // For voltageIsGood() and getVoltages()
 #include <act_energy_source.h> // For enableEnergySource()
 #include <eh_codec.h> // For protocol version
 #include <eh_processor.h>
@@ -31,6 +31,8 @@
 #include <eh_debug.h>
 #include <eh_config.h>
 #include <eh_post.h>
+#include <eh_timeline.h>
+#include <eh_clock.h>
 
 /* This code is intended to run on a UBLOX NINA-B1 module mounted on
  * the tec_eh energy harvesting/sensor board.  It should be built with
@@ -49,14 +51,12 @@
 static EventQueue gWakeUpEventQueue(/* event count */ 10 * EVENTS_EVENT_SIZE);
 
 // The logging buffer, in an uninitialised RAM area
-#if defined(__CC_ARM) || (defined(__ARMCC_VERSION) && (__ARMCC_VERSION >= 6010050))
-__attribute__ ((section(".bss.noinit"), zero_init))
-static char gLoggingBuffer[LOG_STORE_SIZE];
-#elif defined(__GNUC__)
-__attribute__ ((section(".noinit")))
-static char gLoggingBuffer[LOG_STORE_SIZE];
-#elif defined(__ICCARM__)
-static char gLoggingBuffer[LOG_STORE_SIZE] @ ".noinit";
+static char gLoggingBuffer[LOG_STORE_SIZE] NOINIT;
+
+#if TIMELINE_TRACE
+// The timeline store, also in an uninitialised RAM area, as
+// words to keep it aligned
+static int gTimelineStore[TIMELINE_STORE_SIZE / 4] NOINIT;
 #endif
 
 // Buffer to hold the data we collect.
@@ -131,14 +131,26 @@ static void setHwState()
 // cycles before the device is reset.
 static void watchdogCallback()
 {
+    postInvalidate();
+    clockRetain();
     AQ_NRG_LOGX(EVENT_RESTART, RESTART_REASON_WATCHDOG);
     AQ_NRG_LOGX(EVENT_RESTART_TIME, time(NULL));
     AQ_NRG_LOGX(EVENT_RESTART_LINK_REGISTER, (unsigned int) MBED_CALLER_ADDR());
 }
 
+// Handle a timed wake-up and then schedule the next one
+// at the interval chosen by the processor.
+static void timedWakeup(EventQueue *pEventQueue)
+{
+    processorHandleWakeup(pEventQueue);
+    pEventQueue->call_in(processorWakeUpIntervalSeconds() * 1000,
+                         callback(timedWakeup, pEventQueue));
+}
+
 // Our own fatal error hook.
 static void fatalErrorCallback(const mbed_error_ctx *pErrorContext)
 {
+    postInvalidate();
     AQ_NRG_LOGX(EVENT_RESTART, RESTART_REASON_FATAL_ERROR);
     AQ_NRG_LOGX(EVENT_RESTART_TIME, time(NULL));
     AQ_NRG_LOGX(EVENT_RESTART_LINK_REGISTER, (unsigned int) MBED_CALLER_ADDR());
@@ -178,19 +190,37 @@ int main()
     unsigned long long int energyAvailableNWH;
     time_t logSuspendTime;
     DataContents *pDataContents;
+    Voltages voltages;
+    LowPowerTimer bootTimer;
+    bool timeRestored;
+
+    // Time from here to the first measurement, with a
+    // low power timer so as not to keep us out of deep sleep
+    bootTimer.start();
 
-    // No retained real-time clock on this chip so set time to
-    // zero to get it running
-    set_time(0);
+    // No retained real-time clock on this chip so restore the
+    // time if it was retained across a reset, otherwise set
+    // it to zero to get it running
+    timeRestored = clockInit();
 
     // Initialise one-time only stuff
     initWatchdog(WATCHDOG_INTERVAL_SECONDS, watchdogCallback);
     setHwState();
     initLog(gLoggingBuffer);
+    if (timeRestored) {
+        AQ_NRG_LOGX(EVENT_TIME_RESTORED, time(NULL));
+    }
+#if TIMELINE_TRACE
+    // The timeline carries on from before any reset, so
+    // print what led up to this start-up
+    timelineInit((char *) gTimelineStore);
+    timelinePrint();
+#endif
     dataInit(gDataBuffer);
     debugInit(fatalErrorCallback);
     actionInit();
     statisticsInit();
+    postInit();
 
     // Log some fundamentals
     AQ_NRG_LOGX(EVENT_SYSTEM_VERSION, SYSTEM_VERSION_INT);
@@ -220,11 +250,15 @@ int main()
     // for all we know, to drop properly otherwise it can
     // be left in a strange state (it is not connected
     // to the system-wide reset line and has some relatively
-    // large capacitors on its power line)
-    gReset = 0;
-    debugPulseLed(1000);
-    Thread::wait(2000);
-    gReset = 1;
+    // large capacitors on its power line).  None of this
+    // is necessary on a warm start-up, where the hardware
+    // is known to have been left in a good state
+    if (!postIsWarmStart()) {
+        gReset = 0;
+        debugPulseLed(1000);
+        Thread::wait(2000);
+        gReset = 1;
+    }
 
 #if IGNORE_BATTERY_STATE
     voltageFakeIsGood(true);
@@ -232,8 +266,9 @@ int main()
 
     // Wait for there to be enough power to run
     AQ_NRG_LOGX(EVENT_WAITING_ENERGY, 0);
-    AQ_NRG_LOGX(EVENT_V_IN_READING_MV, getVInMV());
-    AQ_NRG_LOGX(EVENT_V_BAT_OK_READING_MV, getVBatOkMV());
+    getVoltages(&voltages);
+    AQ_NRG_LOGX(EVENT_V_IN_READING_MV, voltages.vInMV);
+    AQ_NRG_LOGX(EVENT_V_BAT_OK_READING_MV, voltages.vBatOkMV);
     while (!voltageIsGood()) {
         // Suspend logging so that its timer is off
         suspendLog();
@@ -243,8 +278,9 @@ int main()
         // Resume logging and feed the watchdog
         resumeLog(((unsigned int) (time(NULL) - logSuspendTime)) * 1000000);
         feedWatchdog();
-        AQ_NRG_LOGX(EVENT_V_IN_READING_MV, getVInMV());
-        AQ_NRG_LOGX(EVENT_V_BAT_OK_READING_MV, getVBatOkMV());
+        getVoltages(&voltages);
+        AQ_NRG_LOGX(EVENT_V_IN_READING_MV, voltages.vInMV);
+        AQ_NRG_LOGX(EVENT_V_BAT_OK_READING_MV, voltages.vBatOkMV);
     }
 
     AQ_NRG_LOGX(EVENT_POWER, voltageIsGood() + voltageIsBearable() + voltageIsNotBad());
@@ -256,7 +292,9 @@ int main()
     }
 
     // Second LED pulse to indicate we're go
-    debugPulseLed(1000);
+    if (!postIsWarmStart()) {
+        debugPulseLed(1000);
+    }
 
     // Perform power-on self test, which includes
     // finding out what kind of modem is attached
@@ -264,12 +302,15 @@ int main()
 
         // Initialise the processor
         processorInit();
+        processorSetBootTimer(&bootTimer);
 
-        // Call processor directly to begin with
-        processorHandleWakeup(&gWakeUpEventQueue);
+        // Feed the watchdog from the same queue, so that
+        // it is only fed while wake-ups are being serviced
+        gWakeUpEventQueue.call_every(WATCHDOG_FEED_INTERVAL_SECONDS * 1000, feedWatchdog);
 
-        // Now start the timed callback
-        gWakeUpEventQueue.call_every(WAKEUP_INTERVAL_SECONDS * 1000, callback(processorHandleWakeup, &gWakeUpEventQueue));
+        // Call processor directly to begin with, which
+        // then schedules the timed callbacks that follow
+        timedWakeup(&gWakeUpEventQueue);
         gWakeUpEventQueue.dispatch_forever();
     }
 
@@ -278,6 +319,7 @@ int main()
 
     // Reset and try again after a wait to let PRINTF leave the building
     Thread::wait(1000);
+    clockRetain();
     NVIC_SystemReset();
 }
 
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+"""Convert an Infinite-IoT timeline into Chrome trace/Perfetto JSON"""
+import argparse
+import json
+import re
+from os import path
+from struct import calcsize, unpack_from
+from sys import exit
+
+#  Prompt for informative prints to console
+PROMPT = "TimelineDecode: "
+# The header this script takes the timeline IDs from, by default
+# the one next to this script
+TIMELINE_HEADER = "eh_timeline.h"
+# The header this script takes the action type names from
+ACTION_HEADER = "eh_action.h"
+# The value at the start of a valid timeline store (TIMELINE_MAGIC)
+TIMELINE_MAGIC = 0x54494d31
+# The layout of the header of the timeline store (TimelineHeader)
+TIMELINE_HEADER_FORMAT = "<IIII"
+# The layout of a record in the timeline store (TimelineRecord)
+TIMELINE_RECORD_FORMAT = "<IBBH"
+# The shift of the phase in a record (TIMELINE_PHASE_SHIFT)
+TIMELINE_PHASE_SHIFT = 6
+# The phases (TimelinePhase) as Chrome trace phases
+PHASES = ["B", "E", "i"]
+# The timeline IDs that carry an action type as their parameter
+ACTION_TYPE_IDS = ["ACTION", "ACTION_THREAD_START", "FIRST_MEASUREMENT"]
+# The time the timer is taken to have moved on by across a reset
+RESET_GAP_US = 1000
+
+def read_enum(file_name, prefix):
+    """Read the names of an enum with the given prefix from a header,
+       in order, with the prefix removed"""
+    names = []
+    with open(file_name, "r") as header:
+        for line in header:
+            match = re.match(r"\s*" + prefix + r"(\w+)\s*,", line)
+            if match:
+                names.append(match.group(1))
+    return names
+
+def read_text(file_name):
+    """Read the records, as printed by timelinePrint(), from a log"""
+    records = []
+    with open(file_name, "r") as log:
+        for line in log:
+            match = re.search(r"TIMELINE,(\d+),(\d+),(\d+),(\d+),(-?\d+)", line)
+            if match:
+                records.append([int(x) for x in match.groups()])
+    return records
+
+def read_binary(file_name):
+    """Read the records from a copy of the timeline store, header
+       included, e.g. as dumped with a debugger"""
+    records = []
+    with open(file_name, "rb") as dump:
+        data = dump.read()
+    header_size = calcsize(TIMELINE_HEADER_FORMAT)
+    record_size = calcsize(TIMELINE_RECORD_FORMAT)
+    if len(data) < header_size:
+        return records
+    magic, next_index, num_records, _ = unpack_from(TIMELINE_HEADER_FORMAT, data)
+    capacity = (len(data) - header_size) // record_size
+    if (magic != TIMELINE_MAGIC) or (next_index >= capacity) or \
+       (num_records > capacity):
+        print(PROMPT + "\"" + file_name + "\" does not hold a valid timeline.")
+        return records
+    index = (next_index + capacity - num_records) % capacity
+    for _ in range(num_records):
+        time_us, timeline_id, phase_thread, param = \
+            unpack_from(TIMELINE_RECORD_FORMAT, data, header_size + index * record_size)
+        records.append([time_us, timeline_id, phase_thread >> TIMELINE_PHASE_SHIFT,
+                        phase_thread & ((1 << TIMELINE_PHASE_SHIFT) - 1), param])
+        index = (index + 1) % capacity
+    return records
+
+def convert(records, timeline_names, action_names):
+    """Convert records into Chrome trace events: each start-up becomes
+       a process, so that thread indexes are not confused across a
+       reset, and the 32-bit microsecond time is unwrapped"""
+    events = []
+    boot_name = "BOOT"
+    pid = 0
+    base_us = 0
+    last_raw_us = None
+    last_us = 0
+    for time_us, timeline_id, phase, thread, param in records:
+        name = "ID_" + str(timeline_id)
+        if timeline_id < len(timeline_names):
+            name = timeline_names[timeline_id]
+        if name == boot_name:
+            pid += 1
+            base_us = last_us + RESET_GAP_US - time_us
+        elif (last_raw_us is not None) and (time_us < last_raw_us):
+            base_us += 1 << 32
+        last_raw_us = time_us
+        last_us = time_us + base_us
+        args = {"param": param}
+        if (name in ACTION_TYPE_IDS) and (param < len(action_names)):
+            args["action"] = action_names[param]
+        event = {"name": name, "cat": name.split("_")[0].lower(),
+                 "ph": PHASES[phase] if phase < len(PHASES) else "i",
+                 "ts": last_us, "pid": pid, "tid": thread, "args": args}
+        if event["ph"] == "i":
+            event["s"] = "t"
+        events.append(event)
+    return events
+
+if __name__ == "__main__":
+    PARSER = argparse.ArgumentParser(description="Convert a timeline, as printed " \
+                                     "by timelinePrint() into a console log or " \
+                                     "as a copy of the timeline store, into Chrome " \
+                                     "trace JSON for chrome://tracing or Perfetto.")
+    PARSER.add_argument("input", help="the console log or, with -b, the copy of the " \
+                        "timeline store.")
+    PARSER.add_argument("output", help="the JSON file to write.")
+    PARSER.add_argument("-b", "--binary", action="store_true", help="the input is " \
+                        "a binary copy of the timeline store, e.g. dumped with GDB " \
+                        "using \"dump binary memory <file> gTimelineStore " \
+                        "gTimelineStore+sizeof(gTimelineStore)\".")
+    PARSER.add_argument("-s", "--source", default=path.dirname(path.abspath(__file__)), \
+                        help="the directory containing " + TIMELINE_HEADER + " and " + \
+                        ACTION_HEADER + " (default the directory of this script).")
+    ARGS = PARSER.parse_args()
+
+    TIMELINE_NAMES = read_enum(path.join(ARGS.source, TIMELINE_HEADER), "TIMELINE_ID_")
+    ACTION_NAMES = read_enum(path.join(ARGS.source, ACTION_HEADER), "ACTION_TYPE_")
+    if ARGS.binary:
+        RECORDS = read_binary(ARGS.input)
+    else:
+        RECORDS = read_text(ARGS.input)
+    if not RECORDS:
+        print(PROMPT + "no timeline records found in \"" + ARGS.input + "\".")
+        exit(1)
+    EVENTS = convert(RECORDS, TIMELINE_NAMES, ACTION_NAMES)
+    with open(ARGS.output, "w") as OUTPUT:
+        json.dump({"traceEvents": EVENTS, "displayTimeUnit": "ms"}, OUTPUT)
+    print(PROMPT + str(len(EVENTS)) + " event(s) written to \"" + ARGS.output + "\".")